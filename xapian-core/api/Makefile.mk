@@ -5,6 +5,7 @@ noinst_HEADERS +=\
 	api/emptypostlist.h\
 	api/leafpostlist.h\
 	api/maptermlist.h\
+	api/msetcacheinternal.h\
 	api/omenquireinternal.h\
 	api/postlist.h\
 	api/queryinternal.h\
@@ -20,6 +21,7 @@ EXTRA_DIST +=\
 	api/Makefile
 
 lib_src +=\
+	api/cachestats.cc\
 	api/compactor.cc\
 	api/decvalwtsource.cc\
 	api/documentvaluelist.cc\
@@ -31,6 +33,7 @@ lib_src +=\
 	api/keymaker.cc\
 	api/leafpostlist.cc\
 	api/matchspy.cc\
+	api/msetcache.cc\
 	api/omdatabase.cc\
 	api/omdocument.cc\
 	api/omenquire.cc\
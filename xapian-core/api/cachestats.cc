@@ -0,0 +1,100 @@
+/** @file cachestats.cc
+ * @brief Statistics for the process-wide caches.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "xapian/cachestats.h"
+
+#ifdef XAPIAN_HAS_BRASS_BACKEND
+# include "backends/brass/brass_blockcache.h"
+# include "backends/brass/brass_termfreqcache.h"
+#endif
+#include "debuglog.h"
+#include "queryparser/wildcardcache.h"
+#include "str.h"
+
+using namespace std;
+
+namespace Xapian {
+
+CacheStats::CacheStats(cache_type which)
+    : enabled(false), hits(0), misses(0), size(0), capacity(0)
+{
+    LOGCALL_CTOR(API, "CacheStats", which);
+    switch (which) {
+	case BLOCK_CACHE: {
+#ifdef XAPIAN_HAS_BRASS_BACKEND
+	    const BrassBlockCache * cache = BrassBlockCache::get_instance();
+	    if (cache) {
+		enabled = true;
+		hits = cache->get_hits();
+		misses = cache->get_misses();
+		size = cache->get_used();
+		capacity = cache->get_capacity();
+	    }
+#endif
+	    break;
+	}
+	case TERMFREQ_CACHE: {
+#ifdef XAPIAN_HAS_BRASS_BACKEND
+	    const BrassTermFreqCache * cache =
+		BrassTermFreqCache::get_instance();
+	    if (cache) {
+		enabled = true;
+		hits = cache->get_hits();
+		misses = cache->get_misses();
+		size = cache->get_size();
+		capacity = cache->get_capacity();
+	    }
+#endif
+	    break;
+	}
+	case WILDCARD_CACHE: {
+	    const WildcardCache * cache = WildcardCache::get_instance();
+	    if (cache) {
+		enabled = true;
+		hits = cache->get_hits();
+		misses = cache->get_misses();
+		size = cache->get_size();
+		capacity = cache->get_capacity();
+	    }
+	    break;
+	}
+    }
+}
+
+string
+CacheStats::get_description() const
+{
+    if (!enabled) return "CacheStats(disabled)";
+    string desc = "CacheStats(hits=";
+    desc += str(hits);
+    desc += ", misses=";
+    desc += str(misses);
+    desc += ", size=";
+    desc += str(size);
+    desc += ", capacity=";
+    desc += str(capacity);
+    desc += ')';
+    return desc;
+}
+
+}
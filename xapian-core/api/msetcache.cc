@@ -0,0 +1,213 @@
+/** @file msetcache.cc
+ * @brief Cache of match results
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "msetcacheinternal.h"
+
+#include "debuglog.h"
+#include "omassert.h"
+#include "str.h"
+
+#include <algorithm>
+
+using namespace std;
+
+CachedResults::CachedResults(const Xapian::MSet::Internal & mset,
+			     Xapian::doccount depth_,
+			     Xapian::doccount checked_)
+    : depth(depth_), checked(checked_), items(mset.items),
+      matches_lower_bound(mset.matches_lower_bound),
+      matches_estimated(mset.matches_estimated),
+      matches_upper_bound(mset.matches_upper_bound),
+      uncollapsed_lower_bound(mset.uncollapsed_lower_bound),
+      uncollapsed_estimated(mset.uncollapsed_estimated),
+      uncollapsed_upper_bound(mset.uncollapsed_upper_bound),
+      max_possible(mset.max_possible),
+      max_attained(mset.max_attained),
+      percent_factor(mset.percent_factor)
+{
+    AssertEq(mset.firstitem, 0);
+    if (mset.stats) {
+	stats = *mset.stats;
+	// The database can't be shared with other threads, and MSet doesn't
+	// need it.
+	stats.db = Xapian::Database();
+    }
+}
+
+bool
+CachedResults::covers(Xapian::doccount first, Xapian::doccount maxitems,
+		      Xapian::doccount check_at_least) const
+{
+    AssertRel(check_at_least,>=,maxitems);
+    // If we got fewer results than we asked for, we saw every match, so
+    // can serve any request.
+    if (items.size() < depth) return true;
+    // Compare without adding to first, which could overflow.
+    return maxitems <= depth && first <= depth - maxitems &&
+	   check_at_least <= checked && first <= checked - check_at_least;
+}
+
+Xapian::MSet
+CachedResults::make_mset(Xapian::doccount first,
+			 Xapian::doccount maxitems) const
+{
+    vector<Xapian::Internal::MSetItem> slice;
+    if (first < items.size()) {
+	Xapian::doccount n = min(maxitems, Xapian::doccount(items.size() - first));
+	slice.assign(items.begin() + first, items.begin() + first + n);
+    }
+    Xapian::MSet mset(new Xapian::MSet::Internal(first,
+						 matches_upper_bound,
+						 matches_lower_bound,
+						 matches_estimated,
+						 uncollapsed_upper_bound,
+						 uncollapsed_lower_bound,
+						 uncollapsed_estimated,
+						 max_possible, max_attained,
+						 slice, percent_factor));
+    mset.internal->stats = new Xapian::Weight::Internal(stats);
+    return mset;
+}
+
+bool
+Xapian::MSetCache::Internal::find(const string & key,
+				  Xapian::doccount first,
+				  Xapian::doccount maxitems,
+				  Xapian::doccount check_at_least,
+				  Xapian::MSet & mset)
+{
+    MutexLock lock(mutex);
+    const CachedResults * results = entries.find(key);
+    if (!results || !results->covers(first, maxitems, check_at_least)) {
+	++misses;
+	return false;
+    }
+    ++hits;
+    mset = results->make_mset(first, maxitems);
+    return true;
+}
+
+void
+Xapian::MSetCache::Internal::add(const string & key,
+				 const CachedResults & results)
+{
+    MutexLock lock(mutex);
+    if (max_entries == 0) return;
+    if (entries.contains(key)) {
+	// Replace results which didn't cover a later request.
+	entries.erase(key);
+    } else if (entries.size() >= max_entries) {
+	entries.pop_back();
+    }
+    entries.insert(key, results);
+}
+
+void
+Xapian::MSetCache::Internal::clear()
+{
+    MutexLock lock(mutex);
+    entries.clear();
+}
+
+Xapian::doccount
+Xapian::MSetCache::Internal::size() const
+{
+    MutexLock lock(mutex);
+    return entries.size();
+}
+
+Xapian::doccount
+Xapian::MSetCache::Internal::get_hits() const
+{
+    MutexLock lock(mutex);
+    return hits;
+}
+
+Xapian::doccount
+Xapian::MSetCache::Internal::get_misses() const
+{
+    MutexLock lock(mutex);
+    return misses;
+}
+
+namespace Xapian {
+
+MSetCache::MSetCache(Xapian::doccount max_entries, Xapian::doccount min_depth)
+    : internal(new MSetCache::Internal(max_entries, min_depth))
+{
+    LOGCALL_CTOR(API, "MSetCache", max_entries | min_depth);
+}
+
+MSetCache::MSetCache(const MSetCache & other) : internal(other.internal)
+{
+}
+
+void
+MSetCache::operator=(const MSetCache & other)
+{
+    internal = other.internal;
+}
+
+MSetCache::~MSetCache()
+{
+}
+
+void
+MSetCache::clear()
+{
+    LOGCALL_VOID(API, "Xapian::MSetCache::clear", NO_ARGS);
+    internal->clear();
+}
+
+Xapian::doccount
+MSetCache::size() const
+{
+    return internal->size();
+}
+
+Xapian::doccount
+MSetCache::get_hits() const
+{
+    return internal->get_hits();
+}
+
+Xapian::doccount
+MSetCache::get_misses() const
+{
+    return internal->get_misses();
+}
+
+string
+MSetCache::get_description() const
+{
+    string desc("Xapian::MSetCache(");
+    desc += str(size());
+    desc += " entries, ";
+    desc += str(get_hits());
+    desc += " hits, ";
+    desc += str(get_misses());
+    desc += " misses)";
+    return desc;
+}
+
+}
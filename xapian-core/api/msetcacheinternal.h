@@ -0,0 +1,154 @@
+/** @file msetcacheinternal.h
+ * @brief Internals of Xapian::MSetCache
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_MSETCACHEINTERNAL_H
+#define XAPIAN_INCLUDED_MSETCACHEINTERNAL_H
+
+#include "xapian/enquire.h"
+
+#include "lrucache.h"
+#include "mutexlock.h"
+#include "api/omenquireinternal.h"
+#include "weight/weightinternal.h"
+
+#include <string>
+#include <vector>
+
+/** The results of a search, as stored in an MSetCache.
+ *
+ *  These don't reference any Xapian objects (which can't be shared between
+ *  threads) - in particular, the term statistics don't have a database set.
+ */
+struct CachedResults {
+    /// The number of results which were asked for.
+    Xapian::doccount depth;
+
+    /// The check_at_least value which was used.
+    Xapian::doccount checked;
+
+    /// The results, starting from the first.
+    std::vector<Xapian::Internal::MSetItem> items;
+
+    Xapian::doccount matches_lower_bound;
+
+    Xapian::doccount matches_estimated;
+
+    Xapian::doccount matches_upper_bound;
+
+    Xapian::doccount uncollapsed_lower_bound;
+
+    Xapian::doccount uncollapsed_estimated;
+
+    Xapian::doccount uncollapsed_upper_bound;
+
+    double max_possible;
+
+    double max_attained;
+
+    double percent_factor;
+
+    /// The statistics for the terms in the query.
+    Xapian::Weight::Internal stats;
+
+    /** Take the results from @a mset.
+     *
+     *  @param mset	The results of a match starting from the first result.
+     *  @param depth_	The number of results asked for.
+     *  @param checked_	The check_at_least value used.
+     */
+    CachedResults(const Xapian::MSet::Internal & mset,
+		  Xapian::doccount depth_, Xapian::doccount checked_);
+
+    /** Can these results be used for a search?
+     *
+     *  @param first		The index of the first result wanted.
+     *  @param maxitems		The maximum number of results wanted.
+     *  @param check_at_least	The number of results to check (which must
+     *				be at least maxitems).
+     */
+    bool covers(Xapian::doccount first, Xapian::doccount maxitems,
+		Xapian::doccount check_at_least) const;
+
+    /// Make an MSet containing results [first, first + maxitems).
+    Xapian::MSet make_mset(Xapian::doccount first,
+			   Xapian::doccount maxitems) const;
+};
+
+class Xapian::MSetCache::Internal : public Xapian::Internal::intrusive_base {
+    /// Don't allow copying.
+    Internal(const Internal &);
+
+    /// Don't allow assignment.
+    void operator=(const Internal &);
+
+    /// Map from the key identifying a search to its results.
+    LRUCache<std::string, CachedResults> entries;
+
+    /// The maximum number of entries.
+    Xapian::doccount max_entries;
+
+    /// The minimum number of results to calculate for each search.
+    Xapian::doccount min_depth;
+
+    /// Number of successful lookups.
+    Xapian::doccount hits;
+
+    /// Number of unsuccessful lookups.
+    Xapian::doccount misses;
+
+    /// Protects all the above.
+    mutable Mutex mutex;
+
+  public:
+    Internal(Xapian::doccount max_entries_, Xapian::doccount min_depth_)
+	: max_entries(max_entries_), min_depth(min_depth_),
+	  hits(0), misses(0) { }
+
+    Xapian::doccount get_min_depth() const { return min_depth; }
+
+    /** Look up the results of a search.
+     *
+     *  @param key		Key identifying the search.
+     *  @param first		The index of the first result wanted.
+     *  @param maxitems		The maximum number of results wanted.
+     *  @param check_at_least	The number of results to check (which must
+     *				be at least maxitems).
+     *  @param[out] mset	Set to the results if they're found.
+     *
+     *  @return true if the results were found.
+     */
+    bool find(const std::string & key,
+	      Xapian::doccount first, Xapian::doccount maxitems,
+	      Xapian::doccount check_at_least, Xapian::MSet & mset);
+
+    /// Add the results of a search.
+    void add(const std::string & key, const CachedResults & results);
+
+    void clear();
+
+    Xapian::doccount size() const;
+
+    Xapian::doccount get_hits() const;
+
+    Xapian::doccount get_misses() const;
+};
+
+#endif // XAPIAN_INCLUDED_MSETCACHEINTERNAL_H
@@ -42,6 +42,7 @@
 #include "editdistance.h"
 #include "expand/ortermlist.h"
 #include "noreturn.h"
+#include "pack.h"
 
 #include <algorithm>
 #include <cstdlib> // For abs().
@@ -748,6 +749,20 @@ Database::get_uuid() const
     RETURN(uuid);
 }
 
+std::string
+Database::get_revision_key() const
+{
+    LOGCALL(API, std::string, "Database::get_revision_key", NO_ARGS);
+    string key;
+    for (size_t i = 0; i < internal.size(); ++i) {
+	string sub_key = internal[i]->get_revision_key();
+	if (sub_key.empty())
+	    RETURN(sub_key);
+	pack_string(key, sub_key);
+    }
+    RETURN(key);
+}
+
 ///////////////////////////////////////////////////////////////////////////
 
 WritableDatabase::WritableDatabase() : Database()
@@ -790,6 +805,19 @@ WritableDatabase::commit()
 	internal[i]->commit();
 }
 
+size_t
+WritableDatabase::get_memory_used() const
+{
+    LOGCALL(API, size_t, "WritableDatabase::get_memory_used", NO_ARGS);
+    size_t n_dbs = internal.size();
+    if (rare(n_dbs == 0))
+	no_subdatabases();
+    size_t total = 0;
+    for (size_t i = 0; i != n_dbs; ++i)
+	total += internal[i]->get_memory_used();
+    RETURN(total);
+}
+
 void
 WritableDatabase::begin_transaction(bool flushed)
 {
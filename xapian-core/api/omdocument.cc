@@ -43,6 +43,8 @@ using namespace std;
 
 namespace Xapian {
 
+DataSink::~DataSink() { }
+
 // implementation of Document
 
 Document::Document(Document::Internal *internal_) : internal(internal_)
@@ -67,6 +69,13 @@ Document::get_data() const
     RETURN(internal->get_data());
 }
 
+void
+Document::get_data(DataSink & sink) const
+{
+    LOGCALL_VOID(API, "Document::get_data", Literal("sink"));
+    internal->get_data(sink);
+}
+
 void
 Document::set_data(const string &data)
 {
@@ -289,6 +298,25 @@ Xapian::Document::Internal::get_data() const
     return do_get_data();
 }
 
+void
+Xapian::Document::Internal::get_data(Xapian::DataSink & sink) const
+{
+    LOGCALL_VOID(DB, "Xapian::Document::Internal::get_data", Literal("sink"));
+    if (data_here) {
+	if (!data.empty()) sink.append(data.data(), data.size());
+	return;
+    }
+    if (!database.get()) return;
+    do_stream_data(sink);
+}
+
+void
+Xapian::Document::Internal::do_stream_data(Xapian::DataSink & sink) const
+{
+    string d = do_get_data();
+    if (!d.empty()) sink.append(d.data(), d.size());
+}
+
 void
 Xapian::Document::Internal::set_data(const string &data_)
 {
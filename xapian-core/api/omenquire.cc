@@ -38,9 +38,13 @@
 #include "debuglog.h"
 #include "expand/esetinternal.h"
 #include "expand/expandweight.h"
+#include "matcher/matchprofile.h"
 #include "matcher/multimatch.h"
 #include "omassert.h"
+#include "api/msetcacheinternal.h"
 #include "api/omenquireinternal.h"
+#include "net/length.h"
+#include "serialise-double.h"
 #include "str.h"
 #include "weight/weightinternal.h"
 
@@ -638,7 +642,9 @@ Enquire::Internal::Internal(const Database &db_, ErrorHandler * errorhandler_)
   : db(db_), query(), collapse_key(Xapian::BAD_VALUENO), collapse_max(0),
     order(Enquire::ASCENDING), percent_cutoff(0), weight_cutoff(0),
     sort_key(Xapian::BAD_VALUENO), sort_by(REL), sort_value_forward(true),
-    sorter(0), time_limit(0.0), errorhandler(errorhandler_), weight(0),
+    sorter(0), time_limit(0.0), parallelism(1), profiling(false),
+    mset_cache(NULL), errorhandler(errorhandler_),
+    weight(0),
     eweightname("trad"), expand_k(1.0)
 {
     if (db.internal.empty()) {
@@ -681,43 +687,124 @@ Enquire::Internal::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
     }
 
     Xapian::doccount first_orig = first;
-    {
-	Xapian::doccount docs = db.get_doccount();
-	first = min(first, docs);
-	maxitems = min(maxitems, docs);
-	check_at_least = min(check_at_least, docs);
-	check_at_least = max(check_at_least, maxitems);
+    Xapian::doccount docs = db.get_doccount();
+    first = min(first, docs);
+    maxitems = min(maxitems, docs);
+    check_at_least = min(check_at_least, docs);
+    check_at_least = max(check_at_least, maxitems);
+
+    string cache_key;
+    if (mset_cache) cache_key = get_mset_cache_key(rset, mdecider);
+
+    MSet retval;
+    if (cache_key.empty()) {
+	retval = run_match(first, maxitems, check_at_least, rset, mdecider);
+    } else if (!mset_cache->internal->find(cache_key, first, maxitems,
+					   check_at_least, retval)) {
+	// Calculate enough results to serve later pages from the cache too.
+	// The values are all <= docs, so "docs - x" can't overflow.
+	Xapian::doccount depth = mset_cache->internal->get_min_depth();
+	depth = max(depth, (first > docs - maxitems ? docs : first + maxitems));
+	depth = min(depth, docs);
+	Xapian::doccount checked =
+	    (first > docs - check_at_least ? docs : first + check_at_least);
+	checked = max(checked, depth);
+	MSet full = run_match(0, depth, checked, rset, mdecider);
+	CachedResults results(*full.internal, depth, checked);
+	mset_cache->internal->add(cache_key, results);
+	retval = results.make_mset(first, maxitems);
+    }
+
+    if (first_orig != first && retval.internal.get()) {
+	retval.internal->firstitem = first_orig;
     }
 
+    Assert(weight->name() != "bool" || retval.get_max_possible() == 0);
+
+    // The Xapian::MSet needs to have a pointer to ourselves, so that it can
+    // retrieve the documents.  This is set here explicitly to avoid having
+    // to pass it into the matcher, which gets messy particularly in the
+    // networked case.
+    retval.internal->enquire = this;
+
+    return retval;
+}
+
+MSet
+Enquire::Internal::run_match(Xapian::doccount first, Xapian::doccount maxitems,
+			     Xapian::doccount check_at_least, const RSet *rset,
+			     const MatchDecider *mdecider) const
+{
+    LOGCALL(MATCH, MSet, "Enquire::Internal::run_match", first | maxitems | check_at_least | rset | mdecider);
+
     AutoPtr<Xapian::Weight::Internal> stats(new Xapian::Weight::Internal);
+    AutoPtr<MatchProfile> match_profile(profiling ? new MatchProfile : NULL);
     ::MultiMatch match(db, query, qlen, rset,
 		       collapse_max, collapse_key,
 		       percent_cutoff, weight_cutoff,
 		       order, sort_key, sort_by, sort_value_forward,
 		       time_limit, errorhandler, *(stats.get()), weight, spies,
 		       (sorter != NULL),
-		       (mdecider != NULL));
+		       (mdecider != NULL), parallelism, match_profile.get());
     // Run query and put results into supplied Xapian::MSet object.
     MSet retval;
+    profile.resize(0);
     match.get_mset(first, maxitems, check_at_least, retval,
 		   *(stats.get()), mdecider, sorter);
-    if (first_orig != first && retval.internal.get()) {
-	retval.internal->firstitem = first_orig;
+    if (match_profile.get()) profile = match_profile->get_description();
+
+    if (!retval.internal->stats) {
+	retval.internal->stats = stats.release();
     }
 
-    Assert(weight->name() != "bool" || retval.get_max_possible() == 0);
+    RETURN(retval);
+}
 
-    // The Xapian::MSet needs to have a pointer to ourselves, so that it can
-    // retrieve the documents.  This is set here explicitly to avoid having
-    // to pass it into the matcher, which gets messy particularly in the
-    // networked case.
-    retval.internal->enquire = this;
+string
+Enquire::Internal::get_mset_cache_key(const RSet *rset,
+				      const MatchDecider *mdecider) const
+{
+    // We can't tell if the results would be the same with any of these, and
+    // profiling needs the match to actually run.
+    if (mdecider || sorter || !spies.empty() || time_limit > 0.0 ||
+	(rset && !rset->empty()) || profiling) {
+	return string();
+    }
 
-    if (!retval.internal->stats) {
-	retval.internal->stats = stats.release();
+    string key;
+    // Results are only valid for the revisions of the databases they were
+    // calculated from.
+    string revision_key = db.get_revision_key();
+    if (revision_key.empty()) return string();
+    key += encode_length(revision_key.size());
+    key += revision_key;
+
+    string wt_name = weight->name();
+    if (wt_name.empty()) return string();
+    try {
+	string serialised = query.serialise();
+	key += encode_length(serialised.size());
+	key += serialised;
+	serialised = weight->serialise();
+	key += encode_length(serialised.size());
+	key += serialised;
+    } catch (const Xapian::UnimplementedError &) {
+	// A PostingSource or Weight subclass which can't be serialised.
+	return string();
     }
+    key += encode_length(wt_name.size());
+    key += wt_name;
 
-    return retval;
+    key += encode_length(qlen);
+    key += encode_length(collapse_key);
+    key += encode_length(collapse_max);
+    key += char(order);
+    key += encode_length(percent_cutoff);
+    key += serialise_double(weight_cutoff);
+    key += encode_length(sort_key);
+    key += char(sort_by);
+    key += char(sort_value_forward);
+    return key;
 }
 
 ESet
@@ -1059,6 +1146,30 @@ Enquire::set_time_limit(double time_limit)
     internal->time_limit = time_limit;
 }
 
+void
+Enquire::set_parallelism(unsigned n)
+{
+    internal->parallelism = n;
+}
+
+void
+Enquire::set_profiling(bool enabled)
+{
+    internal->profiling = enabled;
+}
+
+void
+Enquire::set_mset_cache(Xapian::MSetCache * cache)
+{
+    internal->mset_cache = cache;
+}
+
+string
+Enquire::get_profile() const
+{
+    return internal->profile;
+}
+
 MSet
 Enquire::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 		  Xapian::doccount check_at_least, const RSet *rset,
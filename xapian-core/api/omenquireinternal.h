@@ -153,6 +153,18 @@ class Enquire::Internal : public Xapian::Internal::intrusive_base {
 
 	double time_limit;
 
+	/// The maximum number of threads to use for the match.
+	unsigned parallelism;
+
+	/// Should we profile the match?
+	bool profiling;
+
+	/// The profile of the most recent match (if profiled).
+	mutable std::string profile;
+
+	/// The cache to use for match results, or NULL not to use one.
+	MSetCache * mset_cache;
+
 	/** The error handler, if set.  (0 if not set).
 	 */
 	ErrorHandler * errorhandler;
@@ -175,6 +187,24 @@ class Enquire::Internal : public Xapian::Internal::intrusive_base {
 	Internal(const Xapian::Database &databases, ErrorHandler * errorhandler_);
 	~Internal();
 
+	/** Run the match.
+	 *
+	 *  Parameters are as for get_mset(), except that they must have been
+	 *  clamped to the size of the database.
+	 */
+	MSet run_match(Xapian::doccount first, Xapian::doccount maxitems,
+		       Xapian::doccount check_at_least,
+		       const RSet *omrset,
+		       const MatchDecider *mdecider) const;
+
+	/** Get the key to use for the current search in mset_cache.
+	 *
+	 *  @return The key, or an empty string if the results of the search
+	 *	    can't be cached.
+	 */
+	std::string get_mset_cache_key(const RSet *omrset,
+				       const MatchDecider *mdecider) const;
+
 	/** Request a document from the database.
 	 */
 	void request_doc(const Xapian::Internal::MSetItem &item) const;
@@ -52,6 +52,19 @@ PostingIterator::Internal::get_collapse_key() const
     return NULL;
 }
 
+const string *
+PostingIterator::Internal::get_sort_key() const
+{
+    return NULL;
+}
+
+double
+PostList::get_block_maxweight(Xapian::docid & last) const
+{
+    last = Xapian::docid(-1);
+    return get_maxweight();
+}
+
 PositionList *
 PostList::read_position_list()
 {
@@ -78,4 +91,11 @@ PostList::count_matching_subqs() const
     return 0;
 }
 
+void
+PostList::get_read_counts(totlen_t & postings, totlen_t & chunks,
+			  totlen_t & blocks) const
+{
+    postings = chunks = blocks = 0;
+}
+
 }
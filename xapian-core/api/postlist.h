@@ -74,6 +74,17 @@ class Xapian::PostingIterator::Internal : public Xapian::Internal::intrusive_bas
     /// Return an upper bound on what get_weight() can return.
     virtual double get_maxweight() const = 0;
 
+    /** Return an upper bound on get_weight() for a run of documents.
+     *
+     *  The bound applies to the documents from the current position up to
+     *  and including docid @a last, which this method sets.  It must only be
+     *  called when the postlist is positioned on a document.
+     *
+     *  The default implementation sets @a last to the largest possible docid
+     *  and returns get_maxweight().
+     */
+    virtual double get_block_maxweight(Xapian::docid & last) const;
+
     /// Return the current docid.
     virtual Xapian::docid get_docid() const = 0;
 
@@ -100,6 +111,14 @@ class Xapian::PostingIterator::Internal : public Xapian::Internal::intrusive_bas
      */
     virtual const std::string * get_collapse_key() const;
 
+    /** If the sort key is already known, return it.
+     *
+     *  This is implemented by MSetPostList (and MergePostList).  Other
+     *  subclasses rely on the default implementation which just returns
+     *  NULL.
+     */
+    virtual const std::string * get_sort_key() const;
+
     /// Return true if the current position is past the last entry in this list.
     virtual bool at_end() const = 0;
 
@@ -194,6 +213,21 @@ class Xapian::PostingIterator::Internal : public Xapian::Internal::intrusive_bas
     /// Count the number of leaf subqueries which match at the current position.
     virtual Xapian::termcount count_matching_subqs() const;
 
+    /** Get counts of the work done reading this postlist so far.
+     *
+     *  This is used for profiling.  The default implementation reports
+     *  zero for each count.
+     *
+     *  @param[out] postings	The number of postings decoded.
+     *  @param[out] chunks	The number of chunks of postings read.
+     *  @param[out] blocks	The number of blocks loaded from the table.  This
+     *				may include blocks loaded for other postlists
+     *				from the same table, so only the change in
+     *				this count across a call is meaningful.
+     */
+    virtual void get_read_counts(totlen_t & postings, totlen_t & chunks,
+				 totlen_t & blocks) const;
+
     /// Return a string description of this object.
     virtual std::string get_description() const = 0;
 };
@@ -35,6 +35,7 @@
 #include "matcher/externalpostlist.h"
 #include "matcher/maxpostlist.h"
 #include "matcher/multiandpostlist.h"
+#include "matcher/multiorpostlist.h"
 #include "matcher/multixorpostlist.h"
 #include "matcher/orpostlist.h"
 #include "matcher/phrasepostlist.h"
@@ -53,6 +54,7 @@
 #include <algorithm>
 #include <functional>
 #include <list>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -184,39 +186,32 @@ OrContext::postlist(QueryOptimiser* qopt)
 	return pl;
     }
 
-    // Make postlists into a heap so that the postlist with the greatest term
-    // frequency is at the top of the heap.
-    make_heap(pls.begin(), pls.end(), ComparePostListTermFreqAscending());
-
-    // Now build a tree of binary OrPostList objects.
-    //
-    // The algorithm used to build the tree is like that used to build an
-    // optimal Huffman coding tree.  If we called next() repeatedly, this
-    // arrangement would minimise the number of method calls.  Generally we
-    // don't actually do that, but this arrangement is still likely to be a
-    // good one, and it does minimise the work in the worst case.
-    while (true) {
-	// We build the tree such that at each branch:
-	//
-	//   l.get_termfreq_est() >= r.get_termfreq_est()
-	//
-	// We do this so that the OrPostList class can be optimised assuming
-	// that this is the case.
-	PostList * r = pls.front();
-	pop_heap(pls.begin(), pls.end(), ComparePostListTermFreqAscending());
-	pls.pop_back();
+    if (pls.size() > 2) {
+	// For more than two subqueries, use an n-way OR which can skip
+	// documents which only match subqueries whose maximum weights sum to
+	// less than the minimum weight required.
 	PostList * pl;
-	pl = new OrPostList(pls.front(), r, qopt->matcher, qopt->db_size);
-
-	if (pls.size() == 1) {
-	    pls.clear();
-	    return pl;
-	}
-
-	pop_heap(pls.begin(), pls.end(), ComparePostListTermFreqAscending());
-	pls.back() = pl;
-	push_heap(pls.begin(), pls.end(), ComparePostListTermFreqAscending());
+	pl = new MultiOrPostList(pls.begin(), pls.end(),
+				 qopt->matcher, qopt->db_size);
+	if (qopt->profiling())
+	    pl = qopt->profile_postlist(pl, "OR", pls);
+	pls.clear();
+	return pl;
     }
+
+    // Build a binary OrPostList with the more frequent postlist on the
+    // left, since the OrPostList class is optimised assuming that:
+    //
+    //   l.get_termfreq_est() >= r.get_termfreq_est()
+    PostList * l = pls[0];
+    PostList * r = pls[1];
+    if (l->get_termfreq_est() < r->get_termfreq_est())
+	swap(l, r);
+    PostList * pl = new OrPostList(l, r, qopt->matcher, qopt->db_size);
+    if (qopt->profiling())
+	pl = qopt->profile_postlist(pl, "OR", pls);
+    pls.clear();
+    return pl;
 }
 
 PostList *
@@ -236,6 +231,8 @@ OrContext::postlist_max(QueryOptimiser* qopt)
 
     PostList * pl;
     pl = new MaxPostList(pls.begin(), pls.end(), qopt->matcher, qopt->db_size);
+    if (qopt->profiling())
+	pl = qopt->profile_postlist(pl, "MAX", pls);
 
     pls.clear();
     return pl;
@@ -254,6 +251,8 @@ XorContext::postlist(QueryOptimiser* qopt)
     Xapian::doccount db_size = qopt->db_size;
     PostList * pl;
     pl = new MultiXorPostList(pls.begin(), pls.end(), qopt->matcher, db_size);
+    if (qopt->profiling())
+	pl = qopt->profile_postlist(pl, "XOR", pls);
 
     // Empty pls so our destructor doesn't delete them all!
     pls.clear();
@@ -275,6 +274,8 @@ class AndContext : public Context {
 	    : op_(op__), begin(begin_), end(end_), window(window_) { }
 
 	PostList * postlist(PostList * pl, const vector<PostList*>& pls) const;
+
+	Xapian::Query::op get_op() const { return op_; }
     };
 
     list<PosFilter> pos_filters;
@@ -325,6 +326,8 @@ AndContext::postlist(QueryOptimiser* qopt)
 {
     AutoPtr<PostList> pl(new MultiAndPostList(pls.begin(), pls.end(),
 					      qopt->matcher, qopt->db_size));
+    if (qopt->profiling())
+	pl.reset(qopt->profile_postlist(pl.release(), "AND", pls));
 
     // Sort the positional filters to try to apply them in an efficient order.
     // FIXME: We need to figure out what that is!  Try applying lowest cf/tf
@@ -335,6 +338,12 @@ AndContext::postlist(QueryOptimiser* qopt)
     for (i = pos_filters.begin(); i != pos_filters.end(); ++i) {
 	const PosFilter & filter = *i;
 	pl.reset(filter.postlist(pl.release(), pls));
+	if (qopt->profiling()) {
+	    PostList * child = pl.get();
+	    const char * label =
+		filter.get_op() == Query::OP_NEAR ? "NEAR" : "PHRASE";
+	    pl.reset(qopt->profile_postlist(pl.release(), label, child));
+	}
     }
 
     // Empty pls so our destructor doesn't delete them all!
@@ -647,7 +656,10 @@ QueryTerm::postlist(QueryOptimiser * qopt, double factor) const
     LOGCALL(QUERY, PostingIterator::Internal *, "QueryTerm::postlist", qopt | factor);
     if (factor != 0.0)
 	qopt->inc_total_subqs();
-    RETURN(qopt->open_post_list(term, wqf, factor));
+    PostList * pl = qopt->open_post_list(term, wqf, factor);
+    if (qopt->profiling())
+	pl = qopt->profile_postlist(pl, get_description());
+    RETURN(pl);
 }
 
 PostingIterator::Internal *
@@ -658,7 +670,11 @@ QueryPostingSource::postlist(QueryOptimiser * qopt, double factor) const
     if (factor != 0.0)
 	qopt->inc_total_subqs();
     Xapian::Database wrappeddb(new ConstDatabaseWrapper(&(qopt->db)));
-    RETURN(new ExternalPostList(wrappeddb, source, factor, qopt->matcher));
+    PostList * pl = new ExternalPostList(wrappeddb, source, factor,
+					 qopt->matcher);
+    if (qopt->profiling())
+	pl = qopt->profile_postlist(pl, get_description());
+    RETURN(pl);
 }
 
 PostingIterator::Internal *
@@ -691,7 +707,10 @@ QueryValueRange::postlist(QueryOptimiser *qopt, double factor) const
     if (!lb.empty() && (end < lb || begin > db.get_value_upper_bound(slot))) {
 	RETURN(new EmptyPostList);
     }
-    RETURN(new ValueRangePostList(&db, slot, begin, end));
+    PostList * pl = new ValueRangePostList(&db, slot, begin, end);
+    if (qopt->profiling())
+	pl = qopt->profile_postlist(pl, get_description());
+    RETURN(pl);
 }
 
 void
@@ -737,7 +756,10 @@ QueryValueLE::postlist(QueryOptimiser *qopt, double factor) const
     if (limit < db.get_value_lower_bound(slot)) {
 	RETURN(new EmptyPostList);
     }
-    RETURN(new ValueRangePostList(&db, slot, string(), limit));
+    PostList * pl = new ValueRangePostList(&db, slot, string(), limit);
+    if (qopt->profiling())
+	pl = qopt->profile_postlist(pl, get_description());
+    RETURN(pl);
 }
 
 void
@@ -783,7 +805,10 @@ QueryValueGE::postlist(QueryOptimiser *qopt, double factor) const
     if (!lb.empty() && limit > db.get_value_upper_bound(slot)) {
 	RETURN(new EmptyPostList);
     }
-    RETURN(new ValueGePostList(&db, slot, limit));
+    PostList * pl = new ValueGePostList(&db, slot, limit);
+    if (qopt->profiling())
+	pl = qopt->profile_postlist(pl, get_description());
+    RETURN(pl);
 }
 
 void
@@ -964,7 +989,10 @@ QueryBranch::do_synonym(QueryOptimiser * qopt, double factor) const
 
     // We build an OP_OR tree for OP_SYNONYM and then wrap it in a
     // SynonymPostList, which supplies the weights.
-    RETURN(qopt->make_synonym_postlist(pl, factor));
+    PostList * syn_pl = qopt->make_synonym_postlist(pl, factor);
+    if (qopt->profiling())
+	syn_pl = qopt->profile_postlist(syn_pl, "SYNONYM", pl);
+    RETURN(syn_pl);
 }
 
 PostList *
@@ -1268,8 +1296,16 @@ QueryAndNot::postlist(QueryOptimiser * qopt, double factor) const
     OrContext ctx(subqueries.size() - 1);
     do_or_like(ctx, qopt, 0.0, 0, 1);
     AutoPtr<PostList> r(ctx.postlist(qopt));
-    RETURN(new AndNotPostList(l.release(), r.release(),
-			      qopt->matcher, qopt->db_size));
+    vector<PostList *> children;
+    if (qopt->profiling()) {
+	children.push_back(l.get());
+	children.push_back(r.get());
+    }
+    PostList * pl = new AndNotPostList(l.release(), r.release(),
+				       qopt->matcher, qopt->db_size);
+    if (qopt->profiling())
+	pl = qopt->profile_postlist(pl, "AND_NOT", children);
+    RETURN(pl);
 }
 
 PostingIterator::Internal *
@@ -1301,8 +1337,16 @@ QueryAndMaybe::postlist(QueryOptimiser * qopt, double factor) const
     OrContext ctx(subqueries.size() - 1);
     do_or_like(ctx, qopt, factor, 0, 1);
     AutoPtr<PostList> r(ctx.postlist(qopt));
-    RETURN(new AndMaybePostList(l.release(), r.release(),
-				qopt->matcher, qopt->db_size));
+    vector<PostList *> children;
+    if (qopt->profiling()) {
+	children.push_back(l.get());
+	children.push_back(r.get());
+    }
+    PostList * pl = new AndMaybePostList(l.release(), r.release(),
+					 qopt->matcher, qopt->db_size);
+    if (qopt->profiling())
+	pl = qopt->profile_postlist(pl, "AND_MAYBE", children);
+    RETURN(pl);
 }
 
 PostingIterator::Internal *
@@ -1315,7 +1359,12 @@ QueryFilter::postlist(QueryOptimiser * qopt, double factor) const
     AutoPtr<PostList> l(subqueries[0].internal->postlist(qopt, factor));
     pls[1] = subqueries[1].internal->postlist(qopt, 0.0);
     pls[0] = l.release();
-    RETURN(new MultiAndPostList(pls, pls + 2, qopt->matcher, qopt->db_size));
+    PostList * pl = new MultiAndPostList(pls, pls + 2,
+					 qopt->matcher, qopt->db_size);
+    if (qopt->profiling())
+	pl = qopt->profile_postlist(pl, "FILTER",
+				    vector<PostList *>(pls, pls + 2));
+    RETURN(pl);
 }
 
 void
@@ -1336,6 +1385,40 @@ QueryWindowed::postlist_windowed(Query::op op, AndContext& ctx, QueryOptimiser *
 {
     // FIXME: should has_positions() be on the combined DB (not this sub)?
     if (qopt->db.has_positions()) {
+	// A document indexed with biwords for a field can only match an exact
+	// phrase in that field if it has the biword for each adjacent pair of
+	// terms, so we can filter on those.  For a two term phrase, that's
+	// enough to prove the match so we don't need to check positions.
+	//
+	// The biwords are grouped by field prefix.
+	map<string, vector<string> > biwords;
+	size_t n_biwords = 0;
+	if (op == Query::OP_PHRASE && window == subqueries.size()) {
+	    QueryVector::const_iterator i = subqueries.begin();
+	    while (true) {
+		if ((*i).internal->get_type() != Query::LEAF_TERM) break;
+		const QueryTerm * t = static_cast<QueryTerm*>((*i).internal.get());
+		if (++i == subqueries.end()) break;
+		if ((*i).internal->get_type() != Query::LEAF_TERM) break;
+		const QueryTerm * t2 = static_cast<QueryTerm*>((*i).internal.get());
+		const string & term = t->get_term();
+		const string & term2 = t2->get_term();
+		string::size_type n = biword_prefix_length(term);
+		if (n != biword_prefix_length(term2) ||
+		    term.compare(0, n, term2, 0, n) != 0 ||
+		    qopt->get_biword_freq(term.substr(0, n)) == 0) {
+		    continue;
+		}
+		const string & biword = make_biword(term, term2);
+		if (!biword.empty()) {
+		    biwords[term.substr(0, n)].push_back(biword);
+		    ++n_biwords;
+		}
+	    }
+	}
+
+	bool old_need_positions = qopt->need_positions;
+	qopt->need_positions = true;
 	QueryVector::const_iterator i;
 	for (i = subqueries.begin(); i != subqueries.end(); ++i) {
 	    // MatchNothing subqueries should have been removed by done().
@@ -1343,8 +1426,61 @@ QueryWindowed::postlist_windowed(Query::op op, AndContext& ctx, QueryOptimiser *
 	    // FIXME: postlist_sub_positional?
 	    ctx.add_postlist((*i).internal->postlist(qopt, factor));
 	}
-	// Record the positional filter to apply higher up the tree.
-	ctx.add_pos_filter(op, subqueries.size(), window);
+	qopt->need_positions = old_need_positions;
+	bool proved = (subqueries.size() == 2 && n_biwords == 1);
+	if (!proved) {
+	    // Record the positional filter to apply higher up the tree.
+	    ctx.add_pos_filter(op, subqueries.size(), window);
+	}
+
+	map<string, vector<string> >::const_iterator p;
+	for (p = biwords.begin(); p != biwords.end(); ++p) {
+	    const vector<string> & pairs = p->second;
+	    vector<string>::const_iterator b;
+	    if (qopt->get_biword_freq(p->first) == qopt->db_size) {
+		for (b = pairs.begin(); b != pairs.end(); ++b) {
+		    ctx.add_postlist(QueryTerm(*b, 1, 0).postlist(qopt, 0.0));
+		}
+		continue;
+	    }
+
+	    // Only some documents have biwords for this field, so filter on
+	    // the biwords OR not having the marker.  If the biword proves the
+	    // phrase, we still need to check positions for documents without
+	    // the marker.
+	    OrContext either(2);
+	    if (pairs.size() == 1) {
+		either.add_postlist(QueryTerm(pairs[0], 1, 0).postlist(qopt, 0.0));
+	    } else {
+		AndContext with(pairs.size());
+		for (b = pairs.begin(); b != pairs.end(); ++b) {
+		    with.add_postlist(QueryTerm(*b, 1, 0).postlist(qopt, 0.0));
+		}
+		either.add_postlist(with.postlist(qopt));
+	    }
+
+	    AndContext without(subqueries.size());
+	    qopt->need_positions = proved;
+	    for (i = subqueries.begin(); i != subqueries.end(); ++i) {
+		without.add_postlist((*i).internal->postlist(qopt, 0.0));
+	    }
+	    qopt->need_positions = old_need_positions;
+	    if (proved) without.add_pos_filter(op, subqueries.size(), window);
+	    AutoPtr<PostList> l(without.postlist(qopt));
+	    const string & marker = biword_marker(p->first);
+	    AutoPtr<PostList> r(QueryTerm(marker, 1, 0).postlist(qopt, 0.0));
+	    vector<PostList *> children;
+	    if (qopt->profiling()) {
+		children.push_back(l.get());
+		children.push_back(r.get());
+	    }
+	    PostList * pl = new AndNotPostList(l.release(), r.release(),
+					       qopt->matcher, qopt->db_size);
+	    if (qopt->profiling())
+		pl = qopt->profile_postlist(pl, "AND_NOT", children);
+	    either.add_postlist(pl);
+	    ctx.add_postlist(either.postlist(qopt));
+	}
     } else {
 	QueryAndLike::postlist_sub_and_like(ctx, qopt, factor);
     }
@@ -47,6 +47,8 @@ class QueryTerm : public Query::Internal {
 	      Xapian::termpos pos_)
 	: term(term_), wqf(wqf_), pos(pos_) { }
 
+    const std::string & get_term() const { return term; }
+
     Xapian::Query::op get_type() const;
 
     PostingIterator::Internal * postlist(QueryOptimiser * qopt, double factor) const;
@@ -70,6 +72,8 @@ class QueryPostingSource : public Query::Internal {
 
     ~QueryPostingSource();
 
+    PostingSource * get_posting_source() const { return source; }
+
     PostingIterator::Internal * postlist(QueryOptimiser *qopt, double factor) const;
 
     void serialise(std::string & result) const;
@@ -6,15 +6,18 @@ if BUILD_BACKEND_BRASS
 noinst_HEADERS +=\
 	backends/brass/brass_alldocspostlist.h\
 	backends/brass/brass_alltermslist.h\
+	backends/brass/brass_blockcache.h\
 	backends/brass/brass_btreebase.h\
 	backends/brass/brass_changes.h\
 	backends/brass/brass_check.h\
+	backends/brass/brass_codec.h\
 	backends/brass/brass_compact.h\
 	backends/brass/brass_cursor.h\
 	backends/brass/brass_database.h\
 	backends/brass/brass_databasereplicator.h\
 	backends/brass/brass_dbcheck.h\
 	backends/brass/brass_dbstats.h\
+	backends/brass/brass_doclencache.h\
 	backends/brass/brass_document.h\
 	backends/brass/brass_freelist.h\
 	backends/brass/brass_inverter.h\
@@ -28,9 +31,11 @@ noinst_HEADERS +=\
 	backends/brass/brass_spellingwordslist.h\
 	backends/brass/brass_synonym.h\
 	backends/brass/brass_table.h\
+	backends/brass/brass_termfreqcache.h\
 	backends/brass/brass_termlist.h\
 	backends/brass/brass_termlisttable.h\
 	backends/brass/brass_types.h\
+	backends/brass/brass_valuecolumn.h\
 	backends/brass/brass_valuelist.h\
 	backends/brass/brass_values.h\
 	backends/brass/brass_version.h
@@ -38,15 +43,18 @@ noinst_HEADERS +=\
 lib_src +=\
 	backends/brass/brass_alldocspostlist.cc\
 	backends/brass/brass_alltermslist.cc\
+	backends/brass/brass_blockcache.cc\
 	backends/brass/brass_btreebase.cc\
 	backends/brass/brass_changes.cc\
 	backends/brass/brass_check.cc\
+	backends/brass/brass_codec.cc\
 	backends/brass/brass_compact.cc\
 	backends/brass/brass_cursor.cc\
 	backends/brass/brass_database.cc\
 	backends/brass/brass_databasereplicator.cc\
 	backends/brass/brass_dbcheck.cc\
 	backends/brass/brass_dbstats.cc\
+	backends/brass/brass_doclencache.cc\
 	backends/brass/brass_document.cc\
 	backends/brass/brass_freelist.cc\
 	backends/brass/brass_inverter.cc\
@@ -58,8 +66,10 @@ lib_src +=\
 	backends/brass/brass_spellingwordslist.cc\
 	backends/brass/brass_synonym.cc\
 	backends/brass/brass_table.cc\
+	backends/brass/brass_termfreqcache.cc\
 	backends/brass/brass_termlist.cc\
 	backends/brass/brass_termlisttable.cc\
+	backends/brass/brass_valuecolumn.cc\
 	backends/brass/brass_valuelist.cc\
 	backends/brass/brass_values.cc\
 	backends/brass/brass_version.cc
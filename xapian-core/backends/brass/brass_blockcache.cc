@@ -0,0 +1,159 @@
+/** @file brass_blockcache.cc
+ * @brief Process-wide cache of brass B-tree blocks.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "brass_blockcache.h"
+
+#include "debuglog.h"
+#include "omassert.h"
+
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+BrassBlockCache *
+BrassBlockCache::get_instance()
+{
+    // The instance is deliberately never deleted, as tables may still be
+    // using it while static destructors run.
+    static BrassBlockCache * instance = NULL;
+    static bool initialised = false;
+    static Mutex init_mutex;
+    MutexLock lock(init_mutex);
+    if (!initialised) {
+	initialised = true;
+	const char *p = getenv("XAPIAN_BLOCK_CACHE_SIZE");
+	if (p) {
+	    size_t capacity = strtoul(p, NULL, 10);
+	    if (capacity) instance = new BrassBlockCache(capacity);
+	}
+    }
+    return instance;
+}
+
+uint4
+BrassBlockCache::get_file_id(const string & identity)
+{
+    MutexLock lock(mutex);
+    uint4 * p = file_ids.find(identity);
+    if (p) return *p;
+    // Forget the file opened least recently.  If it's opened again it just
+    // gets a new id, and the blocks cached under the old one get evicted in
+    // the usual way.
+    if (file_ids.size() >= MAX_FILE_IDS) file_ids.pop_back();
+    if (++last_file_id == 0) ++last_file_id;
+    file_ids.insert(identity, last_file_id);
+    return last_file_id;
+}
+
+bool
+BrassBlockCache::make_room(size_t len)
+{
+    if (len > capacity) return false;
+    LRUCache<Key, Block>::iterator i = blocks.end();
+    while (used + len > capacity) {
+	// Find the least recently used block which isn't pinned.
+	do {
+	    if (i == blocks.begin()) return false;
+	    --i;
+	} while (i->second.pins);
+	LOGLINE(DB, "Evicting block " << i->first.n << " of file " <<
+		i->first.file_id << " from the block cache");
+	used -= i->second.data.size();
+	i = blocks.erase(i);
+    }
+    return true;
+}
+
+bool
+BrassBlockCache::read(uint4 file_id, brass_revision_number_t revision, uint4 n,
+		      byte * p, size_t len)
+{
+    MutexLock lock(mutex);
+    const Block * block = blocks.find(Key(file_id, revision, n));
+    if (!block) {
+	++misses;
+	return false;
+    }
+    ++hits;
+    AssertEq(block->data.size(), len);
+    memcpy(p, block->data.data(), len);
+    return true;
+}
+
+void
+BrassBlockCache::add(uint4 file_id, brass_revision_number_t revision, uint4 n,
+		     const byte * p, size_t len)
+{
+    MutexLock lock(mutex);
+    Key key(file_id, revision, n);
+    // Another table may have added this block while we were reading it.
+    if (blocks.contains(key)) return;
+    if (!make_room(len)) return;
+    Block & block = blocks.insert(key);
+    block.data.assign(reinterpret_cast<const char *>(p), len);
+    used += len;
+}
+
+bool
+BrassBlockCache::pin(uint4 file_id, brass_revision_number_t revision, uint4 n)
+{
+    MutexLock lock(mutex);
+    Block * block = blocks.peek(Key(file_id, revision, n));
+    if (!block) return false;
+    ++block->pins;
+    return true;
+}
+
+void
+BrassBlockCache::unpin(uint4 file_id, brass_revision_number_t revision, uint4 n)
+{
+    MutexLock lock(mutex);
+    Block * block = blocks.peek(Key(file_id, revision, n));
+    // Pinned blocks are never evicted.
+    Assert(block);
+    if (rare(!block)) return;
+    AssertRel(block->pins,>,0);
+    --block->pins;
+}
+
+unsigned long
+BrassBlockCache::get_hits() const
+{
+    MutexLock lock(mutex);
+    return hits;
+}
+
+unsigned long
+BrassBlockCache::get_misses() const
+{
+    MutexLock lock(mutex);
+    return misses;
+}
+
+size_t
+BrassBlockCache::get_used() const
+{
+    MutexLock lock(mutex);
+    return used;
+}
@@ -0,0 +1,176 @@
+/** @file brass_blockcache.h
+ * @brief Process-wide cache of brass B-tree blocks.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_BRASS_BLOCKCACHE_H
+#define XAPIAN_INCLUDED_BRASS_BLOCKCACHE_H
+
+#include "brass_types.h"
+#include "lrucache.h"
+#include "mutexlock.h"
+
+#include <string>
+
+/** A size-bounded cache of B-tree blocks, shared by all read-only brass
+ *  tables in the process.
+ *
+ *  Blocks are identified by the file they come from, the revision of the
+ *  table which read them, and the block number.  A block read at a
+ *  particular revision can't change while that revision is still valid (if
+ *  a writer reuses the block, its revision will be newer and the existing
+ *  checks in BrassTable will spot that), so cached blocks never need to be
+ *  invalidated explicitly - entries for old revisions just get evicted.
+ *
+ *  Eviction is least-recently-used, but blocks which are pinned (the
+ *  branch blocks on the active path of a table's built-in cursor) are
+ *  never evicted.
+ *
+ *  The cache is enabled by setting XAPIAN_BLOCK_CACHE_SIZE in the
+ *  environment to the maximum number of bytes of block data to hold.
+ */
+class BrassBlockCache {
+    /// Don't allow copying.
+    BrassBlockCache(const BrassBlockCache &);
+
+    /// Don't allow assignment.
+    void operator=(const BrassBlockCache &);
+
+    struct Key {
+	uint4 file_id;
+
+	brass_revision_number_t revision;
+
+	uint4 n;
+
+	Key(uint4 file_id_, brass_revision_number_t revision_, uint4 n_)
+	    : file_id(file_id_), revision(revision_), n(n_) { }
+
+	bool operator<(const Key & o) const {
+	    if (file_id != o.file_id) return file_id < o.file_id;
+	    if (n != o.n) return n < o.n;
+	    return revision < o.revision;
+	}
+    };
+
+    struct Block {
+	/// The block contents.
+	std::string data;
+
+	/// Number of times this block is pinned.
+	unsigned pins;
+
+	Block() : pins(0) { }
+    };
+
+    /// The cached blocks.
+    LRUCache<Key, Block> blocks;
+
+    /// The most files we keep ids for.
+    static const size_t MAX_FILE_IDS = 1024;
+
+    /// Map from file identity to file_id, for recently opened files.
+    LRUCache<std::string, uint4> file_ids;
+
+    /// The last file_id handed out.
+    uint4 last_file_id;
+
+    /// The maximum number of bytes of block data to hold.
+    size_t capacity;
+
+    /// The number of bytes of block data currently held.
+    size_t used;
+
+    /// Number of successful lookups.
+    unsigned long hits;
+
+    /// Number of unsuccessful lookups.
+    unsigned long misses;
+
+    /// Protects all the above.
+    mutable Mutex mutex;
+
+    /** Evict unpinned entries until there's space for @a len more bytes.
+     *
+     *  @return true if there's now space.
+     */
+    bool make_room(size_t len);
+
+  public:
+    /// Create a cache holding up to @a capacity_ bytes of block data.
+    explicit BrassBlockCache(size_t capacity_)
+	: last_file_id(0), capacity(capacity_), used(0), hits(0), misses(0) { }
+
+    /** Return the process-wide cache.
+     *
+     *  @return NULL if the cache isn't enabled.
+     */
+    static BrassBlockCache * get_instance();
+
+    /** Return the id to use for a file.
+     *
+     *  @param identity	String identifying the file uniquely (e.g. device
+     *			and inode numbers, and the database UUID).
+     *
+     *  @return An id for the file, which is never 0.  If a file hasn't
+     *	       been opened recently, it may get a different id from last
+     *	       time.
+     */
+    uint4 get_file_id(const std::string & identity);
+
+    /** Read a block from the cache.
+     *
+     *  @param file_id	The id for the file (from get_file_id()).
+     *  @param revision	The revision of the table reading the block.
+     *  @param n	The block number.
+     *  @param p	Buffer to copy the block to.
+     *  @param len	The block size.
+     *
+     *  @return true if the block was found.
+     */
+    bool read(uint4 file_id, brass_revision_number_t revision, uint4 n,
+	      byte * p, size_t len);
+
+    /// Add a block to the cache.
+    void add(uint4 file_id, brass_revision_number_t revision, uint4 n,
+	     const byte * p, size_t len);
+
+    /** Pin a block so it won't be evicted.
+     *
+     *  @return true if the block was in the cache, and so is now pinned.
+     */
+    bool pin(uint4 file_id, brass_revision_number_t revision, uint4 n);
+
+    /// Remove one pin from a block previously pinned by pin().
+    void unpin(uint4 file_id, brass_revision_number_t revision, uint4 n);
+
+    /// Return the number of reads which found the block in the cache.
+    unsigned long get_hits() const;
+
+    /// Return the number of reads which didn't find the block in the cache.
+    unsigned long get_misses() const;
+
+    /// Return the number of bytes of block data currently held.
+    size_t get_used() const;
+
+    /// Return the maximum number of bytes of block data to hold.
+    size_t get_capacity() const { return capacity; }
+};
+
+#endif // XAPIAN_INCLUDED_BRASS_BLOCKCACHE_H
@@ -58,6 +58,9 @@ class BrassChanges {
 			 brass_revision_number_t rev,
 			 int flags);
 
+    /// Is a changeset currently being written?
+    bool active() const { return changes_fd >= 0; }
+
     void write_block(const char * p, size_t len);
 
     void write_block(const std::string & s) {
@@ -0,0 +1,401 @@
+/** @file brass_codec.cc
+ * @brief Compression codecs for brass tags.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "brass_codec.h"
+
+#include "xapian/error.h"
+
+#include "debuglog.h"
+#include "omassert.h"
+#include "pack.h"
+#include "str.h"
+#include "unaligned.h"
+
+#include <algorithm>
+
+#ifdef HAVE_LZ4
+# include <lz4.h>
+#endif
+#ifdef HAVE_ZSTD
+# include <zstd.h>
+#endif
+
+using namespace std;
+
+/// Zstandard compression level to use.
+const int ZSTD_LEVEL = 3;
+
+/// The most data to compress in one LZ4 block.
+const size_t LZ4_BLOCK_SIZE = 65536;
+
+BrassCodec::BrassCodec(int compress_strategy)
+    : zlib(compress_strategy), zstd_cctx(NULL), zstd_dctx(NULL),
+      stream_codec(-1), stream_done(false)
+{
+}
+
+BrassCodec::~BrassCodec()
+{
+#ifdef HAVE_ZSTD
+    ZSTD_freeCCtx(static_cast<ZSTD_CCtx *>(zstd_cctx));
+    ZSTD_freeDCtx(static_cast<ZSTD_DCtx *>(zstd_dctx));
+#endif
+}
+
+bool
+BrassCodec::available(int codec)
+{
+    switch (codec) {
+	case BRASS_CODEC_ZLIB:
+	    return true;
+#ifdef HAVE_LZ4
+	case BRASS_CODEC_LZ4:
+	    return true;
+#endif
+#ifdef HAVE_ZSTD
+	case BRASS_CODEC_ZSTD:
+	    return true;
+#endif
+    }
+    return false;
+}
+
+const char *
+BrassCodec::name(int codec)
+{
+    switch (codec) {
+	case BRASS_CODEC_ZLIB:
+	    return "zlib";
+	case BRASS_CODEC_LZ4:
+	    return "LZ4";
+	case BRASS_CODEC_ZSTD:
+	    return "Zstandard";
+    }
+    return "unknown";
+}
+
+bool
+BrassCodec::compress_zlib(const string & tag, string & out)
+{
+    zlib.lazy_alloc_deflate_zstream();
+
+    zlib.deflate_zstream->next_in = (Bytef *)const_cast<char *>(tag.data());
+    zlib.deflate_zstream->avail_in = (uInt)tag.size();
+
+    // If compressed size (plus the codec byte) is >= tag.size(), we don't
+    // want to compress.
+    unsigned long blk_len = tag.size() - 2;
+    unsigned char * blk = new unsigned char[blk_len];
+    zlib.deflate_zstream->next_out = blk;
+    zlib.deflate_zstream->avail_out = (uInt)blk_len;
+
+    int err = deflate(zlib.deflate_zstream, Z_FINISH);
+    bool compressed = (err == Z_STREAM_END);
+    if (compressed) {
+	// If deflate succeeded, then the output was at least two bytes
+	// smaller than the input.
+	out.append(reinterpret_cast<const char *>(blk),
+		   zlib.deflate_zstream->total_out);
+    } else {
+	// Deflate failed - presumably the data wasn't compressible.
+    }
+
+    delete [] blk;
+    return compressed;
+}
+
+bool
+BrassCodec::compress(int codec, const string & tag, string & out)
+{
+    LOGCALL(DB, bool, "BrassCodec::compress", codec | tag | Literal("out"));
+    Assert(available(codec));
+    // We need to save at least one byte, and there's the codec byte too.
+    if (tag.size() <= 2) RETURN(false);
+
+    out.resize(0);
+    out += char(codec);
+    switch (codec) {
+#ifdef HAVE_LZ4
+	case BRASS_CODEC_LZ4: {
+	    // We compress in independent blocks, so that the tag can be
+	    // decompressed a block at a time.  Each block is stored as its
+	    // decompressed length, its compressed length and then the
+	    // compressed data (LZ4 blocks don't record their lengths).
+	    lz4_buf.resize(LZ4_COMPRESSBOUND(LZ4_BLOCK_SIZE));
+	    const char * p = tag.data();
+	    const char * end = p + tag.size();
+	    while (p != end) {
+		int n = int(min(size_t(end - p), LZ4_BLOCK_SIZE));
+		int len = LZ4_compress_default(p, &lz4_buf[0], n,
+					       int(lz4_buf.size()));
+		if (len <= 0) RETURN(false);
+		pack_uint(out, unsigned(n));
+		pack_uint(out, unsigned(len));
+		out.append(lz4_buf.data(), len);
+		if (out.size() >= tag.size()) RETURN(false);
+		p += n;
+	    }
+	    RETURN(true);
+	}
+#endif
+#ifdef HAVE_ZSTD
+	case BRASS_CODEC_ZSTD: {
+	    if (!zstd_cctx) {
+		zstd_cctx = ZSTD_createCCtx();
+		if (!zstd_cctx) throw std::bad_alloc();
+	    }
+	    size_t max_len = tag.size() - 2;
+	    out.resize(1 + max_len);
+	    size_t len = ZSTD_compressCCtx(static_cast<ZSTD_CCtx *>(zstd_cctx),
+					   &out[1], max_len,
+					   tag.data(), tag.size(),
+					   ZSTD_LEVEL);
+	    // An error is returned if the output doesn't fit.
+	    if (ZSTD_isError(len)) RETURN(false);
+	    out.resize(1 + len);
+	    RETURN(true);
+	}
+#endif
+	default:
+	    RETURN(compress_zlib(tag, out));
+    }
+}
+
+void
+BrassCodec::decompress_zlib(const char * p, size_t len, BrassTagSink & sink)
+{
+    if (rare(stream_done)) {
+	if (len == 0) return;
+	throw Xapian::DatabaseCorruptError("Data after end of compressed tag");
+    }
+
+    Bytef buf[8192];
+
+    zlib.inflate_zstream->next_in = (Bytef*)const_cast<char *>(p);
+    zlib.inflate_zstream->avail_in = (uInt)len;
+
+    do {
+	zlib.inflate_zstream->next_out = buf;
+	zlib.inflate_zstream->avail_out = (uInt)sizeof(buf);
+	int err = inflate(zlib.inflate_zstream, Z_SYNC_FLUSH);
+	if (err == Z_STREAM_END) {
+	    stream_done = true;
+	} else if (err == Z_BUF_ERROR && zlib.inflate_zstream->avail_in == 0) {
+	    // No progress possible until we get more input.
+	} else if (err != Z_OK) {
+	    if (err == Z_MEM_ERROR) throw std::bad_alloc();
+	    string msg = "inflate failed";
+	    if (zlib.inflate_zstream->msg) {
+		msg += " (";
+		msg += zlib.inflate_zstream->msg;
+		msg += ')';
+	    }
+	    throw Xapian::DatabaseError(msg);
+	}
+
+	sink.append(reinterpret_cast<const char *>(buf),
+		    zlib.inflate_zstream->next_out - buf);
+	// If the output buffer was filled, there may be more output pending.
+    } while (!stream_done && zlib.inflate_zstream->avail_out == 0);
+
+    if (stream_done && zlib.inflate_zstream->avail_in != 0)
+	throw Xapian::DatabaseCorruptError("Data after end of compressed tag");
+}
+
+void
+BrassCodec::end_zlib(BrassTagSink & sink)
+{
+    if (!stream_done) {
+	LOGLINE(DB, "Z_BUF_ERROR - faking checksum of " << zlib.inflate_zstream->adler);
+	Bytef header2[4];
+	setint4(header2, 0, zlib.inflate_zstream->adler);
+	decompress_zlib(reinterpret_cast<const char *>(header2), 4, sink);
+	if (!stream_done)
+	    throw Xapian::DatabaseCorruptError("Compressed tag is truncated");
+    }
+}
+
+void
+BrassCodec::decompress_zstd(const char * p, size_t len, BrassTagSink & sink)
+{
+#ifdef HAVE_ZSTD
+    if (rare(stream_done)) {
+	if (len == 0) return;
+	throw Xapian::DatabaseCorruptError("Data after end of compressed tag");
+    }
+
+    char buf[8192];
+    ZSTD_inBuffer in = { p, len, 0 };
+    bool more;
+    do {
+	ZSTD_outBuffer out = { buf, sizeof(buf), 0 };
+	size_t r = ZSTD_decompressStream(static_cast<ZSTD_DCtx *>(zstd_dctx),
+					 &out, &in);
+	if (ZSTD_isError(r))
+	    throw Xapian::DatabaseCorruptError("Bad Zstandard compressed tag");
+	sink.append(buf, out.pos);
+	if (r == 0) {
+	    stream_done = true;
+	    if (in.pos != in.size)
+		throw Xapian::DatabaseCorruptError("Data after end of compressed tag");
+	}
+	// If the output buffer was filled, there may be more output pending.
+	more = (in.pos < in.size || out.pos == out.size);
+    } while (!stream_done && more);
+#else
+    (void)p;
+    (void)len;
+    (void)sink;
+#endif
+}
+
+void
+BrassCodec::decompress_lz4(const char * p, size_t len, BrassTagSink & sink)
+{
+#ifdef HAVE_LZ4
+    const char * end = p + len;
+    if (!stream_buf.empty()) {
+	// Complete the block left over from the last piece.
+	stream_buf.append(p, len);
+	p = stream_buf.data();
+	end = p + stream_buf.size();
+    }
+
+    while (p != end) {
+	const char * block = p;
+	unsigned size, block_len;
+	if (!unpack_uint(&block, end, &size) ||
+	    !unpack_uint(&block, end, &block_len)) {
+	    // unpack_uint() sets block to NULL if it runs out of data.
+	    if (!block) break;
+	    throw Xapian::DatabaseCorruptError("Bad LZ4 compressed tag");
+	}
+	if (size_t(end - block) < block_len) break;
+	if (size == 0 || size > LZ4_BLOCK_SIZE ||
+	    block_len > unsigned(LZ4_COMPRESSBOUND(LZ4_BLOCK_SIZE))) {
+	    throw Xapian::DatabaseCorruptError("Bad LZ4 compressed tag");
+	}
+	lz4_buf.resize(LZ4_BLOCK_SIZE);
+	int r = LZ4_decompress_safe(block, &lz4_buf[0], int(block_len),
+				    int(size));
+	if (r < 0 || unsigned(r) != size)
+	    throw Xapian::DatabaseCorruptError("Bad LZ4 compressed tag");
+	sink.append(lz4_buf.data(), size);
+	p = block + block_len;
+    }
+
+    // Save any incomplete block for the next piece.
+    if (stream_buf.empty()) {
+	stream_buf.assign(p, end - p);
+    } else {
+	stream_buf.erase(0, p - stream_buf.data());
+    }
+#else
+    (void)p;
+    (void)len;
+    (void)sink;
+#endif
+}
+
+void
+BrassCodec::decompress_chunk(const char * p, size_t len, BrassTagSink & sink)
+{
+    LOGCALL_VOID(DB, "BrassCodec::decompress_chunk", (const void*)p | len | Literal("sink"));
+    if (stream_codec < 0) {
+	if (len == 0) return;
+	int codec = static_cast<unsigned char>(*p++);
+	--len;
+	if (rare(!available(codec))) {
+	    string msg = "Tag compressed with ";
+	    msg += name(codec);
+	    msg += " codec (";
+	    msg += str(codec);
+	    msg += ") which isn't supported by this build";
+	    throw Xapian::FeatureUnavailableError(msg);
+	}
+	stream_codec = codec;
+	switch (codec) {
+	    case BRASS_CODEC_ZLIB:
+		zlib.lazy_alloc_inflate_zstream();
+		break;
+#ifdef HAVE_ZSTD
+	    case BRASS_CODEC_ZSTD:
+		if (!zstd_dctx) {
+		    zstd_dctx = ZSTD_createDCtx();
+		    if (!zstd_dctx) throw std::bad_alloc();
+		} else {
+		    ZSTD_DCtx_reset(static_cast<ZSTD_DCtx *>(zstd_dctx),
+				    ZSTD_reset_session_only);
+		}
+		break;
+#endif
+	    default:
+		stream_buf.resize(0);
+		break;
+	}
+    }
+
+    switch (stream_codec) {
+	case BRASS_CODEC_ZLIB:
+	    decompress_zlib(p, len, sink);
+	    break;
+	case BRASS_CODEC_ZSTD:
+	    decompress_zstd(p, len, sink);
+	    break;
+	default:
+	    decompress_lz4(p, len, sink);
+	    break;
+    }
+}
+
+void
+BrassCodec::decompress_end(BrassTagSink & sink)
+{
+    LOGCALL_VOID(DB, "BrassCodec::decompress_end", Literal("sink"));
+    switch (stream_codec) {
+	case -1:
+	    throw Xapian::DatabaseCorruptError("Compressed tag is empty");
+	case BRASS_CODEC_ZLIB:
+	    end_zlib(sink);
+	    return;
+	case BRASS_CODEC_ZSTD:
+	    if (!stream_done)
+		throw Xapian::DatabaseCorruptError("Compressed tag is truncated");
+	    return;
+    }
+
+    AssertEq(stream_codec, BRASS_CODEC_LZ4);
+    if (!stream_buf.empty())
+	throw Xapian::DatabaseCorruptError("Compressed tag is truncated");
+}
+
+void
+BrassCodec::decompress(const char * p, size_t len, string & out)
+{
+    LOGCALL_VOID(DB, "BrassCodec::decompress", (const void*)p | len | Literal("out"));
+    out.resize(0);
+    BrassStringTagSink sink(out);
+    decompress_start();
+    decompress_chunk(p, len, sink);
+    decompress_end(sink);
+}
@@ -0,0 +1,182 @@
+/** @file brass_codec.h
+ * @brief Compression codecs for brass tags.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_BRASS_CODEC_H
+#define XAPIAN_INCLUDED_BRASS_CODEC_H
+
+#include "common/compression_stream.h"
+
+#include <string>
+
+/** Codecs which can be used to compress tags.
+ *
+ *  A compressed tag starts with a byte giving the codec used, so these
+ *  values are part of the on-disk format and mustn't be changed.
+ */
+enum {
+    /// zlib's raw deflate format (always available).
+    BRASS_CODEC_ZLIB = 0,
+
+    /// LZ4 (only available if built with liblz4).
+    BRASS_CODEC_LZ4 = 1,
+
+    /// Zstandard (only available if built with libzstd).
+    BRASS_CODEC_ZSTD = 2
+};
+
+/// Receives the contents of a tag in pieces.
+class BrassTagSink {
+  public:
+    virtual ~BrassTagSink() { }
+
+    /// Append the next @a len bytes of the tag.
+    virtual void append(const char * p, size_t len) = 0;
+};
+
+/// A BrassTagSink which appends to a std::string.
+class BrassStringTagSink : public BrassTagSink {
+    std::string & s;
+
+  public:
+    explicit BrassStringTagSink(std::string & s_) : s(s_) { }
+
+    void append(const char * p, size_t len) { s.append(p, len); }
+};
+
+/** Compresses and decompresses tags using any of the supported codecs.
+ *
+ *  The state needed by each codec is allocated the first time it's used,
+ *  and then reused.
+ */
+class BrassCodec {
+    /// Don't allow copying.
+    BrassCodec(const BrassCodec &);
+
+    /// Don't allow assignment.
+    void operator=(const BrassCodec &);
+
+    /// The zlib state.
+    CompressionStream zlib;
+
+    /// Zstandard compression context (a ZSTD_CCtx *), or NULL.
+    void * zstd_cctx;
+
+    /// Zstandard decompression context (a ZSTD_DCtx *), or NULL.
+    void * zstd_dctx;
+
+    /** The codec of the tag being decompressed by decompress_chunk().
+     *
+     *  -1 if we've not yet seen the first byte of the tag.
+     */
+    int stream_codec;
+
+    /// True once the end of the compressed stream has been reached.
+    bool stream_done;
+
+    /// Compressed data from the end of the last piece of an LZ4 tag which
+    /// didn't hold a whole block.
+    std::string stream_buf;
+
+    /// Buffer to compress or decompress LZ4 blocks into.
+    std::string lz4_buf;
+
+    bool compress_zlib(const std::string & tag, std::string & out);
+
+    void decompress_zlib(const char * p, size_t len, BrassTagSink & sink);
+
+    void end_zlib(BrassTagSink & sink);
+
+    void decompress_zstd(const char * p, size_t len, BrassTagSink & sink);
+
+    void decompress_lz4(const char * p, size_t len, BrassTagSink & sink);
+
+  public:
+    /** Constructor.
+     *
+     *  @param compress_strategy	zlib strategy to use with
+     *					BRASS_CODEC_ZLIB.
+     */
+    explicit BrassCodec(int compress_strategy);
+
+    ~BrassCodec();
+
+    /// Return true if @a codec is supported by this build.
+    static bool available(int codec);
+
+    /// Return the name of @a codec, for use in messages.
+    static const char * name(int codec);
+
+    /** Compress a tag.
+     *
+     *  @param codec	The codec to use, which must be available.
+     *  @param tag	The tag to compress.
+     *  @param out	Set to the compressed form of tag (starting with a
+     *			byte giving the codec).
+     *
+     *  @return true if the tag was compressed; false if it couldn't be
+     *		made smaller.
+     */
+    bool compress(int codec, const std::string & tag, std::string & out);
+
+    /** Decompress a tag.
+     *
+     *  @param p	The compressed tag (as produced by compress()).
+     *  @param len	The length of the compressed tag.
+     *  @param out	Set to the decompressed tag.
+     *
+     *  @exception Xapian::FeatureUnavailableError if the codec used isn't
+     *		   supported by this build.
+     *  @exception Xapian::DatabaseCorruptError if the data is invalid.
+     */
+    void decompress(const char * p, size_t len, std::string & out);
+
+    /** Start decompressing a tag in pieces.
+     *
+     *  Pass the pieces to decompress_chunk(), then call decompress_end().
+     */
+    void decompress_start() {
+	stream_codec = -1;
+	stream_done = false;
+    }
+
+    /** Decompress the next piece of a tag.
+     *
+     *  As much of the decompressed tag as possible is passed to @a sink.
+     *  LZ4 compressed tags are made up of independent blocks of up to 64KB,
+     *  each of which is decompressed once all of it has been seen.
+     *
+     *  @exception Xapian::FeatureUnavailableError if the codec used isn't
+     *		   supported by this build.
+     *  @exception Xapian::DatabaseCorruptError if the data is invalid.
+     */
+    void decompress_chunk(const char * p, size_t len, BrassTagSink & sink);
+
+    /** Finish decompressing a tag in pieces.
+     *
+     *  Any remaining decompressed data is passed to @a sink.
+     *
+     *  @exception Xapian::DatabaseCorruptError if the compressed data was
+     *		   incomplete or invalid.
+     */
+    void decompress_end(BrassTagSink & sink);
+};
+
+#endif // XAPIAN_INCLUDED_BRASS_CODEC_H
@@ -796,16 +796,18 @@ compact_brass(Xapian::Compactor & compactor,
 	int compress_strategy;
 	// Create tables after position lazily.
 	bool lazy;
+	// Codec to compress tags with.
+	int codec;
     };
 
     static const table_list tables[] = {
-	// name		type		compress_strategy	lazy
-	{ "postlist",	POSTLIST,	DONT_COMPRESS,		false },
-	{ "record",	RECORD,		Z_DEFAULT_STRATEGY,	false },
-	{ "termlist",	TERMLIST,	Z_DEFAULT_STRATEGY,	false },
-	{ "position",	POSITION,	DONT_COMPRESS,		true },
-	{ "spelling",	SPELLING,	Z_DEFAULT_STRATEGY,	true },
-	{ "synonym",	SYNONYM,	Z_DEFAULT_STRATEGY,	true }
+	// name		type		compress_strategy	lazy	codec
+	{ "postlist",	POSTLIST,	DONT_COMPRESS,		false,	BRASS_CODEC_ZLIB },
+	{ "record",	RECORD,		Z_DEFAULT_STRATEGY,	false,	BRASS_CODEC_ZSTD },
+	{ "termlist",	TERMLIST,	Z_DEFAULT_STRATEGY,	false,	BRASS_CODEC_LZ4 },
+	{ "position",	POSITION,	DONT_COMPRESS,		true,	BRASS_CODEC_ZLIB },
+	{ "spelling",	SPELLING,	Z_DEFAULT_STRATEGY,	true,	BRASS_CODEC_ZLIB },
+	{ "synonym",	SYNONYM,	Z_DEFAULT_STRATEGY,	true,	BRASS_CODEC_ZLIB }
     };
     const table_list * tables_end = tables +
 	(sizeof(tables) / sizeof(tables[0]));
@@ -872,7 +874,8 @@ compact_brass(Xapian::Compactor & compactor,
 	    continue;
 	}
 
-	BrassTable out(t->name, dest, false, t->compress_strategy, t->lazy);
+	BrassTable out(t->name, dest, false, t->compress_strategy, t->lazy,
+		       t->codec);
 	if (!t->lazy) {
 	    out.create_and_open(Xapian::DB_DANGEROUS, block_size);
 	} else {
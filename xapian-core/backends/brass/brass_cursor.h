@@ -34,6 +34,11 @@ using std::string;
 
 #define BLK_UNUSED uint4(-1)
 
+// The range of the number of blocks to prefetch at once when reading a table
+// sequentially.
+const uint4 READAHEAD_MIN_BLOCKS = 8;
+const uint4 READAHEAD_MAX_BLOCKS = 256;
+
 namespace Brass {
 
 class Cursor {
@@ -47,7 +52,9 @@ class Cursor {
 
     public:
 	/// Constructor.
-	Cursor() : data(0), c(-1), rewrite(false) { }
+	Cursor()
+	    : data(0), c(-1), rewrite(false),
+	      readahead_end(0), readahead_window(0) { }
 
 	~Cursor() { destroy(); }
 
@@ -78,6 +85,8 @@ class Cursor {
 	    std::swap(data, o.data);
 	    std::swap(c, o.c);
 	    std::swap(rewrite, o.rewrite);
+	    std::swap(readahead_end, o.readahead_end);
+	    std::swap(readahead_window, o.readahead_window);
 	}
 
 	void destroy() {
@@ -135,6 +144,58 @@ class Cursor {
 
 	/// true if the block is not the same as on disk, and so needs rewriting
 	bool rewrite;
+
+	/** Decide which blocks to prefetch for a sequential scan which is
+	 *  about to read block @a n.
+	 *
+	 *  We ask the OS to read ahead in batches, starting a new batch when
+	 *  the scan has consumed half of the previous one.  The batch size
+	 *  doubles each time the scan gets that far, up to
+	 *  READAHEAD_MAX_BLOCKS, and halves if the cursor moves elsewhere,
+	 *  leaving prefetched blocks unused.
+	 *
+	 *  @param n	    The block about to be read.
+	 *  @param last	    The first block number past the end of the table.
+	 *  @param[out] first	The first block to prefetch.
+	 *  @param[out] count	The number of blocks to prefetch.
+	 *
+	 *  @return true if there are blocks to prefetch.
+	 */
+	bool next_readahead(uint4 n, uint4 last, uint4 & first, uint4 & count) {
+	    uint4 w = readahead_window;
+	    if (w == 0) {
+		w = READAHEAD_MIN_BLOCKS;
+		readahead_end = n;
+	    } else if (n > readahead_end || readahead_end - n > 2 * w) {
+		// The scan has restarted somewhere else.  If it left behind
+		// blocks we prefetched, prefetch less next time.
+		if (n < readahead_end && w > READAHEAD_MIN_BLOCKS) w /= 2;
+		readahead_end = n;
+	    } else if (readahead_end - n > w / 2) {
+		// Still plenty of prefetched blocks ahead of us.
+		return false;
+	    } else if (w < READAHEAD_MAX_BLOCKS) {
+		w *= 2;
+	    }
+	    readahead_window = w;
+
+	    first = std::max(readahead_end, n + 1);
+	    if (first >= last) return false;
+	    count = std::min(w, last - first);
+	    readahead_end = first + count;
+	    return true;
+	}
+
+	/** Blocks before this have been prefetched for a sequential scan.
+	 *
+	 *  Only used for the leaf level, by BrassTable::next_for_sequential().
+	 */
+	uint4 readahead_end;
+
+	/** Number of blocks to prefetch at once, or 0 if no prefetching has
+	 *  been done yet.
+	 */
+	uint4 readahead_window;
 };
 
 }
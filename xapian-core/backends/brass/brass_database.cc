@@ -34,6 +34,7 @@
 #include "xapian/valueiterator.h"
 
 #include "backends/contiguousalldocspostlist.h"
+#include "backends/memoryused.h"
 #include "brass_alldocspostlist.h"
 #include "brass_alltermslist.h"
 #include "brass_replicate_internal.h"
@@ -45,9 +46,11 @@
 #include "brass_record.h"
 #include "brass_spellingwordslist.h"
 #include "brass_termlist.h"
+#include "brass_valuecolumn.h"
 #include "brass_valuelist.h"
 #include "brass_values.h"
 #include "debuglog.h"
+#include "edgengram.h"
 #include "fd.h"
 #include "io_utils.h"
 #include "pack.h"
@@ -59,6 +62,7 @@
 #include "str.h"
 #include "stringutils.h"
 #include "backends/valuestats.h"
+#include "workerthreads.h"
 
 #include "safeerrno.h"
 #include "safesysstat.h"
@@ -68,6 +72,8 @@
 #include "autoptr.h"
 #include <cstdlib>
 #include <string>
+#include <utility>
+#include <vector>
 
 using namespace std;
 using namespace Xapian;
@@ -95,12 +101,41 @@ using Xapian::Internal::intrusive_ptr;
  */
 const int MAX_OPEN_RETRIES = 100;
 
+/** Flush a table's changes and commit them, on a worker thread.
+ *
+ *  This is templated on the table class since some tables hide
+ *  BrassTable::flush_db() with a version which merges their pending changes.
+ */
+template<class T>
+class BrassCommitTask : public WorkerTask {
+    T & table;
+
+    brass_revision_number_t revision;
+
+  public:
+    /** Constructor.
+     *
+     *  @param revision_	The revision to commit, or 0 to just flush and
+     *				sync the table.
+     */
+    BrassCommitTask(T & table_, brass_revision_number_t revision_)
+	: table(table_), revision(revision_) { }
+
+    void run() {
+	table.flush_db();
+	if (revision)
+	    table.commit(revision);
+	else
+	    table.sync_db();
+    }
+};
+
 /* This finds the tables, opens them at consistent revisions, manages
  * determining the current and next revision numbers, and stores handles
  * to the tables.
  */
 BrassDatabase::BrassDatabase(const string &brass_dir, int flags,
-			     unsigned int block_size)
+			     unsigned int block_size, int readonly_flags)
 	: db_dir(brass_dir),
 	  readonly(flags == Xapian::DB_READONLY_),
 	  version_file(db_dir),
@@ -114,10 +149,10 @@ BrassDatabase::BrassDatabase(const string &brass_dir, int flags,
 	  lock(db_dir),
 	  changes(db_dir)
 {
-    LOGCALL_CTOR(DB, "BrassDatabase", brass_dir | flags | block_size);
+    LOGCALL_CTOR(DB, "BrassDatabase", brass_dir | flags | block_size | readonly_flags);
 
     if (readonly) {
-	open_tables_consistent(0);
+	open_tables_consistent(readonly_flags & Xapian::DB_MMAP);
 	return;
     }
 
@@ -224,7 +259,18 @@ BrassDatabase::open_tables_consistent(int flags)
     brass_revision_number_t cur_rev = record_table.get_open_revision_number();
 
     // Check the version file unless we're reopening.
-    if (cur_rev == 0) version_file.read_and_check();
+    if (cur_rev == 0) {
+	version_file.read_and_check();
+
+	// The UUID identifies the tables' blocks in the shared block cache.
+	const char * uuid = version_file.get_uuid();
+	postlist_table.set_uuid(uuid);
+	position_table.set_uuid(uuid);
+	termlist_table.set_uuid(uuid);
+	synonym_table.set_uuid(uuid);
+	spelling_table.set_uuid(uuid);
+	record_table.set_uuid(uuid);
+    }
 
     record_table.open(flags);
     brass_revision_number_t revision = record_table.get_open_revision_number();
@@ -393,6 +439,38 @@ BrassDatabase::set_revision_number(int flags, brass_revision_number_t new_revisi
 
     value_manager.merge_changes();
 
+    // The tables are in separate files, so unless we're writing a changeset
+    // (which all the tables append to) we can flush them and wait for them
+    // to sync concurrently.  Readers open record_table first, so that must
+    // still be committed after all the other tables have been, but we can
+    // get its data synced along with the others.
+    if (!changes.active()) {
+	BrassCommitTask<BrassPostListTable>
+	    postlist_task(postlist_table, new_revision);
+	BrassCommitTask<BrassPositionListTable>
+	    position_task(position_table, new_revision);
+	BrassCommitTask<BrassTermListTable>
+	    termlist_task(termlist_table, new_revision);
+	BrassCommitTask<BrassSynonymTable>
+	    synonym_task(synonym_table, new_revision);
+	BrassCommitTask<BrassSpellingTable>
+	    spelling_task(spelling_table, new_revision);
+	BrassCommitTask<BrassRecordTable>
+	    record_task(record_table, 0);
+	WorkerThreads workers;
+	workers.add(&postlist_task);
+	workers.add(&position_task);
+	workers.add(&termlist_task);
+	workers.add(&synonym_task);
+	workers.add(&spelling_task);
+	workers.add(&record_task);
+	workers.run();
+
+	record_table.commit(new_revision);
+	changes.commit(new_revision, flags);
+	return;
+    }
+
     postlist_table.flush_db();
     position_table.flush_db();
     termlist_table.flush_db();
@@ -427,7 +505,9 @@ BrassDatabase::close()
     synonym_table.close(true);
     spelling_table.close(true);
     record_table.close(true);
+    value_manager.reset();
     lock.release();
+    other_instances.clear();
 }
 
 void
@@ -830,6 +910,10 @@ BrassDatabase::open_value_list(Xapian::valueno slot) const
 {
     LOGCALL(DB, ValueList *, "BrassDatabase::open_value_list", slot);
     intrusive_ptr<const BrassDatabase> ptrtothis(this);
+    intrusive_ptr<const BrassValueColumn> column;
+    column = value_manager.get_column(slot, ptrtothis);
+    if (column.get())
+	RETURN(new BrassValueColumnList(column));
     RETURN(new BrassValueList(slot, ptrtothis));
 }
 
@@ -954,6 +1038,38 @@ BrassDatabase::get_uuid() const
     RETURN(version_file.get_uuid_string());
 }
 
+string
+BrassDatabase::get_revision_key() const
+{
+    LOGCALL(DB, string, "BrassDatabase::get_revision_key", NO_ARGS);
+    // A writable database may have changes which aren't committed yet.
+    if (!readonly) RETURN(string());
+    string key = version_file.get_uuid_string();
+    pack_uint(key, get_revision_number());
+    RETURN(key);
+}
+
+Database::Internal *
+BrassDatabase::get_another_instance(size_t n) const
+{
+    LOGCALL(DB, Database::Internal *, "BrassDatabase::get_another_instance", n);
+    // A writable database may have changes which only it can see.
+    if (!readonly) RETURN(NULL);
+    if (n >= other_instances.size()) other_instances.resize(n + 1);
+    intrusive_ptr<BrassDatabase> & db = other_instances[n];
+    if (!db.get()) {
+	db = new BrassDatabase(db_dir, Xapian::DB_READONLY_, 0u,
+			       postlist_table.get_flags());
+    } else if (db->get_revision_number() != get_revision_number()) {
+	// We've been reopened since the instance was opened.
+	db->reopen();
+    }
+    // If a writer has committed since we were opened, the other instance
+    // will be at a later revision.
+    if (db->get_revision_number() != get_revision_number()) RETURN(NULL);
+    RETURN(db.get());
+}
+
 void
 BrassDatabase::throw_termlist_table_close_exception() const
 {
@@ -971,12 +1087,19 @@ BrassWritableDatabase::BrassWritableDatabase(const string &dir, int flags,
 	: BrassDatabase(dir, flags, block_size),
 	  change_count(0),
 	  flush_threshold(0),
+	  flush_memory_limit(0),
 	  modify_shortcut_document(NULL),
 	  modify_shortcut_docid(0)
 {
     LOGCALL_CTOR(DB, "BrassWritableDatabase", dir | flags | block_size);
 
-    const char *p = getenv("XAPIAN_FLUSH_THRESHOLD");
+    const char *p = getenv("XAPIAN_FLUSH_MEMORY_LIMIT");
+    if (p) {
+	flush_memory_limit = strtoul(p, NULL, 10);
+	// With a memory limit, only limit the number of changes if asked to.
+	if (flush_memory_limit) flush_threshold = Xapian::doccount(-1);
+    }
+    p = getenv("XAPIAN_FLUSH_THRESHOLD");
     if (p)
 	flush_threshold = atoi(p);
     if (flush_threshold == 0)
@@ -1020,6 +1143,15 @@ BrassWritableDatabase::close()
     BrassDatabase::close();
 }
 
+size_t
+BrassWritableDatabase::get_memory_used() const
+{
+    size_t total = inverter.get_memory_used();
+    total += value_manager.get_memory_used();
+    total += map_memory_used(value_stats);
+    return total;
+}
+
 void
 BrassWritableDatabase::apply()
 {
@@ -1056,11 +1188,11 @@ BrassWritableDatabase::add_document_(Xapian::docid did,
 	    Xapian::TermIterator term = document.termlist_begin();
 	    for ( ; term != document.termlist_end(); ++term) {
 		termcount wdf = term.get_wdf();
+		string tname = *term;
 		// Calculate the new document length
-		new_doclen += wdf;
+		if (!is_edge_ngram(tname)) new_doclen += wdf;
 		stats.check_wdf(wdf);
 
-		string tname = *term;
 		if (tname.size() > MAX_SAFE_TERM_LENGTH)
 		    throw Xapian::InvalidArgumentError("Term too long (> "STRINGIZE(MAX_SAFE_TERM_LENGTH)"): " + tname);
 
@@ -1086,10 +1218,8 @@ BrassWritableDatabase::add_document_(Xapian::docid did,
 	throw;
     }
 
-    // FIXME: this should be done by checking memory usage, not the number of
-    // changes.  We could also look at the amount of data the inverter object
-    // currently holds.
-    if (++change_count >= flush_threshold) {
+    ++change_count;
+    if (flush_needed()) {
 	flush_postlist_changes();
 	if (!transaction_active()) apply();
     }
@@ -1153,7 +1283,8 @@ BrassWritableDatabase::delete_document(Xapian::docid did)
 	throw;
     }
 
-    if (++change_count >= flush_threshold) {
+    ++change_count;
+    if (flush_needed()) {
 	flush_postlist_changes();
 	if (!transaction_active()) apply();
     }
@@ -1219,6 +1350,9 @@ BrassWritableDatabase::replace_document(Xapian::docid did,
 	    stats.delete_document(old_doclen);
 	    brass_doclen_t new_doclen = old_doclen;
 
+	    // Terms whose wdf hasn't changed.
+	    vector<pair<string, termcount> > unchanged;
+
 	    string old_tname, new_tname;
 
 	    termlist.next();
@@ -1240,7 +1374,7 @@ BrassWritableDatabase::replace_document(Xapian::docid did,
 		if (cmp < 0) {
 		    // Term old_tname has been deleted.
 		    termcount old_wdf = termlist.get_wdf();
-		    new_doclen -= old_wdf;
+		    if (!is_edge_ngram(old_tname)) new_doclen -= old_wdf;
 		    inverter.remove_posting(did, old_tname, old_wdf);
 		    if (pos_modified)
 			inverter.delete_positionlist(did, old_tname);
@@ -1248,7 +1382,7 @@ BrassWritableDatabase::replace_document(Xapian::docid did,
 		} else if (cmp > 0) {
 		    // Term new_tname as been added.
 		    termcount new_wdf = term.get_wdf();
-		    new_doclen += new_wdf;
+		    if (!is_edge_ngram(new_tname)) new_doclen += new_wdf;
 		    stats.check_wdf(new_wdf);
 		    if (new_tname.size() > MAX_SAFE_TERM_LENGTH)
 			throw Xapian::InvalidArgumentError("Term too long (> "STRINGIZE(MAX_SAFE_TERM_LENGTH)"): " + new_tname);
@@ -1268,8 +1402,11 @@ BrassWritableDatabase::replace_document(Xapian::docid did,
 		    stats.check_wdf(new_wdf);
 
 		    if (old_wdf != new_wdf) {
-		    	new_doclen += new_wdf - old_wdf;
+			if (!is_edge_ngram(new_tname))
+			    new_doclen += new_wdf - old_wdf;
 			inverter.update_posting(did, new_tname, old_wdf, new_wdf);
+		    } else {
+			unchanged.push_back(make_pair(new_tname, new_wdf));
 		    }
 
 		    if (pos_modified) {
@@ -1282,6 +1419,16 @@ BrassWritableDatabase::replace_document(Xapian::docid did,
 	    }
 	    LOGLINE(DB, "Calculated doclen for replacement document " << did << " as " << new_doclen);
 
+	    if (new_doclen < old_doclen) {
+		// Each block of postings stores a lower bound on the lengths
+		// of its documents, so rewrite the postings we haven't changed
+		// in case the document was the shortest in its block.
+		vector<pair<string, termcount> >::const_iterator i;
+		for (i = unchanged.begin(); i != unchanged.end(); ++i) {
+		    inverter.update_posting(did, i->first, i->second, i->second);
+		}
+	    }
+
 	    // Set the termlist.
 	    if (termlist_table.is_open())
 		termlist_table.set_termlist(did, document, new_doclen);
@@ -1313,7 +1460,8 @@ BrassWritableDatabase::replace_document(Xapian::docid did,
 	throw;
     }
 
-    if (++change_count >= flush_threshold) {
+    ++change_count;
+    if (flush_needed()) {
 	flush_postlist_changes();
 	if (!transaction_active()) apply();
     }
@@ -46,6 +46,7 @@
 #include "xapian/constants.h"
 
 #include <map>
+#include <vector>
 
 class BrassTermList;
 class BrassAllDocsPostList;
@@ -121,6 +122,14 @@ class BrassDatabase : public Xapian::Database::Internal {
 	/// Replication changesets.
 	BrassChanges changes;
 
+	/** Other instances of this database, for matching in parallel.
+	 *
+	 *  These are kept so that later matches don't need to open them
+	 *  again, and can use any caches they've built.
+	 */
+	mutable std::vector<Xapian::Internal::intrusive_ptr<BrassDatabase> >
+	    other_instances;
+
 	/** Return true if a database exists at the path specified for this
 	 *  database.
 	 */
@@ -237,9 +246,13 @@ class BrassDatabase : public Xapian::Database::Internal {
 	 *                    tables.  This is only important, and has the
 	 *                    correct value, when the database is being
 	 *                    created.
+	 *
+	 *  @param readonly_flags Flags to open the tables with when flags is
+	 *                        Xapian::DB_READONLY_ (currently just
+	 *                        Xapian::DB_MMAP is supported).
 	 */
 	BrassDatabase(const string &db_dir_, int flags = Xapian::DB_READONLY_,
-		      unsigned int block_size = 0u);
+		      unsigned int block_size = 0u, int readonly_flags = 0);
 
 	~BrassDatabase();
 
@@ -297,6 +310,8 @@ class BrassDatabase : public Xapian::Database::Internal {
 				    Xapian::ReplicationInfo * info);
 	string get_revision_info() const;
 	string get_uuid() const;
+	string get_revision_key() const;
+	Xapian::Database::Internal * get_another_instance(size_t n) const;
 	//@}
 
 	XAPIAN_NORETURN(void throw_termlist_table_close_exception() const);
@@ -317,6 +332,18 @@ class BrassWritableDatabase : public BrassDatabase {
 	/// If change_count reaches this threshold we automatically flush.
 	Xapian::doccount flush_threshold;
 
+	/** If the memory used by pending changes reaches this many bytes we
+	 *  automatically flush (0 means no limit).
+	 */
+	size_t flush_memory_limit;
+
+	/// Return true if we should automatically flush.
+	bool flush_needed() const {
+	    return change_count >= flush_threshold ||
+		   (flush_memory_limit &&
+		    get_memory_used() >= flush_memory_limit);
+	}
+
 	/** A pointer to the last document which was returned by
 	 *  open_document(), or NULL if there is no such valid document.  This
 	 *  is used purely for comparing with a supplied document to help with
@@ -347,6 +374,8 @@ class BrassWritableDatabase : public BrassDatabase {
 	/** Cancel pending modifications to the database. */
 	void cancel();
 
+	size_t get_memory_used() const;
+
 	Xapian::docid add_document(const Xapian::Document & document);
 	Xapian::docid add_document_(Xapian::docid did, const Xapian::Document & document);
 	// Stop the default implementation of delete_document(term) and
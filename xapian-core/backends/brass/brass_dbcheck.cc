@@ -25,11 +25,14 @@
 #include "brass_dbcheck.h"
 
 #include "bitstream.h"
+#include "edgengram.h"
 
 #include "internaltypes.h"
 
 #include "brass_check.h"
 #include "brass_cursor.h"
+#include "brass_positionlist.h"
+#include "brass_postlist.h"
 #include "brass_table.h"
 #include "brass_types.h"
 #include "pack.h"
@@ -55,6 +58,117 @@ struct VStats : public ValueStats {
     VStats() : ValueStats(), freq_real(0) {}
 };
 
+/// Iterate through the items in a postlist chunk, checking the block table.
+class ChunkCheck {
+    Brass::PostlistChunkDecoder decoder;
+
+    /// The largest wdfs actually seen in the chunk and the current block.
+    Xapian::termcount max_wdf, block_max_wdf;
+
+    /** Document lengths to check the block lower bounds against.
+     *
+     *  NULL means this is a chunk of the document length list, so each
+     *  item's wdf is its document length.
+     */
+    const vector<Xapian::termcount> * doclens;
+
+    ostream * out;
+
+    size_t & errors;
+
+    void item() {
+	Xapian::termcount wdf = decoder.get_wdf();
+	if (wdf > max_wdf) max_wdf = wdf;
+	if (wdf > block_max_wdf) block_max_wdf = wdf;
+
+	Xapian::termcount doclen = wdf;
+	if (doclens) {
+	    if (doclens->empty()) return;
+	    Xapian::docid did = decoder.get_docid();
+	    doclen = did < doclens->size() ? (*doclens)[did] : 0;
+	}
+	if (decoder.get_block_min_doclen() > doclen ||
+	    decoder.get_chunk_min_doclen() > doclen) {
+	    if (out)
+		*out << "Document id " << decoder.get_docid() << " has length "
+		     << doclen << " but its block's lower bound is "
+		     << decoder.get_block_min_doclen() << " and its chunk's "
+		     << decoder.get_chunk_min_doclen() << endl;
+	    ++errors;
+	}
+    }
+
+  public:
+    ChunkCheck(const vector<Xapian::termcount> * doclens_,
+	       ostream * out_, size_t & errors_)
+	: max_wdf(0), block_max_wdf(0), doclens(doclens_),
+	  out(out_), errors(errors_) { }
+
+    /// Start checking a chunk, returning false on error.
+    bool start(const char * pos, const char * end, Xapian::docid did) {
+	try {
+	    decoder.start(pos, end, did);
+	} catch (const Xapian::Error & e) {
+	    if (out)
+		*out << "Failed to decode chunk: " << e.get_msg() << endl;
+	    ++errors;
+	    return false;
+	}
+	if (decoder.get_docid() != did) {
+	    if (out)
+		*out << "First docid in chunk " << decoder.get_docid()
+		     << " doesn't match " << did << " from the key" << endl;
+	    ++errors;
+	}
+	item();
+	return true;
+    }
+
+    Xapian::docid get_docid() const { return decoder.get_docid(); }
+
+    Xapian::termcount get_wdf() const { return decoder.get_wdf(); }
+
+    /** Move to the next item.
+     *
+     *  @return false at the end of the chunk, or if there's an error (in
+     *	 which case @a bad is set to true).
+     */
+    bool next(bool & bad) {
+	Xapian::docid block_last = decoder.get_block_last_docid();
+	Xapian::termcount block_max = decoder.get_block_max_wdf();
+	bool more;
+	try {
+	    more = decoder.next();
+	} catch (const Xapian::Error & e) {
+	    if (out)
+		*out << "Failed to decode chunk: " << e.get_msg() << endl;
+	    ++errors;
+	    bad = true;
+	    return false;
+	}
+	if (!more || decoder.get_block_last_docid() != block_last) {
+	    if (block_max != block_max_wdf) {
+		if (out)
+		    *out << "Block max wdf " << block_max << " != actual max "
+			    "wdf " << block_max_wdf << endl;
+		++errors;
+	    }
+	    block_max_wdf = 0;
+	}
+	if (!more) {
+	    if (decoder.get_chunk_max_wdf() != max_wdf) {
+		if (out)
+		    *out << "Chunk max wdf " << decoder.get_chunk_max_wdf()
+			 << " != actual max wdf " << max_wdf << endl;
+		++errors;
+	    }
+	    return false;
+	}
+	item();
+	return true;
+    }
+};
+
 size_t
 check_brass_table(const char * tablename, string filename,
 		  brass_revision_number_t * rev_ptr, int opts,
@@ -214,16 +328,12 @@ check_brass_table(const char * tablename, string filename,
 		    continue;
 		}
 		lastdid += did;
+		ChunkCheck chunk(NULL, out, errors);
+		if (!chunk.start(pos, end, did)) continue;
 		bool bad = false;
-		while (true) {
-		    Xapian::termcount doclen;
-		    if (!unpack_uint(&pos, end, &doclen)) {
-			if (out)
-			    *out << "Failed to unpack doclen" << endl;
-			++errors;
-			bad = true;
-			break;
-		    }
+		do {
+		    did = chunk.get_docid();
+		    Xapian::termcount doclen = chunk.get_wdf();
 
 		    if (did > db_last_docid) {
 			if (out)
@@ -250,25 +360,13 @@ check_brass_table(const char * tablename, string filename,
 			}
 		    }
 
-		    if (pos == end) break;
-
-		    Xapian::docid inc;
-		    if (!unpack_uint(&pos, end, &inc)) {
-			if (out)
-			    *out << "Failed to unpack docid increase" << endl;
-			++errors;
-			bad = true;
-			break;
-		    }
-		    ++inc;
-		    did += inc;
 		    if (did > lastdid) {
 			if (out)
 			    *out << "docid " << did << " > last docid "
 				 << lastdid << endl;
 			++errors;
 		    }
-		}
+		} while (chunk.next(bad));
 		if (bad) {
 		    continue;
 		}
@@ -541,38 +639,22 @@ check_brass_table(const char * tablename, string filename,
 		continue;
 	    }
 	    lastdid += did;
+	    ChunkCheck chunk(&doclens, out, errors);
+	    if (!chunk.start(pos, end, did)) continue;
 	    bool bad = false;
-	    while (true) {
-		Xapian::termcount wdf;
-		if (!unpack_uint(&pos, end, &wdf)) {
-		    if (out)
-			*out << "Failed to unpack wdf" << endl;
-		    ++errors;
-		    bad = true;
-		    break;
-		}
+	    do {
+		did = chunk.get_docid();
+		Xapian::termcount wdf = chunk.get_wdf();
 		++tf;
 		cf += wdf;
 
-		if (pos == end) break;
-
-		Xapian::docid inc;
-		if (!unpack_uint(&pos, end, &inc)) {
-		    if (out)
-			*out << "Failed to unpack docid increase" << endl;
-		    ++errors;
-		    bad = true;
-		    break;
-		}
-		++inc;
-		did += inc;
 		if (did > lastdid) {
 		    if (out)
 			*out << "docid " << did << " > last docid " << lastdid
 			     << endl;
 		    ++errors;
 		}
-	    }
+	    } while (chunk.next(bad));
 	    if (bad) {
 		continue;
 	    }
@@ -786,7 +868,8 @@ check_brass_table(const char * tablename, string filename,
 		}
 
 		++actual_termlist_size;
-		actual_doclen += current_wdf;
+		if (!is_edge_ngram(current_tname))
+		    actual_doclen += current_wdf;
 	    }
 	    if (bad) {
 		continue;
@@ -836,6 +919,31 @@ check_brass_table(const char * tablename, string filename,
 	    pos = data.data();
 	    end = pos + data.size();
 
+	    vector<unsigned> positions;
+	    bool streamvbyte;
+	    try {
+		streamvbyte =
+		    BrassPositionListTable::unpack_streamvbyte(data, positions);
+	    } catch (const Xapian::DatabaseCorruptError &) {
+		if (out)
+		    *out << tablename << " table: Position list data corrupt"
+			 << endl;
+		++errors;
+		continue;
+	    }
+	    if (streamvbyte) {
+		for (size_t i = 1; i != positions.size(); ++i) {
+		    if (positions[i] <= positions[i - 1]) {
+			if (out)
+			    *out << tablename << " table: Positions not "
+				    "strictly monotonically increasing" << endl;
+			++errors;
+			break;
+		    }
+		}
+		continue;
+	    }
+
 	    Xapian::termpos pos_last;
 	    if (!unpack_uint(&pos, end, &pos_last)) {
 		if (out)
@@ -0,0 +1,126 @@
+/** @file brass_doclencache.cc
+ * @brief Process-wide cache of brass document lengths.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "brass_doclencache.h"
+
+#include "brass_postlist.h"
+#include "debuglog.h"
+#include "omassert.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+
+/// Value in doclens for a document whose length hasn't been read.
+static const Xapian::termcount UNREAD = Xapian::termcount(-2);
+
+BrassDocLenArray::BrassDocLenArray(Xapian::docid last_did)
+    : doclens(last_did + 1, UNREAD),
+      page_filled((last_did >> PAGE_SHIFT) + 1, false),
+      users(0)
+{
+    doclens[0] = MISSING;
+}
+
+void
+BrassDocLenArray::read_page(size_t page, BrassPostList & pl)
+{
+    LOGCALL_VOID(DB, "BrassDocLenArray::read_page", page);
+    MutexLock lock(mutex);
+    if (page_filled[page]) return;
+    Xapian::docid did = max(Xapian::docid(page << PAGE_SHIFT),
+			    Xapian::docid(1));
+    Xapian::docid last = min(Xapian::docid(((page + 1) << PAGE_SHIFT) - 1),
+			     Xapian::docid(doclens.size() - 1));
+    // Only this page's entries get written, since tables in other threads
+    // may be reading the entries of pages which are already filled.
+    while (did <= last) {
+	did = pl.read_doclens(did, last, doclens, MISSING) + 1;
+    }
+    page_filled[page] = true;
+}
+
+BrassDocLenCache *
+BrassDocLenCache::get_instance()
+{
+    // The instance is deliberately never deleted, as tables may still be
+    // using it while static destructors run.
+    static BrassDocLenCache * instance = NULL;
+    static Mutex init_mutex;
+    MutexLock lock(init_mutex);
+    // Keep checking the environment until the cache is enabled, so it can
+    // be enabled after the first database has been opened.
+    if (!instance) {
+	const char *p = getenv("XAPIAN_DOCLEN_CACHE_SIZE");
+	if (p) {
+	    size_t capacity = strtoul(p, NULL, 10);
+	    if (capacity) instance = new BrassDocLenCache(capacity);
+	}
+    }
+    return instance;
+}
+
+BrassDocLenArray *
+BrassDocLenCache::get_array(const string & file_identity,
+			    brass_revision_number_t revision,
+			    Xapian::docid last_did)
+{
+    LOGCALL(DB, BrassDocLenArray *, "BrassDocLenCache::get_array", file_identity.size() | revision | last_did);
+    MutexLock lock(mutex);
+    Key key(file_identity, revision);
+    BrassDocLenArray ** p = arrays.find(key);
+    if (p) {
+	++(*p)->users;
+	RETURN(*p);
+    }
+
+    size_t len = (size_t(last_did) + 1) * sizeof(Xapian::termcount);
+    if (len > capacity) RETURN(NULL);
+    // Evict the least recently used arrays which aren't in use.
+    LRUCache<Key, BrassDocLenArray *>::iterator i = arrays.end();
+    while (used + len > capacity) {
+	do {
+	    if (i == arrays.begin()) RETURN(NULL);
+	    --i;
+	} while (i->second->users);
+	LOGLINE(DB, "Evicting doclen array for revision " << i->first.revision);
+	used -= i->second->get_bytes();
+	delete i->second;
+	i = arrays.erase(i);
+    }
+
+    BrassDocLenArray * array = new BrassDocLenArray(last_did);
+    used += array->get_bytes();
+    array->users = 1;
+    arrays.insert(key, array);
+    RETURN(array);
+}
+
+void
+BrassDocLenCache::release(BrassDocLenArray * array)
+{
+    MutexLock lock(mutex);
+    AssertRel(array->users,>,0);
+    --array->users;
+}
@@ -0,0 +1,181 @@
+/** @file brass_doclencache.h
+ * @brief Process-wide cache of brass document lengths.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_BRASS_DOCLENCACHE_H
+#define XAPIAN_INCLUDED_BRASS_DOCLENCACHE_H
+
+#include "brass_types.h"
+#include "lrucache.h"
+#include "mutexlock.h"
+#include "xapian/types.h"
+
+#include <string>
+#include <vector>
+
+class BrassPostList;
+
+/** Dense array of the document lengths in one revision of a postlist table.
+ *
+ *  The array is indexed by docid and sized from the highest docid in use.
+ *  It's filled in a page of docids at a time as lengths are needed, so
+ *  documents which are never scored cost no reads.
+ *
+ *  The array is shared by every table with that revision open, which may be
+ *  in different threads.  A page is only written while holding @a mutex,
+ *  and never changes once filled, so a table which has seen a page filled
+ *  (by calling read_page()) can read its entries without locking.
+ */
+class BrassDocLenArray {
+    friend class BrassDocLenCache;
+
+    /// Don't allow assignment.
+    void operator=(const BrassDocLenArray &);
+
+    /// Don't allow copying.
+    BrassDocLenArray(const BrassDocLenArray &);
+
+    /// The length of each document, or MISSING if it doesn't exist.
+    std::vector<Xapian::termcount> doclens;
+
+    /// Which pages of @a doclens have been filled.
+    std::vector<bool> page_filled;
+
+    /// Protects filling pages.
+    Mutex mutex;
+
+    /// How many tables are using this array (protected by the cache's mutex).
+    unsigned users;
+
+  public:
+    /// Entry for a document which doesn't exist.
+    static const Xapian::termcount MISSING = Xapian::termcount(-1);
+
+    /// log2 of the number of docids in a page.
+    static const unsigned PAGE_SHIFT = 10;
+
+    /// Create an array for docids up to @a last_did.
+    explicit BrassDocLenArray(Xapian::docid last_did);
+
+    /// Return the number of entries (the highest docid plus one).
+    Xapian::docid size() const { return doclens.size(); }
+
+    /// Return the number of pages.
+    size_t get_page_count() const { return page_filled.size(); }
+
+    /// Return the number of bytes used by the lengths.
+    size_t get_bytes() const {
+	return doclens.size() * sizeof(Xapian::termcount);
+    }
+
+    /** Make sure page @a page is filled.
+     *
+     *  @param page	The page to fill.
+     *  @param pl	The doclen postlist of the table, used to read the
+     *			lengths if this page hasn't been filled yet.
+     */
+    void read_page(size_t page, BrassPostList & pl);
+
+    /** Return the length of document @a did, or MISSING.
+     *
+     *  The page containing @a did must have been filled by a call to
+     *  read_page() from this thread.
+     */
+    Xapian::termcount get(Xapian::docid did) const { return doclens[did]; }
+};
+
+/** A size-bounded cache of BrassDocLenArray objects, shared by all read-only
+ *  brass postlist tables in the process.
+ *
+ *  Arrays are keyed by the file and revision, so the extra instances of a
+ *  database opened to match docid ranges in parallel share one array, and
+ *  so does a database which is reopened at the same revision.  Arrays for
+ *  old revisions get evicted as they fall out of use, but an array which a
+ *  table is using is never evicted.
+ *
+ *  The cache is enabled by setting XAPIAN_DOCLEN_CACHE_SIZE in the
+ *  environment to the maximum number of bytes of arrays to hold.
+ */
+class BrassDocLenCache {
+    /// Don't allow copying.
+    BrassDocLenCache(const BrassDocLenCache &);
+
+    /// Don't allow assignment.
+    void operator=(const BrassDocLenCache &);
+
+    struct Key {
+	std::string file_identity;
+
+	brass_revision_number_t revision;
+
+	Key(const std::string & file_identity_,
+	    brass_revision_number_t revision_)
+	    : file_identity(file_identity_), revision(revision_) { }
+
+	bool operator<(const Key & o) const {
+	    if (revision != o.revision) return revision < o.revision;
+	    return file_identity < o.file_identity;
+	}
+    };
+
+    /// The cached arrays.
+    LRUCache<Key, BrassDocLenArray *> arrays;
+
+    /// The number of bytes used by the arrays in @a arrays.
+    size_t used;
+
+    /// The maximum number of bytes to use.
+    size_t capacity;
+
+    /// Protects all the above.
+    Mutex mutex;
+
+  public:
+    /// Create a cache holding up to @a capacity_ bytes of arrays.
+    explicit BrassDocLenCache(size_t capacity_)
+	: used(0), capacity(capacity_) { }
+
+    /** Return the process-wide cache.
+     *
+     *  @return NULL if the cache isn't enabled.
+     */
+    static BrassDocLenCache * get_instance();
+
+    /** Return the array for a revision of a table.
+     *
+     *  The caller must pass the array to release() once it's finished with
+     *  it.
+     *
+     *  @param file_identity	String identifying the file uniquely (from
+     *				BrassTable::get_file_identity()).
+     *  @param revision		The revision of the table.
+     *  @param last_did		The highest docid in use in that revision.
+     *
+     *  @return The array, or NULL if it wouldn't fit in the cache.
+     */
+    BrassDocLenArray * get_array(const std::string & file_identity,
+				 brass_revision_number_t revision,
+				 Xapian::docid last_did);
+
+    /// Say a table has finished with an array returned by get_array().
+    void release(BrassDocLenArray * array);
+};
+
+#endif // XAPIAN_INCLUDED_BRASS_DOCLENCACHE_H
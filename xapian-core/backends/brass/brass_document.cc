@@ -29,6 +29,18 @@
 #include "brass_values.h"
 #include "brass_record.h"
 
+/// Passes tags read from a table on to a Xapian::DataSink.
+class BrassDataSink : public BrassTagSink {
+    Xapian::DataSink & sink;
+
+  public:
+    explicit BrassDataSink(Xapian::DataSink & sink_) : sink(sink_) { }
+
+    void append(const char * p, size_t len) {
+	if (len) sink.append(p, len);
+    }
+};
+
 /** Retrieve a value from the database
  *
  *  @param slot	The value number to retrieve.
@@ -57,3 +69,13 @@ BrassDocument::do_get_data() const
     LOGCALL(DB, string, "BrassDocument::do_get_data", NO_ARGS);
     RETURN(record_table->get_record(did));
 }
+
+/** Pass the document data from the database to sink in pieces
+ */
+void
+BrassDocument::do_stream_data(Xapian::DataSink & sink) const
+{
+    LOGCALL_VOID(DB, "BrassDocument::do_stream_data", Literal("sink"));
+    BrassDataSink tag_sink(sink);
+    record_table->get_record(did, tag_sink);
+}
@@ -56,6 +56,7 @@ class BrassDocument : public Xapian::Document::Internal {
     string do_get_value(Xapian::valueno slot) const;
     void do_get_all_values(map<Xapian::valueno, string> & values_) const;
     string do_get_data() const;
+    void do_stream_data(Xapian::DataSink & sink) const;
     /** @} */
 };
 
@@ -56,17 +56,18 @@ BrassFreeList::write_block(BrassTable * B, uint4 n, byte * ptr)
 }
 
 uint4
-BrassFreeList::get_block(BrassTable *B)
+BrassFreeList::get_block(BrassTable *B, uint4 * blk_to_free)
 {
     if (fl == fl_end) {
 	return first_unused_block++;
     }
 
     if (p == 0 || fl.c == block_size - 4) {
+	uint4 finished_blk = BLK_UNUSED;
 	if (p == 0) {
 	    p = new byte[block_size];
 	} else {
-	    mark_block_unused(B, fl.n);
+	    finished_blk = fl.n;
 	    fl.n = getint4(p, fl.c);
 	    // Allow for mini-header at start of freelist block.
 	    fl.c = C_BASE;
@@ -77,7 +78,20 @@ BrassFreeList::get_block(BrassTable *B)
 	// next pointer.
 	Assert(fl.n == fl_end.n || getint4(p, block_size - 4) != -1);
 
-	return get_block(B);
+	if (finished_blk != BLK_UNUSED) {
+	    // Only mark the finished freelist block as unused now we've moved
+	    // past it, as doing so may need to get a block.  If we were called
+	    // by mark_block_unused(), it's part way through updating flw, so
+	    // leave it to mark the block as unused once it's done.
+	    if (blk_to_free) {
+		AssertEq(*blk_to_free, BLK_UNUSED);
+		*blk_to_free = finished_blk;
+	    } else {
+		mark_block_unused(B, finished_blk);
+	    }
+	}
+
+	return get_block(B, blk_to_free);
     }
 
     // Either the freelist end is in this block, or this freelist block has a
@@ -100,7 +114,7 @@ BrassFreeList::walk(BrassTable *B, bool inclusive)
 	return static_cast<uint4>(-1);
     }
 
-    if (p == 0 || fl.c == block_size) {
+    if (p == 0 || fl.c == block_size - 4) {
 	if (p == 0) {
 	    p = new byte[block_size];
 	} else {
@@ -132,6 +146,11 @@ BrassFreeList::walk(BrassTable *B, bool inclusive)
 void
 BrassFreeList::mark_block_unused(BrassTable * B, uint4 blk)
 {
+    // If we need a new block for the freelist and get_block() reaches the end
+    // of a freelist block, that block needs marking as unused too, but we
+    // can't do that until we've finished updating flw here.
+    uint4 blk_to_free = BLK_UNUSED;
+
     if (!pw) {
 	pw = new byte[block_size];
 	if (flw.c != 0) {
@@ -140,7 +159,7 @@ BrassFreeList::mark_block_unused(BrassTable * B, uint4 blk)
 	}
     }
     if (flw.c == 0) {
-	uint4 n = get_block(B);
+	uint4 n = get_block(B, &blk_to_free);
 	flw.n = n;
 	flw.c = C_BASE;
 	if (fl.c == 0) {
@@ -151,7 +170,7 @@ BrassFreeList::mark_block_unused(BrassTable * B, uint4 blk)
     } else if (flw.c == block_size - 4) {
 	// blk is free *after* the current revision gets released, so we can't
 	// just use blk as the next block in the freelist chain.
-	uint4 n = get_block(B);
+	uint4 n = get_block(B, &blk_to_free);
 	setint4(pw, flw.c, n);
 	SET_REVISION(pw, revision + 1);
 	write_block(B, flw.n, pw);
@@ -167,6 +186,9 @@ BrassFreeList::mark_block_unused(BrassTable * B, uint4 blk)
 
     setint4(pw, flw.c, blk);
     flw.c += 4;
+
+    if (blk_to_free != BLK_UNUSED)
+	mark_block_unused(B, blk_to_free);
 }
 
 void
@@ -99,7 +99,13 @@ class BrassFreeList {
 
     bool empty() const { return fl == fl_end; }
 
-    uint4 get_block(BrassTable * B);
+    /** Get a free block.
+     *
+     *  @param blk_to_free	If non-NULL and we finish reading a freelist
+     *				block, set *blk_to_free to it rather than
+     *				marking it as unused.
+     */
+    uint4 get_block(BrassTable * B, uint4 * blk_to_free = NULL);
 
     uint4 walk(BrassTable *B, bool inclusive);
 
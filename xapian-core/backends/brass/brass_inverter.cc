@@ -26,12 +26,272 @@
 #include "brass_positionlist.h"
 
 #include "api/termlist.h"
+#include "backends/memoryused.h"
 
+#include <algorithm>
+#include <cstring>
 #include <map>
 #include <string>
+#include <vector>
 
 using namespace std;
 
+/// Size of the blocks the Arena allocates.
+const size_t ARENA_BLOCK_SIZE = 65536;
+
+/// Number of entries in the first PostingBlock for a term.
+const unsigned MIN_POSTING_BLOCK = 4;
+
+/// Maximum number of entries in a PostingBlock.
+const unsigned MAX_POSTING_BLOCK = 1024;
+
+/// Initial number of slots in the hash table of terms.
+const size_t MIN_HASH_SLOTS = 1024;
+
+void *
+Inverter::Arena::alloc(size_t len)
+{
+    // Round up so that every allocation is suitably aligned.
+    len = (len + 7) & ~size_t(7);
+    if (len > left) {
+	if (len >= ARENA_BLOCK_SIZE / 4) {
+	    // Give large allocations a block of their own, so we don't waste
+	    // the rest of the current block.
+	    char * p = new char[len];
+	    blocks.push_back(p);
+	    total += len;
+	    return p;
+	}
+	next = new char[ARENA_BLOCK_SIZE];
+	blocks.push_back(next);
+	total += ARENA_BLOCK_SIZE;
+	left = ARENA_BLOCK_SIZE;
+    }
+    char * p = next;
+    next += len;
+    left -= len;
+    return p;
+}
+
+void
+Inverter::Arena::clear()
+{
+    vector<char *>::const_iterator i;
+    for (i = blocks.begin(); i != blocks.end(); ++i)
+	delete [] *i;
+    blocks.clear();
+    next = NULL;
+    left = 0;
+    total = 0;
+}
+
+void
+Inverter::PostingChanges::append(Arena & arena,
+				 Xapian::docid did, Xapian::termcount wdf)
+{
+    if (count && did <= last->postings[last->used - 1].did)
+	ordered = false;
+    if (!last || last->used == last->size) {
+	// Make each block bigger than the last (up to a limit) so that terms
+	// with a lot of changes don't need a lot of blocks.
+	unsigned n = MIN_POSTING_BLOCK;
+	if (last) n = min(last->size * 2, MAX_POSTING_BLOCK);
+	void * p = arena.alloc(sizeof(PostingBlock) + (n - 1) * sizeof(Posting));
+	PostingBlock * block = static_cast<PostingBlock *>(p);
+	block->next = NULL;
+	block->used = 0;
+	block->size = n;
+	if (last)
+	    last->next = block;
+	else
+	    first = block;
+	last = block;
+    }
+    Posting & posting = last->postings[last->used++];
+    posting.did = did;
+    posting.wdf = wdf;
+    ++count;
+}
+
+void
+Inverter::PostingChanges::get_changes(vector<Posting> & changes) const
+{
+    changes.clear();
+    changes.reserve(count);
+    for (const PostingBlock * block = first; block; block = block->next) {
+	changes.insert(changes.end(),
+		       block->postings, block->postings + block->used);
+    }
+    // Usually the changes are in docid order already, so there's nothing
+    // more to do.
+    if (ordered) return;
+
+    // Sort by docid, keeping changes to the same docid in the order they
+    // were made, and then just keep the last change to each docid.
+    stable_sort(changes.begin(), changes.end());
+    vector<Posting>::iterator i, j = changes.begin();
+    for (i = changes.begin(); i != changes.end(); ++i) {
+	vector<Posting>::const_iterator next = i + 1;
+	if (next != changes.end() && next->did == i->did)
+	    continue;
+	*j++ = *i;
+    }
+    changes.erase(j, changes.end());
+}
+
+size_t
+Inverter::hash_term(const string & term)
+{
+    // FNV-1a hash.
+    size_t h = 2166136261u;
+    for (string::const_iterator i = term.begin(); i != term.end(); ++i) {
+	h ^= static_cast<unsigned char>(*i);
+	h *= 16777619u;
+    }
+    return h;
+}
+
+Inverter::TermSlot *
+Inverter::find_term(const string & term) const
+{
+    if (postlist_changes_used == 0) return NULL;
+    size_t h = hash_term(term);
+    size_t mask = postlist_changes.size() - 1;
+    for (size_t i = h & mask; ; i = (i + 1) & mask) {
+	const TermSlot & slot = postlist_changes[i];
+	if (!slot.term) return NULL;
+	if (slot.hash == h && slot.term_len == term.size() &&
+	    memcmp(slot.term, term.data(), term.size()) == 0) {
+	    return const_cast<TermSlot *>(&slot);
+	}
+    }
+}
+
+Inverter::PostingChanges &
+Inverter::get_term(const string & term)
+{
+    if ((postlist_changes_used + 1) * 4 > postlist_changes.size() * 3) {
+	// Keep the load factor below 3/4 by doubling the size and rehashing.
+	size_t new_size = max(postlist_changes.size() * 2, MIN_HASH_SLOTS);
+	vector<TermSlot> old(new_size);
+	swap(old, postlist_changes);
+	size_t mask = new_size - 1;
+	vector<TermSlot>::const_iterator s;
+	for (s = old.begin(); s != old.end(); ++s) {
+	    if (!s->term) continue;
+	    size_t i = s->hash & mask;
+	    while (postlist_changes[i].term) i = (i + 1) & mask;
+	    postlist_changes[i] = *s;
+	}
+    }
+
+    size_t h = hash_term(term);
+    size_t mask = postlist_changes.size() - 1;
+    size_t i;
+    for (i = h & mask; postlist_changes[i].term; i = (i + 1) & mask) {
+	TermSlot & slot = postlist_changes[i];
+	if (slot.hash == h && slot.term_len == term.size() &&
+	    memcmp(slot.term, term.data(), term.size()) == 0) {
+	    return slot.changes;
+	}
+    }
+
+    TermSlot & slot = postlist_changes[i];
+    // Allocate at least one byte so that an empty term isn't NULL.
+    char * p = static_cast<char *>(arena.alloc(term.size() + 1));
+    memcpy(p, term.data(), term.size());
+    slot.term = p;
+    slot.term_len = term.size();
+    slot.hash = h;
+    ++postlist_changes_used;
+    return slot.changes;
+}
+
+void
+Inverter::erase_slot(TermSlot * slot)
+{
+    Assert(slot && slot->term);
+    if (--postlist_changes_used == 0) {
+	// Nothing else refers to the arena, so we can release it all.
+	postlist_changes.clear();
+	arena.clear();
+	return;
+    }
+
+    // Move any following entries in the same probe sequence back so that
+    // there are no gaps in it.
+    size_t mask = postlist_changes.size() - 1;
+    size_t i = slot - &postlist_changes[0];
+    size_t j = i;
+    while (true) {
+	j = (j + 1) & mask;
+	if (!postlist_changes[j].term) break;
+	size_t k = postlist_changes[j].hash & mask;
+	// The entry at j can stay put if its home slot k is cyclically in
+	// (i, j].
+	if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+	    continue;
+	postlist_changes[i] = postlist_changes[j];
+	i = j;
+    }
+    postlist_changes[i] = TermSlot();
+}
+
+/// Order TermSlot pointers by term, as std::string would.
+struct TermSlotLess {
+    template<class T>
+    bool operator()(const T * a, const T * b) const {
+	size_t len = min(a->term_len, b->term_len);
+	int r = memcmp(a->term, b->term, len);
+	if (r) return r < 0;
+	return a->term_len < b->term_len;
+    }
+};
+
+void
+Inverter::flush_slot(BrassPostListTable & table, const TermSlot & slot)
+{
+    table.merge_changes(string(slot.term, slot.term_len), slot.changes,
+			doclen_changes);
+}
+
+void
+Inverter::flush_slots(BrassPostListTable & table, vector<TermSlot *> & slots)
+{
+    // The postlist table is keyed by term, so it's much more efficient to
+    // apply the changes in term order.
+    sort(slots.begin(), slots.end(), TermSlotLess());
+    vector<TermSlot *>::const_iterator i;
+    for (i = slots.begin(); i != slots.end(); ++i)
+	flush_slot(table, **i);
+
+    if (slots.size() == postlist_changes_used) {
+	postlist_changes.clear();
+	postlist_changes_used = 0;
+	arena.clear();
+	return;
+    }
+
+    // Erasing moves entries around, so we need to look each term up again.
+    vector<string> terms;
+    terms.reserve(slots.size());
+    for (i = slots.begin(); i != slots.end(); ++i)
+	terms.push_back(string((*i)->term, (*i)->term_len));
+    vector<string>::const_iterator t;
+    for (t = terms.begin(); t != terms.end(); ++t)
+	erase_slot(find_term(*t));
+}
+
+size_t
+Inverter::get_memory_used() const
+{
+    size_t total = arena.size();
+    total += postlist_changes.size() * sizeof(TermSlot);
+    total += map_memory_used(doclen_changes);
+    total += pos_changes_size;
+    return total;
+}
+
 void
 Inverter::store_positions(const BrassPositionListTable & position_table,
 			  Xapian::docid did,
@@ -50,6 +310,8 @@ Inverter::store_positions(const BrassPositionListTable & position_table,
 	    j = m.find(did);
 	    if (j != m.end()) {
 		// Update existing entry.
+		pos_changes_size += s.size();
+		pos_changes_size -= j->second.size();
 		swap(j->second, s);
 		return;
 	    }
@@ -96,8 +358,19 @@ Inverter::set_positionlist(Xapian::docid did,
 			   const string & term,
 			   const string & s)
 {
-    pos_changes.insert(make_pair(term, map<Xapian::docid, string>()))
-	.first->second[did] = s;
+    pair<map<string, map<Xapian::docid, string> >::iterator, bool> r;
+    r = pos_changes.insert(make_pair(term, map<Xapian::docid, string>()));
+    if (r.second)
+	pos_changes_size += sizeof(*r.first) + term.size() + MAP_NODE_OVERHEAD;
+    map<Xapian::docid, string> & m = r.first->second;
+    pair<map<Xapian::docid, string>::iterator, bool> r2;
+    r2 = m.insert(make_pair(did, string()));
+    if (r2.second)
+	pos_changes_size += sizeof(*r2.first) + MAP_NODE_OVERHEAD;
+    else
+	pos_changes_size -= r2.first->second.size();
+    r2.first->second = s;
+    pos_changes_size += s.size();
 }
 
 void
@@ -160,23 +433,24 @@ Inverter::flush_doclengths(BrassPostListTable & table)
 void
 Inverter::flush_post_list(BrassPostListTable & table, const string & term)
 {
-    map<string, PostingChanges>::iterator i;
-    i = postlist_changes.find(term);
-    if (i == postlist_changes.end()) return;
+    TermSlot * slot = find_term(term);
+    if (!slot) return;
 
     // Flush buffered changes for just this term's postlist.
-    table.merge_changes(term, i->second);
-    postlist_changes.erase(i);
+    flush_slot(table, *slot);
+    erase_slot(slot);
 }
 
 void
 Inverter::flush_all_post_lists(BrassPostListTable & table)
 {
-    map<string, PostingChanges>::const_iterator i;
+    vector<TermSlot *> slots;
+    slots.reserve(postlist_changes_used);
+    vector<TermSlot>::iterator i;
     for (i = postlist_changes.begin(); i != postlist_changes.end(); ++i) {
-	table.merge_changes(i->first, i->second);
+	if (i->term) slots.push_back(&*i);
     }
-    postlist_changes.clear();
+    flush_slots(table, slots);
 }
 
 void
@@ -185,24 +459,24 @@ Inverter::flush_post_lists(BrassPostListTable & table, const string & pfx)
     if (pfx.empty())
 	return flush_all_post_lists(table);
 
-    map<string, PostingChanges>::iterator i, begin, end;
-    begin = postlist_changes.lower_bound(pfx);
-    end = postlist_changes.upper_bound(pfx);
-
-    for (i = begin; i != end; ++i) {
-	table.merge_changes(i->first, i->second);
+    vector<TermSlot *> slots;
+    vector<TermSlot>::iterator i;
+    for (i = postlist_changes.begin(); i != postlist_changes.end(); ++i) {
+	if (i->term && i->term_len >= pfx.size() &&
+	    memcmp(i->term, pfx.data(), pfx.size()) == 0) {
+	    slots.push_back(&*i);
+	}
     }
-
-    // Erase all the entries in one go, as that's:
-    //  O(log(postlist_changes.size()) + O(number of elements removed)
-    postlist_changes.erase(begin, end);
+    flush_slots(table, slots);
 }
 
 void
 Inverter::flush(BrassPostListTable & table)
 {
-    flush_doclengths(table);
+    // Flush the postlists first, since merging them looks up the new
+    // document lengths in doclen_changes.
     flush_all_post_lists(table);
+    flush_doclengths(table);
 }
 
 void
@@ -223,4 +497,5 @@ Inverter::flush_pos_lists(BrassPositionListTable & table)
 	}
     }
     pos_changes.clear();
+    pos_changes_size = 0;
 }
@@ -45,9 +45,72 @@ const Xapian::termcount DELETED_POSTING = Xapian::termcount(-1);
 class Inverter {
     friend class BrassPostListTable;
 
+    /** Simple allocator which hands out memory from large blocks.
+     *
+     *  Memory can't be released individually - it's all released by clear().
+     */
+    class Arena {
+	/// Don't allow copying.
+	Arena(const Arena &);
+
+	/// Don't allow assignment.
+	void operator=(const Arena &);
+
+	/// The blocks allocated.
+	std::vector<char *> blocks;
+
+	/// Next free byte in the current block.
+	char * next;
+
+	/// Bytes left in the current block.
+	size_t left;
+
+	/// Total size of the blocks allocated.
+	size_t total;
+
+      public:
+	Arena() : next(NULL), left(0), total(0) { }
+
+	~Arena() { clear(); }
+
+	/// Allocate @a len bytes, suitably aligned for any type.
+	void * alloc(size_t len);
+
+	/// Release all the memory allocated.
+	void clear();
+
+	/// Total number of bytes allocated from the system.
+	size_t size() const { return total; }
+    };
+
+    /// A buffered change to a posting.
+    struct Posting {
+	Xapian::docid did;
+
+	/// The new wdf, or DELETED_POSTING.
+	Xapian::termcount wdf;
+
+	bool operator<(const Posting & o) const { return did < o.did; }
+    };
+
+    /// A block of Posting objects allocated from the Arena.
+    struct PostingBlock {
+	/// The next block for this term, or NULL.
+	PostingBlock * next;
+
+	/// The number of entries in use.
+	unsigned used;
+
+	/// The number of entries allocated.
+	unsigned size;
+
+	/// The entries (actually size of them).
+	Posting postings[1];
+    };
+
     /// Class for storing the changes in frequencies for a term.
     class PostingChanges {
-	friend class BrassPostListTable;
+	friend class Inverter;
 
 	/// Change in term frequency,
 	Xapian::termcount_diff tf_delta;
@@ -55,53 +118,51 @@ class Inverter {
 	/// Change in collection frequency.
 	Xapian::termcount_diff cf_delta;
 
-	/// Changes to this term's postlist.
-	std::map<Xapian::docid, Xapian::termcount> pl_changes;
+	/** Changes to this term's postlist, in the order they were made.
+	 *
+	 *  If the same docid appears more than once, the last change wins.
+	 */
+	PostingBlock * first;
 
-      public:
-	/// Constructor for an added posting.
-	PostingChanges(Xapian::docid did, Xapian::termcount wdf)
-	    : tf_delta(1), cf_delta(Xapian::termcount_diff(wdf))
-	{
-	    pl_changes.insert(std::make_pair(did, wdf));
-	}
+	/// The block to append new changes to.
+	PostingBlock * last;
 
-	/// Constructor for a removed posting.
-	PostingChanges(Xapian::docid did, Xapian::termcount wdf, bool)
-	    : tf_delta(-1), cf_delta(-Xapian::termcount_diff(wdf))
-	{
-	    pl_changes.insert(std::make_pair(did, DELETED_POSTING));
-	}
+	/// The number of changes (including any superseded ones).
+	Xapian::doccount count;
 
-	/// Constructor for an updated posting.
-	PostingChanges(Xapian::docid did, Xapian::termcount old_wdf,
-		       Xapian::termcount new_wdf)
-	    : tf_delta(0), cf_delta(Xapian::termcount_diff(new_wdf - old_wdf))
-	{
-	    pl_changes.insert(std::make_pair(did, new_wdf));
-	}
+	/// True if the docids of the changes are in strictly ascending order.
+	bool ordered;
+
+	/// Append a change.
+	void append(Arena & arena, Xapian::docid did, Xapian::termcount wdf);
+
+      public:
+	PostingChanges()
+	    : tf_delta(0), cf_delta(0), first(NULL), last(NULL), count(0),
+	      ordered(true) { }
 
 	/// Add a posting.
-	void add_posting(Xapian::docid did, Xapian::termcount wdf) {
+	void add_posting(Arena & arena,
+			 Xapian::docid did, Xapian::termcount wdf) {
 	    ++tf_delta;
 	    cf_delta += wdf;
-	    // Add did to term's postlist
-	    pl_changes[did] = wdf;
+	    append(arena, did, wdf);
 	}
 
 	/// Remove a posting.
-	void remove_posting(Xapian::docid did, Xapian::termcount wdf) {
+	void remove_posting(Arena & arena,
+			    Xapian::docid did, Xapian::termcount wdf) {
 	    --tf_delta;
 	    cf_delta -= wdf;
-	    // Remove did from term's postlist.
-	    pl_changes[did] = DELETED_POSTING;
+	    append(arena, did, DELETED_POSTING);
 	}
 
 	/// Update a posting.
-	void update_posting(Xapian::docid did, Xapian::termcount old_wdf,
+	void update_posting(Arena & arena, Xapian::docid did,
+			    Xapian::termcount old_wdf,
 			    Xapian::termcount new_wdf) {
 	    cf_delta += new_wdf - old_wdf;
-	    pl_changes[did] = new_wdf;
+	    append(arena, did, new_wdf);
 	}
 
 	/// Get the term frequency delta.
@@ -109,14 +170,71 @@ class Inverter {
 
 	/// Get the collection frequency delta.
 	Xapian::termcount_diff get_cfdelta() const { return cf_delta; }
+
+	/** Get the changes in ascending docid order.
+	 *
+	 *  Where a docid was changed more than once, only the last change is
+	 *  returned.
+	 */
+	void get_changes(std::vector<Posting> & changes) const;
     };
 
-    /// Buffered changes to postlists.
-    std::map<std::string, PostingChanges> postlist_changes;
+    /// An entry in the hash table of terms with buffered postlist changes.
+    struct TermSlot {
+	/// The term (stored in the arena), or NULL if this slot is empty.
+	const char * term;
+
+	/// Length of the term.
+	size_t term_len;
+
+	/// Hash value of the term.
+	size_t hash;
+
+	PostingChanges changes;
+
+	TermSlot() : term(NULL) { }
+    };
+
+    /// Memory for the posting changes and the terms they're for.
+    Arena arena;
+
+    /** Open-addressing hash table of buffered changes to postlists.
+     *
+     *  Uses linear probing, and the size is always a power of two (or zero).
+     */
+    std::vector<TermSlot> postlist_changes;
+
+    /// The number of slots in postlist_changes in use.
+    size_t postlist_changes_used;
+
+    /// Approximate memory used by pos_changes.
+    size_t pos_changes_size;
 
     /// Buffered changes to positional data.
     std::map<std::string, std::map<Xapian::docid, std::string> > pos_changes;
 
+    /// Calculate the hash value for a term.
+    static size_t hash_term(const std::string & term);
+
+    /// Find the slot for @a term, or NULL if there isn't one.
+    TermSlot * find_term(const std::string & term) const;
+
+    /// Find the slot for @a term, adding an empty one if there isn't one.
+    PostingChanges & get_term(const std::string & term);
+
+    /// Remove the entry in @a slot from the hash table.
+    void erase_slot(TermSlot * slot);
+
+    /// Merge the changes in @a slot into @a table.
+    void flush_slot(BrassPostListTable & table, const TermSlot & slot);
+
+    /** Merge the changes in @a slots into @a table, in term order.
+     *
+     *  The slots are then erased.
+     */
+    void flush_slots(BrassPostListTable & table,
+		     std::vector<TermSlot *> & slots);
+
     void store_positions(const BrassPositionListTable & position_table,
 			 Xapian::docid did,
 			 const std::string & tname,
@@ -132,41 +250,22 @@ class Inverter {
     std::map<Xapian::docid, Xapian::termcount> doclen_changes;
 
   public:
+    Inverter() : postlist_changes_used(0), pos_changes_size(0) { }
+
     void add_posting(Xapian::docid did, const std::string & term,
 		     Xapian::doccount wdf) {
-	std::map<std::string, PostingChanges>::iterator i;
-	i = postlist_changes.find(term);
-	if (i == postlist_changes.end()) {
-	    postlist_changes.insert(
-		std::make_pair(term, PostingChanges(did, wdf)));
-	} else {
-	    i->second.add_posting(did, wdf);
-	}
+	get_term(term).add_posting(arena, did, wdf);
     }
 
     void remove_posting(Xapian::docid did, const std::string & term,
 			Xapian::doccount wdf) {
-	std::map<std::string, PostingChanges>::iterator i;
-	i = postlist_changes.find(term);
-	if (i == postlist_changes.end()) {
-	    postlist_changes.insert(
-		std::make_pair(term, PostingChanges(did, wdf, false)));
-	} else {
-	    i->second.remove_posting(did, wdf);
-	}
+	get_term(term).remove_posting(arena, did, wdf);
     }
 
     void update_posting(Xapian::docid did, const std::string & term,
 			Xapian::termcount old_wdf,
 			Xapian::termcount new_wdf) {
-	std::map<std::string, PostingChanges>::iterator i;
-	i = postlist_changes.find(term);
-	if (i == postlist_changes.end()) {
-	    postlist_changes.insert(
-		std::make_pair(term, PostingChanges(did, old_wdf, new_wdf)));
-	} else {
-	    i->second.update_posting(did, old_wdf, new_wdf);
-	}
+	get_term(term).update_posting(arena, did, old_wdf, new_wdf);
     }
 
     void set_positionlist(const BrassPositionListTable & position_table,
@@ -187,9 +286,20 @@ class Inverter {
     void clear() {
 	doclen_changes.clear();
 	postlist_changes.clear();
+	postlist_changes_used = 0;
+	arena.clear();
 	pos_changes.clear();
+	pos_changes_size = 0;
     }
 
+    /** Return an estimate of the memory used by the buffered changes.
+     *
+     *  This includes the memory allocated for the data structures, not just
+     *  the changes themselves, so it gives an idea of how much memory
+     *  flushing will release.
+     */
+    size_t get_memory_used() const;
+
     void set_doclength(Xapian::docid did, Xapian::termcount doclen, bool add) {
 	if (add) {
 	    Assert(doclen_changes.find(did) == doclen_changes.end() || doclen_changes[did] == DELETED_POSTING);
@@ -234,13 +344,12 @@ class Inverter {
     bool get_deltas(const std::string & term,
 		    Xapian::termcount_diff & tf_delta,
 		    Xapian::termcount_diff & cf_delta) const {
-	std::map<std::string, PostingChanges>::const_iterator i;
-	i = postlist_changes.find(term);
-	if (i == postlist_changes.end()) {
+	const TermSlot * slot = find_term(term);
+	if (!slot) {
 	    return false;
 	}
-	tf_delta = i->second.get_tfdelta();
-	cf_delta = i->second.get_cfdelta();
+	tf_delta = slot->changes.get_tfdelta();
+	cf_delta = slot->changes.get_cfdelta();
 	return true;
     }
 };
@@ -31,10 +31,11 @@ class BrassLazyTable : public BrassTable {
      *  @param path		The path for the table.
      *  @param readonly		true if the table is read-only, else false.
      *  @param z_strategy	zlib strategy.
+     *  @param codec_	The codec to compress tags with.
      */
     BrassLazyTable(const char * name_, const std::string & path, bool readonly,
-		   int z_strategy)
-	: BrassTable(name_, path, readonly, z_strategy, true) { }
+		   int z_strategy, int codec_ = BRASS_CODEC_ZLIB)
+	: BrassTable(name_, path, readonly, z_strategy, true, codec_) { }
 
     /** Lazy version of BrassTable::create_and_open().
      *
@@ -27,12 +27,23 @@
 #include "bitstream.h"
 #include "debuglog.h"
 #include "pack.h"
+#include "streamvbyte.h"
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
 using namespace std;
 
+/** Store position lists with at least this many entries using Stream VByte.
+ *
+ *  Interpolative coding is more compact, but has to be decoded a bit at a
+ *  time, which is slow for long lists.  Stream VByte lists start with a zero
+ *  byte, which the interpolative format never does except for a list whose
+ *  only entry is position 0.
+ */
+const Xapian::termcount STREAMVBYTE_MIN_POSITIONS = 32;
+
 void
 BrassPositionListTable::pack(string & s,
 			     const vector<Xapian::termpos> & vec) const
@@ -40,6 +51,19 @@ BrassPositionListTable::pack(string & s,
     LOGCALL_VOID(DB, "BrassPositionListTable::pack", s | vec);
     Assert(!vec.empty());
 
+    if (vec.size() >= STREAMVBYTE_MIN_POSITIONS) {
+	// Store the first position and then the gaps between positions.
+	vector<unsigned> gaps(vec.size());
+	gaps[0] = vec[0];
+	for (size_t i = 1; i != vec.size(); ++i) {
+	    gaps[i] = vec[i] - vec[i - 1];
+	}
+	s += '\0';
+	pack_uint(s, vec.size());
+	encode_streamvbyte(s, &gaps[0], gaps.size());
+	return;
+    }
+
     pack_uint(s, vec.back());
 
     if (vec.size() > 1) {
@@ -51,6 +75,30 @@ BrassPositionListTable::pack(string & s,
     }
 }
 
+bool
+BrassPositionListTable::unpack_streamvbyte(const string & data,
+					   vector<unsigned> & positions)
+{
+    if (data.size() <= 1 || data[0] != '\0') return false;
+    const char * pos = data.data() + 1;
+    const char * end = data.data() + data.size();
+    Xapian::termcount n;
+    if (!unpack_uint(&pos, end, &n) || n < 2) {
+	throw Xapian::DatabaseCorruptError("Position list data corrupt");
+    }
+    // decode_streamvbyte() needs room for a whole number of groups of four.
+    positions.resize((n + 3) &~ 3);
+    pos = decode_streamvbyte(pos, end, &positions[0], n);
+    if (pos != end) {
+	throw Xapian::DatabaseCorruptError("Position list data corrupt");
+    }
+    positions.resize(n);
+    for (size_t i = 1; i != n; ++i) {
+	positions[i] += positions[i - 1];
+    }
+    return true;
+}
+
 Xapian::termcount
 BrassPositionListTable::positionlist_count(Xapian::docid did,
 					   const string & term) const
@@ -64,6 +112,15 @@ BrassPositionListTable::positionlist_count(Xapian::docid did,
 
     const char * pos = data.data();
     const char * end = pos + data.size();
+    if (data.size() > 1 && *pos == '\0') {
+	// Stream VByte list, which starts with the number of entries.
+	++pos;
+	Xapian::termcount n;
+	if (!unpack_uint(&pos, end, &n)) {
+	    throw Xapian::DatabaseCorruptError("Position list data corrupt");
+	}
+	RETURN(n);
+    }
     Xapian::termpos pos_last;
     if (!unpack_uint(&pos, end, &pos_last)) {
 	throw Xapian::DatabaseCorruptError("Position list data corrupt");
@@ -88,6 +145,7 @@ BrassPositionList::read_data(const string & data)
     LOGCALL(DB, bool, "BrassPositionList::read_data", data);
 
     have_started = false;
+    positions.clear();
 
     if (data.empty()) {
 	// There's no positional information for this term.
@@ -97,6 +155,14 @@ BrassPositionList::read_data(const string & data)
 	RETURN(false);
     }
 
+    if (BrassPositionListTable::unpack_streamvbyte(data, positions)) {
+	size = positions.size();
+	index = 0;
+	current_pos = positions[0];
+	last = positions.back();
+	RETURN(true);
+    }
+
     const char * pos = data.data();
     const char * end = pos + data.size();
     Xapian::termpos pos_last;
@@ -163,6 +229,10 @@ BrassPositionList::next()
 	current_pos = 1;
 	return;
     }
+    if (!positions.empty()) {
+	current_pos = positions[++index];
+	return;
+    }
     current_pos = rd.decode_interpolative_next();
 }
 
@@ -180,6 +250,15 @@ BrassPositionList::skip_to(Xapian::termpos termpos)
 	current_pos = 1;
 	return;
     }
+    if (!positions.empty()) {
+	// termpos < last, so we'll find an entry >= termpos.
+	if (current_pos < termpos) {
+	    index = lower_bound(positions.begin() + index, positions.end(),
+				termpos) - positions.begin();
+	    current_pos = positions[index];
+	}
+	return;
+    }
     while (current_pos < termpos) {
 	if (current_pos == last) {
 	    last = 0;
@@ -197,3 +276,22 @@ BrassPositionList::at_end() const
     Assert(have_started);
     RETURN(current_pos > last);
 }
+
+void
+BrassPositionList::get_positions(vector<Xapian::termpos> & out)
+{
+    LOGCALL_VOID(DB, "BrassPositionList::get_positions", NO_ARGS);
+    Assert(!have_started);
+    have_started = true;
+    if (!positions.empty()) {
+	out.insert(out.end(), positions.begin(), positions.end());
+    } else if (size) {
+	out.push_back(current_pos);
+	while (current_pos != last) {
+	    current_pos = rd.decode_interpolative_next();
+	    out.push_back(current_pos);
+	}
+    }
+    last = 0;
+    current_pos = 1;
+}
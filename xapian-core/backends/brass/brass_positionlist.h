@@ -31,6 +31,7 @@
 #include "backends/positionlist.h"
 
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -73,6 +74,16 @@ class BrassPositionListTable : public BrassLazyTable {
 	del(make_key(did, tname));
     }
 
+    /** Decode a position list stored using Stream VByte.
+     *
+     *  @param data		The position list data.
+     *  @param positions	Set to the positions.
+     *
+     *  @return false if @a data isn't stored using Stream VByte.
+     */
+    static bool unpack_streamvbyte(const string & data,
+				   std::vector<unsigned> & positions);
+
     /// Return the number of entries in specified position list.
     Xapian::termcount positionlist_count(Xapian::docid did,
 					 const string & term) const;
@@ -83,6 +94,15 @@ class BrassPositionList : public PositionList {
     /// Interpolative decoder.
     BitReader rd;
 
+    /** The positions, if the list is stored using Stream VByte.
+     *
+     *  Empty if the list is interpolative coded.
+     */
+    std::vector<unsigned> positions;
+
+    /// The index of current_pos in positions.
+    size_t index;
+
     /// Current entry.
     Xapian::termpos current_pos;
 
@@ -145,6 +165,9 @@ class BrassPositionList : public PositionList {
 
     /// True if we're off the end of the list
     bool at_end() const;
+
+    /// Append all the positions in the list to @a positions.
+    void get_positions(std::vector<Xapian::termpos> & out);
 };
 
 #endif /* XAPIAN_HGUARD_BRASS_POSITIONLIST_H */
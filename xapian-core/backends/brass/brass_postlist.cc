@@ -26,36 +26,138 @@
 
 #include "brass_cursor.h"
 #include "brass_database.h"
+#include "brass_doclencache.h"
+#include "brass_termfreqcache.h"
 #include "debuglog.h"
 #include "noreturn.h"
 #include "pack.h"
 #include "str.h"
+#include "streamvbyte.h"
 #include "unicode/description_append.h"
 
+#include <algorithm>
+
 using Xapian::Internal::intrusive_ptr;
 
+bool
+BrassPostListTable::open(int flags_, brass_revision_number_t revno)
+{
+    doclen_pl.reset(0);
+    release_doclen_cache();
+    doclen_cache_checked = false;
+    termfreq_cache = NULL;
+    if (!BrassTable::open(flags_, revno)) return false;
+    // A writable table's frequencies change without the revision changing.
+    if (!is_writable() && !get_file_identity().empty()) {
+	termfreq_cache = BrassTermFreqCache::get_instance();
+	if (termfreq_cache) {
+	    termfreq_cache_file_id =
+		termfreq_cache->get_file_id(get_file_identity());
+	}
+    }
+    return true;
+}
+
 void
 BrassPostListTable::get_freqs(const string & term,
 			      Xapian::doccount * termfreq_ptr,
 			      Xapian::termcount * collfreq_ptr) const
 {
+    // If the table has been closed, fall through so we throw an exception.
+    bool use_cache = (termfreq_cache && is_open());
+    Xapian::doccount termfreq;
+    Xapian::termcount collfreq;
+    if (use_cache &&
+	termfreq_cache->read(termfreq_cache_file_id,
+			     get_open_revision_number(), term,
+			     termfreq, collfreq)) {
+	if (termfreq_ptr)
+	    *termfreq_ptr = termfreq;
+	if (collfreq_ptr)
+	    *collfreq_ptr = collfreq;
+	return;
+    }
+
     string key = make_key(term);
     string tag;
     if (!get_exact_entry(key, tag)) {
-	if (termfreq_ptr)
-	    *termfreq_ptr = 0;
-	if (collfreq_ptr)
-	    *collfreq_ptr = 0;
+	termfreq = 0;
+	collfreq = 0;
     } else {
 	const char * p = tag.data();
 	BrassPostList::read_number_of_entries(&p, p + tag.size(),
-					      termfreq_ptr, collfreq_ptr);
+					      &termfreq, &collfreq);
+    }
+    if (use_cache) {
+	termfreq_cache->add(termfreq_cache_file_id,
+			    get_open_revision_number(), term,
+			    termfreq, collfreq);
+    }
+    if (termfreq_ptr)
+	*termfreq_ptr = termfreq;
+    if (collfreq_ptr)
+	*collfreq_ptr = collfreq;
+}
+
+void
+BrassPostListTable::release_doclen_cache()
+{
+    if (doclen_cache) {
+	BrassDocLenCache::get_instance()->release(doclen_cache);
+	doclen_cache = NULL;
+	std::vector<bool>().swap(doclen_pages_seen);
+    }
+}
+
+bool
+BrassPostListTable::init_doclen_cache(const intrusive_ptr<const BrassDatabase> & db) const
+{
+    LOGCALL(DB, bool, "BrassPostListTable::init_doclen_cache", NO_ARGS);
+    doclen_cache_checked = true;
+    // A writable table's doclen chunks get updated under us.
+    if (is_writable() || get_file_identity().empty()) RETURN(false);
+    BrassDocLenCache * cache = BrassDocLenCache::get_instance();
+    if (!cache) RETURN(false);
+    Xapian::docid last_did = db->get_lastdocid();
+    if (last_did == 0) RETURN(false);
+    // The array has an entry for every docid up to last_did, so isn't worth
+    // it if most docids aren't in use.
+    if (db->get_doccount() < last_did / 2) RETURN(false);
+
+    doclen_cache = cache->get_array(get_file_identity(),
+				    get_open_revision_number(), last_did);
+    if (!doclen_cache) RETURN(false);
+    doclen_pages_seen.assign(doclen_cache->get_page_count(), false);
+    RETURN(true);
+}
+
+Xapian::termcount
+BrassPostListTable::get_cached_doclength(Xapian::docid did,
+					 const intrusive_ptr<const BrassDatabase> & db) const
+{
+    if (did >= doclen_cache->size()) return BrassDocLenArray::MISSING;
+    size_t page = did >> BrassDocLenArray::PAGE_SHIFT;
+    if (!doclen_pages_seen[page]) {
+	if (!doclen_pl.get()) {
+	    // Don't keep a reference back to the database, since this
+	    // would make a reference loop.
+	    doclen_pl.reset(new BrassPostList(db, string(), false));
+	}
+	doclen_cache->read_page(page, *doclen_pl);
+	doclen_pages_seen[page] = true;
     }
+    return doclen_cache->get(did);
 }
 
 Xapian::termcount
 BrassPostListTable::get_doclength(Xapian::docid did,
 				  intrusive_ptr<const BrassDatabase> db) const {
+    if (use_doclen_cache(db)) {
+	Xapian::termcount doclen = get_cached_doclength(did, db);
+	if (doclen != BrassDocLenArray::MISSING)
+	    return doclen;
+	throw Xapian::DocNotFoundError("Document " + str(did) + " not found");
+    }
     if (!doclen_pl.get()) {
 	// Don't keep a reference back to the database, since this
 	// would make a reference loop.
@@ -70,6 +172,9 @@ bool
 BrassPostListTable::document_exists(Xapian::docid did,
 				    intrusive_ptr<const BrassDatabase> db) const
 {
+    if (use_doclen_cache(db)) {
+	return get_cached_doclength(did, db) != BrassDocLenArray::MISSING;
+    }
     if (!doclen_pl.get()) {
 	// Don't keep a reference back to the database, since this
 	// would make a reference loop.
@@ -98,21 +203,16 @@ class Brass::PostlistChunkWriter {
 			    const string &tname_,
 			    bool is_last_chunk_);
 
-	/// Append an entry to this chunk.
+	/** Append an entry to this chunk.
+	 *
+	 *  @param doclen	A lower bound on the length of document @a did.
+	 */
 	void append(BrassTable * table, Xapian::docid did,
-		    Xapian::termcount wdf);
+		    Xapian::termcount wdf, Xapian::termcount doclen);
 
 	/// Append a block of raw entries to this chunk.
 	void raw_append(Xapian::docid first_did_, Xapian::docid current_did_,
-			const string & s) {
-	    Assert(!started);
-	    first_did = first_did_;
-	    current_did = current_did_;
-	    if (!s.empty()) {
-		chunk.append(s);
-		started = true;
-	    }
-	}
+			const string & s);
 
 	/** Flush the chunk to the buffered table.  Note: this may write it
 	 *  with a different key to the original one, if for example the first
@@ -130,9 +230,47 @@ class Brass::PostlistChunkWriter {
 	Xapian::docid first_did;
 	Xapian::docid current_did;
 
+	/// The number of entries in the chunk.
+	Xapian::doccount count;
+
+	/// The largest wdf in the chunk.
+	Xapian::termcount max_wdf;
+
+	/// Lower bound on the lengths of the documents in the chunk.
+	Xapian::termcount min_doclen;
+
+	/// The encoded block table.
+	string block_table;
+
+	/// The encoded blocks.
 	string chunk;
+
+	/// The last docid in the last encoded block (or first_did - 1 if none).
+	Xapian::docid block_base;
+
+	/// The number of entries waiting to be encoded as a block.
+	unsigned pending;
+
+	/// The docids of the entries waiting to be encoded.
+	Xapian::docid pending_dids[BRASS_POSTLIST_BLOCK_SIZE];
+
+	/// The wdfs of the entries waiting to be encoded.
+	Xapian::termcount pending_wdfs[BRASS_POSTLIST_BLOCK_SIZE];
+
+	/// Lower bounds on the lengths of the entries waiting to be encoded.
+	Xapian::termcount pending_doclens[BRASS_POSTLIST_BLOCK_SIZE];
+
+	/// Start a new chunk, with @a did as the first entry.
+	void start_chunk(Xapian::docid did);
+
+	/// Encode the pending entries as a block.
+	void encode_block();
+
+	/// Append the chunk info, block table and blocks to @a tag.
+	void append_chunk_data(string & tag);
 };
 
+using Brass::PostlistChunkDecoder;
 using Brass::PostlistChunkWriter;
 
 // Static functions
@@ -207,20 +345,129 @@ read_start_of_first_chunk(const char ** posptr,
     RETURN(did);
 }
 
-static inline void
-read_did_increase(const char ** posptr, const char * end,
-		  Xapian::docid * did_ptr)
+void
+PostlistChunkDecoder::read_chunk_info(const char ** p, const char * end,
+				      Xapian::doccount * count_ptr,
+				      Xapian::termcount * max_wdf_ptr,
+				      Xapian::termcount * min_doclen_ptr,
+				      const char ** table_ptr)
+{
+    Xapian::doccount count;
+    if (!unpack_uint(p, end, &count) ||
+	!unpack_uint(p, end, max_wdf_ptr) ||
+	!unpack_uint(p, end, min_doclen_ptr))
+	report_read_error(*p);
+    if (count == 0)
+	throw Xapian::DatabaseCorruptError("Postlist chunk with no entries");
+    if (count_ptr) *count_ptr = count;
+    if (table_ptr) *table_ptr = *p;
+    // Skip over the block table.
+    Xapian::doccount blocks = (count - 1) / BRASS_POSTLIST_BLOCK_SIZE + 1;
+    while (blocks--) {
+	if (!unpack_uint(p, end, static_cast<Xapian::docid *>(NULL)) ||
+	    !unpack_uint(p, end, static_cast<size_t *>(NULL)) ||
+	    !unpack_uint(p, end, static_cast<Xapian::termcount *>(NULL)) ||
+	    !unpack_uint(p, end, static_cast<Xapian::termcount *>(NULL))) {
+	    report_read_error(*p);
+	}
+    }
+}
+
+const char *
+PostlistChunkDecoder::decode_block(const char * p, const char * end,
+				   Xapian::docid prev_did, unsigned n,
+				   Xapian::docid * dids_out,
+				   Xapian::termcount * wdfs_out)
+{
+    p = decode_streamvbyte(p, end, dids_out, n);
+    if (!p) return NULL;
+    // Turn the docid gaps into docids.
+    for (unsigned j = 0; j != n; ++j) {
+	prev_did += dids_out[j] + 1;
+	dids_out[j] = prev_did;
+    }
+    return decode_streamvbyte(p, end, wdfs_out, n);
+}
+
+void
+PostlistChunkDecoder::start(const char * p, const char * end_,
+			    Xapian::docid first_did)
+{
+    end = end_;
+    read_chunk_info(&p, end, &items_left, &chunk_max_wdf, &chunk_min_doclen,
+		    &table_pos);
+    table_end = p;
+    pos = p;
+    next_last_did = first_did - 1;
+    read_block_entry();
+    read_block();
+}
+
+void
+PostlistChunkDecoder::read_block_entry()
 {
     Xapian::docid did_increase;
-    if (!unpack_uint(posptr, end, &did_increase)) report_read_error(*posptr);
-    *did_ptr += did_increase + 1;
+    if (!unpack_uint(&table_pos, table_end, &did_increase) ||
+	!unpack_uint(&table_pos, table_end, &next_len) ||
+	!unpack_uint(&table_pos, table_end, &next_max_wdf) ||
+	!unpack_uint(&table_pos, table_end, &next_min_doclen)) {
+	report_read_error(table_pos);
+    }
+    next_prev_did = next_last_did;
+    next_last_did += did_increase;
+}
+
+void
+PostlistChunkDecoder::read_block()
+{
+    unsigned n = BRASS_POSTLIST_BLOCK_SIZE;
+    if (items_left < n) n = items_left;
+    if (next_len > size_t(end - pos) ||
+	decode_block(pos, pos + next_len, next_prev_did, n,
+		     dids, wdfs) != pos + next_len ||
+	dids[n - 1] != next_last_did) {
+	throw Xapian::DatabaseCorruptError("Bad block in postlist chunk");
+    }
+    pos += next_len;
+    items_left -= n;
+    items_decoded += n;
+    block_items = n;
+    block_max_wdf = next_max_wdf;
+    block_min_doclen = next_min_doclen;
+    i = 0;
+    if (items_left) read_block_entry();
 }
 
-/// Read the wdf for an entry.
-static inline void
-read_wdf(const char ** posptr, const char * end, Xapian::termcount * wdf_ptr)
+bool
+PostlistChunkDecoder::next()
 {
-    if (!unpack_uint(posptr, end, wdf_ptr)) report_read_error(*posptr);
+    if (++i < block_items) return true;
+    if (items_left == 0) {
+	--i;
+	return false;
+    }
+    read_block();
+    return true;
+}
+
+void
+PostlistChunkDecoder::skip_to(Xapian::docid did)
+{
+    if (did > get_block_last_docid()) {
+	// Skip over any blocks which end before did without decoding them.
+	while (next_last_did < did) {
+	    if (next_len > size_t(end - pos) ||
+		items_left <= BRASS_POSTLIST_BLOCK_SIZE) {
+		throw Xapian::DatabaseCorruptError("Bad block table in postlist chunk");
+	    }
+	    pos += next_len;
+	    items_left -= BRASS_POSTLIST_BLOCK_SIZE;
+	    read_block_entry();
+	}
+	read_block();
+    }
+    i = lower_bound(dids + i, dids + block_items, did) - dids;
+    Assert(i < block_items);
 }
 
 /// Read the start of a chunk.
@@ -254,13 +501,9 @@ read_start_of_chunk(const char ** posptr,
 class Brass::PostlistChunkReader {
     string data;
 
-    const char *pos;
-    const char *end;
-
     bool at_end;
 
-    Xapian::docid did;
-    Xapian::termcount wdf;
+    PostlistChunkDecoder decoder;
 
   public:
     /** Initialise the postlist chunk reader.
@@ -269,16 +512,22 @@ class Brass::PostlistChunkReader {
      *  @param data       The tag string with the header removed.
      */
     PostlistChunkReader(Xapian::docid first_did, const string & data_)
-	: data(data_), pos(data.data()), end(pos + data.length()), at_end(data.empty()), did(first_did)
+	: data(data_), at_end(data.empty())
     {
-	if (!at_end) read_wdf(&pos, end, &wdf);
+	if (!at_end)
+	    decoder.start(data.data(), data.data() + data.size(), first_did);
     }
 
     Xapian::docid get_docid() const {
-	return did;
+	return decoder.get_docid();
     }
     Xapian::termcount get_wdf() const {
-	return wdf;
+	return decoder.get_wdf();
+    }
+
+    /// Lower bound on the length of the current document.
+    Xapian::termcount get_doclen_lower_bound() const {
+	return decoder.get_block_min_doclen();
     }
 
     bool is_at_end() const {
@@ -287,22 +536,13 @@ class Brass::PostlistChunkReader {
 
     /** Advance to the next entry.  Set at_end if we run off the end.
      */
-    void next();
+    void next() {
+	if (!decoder.next()) at_end = true;
+    }
 };
 
 using Brass::PostlistChunkReader;
 
-void
-PostlistChunkReader::next()
-{
-    if (pos == end) {
-	at_end = true;
-    } else {
-	read_did_increase(&pos, end, &did);
-	read_wdf(&pos, end, &wdf);
-    }
-}
-
 PostlistChunkWriter::PostlistChunkWriter(const string &orig_key_,
 					 bool is_first_chunk_,
 					 const string &tname_,
@@ -315,31 +555,143 @@ PostlistChunkWriter::PostlistChunkWriter(const string &orig_key_,
     LOGCALL_CTOR(DB, "PostlistChunkWriter", orig_key_ | is_first_chunk_ | tname_ | is_last_chunk_);
 }
 
+void
+PostlistChunkWriter::start_chunk(Xapian::docid did)
+{
+    first_did = did;
+    count = 0;
+    max_wdf = 0;
+    min_doclen = Xapian::termcount(-1);
+    block_table.resize(0);
+    chunk.resize(0);
+    block_base = did - 1;
+    pending = 0;
+}
+
+void
+PostlistChunkWriter::encode_block()
+{
+    if (pending == 0) return;
+    Xapian::docid gaps[BRASS_POSTLIST_BLOCK_SIZE];
+    Xapian::docid prev_did = block_base;
+    Xapian::termcount block_max_wdf = 0;
+    Xapian::termcount block_min_doclen = Xapian::termcount(-1);
+    for (unsigned i = 0; i != pending; ++i) {
+	gaps[i] = pending_dids[i] - prev_did - 1;
+	prev_did = pending_dids[i];
+	if (pending_wdfs[i] > block_max_wdf) block_max_wdf = pending_wdfs[i];
+	if (pending_doclens[i] < block_min_doclen)
+	    block_min_doclen = pending_doclens[i];
+    }
+    size_t old_size = chunk.size();
+    encode_streamvbyte(chunk, gaps, pending);
+    encode_streamvbyte(chunk, pending_wdfs, pending);
+    pack_uint(block_table, prev_did - block_base);
+    pack_uint(block_table, chunk.size() - old_size);
+    pack_uint(block_table, block_max_wdf);
+    pack_uint(block_table, block_min_doclen);
+    block_base = prev_did;
+    pending = 0;
+}
+
+void
+PostlistChunkWriter::raw_append(Xapian::docid first_did_,
+				Xapian::docid current_did_,
+				const string & s)
+{
+    Assert(!started);
+    start_chunk(first_did_);
+    current_did = current_did_;
+    if (s.empty()) return;
+
+    const char * pos = s.data();
+    const char * end = pos + s.size();
+    const char * table_start;
+    PostlistChunkDecoder::read_chunk_info(&pos, end, &count, &max_wdf,
+					  &min_doclen, &table_start);
+
+    // Keep all the blocks apart from the last, which we decode so that new
+    // entries can be added to it.
+    const char * p = table_start;
+    const char * last_entry = p;
+    Xapian::docid last_did = block_base;
+    size_t offset = 0, last_offset = 0;
+    Xapian::termcount last_min_doclen = 0;
+    while (p != pos) {
+	last_entry = p;
+	Xapian::docid did_increase;
+	size_t len;
+	if (!unpack_uint(&p, pos, &did_increase) ||
+	    !unpack_uint(&p, pos, &len) ||
+	    !unpack_uint(&p, pos, static_cast<Xapian::termcount *>(NULL)) ||
+	    !unpack_uint(&p, pos, &last_min_doclen)) {
+	    report_read_error(p);
+	}
+	block_base = last_did;
+	last_did += did_increase;
+	last_offset = offset;
+	offset += len;
+    }
+    block_table.assign(table_start, last_entry - table_start);
+    chunk.assign(pos, last_offset);
+    pending = (count - 1) % BRASS_POSTLIST_BLOCK_SIZE + 1;
+    if (offset > size_t(end - pos) ||
+	!PostlistChunkDecoder::decode_block(pos + last_offset, pos + offset,
+					    block_base, pending,
+					    pending_dids, pending_wdfs) ||
+	pending_dids[pending - 1] != current_did) {
+	throw Xapian::DatabaseCorruptError("Bad block in postlist chunk");
+    }
+    // We don't know the actual lengths of the decoded entries, but the
+    // block's lower bound is still valid for them.
+    for (unsigned i = 0; i != pending; ++i) {
+	pending_doclens[i] = last_min_doclen;
+    }
+    started = true;
+    // If the last block is full, there's no room to add to it.
+    if (pending == BRASS_POSTLIST_BLOCK_SIZE) encode_block();
+}
+
+void
+PostlistChunkWriter::append_chunk_data(string & tag)
+{
+    encode_block();
+    pack_uint(tag, count);
+    pack_uint(tag, max_wdf);
+    pack_uint(tag, min_doclen);
+    tag += block_table;
+    tag += chunk;
+}
+
 void
 PostlistChunkWriter::append(BrassTable * table, Xapian::docid did,
-			    Xapian::termcount wdf)
+			    Xapian::termcount wdf, Xapian::termcount doclen)
 {
     if (!started) {
 	started = true;
-	first_did = did;
+	start_chunk(did);
     } else {
 	Assert(did > current_did);
-	// Start a new chunk if this one has grown to the threshold.
-	if (chunk.size() >= CHUNKSIZE) {
+	// Start a new chunk if this one has grown to the threshold (allowing
+	// roughly two bytes for each entry which is yet to be encoded).
+	if (chunk.size() + pending * 2 >= CHUNKSIZE) {
 	    bool save_is_last_chunk = is_last_chunk;
 	    is_last_chunk = false;
 	    flush(table);
 	    is_last_chunk = save_is_last_chunk;
 	    is_first_chunk = false;
-	    first_did = did;
-	    chunk.resize(0);
+	    start_chunk(did);
 	    orig_key = BrassPostListTable::make_key(tname, first_did);
-	} else {
-	    pack_uint(chunk, did - current_did - 1);
 	}
     }
     current_did = did;
-    pack_uint(chunk, wdf);
+    pending_dids[pending] = did;
+    pending_wdfs[pending] = wdf;
+    pending_doclens[pending] = doclen;
+    ++count;
+    if (wdf > max_wdf) max_wdf = wdf;
+    if (doclen < min_doclen) min_doclen = doclen;
+    if (++pending == BRASS_POSTLIST_BLOCK_SIZE) encode_block();
 }
 
 /** Make the data to go at the start of the very first chunk.
@@ -587,7 +939,7 @@ PostlistChunkWriter::flush(BrassTable *table)
 	    tag = make_start_of_first_chunk(num_ent, coll_freq, first_did);
 
 	    tag += make_start_of_chunk(is_last_chunk, first_did, current_did);
-	    tag += chunk;
+	    append_chunk_data(tag);
 	    table->add(key, tag);
 	    return;
 	}
@@ -628,7 +980,7 @@ PostlistChunkWriter::flush(BrassTable *table)
 	// ...and write the start of this chunk.
 	tag = make_start_of_chunk(is_last_chunk, first_did, current_did);
 
-	tag += chunk;
+	append_chunk_data(tag);
 	table->add(new_key, tag);
     }
 }
@@ -659,9 +1011,19 @@ void BrassPostList::read_number_of_entries(const char ** posptr,
  *
  *  1)  bool - true if this is the last chunk.
  *  2)  difference between final docid in chunk and first docid.
- *  3)  wdf for the first item.
- *  4)  increment in docid to next item, followed by wdf for the item.
- *  5)  (4) repeatedly.
+ *  3)  the number of items in the chunk.
+ *  4)  the largest wdf in the chunk, and a lower bound on the lengths of
+ *      the documents in the chunk.
+ *  5)  the block table, with an entry for each block in (6) giving the
+ *      increase in the last docid from the previous block (or from the docid
+ *      before the first in the chunk), the length of the block in bytes, the
+ *      largest wdf in the block, and a lower bound on the lengths of the
+ *      documents in the block.  The lower bounds can be below the actual
+ *      minimum, since entries copied from an existing block keep its bound.
+ *  6)  the items in blocks of BRASS_POSTLIST_BLOCK_SIZE (the last block may
+ *      be shorter).  Each block holds the gaps between the docids (each minus
+ *      one, with the first from the last docid in the previous block), and
+ *      then the wdfs, both encoded with Stream VByte.
  *
  *  The first chunk begins with the number of entries, the collection
  *  frequency, then the docid of the first document, then has the header of a
@@ -674,7 +1036,10 @@ BrassPostList::BrassPostList(intrusive_ptr<const BrassDatabase> this_db_,
 	  this_db(keep_reference ? this_db_ : NULL),
 	  have_started(false),
 	  is_at_end(false),
-	  cursor(this_db_->postlist_table.cursor_get())
+	  cursor(this_db_->postlist_table.cursor_get()),
+	  chunks_read(0),
+	  block_maxweight(0),
+	  block_maxweight_last(0)
 {
     LOGCALL_CTOR(DB, "BrassPostList", this_db_.get() | term_ | keep_reference);
     init();
@@ -687,7 +1052,10 @@ BrassPostList::BrassPostList(intrusive_ptr<const BrassDatabase> this_db_,
 	  this_db(this_db_),
 	  have_started(false),
 	  is_at_end(false),
-	  cursor(cursor_)
+	  cursor(cursor_),
+	  chunks_read(0),
+	  block_maxweight(0),
+	  block_maxweight_last(0)
 {
     LOGCALL_CTOR(DB, "BrassPostList", this_db_.get() | term_ | cursor_);
     init();
@@ -716,7 +1084,7 @@ BrassPostList::init()
     first_did_in_chunk = did;
     last_did_in_chunk = read_start_of_chunk(&pos, end, first_did_in_chunk,
 					    &is_last_chunk);
-    read_wdf(&pos, end, &wdf);
+    read_chunk_data();
     LOGLINE(DB, "Initial docid " << did);
 }
 
@@ -745,19 +1113,24 @@ BrassPostList::get_doclength() const
     RETURN(this_db->get_doclength(did));
 }
 
+void
+BrassPostList::read_chunk_data()
+{
+    decoder.start(pos, end, first_did_in_chunk);
+    ++chunks_read;
+    did = decoder.get_docid();
+    wdf = decoder.get_wdf();
+}
+
 bool
 BrassPostList::next_in_chunk()
 {
     LOGCALL(DB, bool, "BrassPostList::next_in_chunk", NO_ARGS);
-    if (pos == end) RETURN(false);
+    if (!decoder.next()) RETURN(false);
 
-    read_did_increase(&pos, end, &did);
-    read_wdf(&pos, end, &wdf);
-
-    // Either not at last doc in chunk, or pos == end, but not both.
+    did = decoder.get_docid();
+    wdf = decoder.get_wdf();
     Assert(did <= last_did_in_chunk);
-    Assert(did < last_did_in_chunk || pos == end);
-    Assert(pos != end || did == last_did_in_chunk);
 
     RETURN(true);
 }
@@ -805,7 +1178,7 @@ BrassPostList::next_chunk()
     first_did_in_chunk = did;
     last_did_in_chunk = read_start_of_chunk(&pos, end, first_did_in_chunk,
 					    &is_last_chunk);
-    read_wdf(&pos, end, &wdf);
+    read_chunk_data();
 }
 
 PositionList *
@@ -825,11 +1198,70 @@ BrassPostList::open_position_list() const
     RETURN(new BrassPositionList(&this_db->position_table, did, term));
 }
 
+void
+BrassPostList::update_block_maxweight() const
+{
+    if (did > block_maxweight_last) {
+	block_maxweight_last = decoder.get_block_last_docid();
+	block_maxweight = get_maxpart_for_wdf(decoder.get_block_max_wdf(),
+					      decoder.get_block_min_doclen());
+    }
+}
+
+void
+BrassPostList::get_read_counts(totlen_t & postings, totlen_t & chunks,
+			       totlen_t & blocks) const
+{
+    postings = decoder.get_items_decoded();
+    chunks = chunks_read;
+    blocks = cursor->get_table()->get_blocks_loaded();
+}
+
+double
+BrassPostList::get_block_maxweight(Xapian::docid & last) const
+{
+    Assert(have_started);
+    Assert(!is_at_end);
+    if (!weight) {
+	last = Xapian::docid(-1);
+	return 0;
+    }
+    update_block_maxweight();
+    last = block_maxweight_last;
+    return block_maxweight;
+}
+
+void
+BrassPostList::skip_low_weight_blocks(double w_min)
+{
+    LOGCALL_VOID(DB, "BrassPostList::skip_low_weight_blocks", w_min);
+    while (true) {
+	update_block_maxweight();
+	if (block_maxweight >= w_min) return;
+
+	if (block_maxweight_last == last_did_in_chunk ||
+	    get_maxpart_for_wdf(decoder.get_chunk_max_wdf(),
+				decoder.get_chunk_min_doclen()) < w_min) {
+	    // Nothing else in this chunk can achieve w_min.
+	    LOGLINE(DB, "Skipping rest of chunk after docid " << did);
+	    decoder.skip_to_end();
+	    next_chunk();
+	    if (is_at_end) return;
+	    continue;
+	}
+
+	LOGLINE(DB, "Skipping block from docid " << did << " to " <<
+		    block_maxweight_last);
+	decoder.skip_to(block_maxweight_last + 1);
+	did = decoder.get_docid();
+	wdf = decoder.get_wdf();
+    }
+}
+
 PostList *
 BrassPostList::next(double w_min)
 {
     LOGCALL(DB, PostList *, "BrassPostList::next", w_min);
-    (void)w_min; // no warning
 
     if (!have_started) {
 	have_started = true;
@@ -837,6 +1269,9 @@ BrassPostList::next(double w_min)
 	if (!next_in_chunk()) next_chunk();
     }
 
+    if (!is_at_end && w_min > 0 && weight)
+	skip_low_weight_blocks(w_min);
+
     if (is_at_end) {
 	LOGLINE(DB, "Moved to end");
     } else {
@@ -898,7 +1333,7 @@ BrassPostList::move_to_chunk_containing(Xapian::docid desired_did)
     first_did_in_chunk = did;
     last_did_in_chunk = read_start_of_chunk(&pos, end, first_did_in_chunk,
 					    &is_last_chunk);
-    read_wdf(&pos, end, &wdf);
+    read_chunk_data();
 
     // Possible, since desired_did might be after end of this chunk and before
     // the next.
@@ -913,21 +1348,13 @@ BrassPostList::move_forward_in_chunk_to_at_least(Xapian::docid desired_did)
 	RETURN(true);
 
     if (desired_did <= last_did_in_chunk) {
-	while (pos != end) {
-	    read_did_increase(&pos, end, &did);
-	    if (did >= desired_did) {
-		read_wdf(&pos, end, &wdf);
-		RETURN(true);
-	    }
-	    // It's faster to just skip over the wdf than to decode it.
-	    read_wdf(&pos, end, NULL);
-	}
-
-	// If we hit the end of the chunk then last_did_in_chunk must be wrong.
-	Assert(false);
+	decoder.skip_to(desired_did);
+	did = decoder.get_docid();
+	wdf = decoder.get_wdf();
+	RETURN(true);
     }
 
-    pos = end;
+    decoder.skip_to_end();
     RETURN(false);
 }
 
@@ -935,7 +1362,6 @@ PostList *
 BrassPostList::skip_to(Xapian::docid desired_did, double w_min)
 {
     LOGCALL(DB, PostList *, "BrassPostList::skip_to", desired_did | w_min);
-    (void)w_min; // no warning
     // We've started now - if we hadn't already, we're already positioned
     // at start so there's no need to actually do anything.
     have_started = true;
@@ -956,6 +1382,9 @@ BrassPostList::skip_to(Xapian::docid desired_did, double w_min)
     (void)have_document;
     Assert(have_document);
 
+    if (w_min > 0 && weight)
+	skip_low_weight_blocks(w_min);
+
     if (is_at_end) {
 	LOGLINE(DB, "Skipped to end");
     } else {
@@ -995,6 +1424,42 @@ BrassPostList::jump_to(Xapian::docid desired_did)
     RETURN(desired_did == did);
 }
 
+Xapian::docid
+BrassPostList::read_doclens(Xapian::docid first_did,
+			    Xapian::docid last_did,
+			    vector<Xapian::termcount> & doclens,
+			    Xapian::termcount missing)
+{
+    LOGCALL(DB, Xapian::docid, "BrassPostList::read_doclens", first_did | last_did | doclens.size() | missing);
+    AssertRel(first_did,<=,last_did);
+    AssertRel(last_did,<,doclens.size());
+    have_started = true;
+
+    if (pos != 0) {
+	is_at_end = false;
+	move_to_chunk_containing(first_did);
+    }
+    if (pos == 0 || is_at_end || !current_chunk_contains(first_did)) {
+	// first_did is before the first chunk, after the last, or between
+	// two chunks.
+	doclens[first_did] = missing;
+	RETURN(first_did);
+    }
+
+    Xapian::docid last = min(last_did_in_chunk, last_did);
+    Xapian::docid d = first_did;
+    if (move_forward_in_chunk_to_at_least(first_did)) {
+	do {
+	    if (did > last) break;
+	    while (d < did) doclens[d++] = missing;
+	    doclens[did] = wdf;
+	    d = did + 1;
+	} while (next_in_chunk());
+    }
+    while (d <= last) doclens[d++] = missing;
+    RETURN(last);
+}
+
 string
 BrassPostList::get_description() const
 {
@@ -1130,7 +1595,7 @@ next_doclen_chunk:
 		if (copy_did == did) from->next();
 		break;
 	    }
-	    to->append(this, copy_did, from->get_wdf());
+	    to->append(this, copy_did, from->get_wdf(), from->get_wdf());
 	    from->next();
 	}
 	if ((!from || from->is_at_end()) && did > max_did) {
@@ -1143,13 +1608,14 @@ next_doclen_chunk:
 
 	Xapian::termcount new_doclen = j->second;
 	if (new_doclen != static_cast<Xapian::termcount>(-1)) {
-	    to->append(this, did, new_doclen);
+	    to->append(this, did, new_doclen, new_doclen);
 	}
     }
 
     if (from) {
 	while (!from->is_at_end()) {
-	    to->append(this, from->get_docid(), from->get_wdf());
+	    to->append(this, from->get_docid(), from->get_wdf(),
+		       from->get_wdf());
 	    from->next();
 	}
 	delete from;
@@ -1160,7 +1626,8 @@ next_doclen_chunk:
 
 void
 BrassPostListTable::merge_changes(const string &term,
-				  const Inverter::PostingChanges & changes)
+				  const Inverter::PostingChanges & changes,
+				  const map<Xapian::docid, Xapian::termcount> & doclens)
 {
     {
 	// Rewrite the first chunk of this posting list with the updated
@@ -1222,16 +1689,18 @@ BrassPostListTable::merge_changes(const string &term,
 	    add(current_key, tag);
 	}
     }
-    map<Xapian::docid, Xapian::termcount>::const_iterator j;
-    j = changes.pl_changes.begin();
-    Assert(j != changes.pl_changes.end()); // This case is caught above.
+    vector<Inverter::Posting> pl_changes;
+    changes.get_changes(pl_changes);
+    vector<Inverter::Posting>::const_iterator j;
+    j = pl_changes.begin();
+    Assert(j != pl_changes.end()); // This case is caught above.
 
     Xapian::docid max_did;
     PostlistChunkReader *from;
     PostlistChunkWriter *to;
-    max_did = get_chunk(term, j->first, false, &from, &to);
-    for ( ; j != changes.pl_changes.end(); ++j) {
-	Xapian::docid did = j->first;
+    max_did = get_chunk(term, j->did, false, &from, &to);
+    for ( ; j != pl_changes.end(); ++j) {
+	Xapian::docid did = j->did;
 
 next_chunk:
 	LOGLINE(DB, "Updating term=" << term << ", did=" << did);
@@ -1243,7 +1712,8 @@ next_chunk:
 		}
 		break;
 	    }
-	    to->append(this, copy_did, from->get_wdf());
+	    to->append(this, copy_did, from->get_wdf(),
+		       from->get_doclen_lower_bound());
 	    from->next();
 	}
 	if ((!from || from->is_at_end()) && did > max_did) {
@@ -1254,15 +1724,24 @@ next_chunk:
 	    goto next_chunk;
 	}
 
-	Xapian::termcount new_wdf = j->second;
-	if (new_wdf != Xapian::termcount(-1)) {
-	    to->append(this, did, new_wdf);
+	Xapian::termcount new_wdf = j->wdf;
+	if (new_wdf != DELETED_POSTING) {
+	    // The document's length is only missing from doclens if it hasn't
+	    // changed and the other changes have already been flushed, in
+	    // which case we fall back to the trivial lower bound.
+	    Xapian::termcount doclen = 0;
+	    map<Xapian::docid, Xapian::termcount>::const_iterator k;
+	    k = doclens.find(did);
+	    if (k != doclens.end() && k->second != DELETED_POSTING)
+		doclen = k->second;
+	    to->append(this, did, new_wdf, doclen);
 	}
     }
 
     if (from) {
 	while (!from->is_at_end()) {
-	    to->append(this, from->get_docid(), from->get_wdf());
+	    to->append(this, from->get_docid(), from->get_wdf(),
+		       from->get_doclen_lower_bound());
 	    from->next();
 	}
 	delete from;
@@ -32,27 +32,242 @@
 #include "brass_positionlist.h"
 #include "api/leafpostlist.h"
 #include "omassert.h"
+#include "weight/weightinternal.h"
 
 #include "autoptr.h"
 #include <map>
 #include <string>
+#include <vector>
 
 using namespace std;
 
 class BrassCursor;
 class BrassDatabase;
 
+/** The number of items in each block of a postlist chunk.
+ *
+ *  Items are decoded a block at a time, and skipping within a chunk moves
+ *  a block at a time.
+ */
+const unsigned int BRASS_POSTLIST_BLOCK_SIZE = 128;
+
 namespace Brass {
     class PostlistChunkReader;
     class PostlistChunkWriter;
+
+/** Decode the items in a postlist chunk a block at a time.
+ *
+ *  This handles the part of the chunk after the chunk header.
+ */
+class PostlistChunkDecoder {
+    /// Start of the next block's data.
+    const char * pos;
+
+    /// Pointer to byte after end of the chunk.
+    const char * end;
+
+    /// Position in the block table of the entry after the next block's.
+    const char * table_pos;
+
+    /// Pointer to byte after end of the block table.
+    const char * table_end;
+
+    /// The number of items in the chunk which follow the current block.
+    Xapian::doccount items_left;
+
+    /// The last docid before the next block.
+    Xapian::docid next_prev_did;
+
+    /// The last docid in the next block.
+    Xapian::docid next_last_did;
+
+    /// The length in bytes of the next block.
+    size_t next_len;
+
+    /// The largest wdf in the next block.
+    Xapian::termcount next_max_wdf;
+
+    /// Lower bound on the lengths of the documents in the next block.
+    Xapian::termcount next_min_doclen;
+
+    /// The largest wdf in the current block.
+    Xapian::termcount block_max_wdf;
+
+    /// Lower bound on the lengths of the documents in the current block.
+    Xapian::termcount block_min_doclen;
+
+    /// The largest wdf in the chunk.
+    Xapian::termcount chunk_max_wdf;
+
+    /// Lower bound on the lengths of the documents in the chunk.
+    Xapian::termcount chunk_min_doclen;
+
+    /// The number of items in the current block.
+    unsigned block_items;
+
+    /// The index of the current item in the current block.
+    unsigned i;
+
+    /// The docids in the current block.
+    Xapian::docid dids[BRASS_POSTLIST_BLOCK_SIZE];
+
+    /// The wdfs in the current block.
+    Xapian::termcount wdfs[BRASS_POSTLIST_BLOCK_SIZE];
+
+    /// The number of items decoded so far (for profiling).
+    totlen_t items_decoded;
+
+    /// Read the next block table entry.
+    void read_block_entry();
+
+    /// Decode the next block and move to its first item.
+    void read_block();
+
+  public:
+    PostlistChunkDecoder() : items_decoded(0) { }
+
+    /** Start decoding a chunk.
+     *
+     *  @param p	 Start of the data after the chunk header.
+     *  @param end_	 End of the chunk.
+     *  @param first_did The first docid in the chunk.
+     */
+    void start(const char * p, const char * end_, Xapian::docid first_did);
+
+    /** Move to the next item.
+     *
+     *  @return false if there are no more items in the chunk.
+     */
+    bool next();
+
+    /** Move to the first item with docid >= @a did.
+     *
+     *  @a did must not be more than the last docid in the chunk.
+     */
+    void skip_to(Xapian::docid did);
+
+    /// Move past the last item in the chunk.
+    void skip_to_end() {
+	i = block_items - 1;
+	items_left = 0;
+    }
+
+    Xapian::docid get_docid() const { return dids[i]; }
+
+    Xapian::termcount get_wdf() const { return wdfs[i]; }
+
+    /// The largest wdf in the chunk.
+    Xapian::termcount get_chunk_max_wdf() const { return chunk_max_wdf; }
+
+    /// Lower bound on the lengths of the documents in the chunk.
+    Xapian::termcount get_chunk_min_doclen() const { return chunk_min_doclen; }
+
+    /// The largest wdf in the current block.
+    Xapian::termcount get_block_max_wdf() const { return block_max_wdf; }
+
+    /// Lower bound on the lengths of the documents in the current block.
+    Xapian::termcount get_block_min_doclen() const { return block_min_doclen; }
+
+    /// The last docid in the current block.
+    Xapian::docid get_block_last_docid() const {
+	return dids[block_items - 1];
+    }
+
+    /// The number of items decoded so far.
+    totlen_t get_items_decoded() const { return items_decoded; }
+
+    /** Read the chunk info from the start of a chunk's data.
+     *
+     *  On return, *p points to the first block and *table_ptr (if not NULL)
+     *  to the start of the block table, which ends at *p.
+     */
+    static void read_chunk_info(const char ** p, const char * end,
+				Xapian::doccount * count_ptr,
+				Xapian::termcount * max_wdf_ptr,
+				Xapian::termcount * min_doclen_ptr,
+				const char ** table_ptr);
+
+    /** Decode a block of @a n items.
+     *
+     *  @param prev_did	 The docid before the first in the block.
+     *
+     *  @return Pointer to the byte after the block, or NULL if the data runs
+     *	 out.
+     */
+    static const char * decode_block(const char * p, const char * end,
+				     Xapian::docid prev_did, unsigned n,
+				     Xapian::docid * dids_out,
+				     Xapian::termcount * wdfs_out);
+};
+
 }
 
+class BrassDocLenArray;
 class BrassPostList;
+class BrassTermFreqCache;
 
 class BrassPostListTable : public BrassTable {
 	/// PostList for looking up document lengths.
 	mutable AutoPtr<BrassPostList> doclen_pl;
 
+	/** Dense array of document lengths from the shared doclen cache.
+	 *
+	 *  NULL if the cache isn't enabled, the table is writable, or the
+	 *  array wouldn't fit in the cache.
+	 */
+	mutable BrassDocLenArray * doclen_cache;
+
+	/** Which pages of doclen_cache this table has seen filled.
+	 *
+	 *  A page this table hasn't seen may be being filled by another
+	 *  thread, so its entries can only be read after calling
+	 *  BrassDocLenArray::read_page().
+	 */
+	mutable std::vector<bool> doclen_pages_seen;
+
+	/// Have we decided whether to use doclen_cache since the last open?
+	mutable bool doclen_cache_checked;
+
+	/** The shared termfreq cache, or NULL if we're not using it.
+	 *
+	 *  Only read-only tables use the termfreq cache.
+	 */
+	BrassTermFreqCache * termfreq_cache;
+
+	/// Identifies this table's DB file in termfreq_cache.
+	uint4 termfreq_cache_file_id;
+
+	/// Stop using doclen_cache.
+	void release_doclen_cache();
+
+	/** Try to set up doclen_cache.
+	 *
+	 *  @return true if doclen_cache can be used.
+	 */
+	bool init_doclen_cache(const Xapian::Internal::intrusive_ptr<const BrassDatabase> & db) const;
+
+	/** Check doclen_cache is set up, if it's going to be.
+	 *
+	 *  @return true if doclen_cache can be used.
+	 */
+	bool use_doclen_cache(const Xapian::Internal::intrusive_ptr<const BrassDatabase> & db) const {
+	    // Don't answer from the cache once the table has been closed.
+	    if (!is_open()) return false;
+	    if (!doclen_cache_checked) return init_doclen_cache(db);
+	    return doclen_cache != NULL;
+	}
+
+	/** Look up the length of document @a did in doclen_cache.
+	 *
+	 *  Fills the page of the array containing @a did if it hasn't been
+	 *  filled.
+	 *
+	 *  @return The length, or BrassDocLenArray::MISSING if @a did doesn't
+	 *	    exist.
+	 */
+	Xapian::termcount get_cached_doclength(Xapian::docid did,
+					       const Xapian::Internal::intrusive_ptr<const BrassDatabase> & db) const;
+
     public:
 	/** Create a new table object.
 	 *
@@ -68,16 +283,22 @@ class BrassPostListTable : public BrassTable {
 	 */
 	BrassPostListTable(const string & path_, bool readonly_)
 	    : BrassTable("postlist", path_ + "/postlist.", readonly_),
-	      doclen_pl()
+	      doclen_pl(), doclen_cache(NULL), doclen_cache_checked(false),
+	      termfreq_cache(NULL), termfreq_cache_file_id(0)
 	{ }
 
-	bool open(int flags_, brass_revision_number_t revno) {
-	    doclen_pl.reset(0);
-	    return BrassTable::open(flags_, revno);
-	}
+	~BrassPostListTable() { release_doclen_cache(); }
+
+	bool open(int flags_, brass_revision_number_t revno);
 
-	/// Merge changes for a term.
-	void merge_changes(const string &term, const Inverter::PostingChanges & changes);
+	/** Merge changes for a term.
+	 *
+	 *  @param doclens	Buffered document length changes, used to find
+	 *			the lengths of documents with changed postings.
+	 */
+	void merge_changes(const string &term,
+			   const Inverter::PostingChanges & changes,
+			   const map<Xapian::docid, Xapian::termcount> & doclens);
 
 	/// Merge document length changes.
 	void merge_doclen_changes(const map<Xapian::docid, Xapian::termcount> & doclens);
@@ -152,7 +373,7 @@ class BrassPostList : public LeafPostList {
 	/// The last document id in this chunk.
 	Xapian::docid last_did_in_chunk;
 
-	/// Position of iteration through current chunk.
+	/// Position of the data in the current chunk after the header.
 	const char * pos;
 
 	/// Pointer to byte after end of current chunk.
@@ -167,12 +388,52 @@ class BrassPostList : public LeafPostList {
 	/// The number of entries in the posting list.
 	Xapian::doccount number_of_entries;
 
+	/// Decoder for the items in the current chunk.
+	Brass::PostlistChunkDecoder decoder;
+
+	/// The number of chunks read (for profiling).
+	totlen_t chunks_read;
+
+	/** Upper bound on the weight in the current block.
+	 *
+	 *  This is only valid while did <= block_maxweight_last.
+	 */
+	mutable double block_maxweight;
+
+	/// The last docid in the block block_maxweight is for.
+	mutable Xapian::docid block_maxweight_last;
+
+	/// Update block_maxweight if we've moved to a new block.
+	void update_block_maxweight() const;
+
+	/** Upper bound on the weight of postings with wdf <= wdf_max in
+	 *  documents with length >= doclen_min.
+	 */
+	double get_maxpart_for_wdf(Xapian::termcount wdf_max,
+				   Xapian::termcount doclen_min) const {
+	    return Xapian::Weight::Internal::get_maxpart_for_wdf(*weight,
+								 wdf_max,
+								 doclen_min);
+	}
+
+	/** Skip any blocks which can't achieve weight @a w_min.
+	 *
+	 *  We must be positioned on a document and have a weight object.
+	 */
+	void skip_low_weight_blocks(double w_min);
+
 	/// Copying is not allowed.
 	BrassPostList(const BrassPostList &);
 
 	/// Assignment is not allowed.
 	void operator=(const BrassPostList &);
 
+	/** Start decoding the current chunk, and move to its first item.
+	 *
+	 *  pos should point to the data after the chunk header.
+	 */
+	void read_chunk_data();
+
 	/** Move to the next item in the chunk, if possible.
 	 *  If already at the end of the chunk, returns false.
 	 */
@@ -241,6 +502,21 @@ class BrassPostList : public LeafPostList {
 	 */
 	bool jump_to(Xapian::docid desired_did);
 
+	/** Used for filling a cache of doclens a chunk at a time.
+	 *
+	 *  Sets the entry in @a doclens for each docid from @a first_did to
+	 *  @a last_did, or to the end of the chunk containing @a first_did if
+	 *  that's sooner, to its doclen, or to @a missing if there isn't one.
+	 *  If no chunk covers @a first_did, just its entry is set to
+	 *  @a missing.
+	 *
+	 *  @return The last docid whose entry was set.
+	 */
+	Xapian::docid read_doclens(Xapian::docid first_did,
+				   Xapian::docid last_did,
+				   std::vector<Xapian::termcount> & doclens,
+				   Xapian::termcount missing);
+
 	/** Returns number of docs indexed by this term.
 	 *
 	 *  This is the length of the postlist.
@@ -266,6 +542,11 @@ class BrassPostList : public LeafPostList {
 	 */
 	PositionList * open_position_list() const;
 
+	double get_block_maxweight(Xapian::docid & last) const;
+
+	void get_read_counts(totlen_t & postings, totlen_t & chunks,
+			     totlen_t & blocks) const;
+
 	/// Move to the next document.
 	PostList * next(double w_min);
 
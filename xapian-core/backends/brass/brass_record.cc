@@ -52,6 +52,15 @@ BrassRecordTable::get_record(Xapian::docid did) const
     RETURN(tag);
 }
 
+void
+BrassRecordTable::get_record(Xapian::docid did, BrassTagSink & sink) const
+{
+    LOGCALL_VOID(DB, "BrassRecordTable::get_record", did | Literal("sink"));
+    if (!get_exact_entry(make_key(did), sink)) {
+	throw Xapian::DocNotFoundError("Document " + str(did) + " not found.");
+    }
+}
+
 Xapian::doccount
 BrassRecordTable::get_doccount() const
 {   
@@ -49,12 +49,20 @@ class BrassRecordTable : public BrassTable {
 	 *                          access.
 	 */
 	BrassRecordTable(const string & path_, bool readonly_)
-	    : BrassTable("record", path_ + "/record.", readonly_, Z_DEFAULT_STRATEGY) { }
+	    : BrassTable("record", path_ + "/record.", readonly_,
+			 Z_DEFAULT_STRATEGY, false, BRASS_CODEC_ZSTD) { }
 
 	/** Retrieve a document from the table.
 	 */
 	string get_record(Xapian::docid did) const;
 
+	/** Retrieve a document from the table, passing its data to @a sink
+	 *  in pieces.
+	 *
+	 *  This allows large document data to be consumed incrementally.
+	 */
+	void get_record(Xapian::docid did, BrassTagSink & sink) const;
+
 	/** Get the number of records in the table.
 	 */
 	Xapian::doccount get_doccount() const;
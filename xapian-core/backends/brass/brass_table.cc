@@ -28,6 +28,7 @@
 #include <xapian/error.h>
 
 #include "safeerrno.h"
+#include "safesysstat.h"
 
 #include "omassert.h"
 #include "posixy_wrapper.h"
@@ -35,11 +36,15 @@
 #include "stringutils.h" // For STRINGIZE().
 
 #include <sys/types.h>
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+#endif
 
 #include <cstdio>    /* for rename */
-#include <cstring>   /* for memmove */
+#include <cstring>   /* for memmove, memcpy */
 #include <climits>   /* for CHAR_BIT */
 
+#include "brass_blockcache.h"
 #include "brass_btreebase.h"
 #include "brass_changes.h"
 #include "brass_cursor.h"
@@ -153,7 +158,26 @@ static inline byte *zeroed_new(size_t size)
 
 #define BYTE_PAIR_RANGE (1 << 2 * CHAR_BIT)
 
-/// read_block(n, p) reads block n of the DB file to address p.
+/// Check the directory end of block n, which has been read to p.
+static inline void
+check_block(uint4 n, const byte * p, unsigned block_size)
+{
+    if (GET_LEVEL(p) != LEVEL_FREELIST) {
+	int dir_end = DIR_END(p);
+	if (rare(dir_end < DIR_START || unsigned(dir_end) > block_size)) {
+	    string msg("dir_end invalid in block ");
+	    msg += str(n);
+	    throw Xapian::DatabaseCorruptError(msg);
+	}
+    }
+}
+
+/** read_block(n, p) reads block n of the DB file to address p.
+ *
+ *  If we're using the shared block cache, the block is read from there if
+ *  possible, and added to it otherwise.  If the DB file is memory mapped and
+ *  block n is in the mapping, the block is copied from the mapping.
+ */
 void
 BrassTable::read_block(uint4 n, byte * p) const
 {
@@ -163,16 +187,115 @@ BrassTable::read_block(uint4 n, byte * p) const
 	BrassTable::throw_database_closed();
     AssertRel(n,<,base.get_first_unused_block());
 
-    io_read_block(handle, reinterpret_cast<char *>(p), block_size, n);
+    if (block_cache &&
+	block_cache->read(cache_file_id, revision_number, n, p, block_size))
+	return;
 
-    if (GET_LEVEL(p) != LEVEL_FREELIST) {
-	int dir_end = DIR_END(p);
-	if (rare(dir_end < DIR_START || unsigned(dir_end) > block_size)) {
-	    string msg("dir_end invalid in block ");
-	    msg += str(n);
-	    throw Xapian::DatabaseCorruptError(msg);
+    if (mapping && (size_t(n) + 1) * block_size <= mapped_size) {
+	// A writer can reuse the block at any time, so we copy it rather than
+	// using it in place - that way the block we check (and later check
+	// the revision of) is the block we use.  This still saves a syscall.
+	memcpy(p, mapping + size_t(n) * block_size, block_size);
+    } else {
+	io_read_block(handle, reinterpret_cast<char *>(p), block_size, n);
+    }
+
+    check_block(n, p, block_size);
+
+    // Don't cache a block which has been overwritten by a newer revision -
+    // the caller will report that.
+    if (block_cache && REVISION(p) <= revision_number)
+	block_cache->add(cache_file_id, revision_number, n, p, block_size);
+}
+
+/** load_block(cur, n) loads block n of the DB file into cursor entry cur.
+ *
+ *  The caller is responsible for setting the block number in cur.
+ *
+ *  Returns a pointer to the block.
+ */
+const byte *
+BrassTable::load_block(Brass::Cursor & cur, uint4 n) const
+{
+    LOGCALL(DB, const byte *, "BrassTable::load_block", (void*)&cur | n);
+    ++blocks_loaded;
+    byte * p = cur.init(block_size);
+    read_block(n, p);
+    RETURN(p);
+}
+
+/// Prefetch blocks for a sequential scan which is about to read block n.
+void
+BrassTable::readahead_for_sequential(Brass::Cursor & cur, uint4 n) const
+{
+    LOGCALL_VOID(DB, "BrassTable::readahead_for_sequential", (void*)&cur | n);
+    uint4 first, count;
+    if (cur.next_readahead(n, base.get_first_unused_block(), first, count))
+	io_readahead_block(handle, block_size, first, count);
+}
+
+/** Memory map the DB file for reading.
+ *
+ *  If the file which is already mapped is still the DB file and the mapping
+ *  covers it, the existing mapping is reused.  Otherwise any existing mapping
+ *  is unmapped (blocks are always copied out of the mapping, so nothing can
+ *  still be using it) and a new mapping is made, with some room for the file
+ *  to grow.  If the mapping fails we just read blocks as usual.
+ */
+void
+BrassTable::map_file()
+{
+    LOGCALL_VOID(DB, "BrassTable::map_file", NO_ARGS);
+#ifdef HAVE_MMAP
+    struct stat statbuf;
+    if (fstat(handle, &statbuf) != 0) return;
+    size_t file_size = statbuf.st_size;
+    if (off_t(file_size) != statbuf.st_size) return;
+    string identity(reinterpret_cast<const char *>(&statbuf.st_dev),
+		    sizeof(statbuf.st_dev));
+    identity.append(reinterpret_cast<const char *>(&statbuf.st_ino),
+		    sizeof(statbuf.st_ino));
+
+    if (mapping) {
+	if (identity == mapping_identity && file_size <= mapping_length) {
+	    mapped_size = file_size;
+	    return;
 	}
+	unmap_files();
+    }
+
+    if (file_size == 0) return;
+
+    // Allow for the file growing by a quarter before we need to map it
+    // again.  Blocks beyond the end of the file when it was last opened are
+    // never accessed via the mapping, but once the file has grown they
+    // become valid.
+    size_t length = file_size + file_size / 4;
+    if (length < file_size) length = file_size;
+    void * p = mmap(NULL, length, PROT_READ, MAP_SHARED, handle, 0);
+    if (p == MAP_FAILED) {
+	LOGLINE(DB, "Failed to mmap " << name << "DB: " << strerror(errno));
+	return;
     }
+    mapping = static_cast<const byte *>(p);
+    mapping_length = length;
+    mapped_size = file_size;
+    mapping_identity = identity;
+#endif
+}
+
+/// Unmap the memory mapping of the DB file, if there is one.
+void
+BrassTable::unmap_files()
+{
+    LOGCALL_VOID(DB, "BrassTable::unmap_files", NO_ARGS);
+#ifdef HAVE_MMAP
+    if (mapping) {
+	(void)munmap(const_cast<byte *>(mapping), mapping_length);
+	mapping = NULL;
+	mapped_size = 0;
+    }
+#endif
 }
 
 /** write_block(n, p, appending) writes block n in the DB file from address p.
@@ -335,10 +458,16 @@ BrassTable::block_to_cursor(Brass::Cursor * C_, int j, uint4 n) const
     if (n == C[j].get_n()) {
 	p = C_[j].clone(C[j]);
     } else {
-	byte * q = C_[j].init(block_size);
-	read_block(n, q);
-	p = q;
+	p = load_block(C_[j], n);
 	C_[j].set_n(n);
+	if (block_cache && C_ == C && j > 0) {
+	    // Keep the branch blocks on the path of the built-in cursor
+	    // in the block cache.
+	    if (pinned[j] != BLK_UNUSED)
+		block_cache->unpin(cache_file_id, revision_number, pinned[j]);
+	    bool ok = block_cache->pin(cache_file_id, revision_number, n);
+	    pinned[j] = ok ? n : BLK_UNUSED;
+	}
     }
 
     if (j < level) {
@@ -360,6 +489,18 @@ BrassTable::block_to_cursor(Brass::Cursor * C_, int j, uint4 n) const
     }
 }
 
+void
+BrassTable::unpin_cursor_blocks() const
+{
+    LOGCALL_VOID(DB, "BrassTable::unpin_cursor_blocks", NO_ARGS);
+    for (int j = 0; j < BTREE_CURSOR_LEVELS; ++j) {
+	if (pinned[j] != BLK_UNUSED) {
+	    block_cache->unpin(cache_file_id, revision_number, pinned[j]);
+	    pinned[j] = BLK_UNUSED;
+	}
+    }
+}
+
 /** Btree::alter(); is called when the B-tree is to be altered.
 
    It causes new blocks to be forced for the current set of blocks in
@@ -1002,28 +1143,11 @@ BrassTable::add(const string &key, string tag, bool already_compressed)
 	CompileTimeAssert(DONT_COMPRESS != Z_RLE);
 #endif
 
-	comp_stream.lazy_alloc_deflate_zstream();
-
-	comp_stream.deflate_zstream->next_in = (Bytef *)const_cast<char *>(tag.data());
-	comp_stream.deflate_zstream->avail_in = (uInt)tag.size();
-
-	// If compressed size is >= tag.size(), we don't want to compress.
-	unsigned long blk_len = tag.size() - 1;
-	unsigned char * blk = new unsigned char[blk_len];
-	comp_stream.deflate_zstream->next_out = blk;
-	comp_stream.deflate_zstream->avail_out = (uInt)blk_len;
-
-	int err = deflate(comp_stream.deflate_zstream, Z_FINISH);
-	if (err == Z_STREAM_END) {
-	    // If deflate succeeded, then the output was at least one byte
-	    // smaller than the input.
-	    tag.assign(reinterpret_cast<const char *>(blk), comp_stream.deflate_zstream->total_out);
+	string compressed_tag;
+	if (codecs.compress(codec, tag, compressed_tag)) {
+	    swap(tag, compressed_tag);
 	    compressed = true;
-	} else {
-	    // Deflate failed - presumably the data wasn't compressible.
 	}
-
-	delete [] blk;
     }
 
     // sort of matching kt.append_chunk(), but setting the chunk
@@ -1162,6 +1286,29 @@ BrassTable::get_exact_entry(const string &key, string & tag) const
     RETURN(true);
 }
 
+bool
+BrassTable::get_exact_entry(const string &key, BrassTagSink & sink) const
+{
+    LOGCALL(DB, bool, "BrassTable::get_exact_entry", key | Literal("sink"));
+    Assert(!key.empty());
+
+    if (handle < 0) {
+	if (handle == -2) {
+	    BrassTable::throw_database_closed();
+	}
+	RETURN(false);
+    }
+
+    // An oversized key can't exist, so attempting to search for it should fail.
+    if (key.size() > BRASS_BTREE_MAX_KEY_LEN) RETURN(false);
+
+    form_key(key);
+    if (!find(C)) RETURN(false);
+
+    read_tag(C, sink);
+    RETURN(true);
+}
+
 bool
 BrassTable::key_exists(const string &key) const
 {
@@ -1185,12 +1332,21 @@ BrassTable::read_tag(Brass::Cursor * C_, string *tag, bool keep_compressed) cons
     int n = item.components_of();
 
     tag->resize(0);
+
+    bool compressed = item.get_compressed();
+    if (compressed && !keep_compressed) {
+	// Decompress each component as we read it, so we don't need both the
+	// full compressed and uncompressed tags in memory at once.
+	BrassStringTagSink sink(*tag);
+	read_tag(C_, sink);
+	RETURN(false);
+    }
+
     // max_item_size also includes K1 + I2 + C2 + C2 bytes overhead and the key
     // (which is at least 1 byte long).
     if (n > 1) tag->reserve((max_item_size - (1 + K1 + I2 + C2 + C2)) * n);
 
     item.append_chunk(tag);
-    bool compressed = item.get_compressed();
 
     for (int i = 2; i <= n; i++) {
 	if (!next(C_, 0)) {
@@ -1200,64 +1356,39 @@ BrassTable::read_tag(Brass::Cursor * C_, string *tag, bool keep_compressed) cons
     }
     // At this point the cursor is on the last item - calling next will move
     // it to the next key (BrassCursor::get_tag() relies on this).
-    if (!compressed || keep_compressed) RETURN(compressed);
-
-    // FIXME: Perhaps we should we decompress each chunk as we read it so we
-    // don't need both the full compressed and uncompressed tags in memory
-    // at once.
-
-    string utag;
-    // May not be enough for a compressed tag, but it's a reasonable guess.
-    utag.reserve(tag->size() + tag->size() / 2);
-
-    Bytef buf[8192];
-
-    comp_stream.lazy_alloc_inflate_zstream();
-
-    comp_stream.inflate_zstream->next_in = (Bytef*)const_cast<char *>(tag->data());
-    comp_stream.inflate_zstream->avail_in = (uInt)tag->size();
-
-    int err = Z_OK;
-    while (err != Z_STREAM_END) {
-	comp_stream.inflate_zstream->next_out = buf;
-	comp_stream.inflate_zstream->avail_out = (uInt)sizeof(buf);
-	err = inflate(comp_stream.inflate_zstream, Z_SYNC_FLUSH);
-	if (err == Z_BUF_ERROR && comp_stream.inflate_zstream->avail_in == 0) {
-	    LOGLINE(DB, "Z_BUF_ERROR - faking checksum of " << comp_stream.inflate_zstream->adler);
-	    Bytef header2[4];
-	    setint4(header2, 0, comp_stream.inflate_zstream->adler);
-	    comp_stream.inflate_zstream->next_in = header2;
-	    comp_stream.inflate_zstream->avail_in = 4;
-	    err = inflate(comp_stream.inflate_zstream, Z_SYNC_FLUSH);
-	    if (err == Z_STREAM_END) break;
-	}
+    RETURN(compressed);
+}
 
-	if (err != Z_OK && err != Z_STREAM_END) {
-	    if (err == Z_MEM_ERROR) throw std::bad_alloc();
-	    string msg = "inflate failed";
-	    if (comp_stream.inflate_zstream->msg) {
-		msg += " (";
-		msg += comp_stream.inflate_zstream->msg;
-		msg += ')';
-	    }
-	    throw Xapian::DatabaseError(msg);
-	}
+void
+BrassTable::read_tag(Brass::Cursor * C_, BrassTagSink & sink) const
+{
+    LOGCALL_VOID(DB, "BrassTable::read_tag", Literal("C_") | Literal("sink"));
+    Item item(C_[0].get_p(), C_[0].c);
 
-	utag.append(reinterpret_cast<const char *>(buf),
-		    comp_stream.inflate_zstream->next_out - buf);
-    }
-    if (utag.size() != comp_stream.inflate_zstream->total_out) {
-	string msg = "compressed tag didn't expand to the expected size: ";
-	msg += str(utag.size());
-	msg += " != ";
-	// OpenBSD's zlib.h uses off_t instead of uLong for total_out.
-	msg += str((size_t)comp_stream.inflate_zstream->total_out);
-	throw Xapian::DatabaseCorruptError(msg);
-    }
+    /* n components to join */
+    int n = item.components_of();
 
-    swap(*tag, utag);
+    bool compressed = item.get_compressed();
+    if (compressed) codecs.decompress_start();
 
-    RETURN(false);
+    for (int i = 1; i <= n; i++) {
+	if (i > 1) {
+	    if (!next(C_, 0)) {
+		throw Xapian::DatabaseCorruptError("Unexpected end of table when reading continuation of tag");
+	    }
+	    item = Item(C_[0].get_p(), C_[0].c);
+	}
+	size_t len;
+	const char * chunk = item.get_chunk(len);
+	if (compressed) {
+	    codecs.decompress_chunk(chunk, len, sink);
+	} else {
+	    sink.append(chunk, len);
+	}
+    }
+    // At this point the cursor is on the last item - calling next will move
+    // it to the next key (BrassCursor::get_tag() relies on this).
+    if (compressed) codecs.decompress_end(sink);
 }
 
 void
@@ -1508,7 +1639,8 @@ BrassTable::do_open_to_write(bool revision_supplied,
 }
 
 BrassTable::BrassTable(const char * tablename_, const string & path_,
-		       bool readonly_, int compress_strategy_, bool lazy_)
+		       bool readonly_, int compress_strategy_, bool lazy_,
+		       int codec_)
 	: tablename(tablename_),
 	  revision_number(0),
 	  item_count(0),
@@ -1537,10 +1669,20 @@ BrassTable::BrassTable(const char * tablename_, const string & path_,
 	  changes_obj(NULL),
 	  split_p(0),
 	  compress_strategy(compress_strategy_),
-	  comp_stream(compress_strategy_),
-	  lazy(lazy_)
+	  codec(BrassCodec::available(codec_) ? codec_ : BRASS_CODEC_ZLIB),
+	  codecs(compress_strategy_),
+	  lazy(lazy_),
+	  block_cache(NULL),
+	  cache_file_id(0),
+	  mapping(NULL),
+	  mapping_length(0),
+	  mapped_size(0),
+	  blocks_loaded(0)
 {
-    LOGCALL_CTOR(DB, "BrassTable", tablename_ | path_ | readonly_ | compress_strategy_ | lazy_);
+    LOGCALL_CTOR(DB, "BrassTable", tablename_ | path_ | readonly_ | compress_strategy_ | lazy_ | codec_);
+    for (int j = 0; j < BTREE_CURSOR_LEVELS; ++j) {
+	pinned[j] = BLK_UNUSED;
+    }
 }
 
 bool
@@ -1613,11 +1755,18 @@ BrassTable::create_and_open(int flags_, unsigned int block_size_)
 BrassTable::~BrassTable() {
     LOGCALL_DTOR(DB, "BrassTable");
     BrassTable::close();
+    unmap_files();
 }
 
 void BrassTable::close(bool permanent) {
     LOGCALL_VOID(DB, "BrassTable::close", NO_ARGS);
 
+    if (block_cache) {
+	unpin_cursor_blocks();
+	block_cache = NULL;
+    }
+    file_identity.resize(0);
+
     if (handle >= 0) {
 	// If an error occurs here, we just ignore it, since we're just
 	// trying to free everything.
@@ -1625,6 +1774,10 @@ void BrassTable::close(bool permanent) {
 	handle = -1;
     }
 
+    // Keep any mapping so that we can reuse it if the table is reopened, but
+    // don't read any more blocks from it until then.
+    mapped_size = 0;
+
     if (permanent) {
 	handle = -2;
 	// Don't delete the resources in the table, since they may
@@ -1666,6 +1819,16 @@ BrassTable::flush_db()
     }
 }
 
+void
+BrassTable::sync_db()
+{
+    LOGCALL_VOID(DB, "BrassTable::sync_db", NO_ARGS);
+    Assert(writable);
+    if (handle < 0 || (flags & Xapian::DB_NO_SYNC)) return;
+    if (!io_sync(handle))
+	throw Xapian::DatabaseError("Can't commit new revision - failed to flush DB to disk");
+}
+
 void
 BrassTable::commit(brass_revision_number_t revision)
 {
@@ -1839,6 +2002,32 @@ BrassTable::do_open_to_read(bool revision_supplied, brass_revision_number_t revi
 	throw Xapian::DatabaseOpeningError("Failed to open table for reading");
     }
 
+    if (flags & Xapian::DB_MMAP) map_file();
+
+    if (!uuid.empty()) {
+	// Identify the file by device and inode, and the database UUID in
+	// case the file has been truncated and reused for a new database.
+	// The UUID alone isn't enough since a copy of a database may have
+	// been modified independently.
+	struct stat statbuf;
+	if (fstat(handle, &statbuf) == 0) {
+	    file_identity = uuid;
+	    file_identity.append(reinterpret_cast<const char *>(&statbuf.st_dev),
+				 sizeof(statbuf.st_dev));
+	    file_identity.append(reinterpret_cast<const char *>(&statbuf.st_ino),
+				 sizeof(statbuf.st_ino));
+	}
+    }
+
+    // The page cache already does the job of the block cache for blocks
+    // read via a memory mapping.
+    if (!mapping && !file_identity.empty()) {
+	block_cache = BrassBlockCache::get_instance();
+	if (block_cache) {
+	    cache_file_id = block_cache->get_file_id(file_identity);
+	}
+    }
+
     for (int j = 0; j <= level; j++) {
 	C[j].init(block_size);
     }
@@ -1927,9 +2116,7 @@ BrassTable::prev_for_sequential(Brass::Cursor * C_, int /*dummy*/) const
 		// Block isn't in the built-in cursor, so the form on disk
 		// is valid, so read it to check if it's the next level 0
 		// block.
-		byte * q = C_[0].init(block_size);
-		read_block(n, q);
-		p = q;
+		p = load_block(C_[0], n);
 		C_[0].set_n(n);
 	    }
 	    if (writable) AssertEq(revision_number, latest_revision_number);
@@ -1985,9 +2172,8 @@ BrassTable::next_for_sequential(Brass::Cursor * C_, int /*dummy*/) const
 		    p = q;
 		}
 	    } else {
-		byte * q = C_[0].init(block_size);
-		read_block(n, q);
-		p = q;
+		readahead_for_sequential(C_[0], n);
+		p = load_block(C_[0], n);
 	    }
 	    if (writable) AssertEq(revision_number, latest_revision_number);
 	    if (REVISION(p) > revision_number + writable) {
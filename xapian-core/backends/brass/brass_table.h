@@ -36,6 +36,7 @@
 #include "stringutils.h"
 #include "unaligned.h"
 
+#include "brass_codec.h"
 #include "common/compression_stream.h"
 
 #include <algorithm>
@@ -169,6 +170,12 @@ public:
 	int l = size() - cd;
 	tag->append(reinterpret_cast<const char *>(p + cd), l);
     }
+    /// Return this item's chunk of the tag, and set len to its length.
+    const char * get_chunk(size_t & len) const {
+	int cd = getK(p, I2) + I2 + C2;
+	len = size() - cd;
+	return reinterpret_cast<const char *>(p + cd);
+    }
     /** Get this item's tag as a block number (this block should not be at
      *  level 0).
      */
@@ -273,6 +280,7 @@ public:
 // FIXME: but we want it to be completely impossible...
 #define BTREE_CURSOR_LEVELS 10
 
+class BrassBlockCache;
 class BrassChanges;
 
 /** Class managing a Btree table in a Brass database.
@@ -321,10 +329,14 @@ class BrassTable {
 	 *				Z_FILTERED, Z_HUFFMAN_ONLY, or Z_RLE.
 	 *  @param lazy		If true, don't create the table until it's
 	 *			needed.
+	 *  @param codec_	The codec to compress tags with (one of the
+	 *			BRASS_CODEC_* constants).  If this build doesn't
+	 *			support it, BRASS_CODEC_ZLIB is used instead.
+	 *			Ignored if compress_strategy_ is DONT_COMPRESS.
 	 */
 	BrassTable(const char * tablename_, const std::string & path_,
 		   bool readonly_, int compress_strategy_ = DONT_COMPRESS,
-		   bool lazy = false);
+		   bool lazy = false, int codec_ = BRASS_CODEC_ZLIB);
 
 	/** Close the Btree.
 	 *
@@ -382,6 +394,12 @@ class BrassTable {
 	/** Return true if this table is writable. */
 	bool is_writable() const { return writable; }
 
+	/** The number of blocks loaded into cursors so far.
+	 *
+	 *  Used for profiling.
+	 */
+	totlen_t get_blocks_loaded() const { return blocks_loaded; }
+
 	/** Flush any outstanding changes to the DB file of the table.
 	 *
 	 *  This must be called before commit, to ensure that the DB file is
@@ -389,6 +407,14 @@ class BrassTable {
 	 */
 	void flush_db();
 
+	/** Sync the DB file of the table to disk.
+	 *
+	 *  commit() does this anyway, but calling this first means there's
+	 *  little left for commit() to wait for.  Does nothing if the table
+	 *  was opened with Xapian::DB_NO_SYNC.
+	 */
+	void sync_db();
+
 	/** Commit any outstanding changes to the table.
 	 *
 	 *  Commit changes made by calling add() and del() to the Btree.
@@ -427,6 +453,20 @@ class BrassTable {
 	 */
 	bool get_exact_entry(const std::string & key, std::string & tag) const;
 
+	/** Read an entry from the table, passing the tag to @a sink in
+	 *  pieces.
+	 *
+	 *  This is like get_exact_entry(key, tag), but avoids needing to
+	 *  hold the whole tag (and its compressed form) in memory.
+	 *
+	 *  @param key  The key to look for in the table.
+	 *  @param sink The tag is passed to this if the key is found.
+	 *
+	 *  @return true if key is found in table,
+	 *          false if key is not found in table.
+	 */
+	bool get_exact_entry(const std::string & key, BrassTagSink & sink) const;
+
 	/** Check if a key exists in the Btree.
 	 *
 	 *  This is just like get_exact_entry() except it doesn't read the tag
@@ -450,6 +490,13 @@ class BrassTable {
 	 */
 	bool read_tag(Brass::Cursor * C_, std::string *tag, bool keep_compressed) const;
 
+	/** Read the tag value for the key pointed to by cursor C_, passing
+	 *  it to @a sink in pieces.
+	 *
+	 *  Each component of a compressed tag is decompressed as it's read.
+	 */
+	void read_tag(Brass::Cursor * C_, BrassTagSink & sink) const;
+
 	/** Add a key/tag pair to the table, replacing any existing pair with
 	 *  the same key.
 	 *
@@ -605,6 +652,27 @@ class BrassTable {
 	    changes_obj = changes;
 	}
 
+	/** Set the UUID of the database this table belongs to.
+	 *
+	 *  This is used to identify the table's blocks in the shared block
+	 *  cache - if it isn't set, blocks from this table won't be cached.
+	 *
+	 *  @param uuid_	The 16 byte binary UUID.
+	 */
+	void set_uuid(const char * uuid_) {
+	    uuid.assign(uuid_, 16);
+	}
+
+	/** Return a string uniquely identifying the DB file open for reading.
+	 *
+	 *  This is suitable for identifying data from this table in caches
+	 *  shared across the process.
+	 *
+	 *  @return The identity, or an empty string if the table isn't open
+	 *	    for reading or the file can't be identified.
+	 */
+	const std::string & get_file_identity() const { return file_identity; }
+
 	/// Throw an exception indicating that the database is closed.
 	XAPIAN_NORETURN(static void throw_database_closed());
 
@@ -628,9 +696,14 @@ class BrassTable {
 	bool find(Brass::Cursor *) const;
 	int delete_kt();
 	void read_block(uint4 n, byte *p) const;
+	const byte * load_block(Brass::Cursor & cur, uint4 n) const;
+	void readahead_for_sequential(Brass::Cursor & cur, uint4 n) const;
+	void map_file();
+	void unmap_files();
 	void write_block(uint4 n, const byte *p, bool appending = false) const;
 	XAPIAN_NORETURN(void set_overwritten() const);
 	void block_to_cursor(Brass::Cursor *C_, int j, uint4 n) const;
+	void unpin_cursor_blocks() const;
 	void alter();
 	void compact(byte *p);
 	void enter_key(int j, Brass::Key prevkey, Brass::Key newkey);
@@ -790,11 +863,56 @@ class BrassTable {
 	 *  Z_RLE. */
 	int compress_strategy;
 
-	mutable CompressionStream comp_stream;
+	/// The codec to compress new tags with.
+	int codec;
+
+	/// Used to compress and decompress tags.
+	mutable BrassCodec codecs;
 
 	/// If true, don't create the table until it's needed.
 	bool lazy;
 
+	/// UUID of the database, or empty if not known.
+	std::string uuid;
+
+	/** String which uniquely identifies the open DB file, or empty if
+	 *  it can't be identified (e.g. the UUID isn't known).
+	 */
+	std::string file_identity;
+
+	/** The shared block cache, or NULL if we're not using it.
+	 *
+	 *  Only read-only tables use the block cache.
+	 */
+	BrassBlockCache * block_cache;
+
+	/// Identifies this table's DB file in block_cache.
+	uint4 cache_file_id;
+
+	/** Blocks in block_cache pinned for the built-in cursor.
+	 *
+	 *  pinned[j] is BLK_UNUSED if there's no block pinned for level j.
+	 */
+	mutable uint4 pinned[BTREE_CURSOR_LEVELS];
+
+	/** Read-only memory mapping of the DB file, or NULL.
+	 *
+	 *  Only used for read-only tables opened with Xapian::DB_MMAP.
+	 */
+	const byte * mapping;
+
+	/// The length of mapping.
+	size_t mapping_length;
+
+	/// The number of bytes at the start of mapping which can be used.
+	size_t mapped_size;
+
+	/// Device and inode of the file mapped by mapping.
+	std::string mapping_identity;
+
+	/// The number of blocks loaded into cursors (for profiling).
+	mutable totlen_t blocks_loaded;
+
 	/* Debugging methods */
 //	void report_block_full(int m, int n, const byte * p);
 };
@@ -0,0 +1,121 @@
+/** @file brass_termfreqcache.cc
+ * @brief Process-wide cache of brass term frequencies.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "brass_termfreqcache.h"
+
+#include "debuglog.h"
+
+#include <cstdlib>
+
+using namespace std;
+
+BrassTermFreqCache *
+BrassTermFreqCache::get_instance()
+{
+    // The instance is deliberately never deleted, as tables may still be
+    // using it while static destructors run.
+    static BrassTermFreqCache * instance = NULL;
+    static bool initialised = false;
+    static Mutex init_mutex;
+    MutexLock lock(init_mutex);
+    if (!initialised) {
+	initialised = true;
+	const char *p = getenv("XAPIAN_TERMFREQ_CACHE_SIZE");
+	if (p) {
+	    size_t capacity = strtoul(p, NULL, 10);
+	    if (capacity) instance = new BrassTermFreqCache(capacity);
+	}
+    }
+    return instance;
+}
+
+uint4
+BrassTermFreqCache::get_file_id(const string & identity)
+{
+    MutexLock lock(mutex);
+    uint4 * p = file_ids.find(identity);
+    if (p) return *p;
+    // Forget the file opened least recently.  If it's opened again it just
+    // gets a new id, and the entries cached under the old one get evicted in
+    // the usual way.
+    if (file_ids.size() >= MAX_FILE_IDS) file_ids.pop_back();
+    if (++last_file_id == 0) ++last_file_id;
+    file_ids.insert(identity, last_file_id);
+    return last_file_id;
+}
+
+bool
+BrassTermFreqCache::read(uint4 file_id, brass_revision_number_t revision,
+			 const string & term,
+			 Xapian::doccount & termfreq,
+			 Xapian::termcount & collfreq)
+{
+    MutexLock lock(mutex);
+    const Freqs * freqs = entries.find(Key(file_id, revision, term));
+    if (!freqs) {
+	++misses;
+	return false;
+    }
+    ++hits;
+    termfreq = freqs->termfreq;
+    collfreq = freqs->collfreq;
+    return true;
+}
+
+void
+BrassTermFreqCache::add(uint4 file_id, brass_revision_number_t revision,
+			const string & term,
+			Xapian::doccount termfreq, Xapian::termcount collfreq)
+{
+    MutexLock lock(mutex);
+    Key key(file_id, revision, term);
+    // Another table may have added this term while we were looking it up.
+    if (entries.contains(key)) return;
+    if (entries.size() >= capacity) {
+	LOGLINE(DB, "Evicting term " << entries.back().first.term <<
+		" from the termfreq cache");
+	entries.pop_back();
+    }
+    entries.insert(key, Freqs(termfreq, collfreq));
+}
+
+unsigned long
+BrassTermFreqCache::get_hits() const
+{
+    MutexLock lock(mutex);
+    return hits;
+}
+
+unsigned long
+BrassTermFreqCache::get_misses() const
+{
+    MutexLock lock(mutex);
+    return misses;
+}
+
+size_t
+BrassTermFreqCache::get_size() const
+{
+    MutexLock lock(mutex);
+    return entries.size();
+}
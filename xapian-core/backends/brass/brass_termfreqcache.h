@@ -0,0 +1,160 @@
+/** @file brass_termfreqcache.h
+ * @brief Process-wide cache of brass term frequencies.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_BRASS_TERMFREQCACHE_H
+#define XAPIAN_INCLUDED_BRASS_TERMFREQCACHE_H
+
+#include "brass_types.h"
+#include "lrucache.h"
+#include "mutexlock.h"
+#include "xapian/types.h"
+
+#include <string>
+
+/** A size-bounded cache of term frequencies, shared by all read-only brass
+ *  postlist tables in the process.
+ *
+ *  Looking up a term's frequencies needs a B-tree lookup of the first chunk
+ *  of its postlist, and the same popular terms tend to be looked up for
+ *  query after query.  Since the frequencies can only change when the
+ *  table's revision does, entries are keyed by the revision as well as the
+ *  file and the term, and entries for old revisions get evicted as they
+ *  fall out of use.
+ *
+ *  The wdf upper bound for a term is calculated from its collection
+ *  frequency, so that's cached too in effect.
+ *
+ *  The cache is enabled by setting XAPIAN_TERMFREQ_CACHE_SIZE in the
+ *  environment to the maximum number of terms to hold.
+ */
+class BrassTermFreqCache {
+    /// Don't allow copying.
+    BrassTermFreqCache(const BrassTermFreqCache &);
+
+    /// Don't allow assignment.
+    void operator=(const BrassTermFreqCache &);
+
+    struct Key {
+	uint4 file_id;
+
+	brass_revision_number_t revision;
+
+	std::string term;
+
+	Key(uint4 file_id_, brass_revision_number_t revision_,
+	    const std::string & term_)
+	    : file_id(file_id_), revision(revision_), term(term_) { }
+
+	bool operator<(const Key & o) const {
+	    if (file_id != o.file_id) return file_id < o.file_id;
+	    if (revision != o.revision) return revision < o.revision;
+	    return term < o.term;
+	}
+    };
+
+    struct Freqs {
+	Xapian::doccount termfreq;
+
+	Xapian::termcount collfreq;
+
+	Freqs(Xapian::doccount termfreq_, Xapian::termcount collfreq_)
+	    : termfreq(termfreq_), collfreq(collfreq_) { }
+    };
+
+    /// The cached frequencies.
+    LRUCache<Key, Freqs> entries;
+
+    /// The most files we keep ids for.
+    static const size_t MAX_FILE_IDS = 1024;
+
+    /// Map from file identity to file_id, for recently opened files.
+    LRUCache<std::string, uint4> file_ids;
+
+    /// The last file_id handed out.
+    uint4 last_file_id;
+
+    /// The maximum number of entries.
+    size_t capacity;
+
+    /// Number of successful lookups.
+    unsigned long hits;
+
+    /// Number of unsuccessful lookups.
+    unsigned long misses;
+
+    /// Protects all the above.
+    mutable Mutex mutex;
+
+  public:
+    /// Create a cache holding up to @a capacity_ terms.
+    explicit BrassTermFreqCache(size_t capacity_)
+	: last_file_id(0), capacity(capacity_), hits(0), misses(0) { }
+
+    /** Return the process-wide cache.
+     *
+     *  @return NULL if the cache isn't enabled.
+     */
+    static BrassTermFreqCache * get_instance();
+
+    /** Return the id to use for a file.
+     *
+     *  @param identity	String identifying the file uniquely (from
+     *			BrassTable::get_file_identity()).
+     *
+     *  @return An id for the file, which is never 0.  If a file hasn't
+     *	       been opened recently, it may get a different id from last
+     *	       time.
+     */
+    uint4 get_file_id(const std::string & identity);
+
+    /** Look up the frequencies of a term.
+     *
+     *  @param file_id		The id for the file (from get_file_id()).
+     *  @param revision		The revision of the table.
+     *  @param term		The term.
+     *  @param[out] termfreq	The term frequency, if found.
+     *  @param[out] collfreq	The collection frequency, if found.
+     *
+     *  @return true if the term was found.
+     */
+    bool read(uint4 file_id, brass_revision_number_t revision,
+	      const std::string & term,
+	      Xapian::doccount & termfreq, Xapian::termcount & collfreq);
+
+    /// Add the frequencies of a term to the cache.
+    void add(uint4 file_id, brass_revision_number_t revision,
+	     const std::string & term,
+	     Xapian::doccount termfreq, Xapian::termcount collfreq);
+
+    /// Return the number of lookups which found the term in the cache.
+    unsigned long get_hits() const;
+
+    /// Return the number of lookups which didn't find the term in the cache.
+    unsigned long get_misses() const;
+
+    /// Return the number of terms currently held.
+    size_t get_size() const;
+
+    /// Return the maximum number of terms to hold.
+    size_t get_capacity() const { return capacity; }
+};
+
+#endif // XAPIAN_INCLUDED_BRASS_TERMFREQCACHE_H
@@ -50,7 +50,7 @@ class BrassTermListTable : public BrassLazyTable {
      */
     BrassTermListTable(const std::string & dbdir, bool readonly)
 	: BrassLazyTable("termlist", dbdir + "/termlist.", readonly,
-			 Z_DEFAULT_STRATEGY) { }
+			 Z_DEFAULT_STRATEGY, BRASS_CODEC_LZ4) { }
 
     /** Set the termlist data for document @a did.
      *
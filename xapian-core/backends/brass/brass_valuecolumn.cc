@@ -0,0 +1,199 @@
+/** @file brass_valuecolumn.cc
+ * @brief Dense in-memory copy of a brass value slot.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "brass_valuecolumn.h"
+
+#include "brass_database.h"
+#include "brass_valuelist.h"
+#include "autoptr.h"
+#include "debuglog.h"
+#include "omassert.h"
+#include "str.h"
+
+#include <map>
+
+using namespace std;
+
+BrassValueColumn *
+BrassValueColumn::build(Xapian::valueno slot,
+			const Xapian::Internal::intrusive_ptr<const BrassDatabase> & db,
+			Xapian::docid last_did)
+{
+    LOGCALL_STATIC(DB, BrassValueColumn *, "BrassValueColumn::build", slot | db | last_did);
+    AutoPtr<BrassValueColumn> column(new BrassValueColumn(slot));
+    vector<Xapian::docid> & ordinals = column->ordinals;
+    ordinals.resize(last_did + 1);
+    vector<string::size_type> & offsets = column->offsets;
+    offsets.resize(last_did + 2);
+    string & data = column->data;
+
+    // Storing each distinct value once only saves memory if values repeat.
+    // If most are distinct (e.g. a timestamp or an id), the dictionary costs
+    // as much as the values themselves, and the map we build it with costs
+    // several times that, so once we've seen that many distinct values we
+    // stop building the dictionary and just keep the values in docid order.
+    Xapian::doccount max_distinct = db->get_value_freq(slot) / 2;
+    bool use_dictionary = true;
+
+    // First number the distinct values in the order we see them...
+    map<string, Xapian::docid> values;
+    Xapian::docid filled = 0;
+    BrassValueList vl(slot, db);
+    while (vl.next(), !vl.at_end()) {
+	Xapian::docid did = vl.get_docid();
+	if (rare(did > last_did)) {
+	    // Shouldn't happen, but don't index off the end of the array.
+	    RETURN(NULL);
+	}
+	// Docids between the last one with a value and this one get an empty
+	// range.
+	while (filled < did) offsets[++filled] = data.size();
+	string value = vl.get_value();
+	data += value;
+	if (!use_dictionary) continue;
+	pair<map<string, Xapian::docid>::iterator, bool> r;
+	r = values.insert(make_pair(value, Xapian::docid(values.size() + 1)));
+	if (r.second && values.size() > max_distinct) {
+	    LOGLINE(DB, "Too many distinct values in slot " << slot <<
+			" for a dictionary");
+	    use_dictionary = false;
+	    values.clear();
+	    vector<Xapian::docid>().swap(ordinals);
+	    continue;
+	}
+	ordinals[did] = r.first->second;
+    }
+    while (filled <= last_did) offsets[++filled] = data.size();
+
+    if (!use_dictionary) RETURN(column.release());
+
+    // The dictionary is being used, so we don't need the values by docid.
+    vector<string::size_type>().swap(offsets);
+    string().swap(data);
+
+    // ...then renumber them in sorted order, so the dictionary is in the
+    // same order as the values.
+    vector<Xapian::docid> renumber(values.size() + 1);
+    column->dictionary.reserve(values.size());
+    map<string, Xapian::docid>::const_iterator i;
+    for (i = values.begin(); i != values.end(); ++i) {
+	column->dictionary.push_back(i->first);
+	renumber[i->second] = column->dictionary.size();
+    }
+    values.clear();
+
+    vector<Xapian::docid>::iterator j;
+    for (j = ordinals.begin(); j != ordinals.end(); ++j) {
+	*j = renumber[*j];
+    }
+
+    RETURN(column.release());
+}
+
+Xapian::docid
+BrassValueColumn::next_set(Xapian::docid did) const
+{
+    if (did == 0) did = 1;
+    if (!ordinals.empty()) {
+	while (did < ordinals.size()) {
+	    if (ordinals[did]) return did;
+	    ++did;
+	}
+	return 0;
+    }
+    while (did + 1 < offsets.size()) {
+	if (offsets[did] != offsets[did + 1]) return did;
+	++did;
+    }
+    return 0;
+}
+
+Xapian::docid
+BrassValueColumnList::get_docid() const
+{
+    Assert(!at_end());
+    return did;
+}
+
+Xapian::valueno
+BrassValueColumnList::get_valueno() const
+{
+    return column->get_slot();
+}
+
+std::string
+BrassValueColumnList::get_value() const
+{
+    Assert(!at_end());
+    return column->get_value(did);
+}
+
+const std::string *
+BrassValueColumnList::get_value_ptr() const
+{
+    Assert(!at_end());
+    // We're always positioned on a document with a value.
+    return column->get_value_ptr(did);
+}
+
+bool
+BrassValueColumnList::at_end() const
+{
+    return finished;
+}
+
+void
+BrassValueColumnList::next()
+{
+    Assert(!at_end());
+    did = column->next_set(did + 1);
+    if (did == 0) finished = true;
+}
+
+void
+BrassValueColumnList::skip_to(Xapian::docid target)
+{
+    Assert(!at_end());
+    // If check() left us on a docid without a value, we still need to
+    // advance, so don't return early if target <= did.
+    did = column->next_set(max(target, did));
+    if (did == 0) finished = true;
+}
+
+bool
+BrassValueColumnList::check(Xapian::docid target)
+{
+    Assert(!at_end());
+    if (target <= did && column->is_set(did)) return true;
+    did = target;
+    return column->is_set(did);
+}
+
+string
+BrassValueColumnList::get_description() const
+{
+    string desc("BrassValueColumnList(slot=");
+    desc += str(column->get_slot());
+    desc += ')';
+    return desc;
+}
@@ -0,0 +1,177 @@
+/** @file brass_valuecolumn.h
+ * @brief Dense in-memory copy of a brass value slot.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_BRASS_VALUECOLUMN_H
+#define XAPIAN_INCLUDED_BRASS_VALUECOLUMN_H
+
+#include "backends/valuelist.h"
+#include "xapian/intrusive_ptr.h"
+#include "xapian/types.h"
+
+#include <string>
+#include <vector>
+
+class BrassDatabase;
+
+/** The values in one slot of a read-only brass database, stored by docid.
+ *
+ *  If values in the slot repeat, each distinct value is stored once in a
+ *  sorted dictionary, and each document has a fixed-width entry giving the
+ *  ordinal of its value in the dictionary (or 0 if it has no value in the
+ *  slot).  If most values are distinct (e.g. a timestamp), a dictionary
+ *  wouldn't save anything, so instead the values are concatenated in docid
+ *  order, with each document having an entry giving the offset of its value.
+ *
+ *  Either way, looking up a value is an array index rather than a B-tree
+ *  lookup and a scan of a value chunk.
+ */
+class BrassValueColumn : public Xapian::Internal::intrusive_base {
+    /// Don't allow assignment.
+    void operator=(const BrassValueColumn &);
+
+    /// Don't allow copying.
+    BrassValueColumn(const BrassValueColumn &);
+
+    /// The value slot.
+    Xapian::valueno slot;
+
+    /** The ordinal of the value for each docid.
+     *
+     *  Ordinal n refers to dictionary[n - 1]; 0 means no value is set.
+     *
+     *  Empty if the values are stored in @a data instead.
+     */
+    std::vector<Xapian::docid> ordinals;
+
+    /// The distinct values in the slot, in ascending order.
+    std::vector<std::string> dictionary;
+
+    /** The offset in @a data of the value for each docid.
+     *
+     *  The value for docid did runs from offsets[did] to offsets[did + 1] -
+     *  values can't be empty, so an empty range means no value is set.
+     *
+     *  Only used if @a ordinals is empty.
+     */
+    std::vector<std::string::size_type> offsets;
+
+    /// The values for each docid, concatenated.
+    std::string data;
+
+    BrassValueColumn(Xapian::valueno slot_) : slot(slot_) { }
+
+  public:
+    /** Build a column from the value stream for @a slot.
+     *
+     *  @param slot	The value slot.
+     *  @param db	The database to read the values from.
+     *  @param last_did	The highest docid in use in @a db.
+     *
+     *  @return The new column, or NULL if the value stream contains a docid
+     *	    above @a last_did.
+     */
+    static BrassValueColumn * build(Xapian::valueno slot,
+				    const Xapian::Internal::intrusive_ptr<const BrassDatabase> & db,
+				    Xapian::docid last_did);
+
+    Xapian::valueno get_slot() const { return slot; }
+
+    /// Return true if document @a did has a value set in this slot.
+    bool is_set(Xapian::docid did) const {
+	if (!ordinals.empty())
+	    return did < ordinals.size() && ordinals[did] != 0;
+	return did + 1 < offsets.size() && offsets[did] != offsets[did + 1];
+    }
+
+    /// Return the value of document @a did (empty if it isn't set).
+    std::string get_value(Xapian::docid did) const {
+	if (!ordinals.empty()) {
+	    if (did >= ordinals.size() || ordinals[did] == 0)
+		return std::string();
+	    return dictionary[ordinals[did] - 1];
+	}
+	if (did + 1 >= offsets.size()) return std::string();
+	return data.substr(offsets[did], offsets[did + 1] - offsets[did]);
+    }
+
+    /** Return a pointer to the value of document @a did.
+     *
+     *  @a did must have a value set.  Returns NULL if the values aren't
+     *  stored as separate strings, in which case use get_value() instead.
+     */
+    const std::string * get_value_ptr(Xapian::docid did) const {
+	if (ordinals.empty()) return NULL;
+	return &dictionary[ordinals[did] - 1];
+    }
+
+    /** Return the first docid >= @a did which has a value set.
+     *
+     *  Returns 0 if there isn't one.
+     */
+    Xapian::docid next_set(Xapian::docid did) const;
+
+    /** Return the number of distinct values in the slot.
+     *
+     *  Returns 0 if the values are stored by docid without a dictionary.
+     */
+    Xapian::docid get_dictionary_size() const { return dictionary.size(); }
+};
+
+/// Brass class for value streams read from a BrassValueColumn.
+class BrassValueColumnList : public Xapian::ValueIterator::Internal {
+    /// Don't allow assignment.
+    void operator=(const BrassValueColumnList &);
+
+    /// Don't allow copying.
+    BrassValueColumnList(const BrassValueColumnList &);
+
+    Xapian::Internal::intrusive_ptr<const BrassValueColumn> column;
+
+    /// The current docid, or 0 if we've not started, or are at the end.
+    Xapian::docid did;
+
+    /// Have we reached the end?
+    bool finished;
+
+  public:
+    BrassValueColumnList(const Xapian::Internal::intrusive_ptr<const BrassValueColumn> & column_)
+	: column(column_), did(0), finished(false) { }
+
+    Xapian::docid get_docid() const;
+
+    Xapian::valueno get_valueno() const;
+
+    std::string get_value() const;
+
+    const std::string * get_value_ptr() const;
+
+    bool at_end() const;
+
+    void next();
+
+    void skip_to(Xapian::docid);
+
+    bool check(Xapian::docid did);
+
+    std::string get_description() const;
+};
+
+#endif // XAPIAN_INCLUDED_BRASS_VALUECOLUMN_H
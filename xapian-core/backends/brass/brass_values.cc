@@ -24,16 +24,19 @@
 #include "brass_values.h"
 
 #include "brass_cursor.h"
+#include "brass_database.h"
 #include "brass_postlist.h"
 #include "brass_termlist.h"
 #include "debuglog.h"
 #include "backends/document.h"
+#include "backends/memoryused.h"
 #include "pack.h"
 
 #include "xapian/error.h"
 #include "xapian/valueiterator.h"
 
 #include <algorithm>
+#include <cstdlib>
 #include "autoptr.h"
 
 using namespace Brass;
@@ -129,6 +132,20 @@ ValueChunkReader::skip_to(Xapian::docid target)
     p = NULL;
 }
 
+void
+BrassValueManager::set_change(map<Xapian::docid, string> & m,
+			      Xapian::docid did, const string & val)
+{
+    pair<map<Xapian::docid, string>::iterator, bool> r;
+    r = m.insert(make_pair(did, string()));
+    if (r.second)
+	changes_size += sizeof(*r.first) + MAP_NODE_OVERHEAD;
+    else
+	changes_size -= r.first->second.size();
+    r.first->second = val;
+    changes_size += val.size();
+}
+
 void
 BrassValueManager::add_value(Xapian::docid did, Xapian::valueno slot,
 			     const string & val)
@@ -137,8 +154,9 @@ BrassValueManager::add_value(Xapian::docid did, Xapian::valueno slot,
     i = changes.find(slot);
     if (i == changes.end()) {
 	i = changes.insert(make_pair(slot, map<Xapian::docid, string>())).first;
+	changes_size += sizeof(*i) + MAP_NODE_OVERHEAD;
     }
-    i->second[did] = val;
+    set_change(i->second, did, val);
 }
 
 void
@@ -148,8 +166,9 @@ BrassValueManager::remove_value(Xapian::docid did, Xapian::valueno slot)
     i = changes.find(slot);
     if (i == changes.end()) {
 	i = changes.insert(make_pair(slot, map<Xapian::docid, string>())).first;
+	changes_size += sizeof(*i) + MAP_NODE_OVERHEAD;
     }
-    i->second[did] = string();
+    set_change(i->second, did, string());
 }
 
 Xapian::docid
@@ -354,6 +373,7 @@ BrassValueManager::merge_changes()
 	}
 	changes.clear();
     }
+    changes_size = 0;
 }
 
 void
@@ -403,7 +423,7 @@ BrassValueManager::add_document(Xapian::docid did, const Xapian::Document &doc,
     if (slots_used.empty() && slots.find(did) == slots.end()) {
 	// Adding a new document with no values which we didn't just remove.
     } else {
-	swap(slots[did], slots_used);
+	set_change(slots, did, slots_used);
     }
 }
 
@@ -415,11 +435,12 @@ BrassValueManager::delete_document(Xapian::docid did,
     map<Xapian::docid, string>::iterator it = slots.find(did);
     string s;
     if (it != slots.end()) {
+	changes_size -= it->second.size();
 	swap(s, it->second);
     } else {
 	// Get from table, making a swift exit if this document has no values.
 	if (!termlist_table->get_exact_entry(make_slot_key(did), s)) return;
-	slots.insert(make_pair(did, string()));
+	set_change(slots, did, string());
     }
     const char * p = s.data();
     const char * end = p + s.size();
@@ -475,6 +496,12 @@ BrassValueManager::get_value(Xapian::docid did, Xapian::valueno slot) const
 	if (j != i->second.end()) return j->second;
     }
 
+    // Use a column for the slot if there's already one.
+    columns_type::const_iterator c = columns.find(slot);
+    if (c != columns.end() && c->second.get()) {
+	return c->second->get_value(did);
+    }
+
     // Read it from the table.
     string chunk;
     Xapian::docid first_did;
@@ -487,6 +514,36 @@ BrassValueManager::get_value(Xapian::docid did, Xapian::valueno slot) const
     return reader.get_value();
 }
 
+BrassValueColumn *
+BrassValueManager::get_column(Xapian::valueno slot,
+			      const Xapian::Internal::intrusive_ptr<const BrassDatabase> & db) const
+{
+    LOGCALL(DB, BrassValueColumn *, "BrassValueManager::get_column", slot | db);
+    pair<columns_type::iterator, bool> r;
+    r = columns.insert(make_pair(slot, Xapian::Internal::intrusive_ptr<BrassValueColumn>()));
+    if (!r.second) RETURN(r.first->second.get());
+
+    // A writable database's value streams get updated under us.
+    if (postlist_table->is_writable() || !postlist_table->is_open())
+	RETURN(NULL);
+    const char * p = getenv("XAPIAN_VALUE_COLUMNS");
+    if (!p) RETURN(NULL);
+    Xapian::docid limit = strtoul(p, NULL, 10);
+    Xapian::docid last_did = db->get_lastdocid();
+    if (last_did == 0 || last_did > limit) RETURN(NULL);
+    // Don't bother if the slot is empty.
+    if (get_value_freq(slot) == 0) RETURN(NULL);
+
+    try {
+	r.first->second = BrassValueColumn::build(slot, db, last_did);
+    } catch (...) {
+	// Try again next time.
+	columns.erase(r.first);
+	throw;
+    }
+    RETURN(r.first->second.get());
+}
+
 void
 BrassValueManager::get_all_values(map<Xapian::valueno, string> & values,
 				  Xapian::docid did) const
@@ -24,6 +24,7 @@
 
 #include "pack.h"
 #include "backends/valuestats.h"
+#include "brass_valuecolumn.h"
 
 #include "xapian/error.h"
 #include "xapian/types.h"
@@ -93,8 +94,26 @@ class BrassValueManager {
 
     std::map<Xapian::valueno, std::map<Xapian::docid, std::string> > changes;
 
+    /// Approximate memory used by slots and changes.
+    size_t changes_size;
+
     mutable AutoPtr<BrassCursor> cursor;
 
+    typedef std::map<Xapian::valueno,
+		     Xapian::Internal::intrusive_ptr<BrassValueColumn> > columns_type;
+
+    /** Dense copies of value slots, built on demand.
+     *
+     *  A NULL entry means we decided not to build a column for that slot.
+     *  Columns are only built for a read-only database, and only if
+     *  XAPIAN_VALUE_COLUMNS is set to at least the highest docid in use.
+     */
+    mutable columns_type columns;
+
+    /// Set the entry for @a did in @a m, keeping changes_size up to date.
+    void set_change(std::map<Xapian::docid, std::string> & m,
+		    Xapian::docid did, const std::string & val);
+
     void add_value(Xapian::docid did, Xapian::valueno slot,
 		   const std::string & val);
 
@@ -115,7 +134,8 @@ class BrassValueManager {
 		      BrassTermListTable * termlist_table_)
 	: mru_slot(Xapian::BAD_VALUENO),
 	  postlist_table(postlist_table_),
-	  termlist_table(termlist_table_) { }
+	  termlist_table(termlist_table_),
+	  changes_size(0) { }
 
     // Merge in batched-up changes.
     void merge_changes();
@@ -131,6 +151,15 @@ class BrassValueManager {
 
     std::string get_value(Xapian::docid did, Xapian::valueno slot) const;
 
+    /** Get a dense copy of value slot @a slot.
+     *
+     *  The column is built the first time it's asked for, if it's enabled.
+     *
+     *  @return The column, or NULL if there isn't one for this slot.
+     */
+    BrassValueColumn * get_column(Xapian::valueno slot,
+				  const Xapian::Internal::intrusive_ptr<const BrassDatabase> & db) const;
+
     void get_all_values(std::map<Xapian::valueno, std::string> & values,
 			Xapian::docid did) const;
 
@@ -161,16 +190,22 @@ class BrassValueManager {
     void reset() {
 	/// Ignore any old cached valuestats.
 	mru_slot = Xapian::BAD_VALUENO;
+	/// And any columns built from the old revision.
+	columns.clear();
     }
 
     bool is_modified() const {
 	return !changes.empty();
     }
 
+    /// Return an estimate of the memory used by batched-up changes.
+    size_t get_memory_used() const { return changes_size; }
+
     void cancel() {
 	// Discard batched-up changes.
 	slots.clear();
 	changes.clear();
+	changes_size = 0;
     }
 };
 
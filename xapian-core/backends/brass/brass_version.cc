@@ -42,7 +42,12 @@
 using namespace std;
 
 // YYYYMMDDX where X allows multiple format revisions in a day
-#define BRASS_VERSION 201311060
+#define BRASS_VERSION 201410240
+// 201410240 1.3.2 Compress LZ4 tags in independent blocks
+// 201410230 1.3.2 Store long position lists with Stream VByte
+// 201410220 1.3.2 Store postlist chunk items in Stream VByte blocks
+// 201410210 1.3.2 Add chunk info and skip table to postlist chunks
+// 201410170 1.3.2 Record the codec used in compressed tags
 // 201311060 1.3.2 Order position table by term first
 // 201103110 1.2.5 Bump for new max changesets dbstats
 // 200912150 1.1.4 Brass debuts.
@@ -34,6 +34,7 @@
 #include "xapian/valueiterator.h"
 
 #include "backends/contiguousalldocspostlist.h"
+#include "backends/memoryused.h"
 #include "chert_alldocsmodifiedpostlist.h"
 #include "chert_alldocspostlist.h"
 #include "chert_alltermslist.h"
@@ -50,6 +51,7 @@
 #include "chert_valuelist.h"
 #include "chert_values.h"
 #include "debuglog.h"
+#include "edgengram.h"
 #include "fd.h"
 #include "io_utils.h"
 #include "pack.h"
@@ -993,6 +995,17 @@ ChertDatabase::get_uuid() const
     RETURN(version_file.get_uuid_string());
 }
 
+string
+ChertDatabase::get_revision_key() const
+{
+    LOGCALL(DB, string, "ChertDatabase::get_revision_key", NO_ARGS);
+    // A writable database may have changes which aren't committed yet.
+    if (!readonly) RETURN(string());
+    string key = version_file.get_uuid_string();
+    pack_uint(key, get_revision_number());
+    RETURN(key);
+}
+
 void
 ChertDatabase::throw_termlist_table_close_exception() const
 {
@@ -1011,14 +1024,22 @@ ChertWritableDatabase::ChertWritableDatabase(const string &dir, int action,
 	  freq_deltas(),
 	  doclens(),
 	  mod_plists(),
+	  mod_plists_size(0),
 	  change_count(0),
 	  flush_threshold(0),
+	  flush_memory_limit(0),
 	  modify_shortcut_document(NULL),
 	  modify_shortcut_docid(0)
 {
     LOGCALL_CTOR(DB, "ChertWritableDatabase", dir | action | block_size);
 
-    const char *p = getenv("XAPIAN_FLUSH_THRESHOLD");
+    const char *p = getenv("XAPIAN_FLUSH_MEMORY_LIMIT");
+    if (p) {
+	flush_memory_limit = strtoul(p, NULL, 10);
+	// With a memory limit, only limit the number of changes if asked to.
+	if (flush_memory_limit) flush_threshold = Xapian::doccount(-1);
+    }
+    p = getenv("XAPIAN_FLUSH_THRESHOLD");
     if (p)
 	flush_threshold = atoi(p);
     if (flush_threshold == 0)
@@ -1049,6 +1070,7 @@ ChertWritableDatabase::flush_postlist_changes() const
     freq_deltas.clear();
     doclens.clear();
     mod_plists.clear();
+    mod_plists_size = 0;
     change_count = 0;
 }
 
@@ -1063,6 +1085,16 @@ ChertWritableDatabase::close()
     ChertDatabase::close();
 }
 
+size_t
+ChertWritableDatabase::get_memory_used() const
+{
+    size_t total = mod_plists_size;
+    total += map_memory_used(doclens);
+    total += value_manager.get_memory_used();
+    total += map_memory_used(value_stats);
+    return total;
+}
+
 void
 ChertWritableDatabase::apply()
 {
@@ -1079,6 +1111,7 @@ ChertWritableDatabase::add_freq_delta(const string & tname,
     i = freq_deltas.find(tname);
     if (i == freq_deltas.end()) {
 	freq_deltas.insert(make_pair(tname, make_pair(tf_delta, cf_delta)));
+	mod_plists_size += sizeof(*i) + tname.size() + MAP_NODE_OVERHEAD;
     } else {
 	i->second.first += tf_delta;
 	i->second.second += cf_delta;
@@ -1096,8 +1129,15 @@ ChertWritableDatabase::insert_mod_plist(Xapian::docid did,
     if (j == mod_plists.end()) {
 	map<docid, pair<char, termcount> > m;
 	j = mod_plists.insert(make_pair(tname, m)).first;
+	mod_plists_size += sizeof(*j) + tname.size() + MAP_NODE_OVERHEAD;
+    }
+    pair<map<docid, pair<char, termcount> >::iterator, bool> r;
+    r = j->second.insert(make_pair(did, make_pair('A', wdf)));
+    if (r.second) {
+	mod_plists_size += sizeof(*r.first) + MAP_NODE_OVERHEAD;
+    } else {
+	r.first->second = make_pair('A', wdf);
     }
-    j->second[did] = make_pair('A', wdf);
 }
 
 void
@@ -1112,12 +1152,14 @@ ChertWritableDatabase::update_mod_plist(Xapian::docid did,
     if (j == mod_plists.end()) {
 	map<docid, pair<char, termcount> > m;
 	j = mod_plists.insert(make_pair(tname, m)).first;
+	mod_plists_size += sizeof(*j) + tname.size() + MAP_NODE_OVERHEAD;
     }
 
     map<docid, pair<char, termcount> >::iterator k;
     k = j->second.find(did);
     if (k == j->second.end()) {
 	j->second.insert(make_pair(did, make_pair(type, wdf)));
+	mod_plists_size += sizeof(*k) + MAP_NODE_OVERHEAD;
     } else {
 	if (type == 'A') {
 	    // Adding an entry which has already been deleted.
@@ -1157,11 +1199,11 @@ ChertWritableDatabase::add_document_(Xapian::docid did,
 	    Xapian::TermIterator term = document.termlist_begin();
 	    for ( ; term != document.termlist_end(); ++term) {
 		termcount wdf = term.get_wdf();
+		string tname = *term;
 		// Calculate the new document length
-		new_doclen += wdf;
+		if (!is_edge_ngram(tname)) new_doclen += wdf;
 		stats.check_wdf(wdf);
 
-		string tname = *term;
 		if (tname.size() > MAX_SAFE_TERM_LENGTH)
 		    throw Xapian::InvalidArgumentError("Term too long (> "STRINGIZE(MAX_SAFE_TERM_LENGTH)"): " + tname);
 		add_freq_delta(tname, 1, wdf);
@@ -1194,17 +1236,8 @@ ChertWritableDatabase::add_document_(Xapian::docid did,
 	throw;
     }
 
-    // FIXME: this should be done by checking memory usage, not the number of
-    // changes.
-    // We could also look at:
-    // * mod_plists.size()
-    // * doclens.size()
-    // * freq_deltas.size()
-    //
-    // cout << "+++ mod_plists.size() " << mod_plists.size() <<
-    //     ", doclens.size() " << doclens.size() <<
-    //	   ", freq_deltas.size() " << freq_deltas.size() << endl;
-    if (++change_count >= flush_threshold) {
+    ++change_count;
+    if (flush_needed()) {
 	flush_postlist_changes();
 	if (!transaction_active()) apply();
     }
@@ -1270,7 +1303,8 @@ ChertWritableDatabase::delete_document(Xapian::docid did)
 	throw;
     }
 
-    if (++change_count >= flush_threshold) {
+    ++change_count;
+    if (flush_needed()) {
 	flush_postlist_changes();
 	if (!transaction_active()) apply();
     }
@@ -1357,7 +1391,7 @@ ChertWritableDatabase::replace_document(Xapian::docid did,
 		if (cmp < 0) {
 		    // Term old_tname has been deleted.
 		    termcount old_wdf = termlist.get_wdf();
-		    new_doclen -= old_wdf;
+		    if (!is_edge_ngram(old_tname)) new_doclen -= old_wdf;
 		    add_freq_delta(old_tname, -1, -old_wdf);
 		    if (pos_modified)
 			position_table.delete_positionlist(did, old_tname);
@@ -1366,7 +1400,7 @@ ChertWritableDatabase::replace_document(Xapian::docid did,
 		} else if (cmp > 0) {
 		    // Term new_tname as been added.
 		    termcount new_wdf = term.get_wdf();
-		    new_doclen += new_wdf;
+		    if (!is_edge_ngram(new_tname)) new_doclen += new_wdf;
 		    stats.check_wdf(new_wdf);
 		    if (new_tname.size() > MAX_SAFE_TERM_LENGTH)
 			throw Xapian::InvalidArgumentError("Term too long (> "STRINGIZE(MAX_SAFE_TERM_LENGTH)"): " + new_tname);
@@ -1392,7 +1426,8 @@ ChertWritableDatabase::replace_document(Xapian::docid did,
 		    stats.check_wdf(new_wdf);
 
 		    if (old_wdf != new_wdf) {
-		    	new_doclen += new_wdf - old_wdf;
+			if (!is_edge_ngram(new_tname))
+			    new_doclen += new_wdf - old_wdf;
 			add_freq_delta(new_tname, 0, new_wdf - old_wdf);
 			update_mod_plist(did, new_tname, 'M', new_wdf);
 		    }
@@ -1445,7 +1480,8 @@ ChertWritableDatabase::replace_document(Xapian::docid did,
 	throw;
     }
 
-    if (++change_count >= flush_threshold) {
+    ++change_count;
+    if (flush_needed()) {
 	flush_postlist_changes();
 	if (!transaction_active()) apply();
     }
@@ -1592,6 +1628,7 @@ ChertWritableDatabase::cancel()
     freq_deltas.clear();
     doclens.clear();
     mod_plists.clear();
+    mod_plists_size = 0;
     value_stats.clear();
     change_count = 0;
 }
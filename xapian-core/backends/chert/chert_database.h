@@ -295,6 +295,7 @@ class ChertDatabase : public Xapian::Database::Internal {
 				    Xapian::ReplicationInfo * info);
 	string get_revision_info() const;
 	string get_uuid() const;
+	string get_revision_key() const;
 	//@}
 
 	XAPIAN_NORETURN(void throw_termlist_table_close_exception() const);
@@ -314,6 +315,9 @@ class ChertWritableDatabase : public ChertDatabase {
 	mutable map<string, map<Xapian::docid,
 				pair<char, Xapian::termcount> > > mod_plists;
 
+	/// Approximate memory used by freq_deltas and mod_plists.
+	mutable size_t mod_plists_size;
+
 	mutable map<Xapian::valueno, ValueStats> value_stats;
 
 	/** The number of documents added, deleted, or replaced since the last
@@ -324,6 +328,18 @@ class ChertWritableDatabase : public ChertDatabase {
 	/// If change_count reaches this threshold we automatically flush.
 	Xapian::doccount flush_threshold;
 
+	/** If the memory used by pending changes reaches this many bytes we
+	 *  automatically flush (0 means no limit).
+	 */
+	size_t flush_memory_limit;
+
+	/// Return true if we should automatically flush.
+	bool flush_needed() const {
+	    return change_count >= flush_threshold ||
+		   (flush_memory_limit &&
+		    get_memory_used() >= flush_memory_limit);
+	}
+
 	/** A pointer to the last document which was returned by
 	 *  open_document(), or NULL if there is no such valid document.  This
 	 *  is used purely for comparing with a supplied document to help with
@@ -390,6 +406,8 @@ class ChertWritableDatabase : public ChertDatabase {
 	/** Cancel pending modifications to the database. */
 	void cancel();
 
+	size_t get_memory_used() const;
+
 	Xapian::docid add_document(const Xapian::Document & document);
 	Xapian::docid add_document_(Xapian::docid did, const Xapian::Document & document);
 	// Stop the default implementation of delete_document(term) and
@@ -25,6 +25,7 @@
 #include "chert_dbcheck.h"
 
 #include "bitstream.h"
+#include "edgengram.h"
 
 #include "internaltypes.h"
 
@@ -803,7 +804,8 @@ check_chert_table(const char * tablename, string filename,
 		}
 
 		++actual_termlist_size;
-		actual_doclen += current_wdf;
+		if (!is_edge_ngram(current_tname))
+		    actual_doclen += current_wdf;
 	    }
 	    if (bad) {
 		continue;
@@ -28,6 +28,7 @@
 #include "chert_termlist.h"
 #include "debuglog.h"
 #include "backends/document.h"
+#include "backends/memoryused.h"
 #include "pack.h"
 
 #include "xapian/error.h"
@@ -128,6 +129,20 @@ ValueChunkReader::skip_to(Xapian::docid target)
     p = NULL;
 }
 
+void
+ChertValueManager::set_change(map<Xapian::docid, string> & m,
+			      Xapian::docid did, const string & val)
+{
+    pair<map<Xapian::docid, string>::iterator, bool> r;
+    r = m.insert(make_pair(did, string()));
+    if (r.second)
+	changes_size += sizeof(*r.first) + MAP_NODE_OVERHEAD;
+    else
+	changes_size -= r.first->second.size();
+    r.first->second = val;
+    changes_size += val.size();
+}
+
 void
 ChertValueManager::add_value(Xapian::docid did, Xapian::valueno slot,
 			     const string & val)
@@ -136,8 +151,9 @@ ChertValueManager::add_value(Xapian::docid did, Xapian::valueno slot,
     i = changes.find(slot);
     if (i == changes.end()) {
 	i = changes.insert(make_pair(slot, map<Xapian::docid, string>())).first;
+	changes_size += sizeof(*i) + MAP_NODE_OVERHEAD;
     }
-    i->second[did] = val;
+    set_change(i->second, did, val);
 }
 
 void
@@ -147,8 +163,9 @@ ChertValueManager::remove_value(Xapian::docid did, Xapian::valueno slot)
     i = changes.find(slot);
     if (i == changes.end()) {
 	i = changes.insert(make_pair(slot, map<Xapian::docid, string>())).first;
+	changes_size += sizeof(*i) + MAP_NODE_OVERHEAD;
     }
-    i->second[did] = string();
+    set_change(i->second, did, string());
 }
 
 Xapian::docid
@@ -349,6 +366,7 @@ ChertValueManager::merge_changes()
 	}
 	changes.clear();
     }
+    changes_size = 0;
 }
 
 void
@@ -398,7 +416,7 @@ ChertValueManager::add_document(Xapian::docid did, const Xapian::Document &doc,
     if (slots_used.empty() && slots.find(did) == slots.end()) {
 	// Adding a new document with no values which we didn't just remove.
     } else {
-	swap(slots[did], slots_used);
+	set_change(slots, did, slots_used);
     }
 }
 
@@ -410,11 +428,12 @@ ChertValueManager::delete_document(Xapian::docid did,
     map<Xapian::docid, string>::iterator it = slots.find(did);
     string s;
     if (it != slots.end()) {
+	changes_size -= it->second.size();
 	swap(s, it->second);
     } else {
 	// Get from table, making a swift exit if this document has no values.
 	if (!termlist_table->get_exact_entry(make_slot_key(did), s)) return;
-	slots.insert(make_pair(did, string()));
+	set_change(slots, did, string());
     }
     const char * p = s.data();
     const char * end = p + s.size();
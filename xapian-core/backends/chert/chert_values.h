@@ -89,8 +89,15 @@ class ChertValueManager {
 
     std::map<Xapian::valueno, std::map<Xapian::docid, std::string> > changes;
 
+    /// Approximate memory used by slots and changes.
+    size_t changes_size;
+
     mutable AutoPtr<ChertCursor> cursor;
 
+    /// Set the entry for @a did in @a m, keeping changes_size up to date.
+    void set_change(std::map<Xapian::docid, std::string> & m,
+		    Xapian::docid did, const std::string & val);
+
     void add_value(Xapian::docid did, Xapian::valueno slot,
 		   const std::string & val);
 
@@ -111,7 +118,8 @@ class ChertValueManager {
 		      ChertTermListTable * termlist_table_)
 	: mru_slot(Xapian::BAD_VALUENO),
 	  postlist_table(postlist_table_),
-	  termlist_table(termlist_table_) { }
+	  termlist_table(termlist_table_),
+	  changes_size(0) { }
 
     // Merge in batched-up changes.
     void merge_changes();
@@ -163,10 +171,14 @@ class ChertValueManager {
 	return !changes.empty();
     }
 
+    /// Return an estimate of the memory used by batched-up changes.
+    size_t get_memory_used() const { return changes_size; }
+
     void cancel() {
 	// Discard batched-up changes.
 	slots.clear();
 	changes.clear();
+	changes_size = 0;
     }
 };
 
@@ -125,6 +125,12 @@ Database::Internal::cancel()
     Assert(false);
 }
 
+size_t
+Database::Internal::get_memory_used() const
+{
+    return 0;
+}
+
 void
 Database::Internal::begin_transaction(bool flushed)
 {
@@ -362,12 +368,25 @@ Database::Internal::get_uuid() const
     return string();
 }
 
+string
+Database::Internal::get_revision_key() const
+{
+    return string();
+}
+
 void
 Database::Internal::invalidate_doc_object(Xapian::Document::Internal *) const
 {
     // Do nothing, by default.
 }
 
+Database::Internal *
+Database::Internal::get_another_instance(size_t) const
+{
+    // Not supported by default.
+    return NULL;
+}
+
 RemoteDatabase *
 Database::Internal::as_remotedatabase()
 {
@@ -403,6 +403,14 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
 	/** Cancel pending modifications to the database. */
 	virtual void cancel();
 
+	/** Get an estimate of the memory used to buffer pending changes.
+	 *
+	 *  See WritableDatabase::get_memory_used() for more information.
+	 *
+	 *  The default implementation returns 0.
+	 */
+	virtual size_t get_memory_used() const;
+
 	/** Begin a transaction.
 	 *
 	 *  See WritableDatabase::begin_transaction() for more information.
@@ -493,6 +501,18 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
 	 */
 	virtual string get_uuid() const;
 
+	/** Get a key identifying the revision of the database a reader sees.
+	 *
+	 *  The key is different for different databases and different
+	 *  revisions of the same database, so it can be used to tell if
+	 *  cached results are still valid.
+	 *
+	 *  @return The key, or an empty string if there isn't a suitable key
+	 *	    (the default - e.g. a writable database may have changes
+	 *	    which haven't been committed yet).
+	 */
+	virtual string get_revision_key() const;
+
 	/** Notify the database that document is no longer valid.
 	 *
 	 *  This is used to invalidate references to a document kept by a
@@ -502,6 +522,23 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
 	 */
 	virtual void invalidate_doc_object(Xapian::Document::Internal * obj) const;
 
+	/** Get another instance of this database at the same revision.
+	 *
+	 *  Database objects can't be used from more than one thread at once,
+	 *  so this is used to allow a match to be split between threads.
+	 *
+	 *  Implementations should keep the instances they open and return
+	 *  them again from later calls, so that they don't need reopening
+	 *  and any caches they've built can be reused.
+	 *
+	 *  @param n	Which other instance to return - different values give
+	 *		different instances.
+	 *
+	 *  @return The instance, or NULL if this isn't supported (or the
+	 *	    database can't currently be opened at the same revision).
+	 */
+	virtual Internal * get_another_instance(size_t n) const;
+
 	//////////////////////////////////////////////////////////////////
 	// Introspection methods:
 	// ======================
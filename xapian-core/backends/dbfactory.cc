@@ -66,7 +66,7 @@ InMemory::open() {
 #endif
 
 static void
-open_stub(Database &db, const string &file)
+open_stub(Database &db, const string &file, int flags)
 {
     // A stub database is a text file with one or more lines of this format:
     // <dbtype> <serialised db object>
@@ -95,7 +95,7 @@ open_stub(Database &db, const string &file)
 
 	if (type == "auto") {
 	    resolve_relative_path(line, file);
-	    db.add_database(Database(line));
+	    db.add_database(Database(line, flags));
 	    continue;
 	}
 
@@ -110,7 +110,8 @@ open_stub(Database &db, const string &file)
 #ifdef XAPIAN_HAS_BRASS_BACKEND
 	if (type == "brass") {
 	    resolve_relative_path(line, file);
-	    db.add_database(Database(new BrassDatabase(line)));
+	    db.add_database(Database(new BrassDatabase(line, DB_READONLY_, 0,
+						       flags)));
 	    continue;
 	}
 #endif
@@ -289,13 +290,13 @@ Database::Database(const string &path, int flags)
 #endif
 	case DB_BACKEND_BRASS:
 #ifdef XAPIAN_HAS_BRASS_BACKEND
-	    internal.push_back(new BrassDatabase(path));
+	    internal.push_back(new BrassDatabase(path, DB_READONLY_, 0, flags));
 	    return;
 #else
 	    throw FeatureUnavailableError("Brass backend disabled");
 #endif
 	case DB_BACKEND_STUB:
-	    open_stub(*this, path);
+	    open_stub(*this, path, flags & ~DB_BACKEND_MASK_);
 	    return;
     }
 
@@ -306,7 +307,7 @@ Database::Database(const string &path, int flags)
 
     if (S_ISREG(statbuf.st_mode)) {
 	// The path is a file, so assume it is a stub database file.
-	open_stub(*this, path);
+	open_stub(*this, path, flags);
 	return;
     }
 
@@ -323,7 +324,7 @@ Database::Database(const string &path, int flags)
 
 #ifdef XAPIAN_HAS_BRASS_BACKEND
     if (file_exists(path + "/iambrass")) {
-	internal.push_back(new BrassDatabase(path));
+	internal.push_back(new BrassDatabase(path, DB_READONLY_, 0, flags));
 	return;
     }
 #endif
@@ -332,7 +333,7 @@ Database::Database(const string &path, int flags)
     string stub_file = path;
     stub_file += "/XAPIANDB";
     if (usual(file_exists(stub_file))) {
-	open_stub(*this, stub_file);
+	open_stub(*this, stub_file, flags);
 	return;
     }
 
@@ -87,6 +87,13 @@ class Xapian::Document::Internal : public Xapian::Internal::intrusive_base {
 	}
 	virtual string do_get_data() const { return string(); }
 
+	/** Pass the document data to @a sink.
+	 *
+	 *  The default implementation passes the result of do_get_data() in
+	 *  one piece.
+	 */
+	virtual void do_stream_data(Xapian::DataSink & sink) const;
+
     public:
 	/** Get value by value number.
 	 *
@@ -143,6 +150,9 @@ class Xapian::Document::Internal : public Xapian::Internal::intrusive_base {
 	 */
 	string get_data() const;
 
+	/// Pass the data stored in the document to @a sink in pieces.
+	void get_data(Xapian::DataSink & sink) const;
+
 	void set_data(const string &);
 
 	/** Open a term list.
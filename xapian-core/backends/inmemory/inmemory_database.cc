@@ -26,6 +26,7 @@
 #include "inmemory_database.h"
 
 #include "debuglog.h"
+#include "edgengram.h"
 
 #include "expand/expandweight.h"
 #include "inmemory_document.h"
@@ -822,8 +823,10 @@ InMemoryDatabase::finish_add_doc(Xapian::docid did, const Xapian::Document &docu
 	}
 
 	Assert(did > 0 && did <= doclengths.size());
-	doclengths[did - 1] += i.get_wdf();
-	totlen += i.get_wdf();
+	if (!is_edge_ngram(*i)) {
+	    doclengths[did - 1] += i.get_wdf();
+	    totlen += i.get_wdf();
+	}
 	postlists[*i].collection_freq += i.get_wdf();
 	++postlists[*i].term_freq;
     }
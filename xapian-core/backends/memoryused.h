@@ -0,0 +1,46 @@
+/** @file memoryused.h
+ * @brief Estimate the memory used by buffered changes.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_MEMORYUSED_H
+#define XAPIAN_INCLUDED_MEMORYUSED_H
+
+#include <cstddef>
+
+/** Rough allowance for the overhead of each node of a std::map.
+ *
+ *  This is the parent, left and right pointers and the colour, plus malloc
+ *  overhead.
+ */
+const size_t MAP_NODE_OVERHEAD = 4 * sizeof(void*);
+
+/** Estimate the memory used by std::map @a m.
+ *
+ *  This doesn't include any memory which the keys or values allocate
+ *  themselves.
+ */
+template<class M>
+inline size_t
+map_memory_used(const M & m)
+{
+    return m.size() * (sizeof(typename M::value_type) + MAP_NODE_OVERHEAD);
+}
+
+#endif // XAPIAN_INCLUDED_MEMORYUSED_H
@@ -28,6 +28,8 @@
 #include <xapian/error.h>
 #include <xapian/positioniterator.h>
 
+#include <vector>
+
 using namespace std;
 
 /** Abstract base class for position lists. */
@@ -73,6 +75,17 @@ class Xapian::PositionIterator::Internal : public Xapian::Internal::intrusive_ba
 	 */
 	virtual bool at_end() const = 0;
 
+	/** Append all the positions in the list to @a positions.
+	 *
+	 *  This must be called before next() or skip_to(), and leaves the
+	 *  list at the end.  Subclasses which decode the whole list up front
+	 *  can override this to avoid a virtual method call per position.
+	 */
+	virtual void get_positions(std::vector<Xapian::termpos> & positions) {
+	    for (next(); !at_end(); next())
+		positions.push_back(get_position());
+	}
+
 	/** For use by PhrasePostList - ignored by PostingList itself.
 	 *  This isn't the most elegant place to put this, but it greatly
 	 *  eases the implementation of PhrasePostList which can't subclass
@@ -26,6 +26,12 @@ namespace Xapian {
 
 ValueIterator::Internal::~Internal() { }
 
+const std::string *
+ValueIterator::Internal::get_value_ptr() const
+{
+    return NULL;
+}
+
 bool
 ValueIterator::Internal::check(Xapian::docid did)
 {
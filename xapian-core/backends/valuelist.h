@@ -51,6 +51,17 @@ class Xapian::ValueIterator::Internal : public Xapian::Internal::intrusive_base
     /// Return the value at the current position.
     virtual std::string get_value() const = 0;
 
+    /** Return a pointer to the value at the current position, if we have it.
+     *
+     *  A value stream which holds its values in memory can return a pointer
+     *  to the value here to save the caller copying it.  The pointer remains
+     *  valid while this object exists.
+     *
+     *  The default implementation returns NULL, meaning the caller should
+     *  use get_value() instead.
+     */
+    virtual const std::string * get_value_ptr() const;
+
     /// Return the value slot for the current position/this iterator.
     virtual Xapian::valueno get_valueno() const = 0;
 
@@ -2,9 +2,11 @@ noinst_HEADERS +=\
 	common/append_filename_arg.h\
 	common/autoptr.h\
 	common/bitstream.h\
+	common/biword.h\
 	common/closefrom.h\
 	common/compression_stream.h\
 	common/debuglog.h\
+	common/edgengram.h\
 	common/fd.h\
 	common/filetests.h\
 	common/fileutils.h\
@@ -13,7 +15,9 @@ noinst_HEADERS +=\
 	common/io_utils.h\
 	common/keyword.h\
 	common/log2.h\
+	common/lrucache.h\
 	common/msvc_dirent.h\
+	common/mutexlock.h\
 	common/noreturn.h\
 	common/omassert.h\
 	common/output.h\
@@ -40,9 +44,11 @@ noinst_HEADERS +=\
 	common/serialise-double.h\
 	common/socket_utils.h\
 	common/str.h\
+	common/streamvbyte.h\
 	common/stringutils.h\
 	common/submatch.h\
-	common/unaligned.h
+	common/unaligned.h\
+	common/workerthreads.h
 
 EXTRA_DIST +=\
 	common/dir_contents\
@@ -66,7 +72,9 @@ lib_src +=\
 	common/serialise-double.cc\
 	common/socket_utils.cc\
 	common/str.cc\
-	common/stringutils.cc
+	common/streamvbyte.cc\
+	common/stringutils.cc\
+	common/workerthreads.cc
 
 if BUILD_BACKEND_BRASS_OR_CHERT
 lib_src +=\
@@ -0,0 +1,97 @@
+/** @file biword.h
+ * @brief Terms which index pairs of adjacent words.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_BIWORD_H
+#define XAPIAN_INCLUDED_BIWORD_H
+
+#include <string>
+
+/** The longest biword term we generate.
+ *
+ *  This is the limit on the length of a term imposed by the disk-based
+ *  backends.
+ */
+const std::string::size_type MAX_BIWORD_LENGTH = 245;
+
+/** Is @a term one TermGenerator generates for internal use?
+ *
+ *  Such terms start with a zero byte, which the terms TermGenerator
+ *  produces from text can't contain, and which sorts them before any such
+ *  term, so they aren't reached when iterating the terms starting with a
+ *  prefix.  They shouldn't be suggested by query expansion.
+ */
+inline bool
+is_internal_term(const std::string & term)
+{
+    return !term.empty() && term[0] == '\0';
+}
+
+/** Return the length of the field prefix of @a term.
+ *
+ *  Following the usual convention, this is the run of ASCII capital letters
+ *  at the start of the term.
+ */
+inline std::string::size_type
+biword_prefix_length(const std::string & term)
+{
+    std::string::size_type i = 0;
+    while (i < term.size() && term[i] >= 'A' && term[i] <= 'Z') ++i;
+    return i;
+}
+
+/** Make the biword term for @a first followed by @a second.
+ *
+ *  Biword terms are a zero byte, then the two terms separated by another
+ *  zero byte.  We only generate biwords for two terms with the same field
+ *  prefix.
+ *
+ *  @return The biword term, or an empty string if it would be longer than
+ *	    MAX_BIWORD_LENGTH.
+ */
+inline std::string
+make_biword(const std::string & first, const std::string & second)
+{
+    std::string biword;
+    if (2 + first.size() + second.size() <= MAX_BIWORD_LENGTH) {
+	biword.reserve(2 + first.size() + second.size());
+	biword += '\0';
+	biword += first;
+	biword += '\0';
+	biword += second;
+    }
+    return biword;
+}
+
+/** The term which marks a document as having had biwords generated for all
+ *  its positional terms with field prefix @a prefix.
+ *
+ *  This can't clash with an actual biword, since the first half of those
+ *  can't be empty.
+ */
+inline std::string
+biword_marker(const std::string & prefix)
+{
+    std::string marker(2, '\0');
+    marker += prefix;
+    return marker;
+}
+
+#endif // XAPIAN_INCLUDED_BIWORD_H
@@ -55,6 +55,10 @@ DebugLogger::~DebugLogger()
 void
 DebugLogger::initialise_categories_mask()
 {
+    MutexLock lock(mutex);
+    // Another thread may have got here first.
+    if (fd != -1) return;
+
     fd = -2;
     const char * f = getenv("XAPIAN_DEBUG_LOG");
     if (f && *f) {
@@ -81,8 +85,9 @@ DebugLogger::initialise_categories_mask()
 		// user will probably miss the message about the debug log
 		// failing to open!
 		fd = 2;
-		LOGLINE(ALWAYS, PACKAGE_STRING": Failed to open debug log '"
-			<< fnm << "' (" << strerror(errno) << ')');
+		write_line(DEBUGLOG_CATEGORY_ALWAYS,
+			   PACKAGE_STRING": Failed to open debug log '" +
+			   fnm + "' (" + strerror(errno) + ')');
 		fd = -2;
 	    }
 	}
@@ -101,11 +106,18 @@ DebugLogger::initialise_categories_mask()
 	    }
 	}
     }
-    LOGLINE(ALWAYS, PACKAGE_STRING": debug log started");
+    write_line(DEBUGLOG_CATEGORY_ALWAYS, PACKAGE_STRING": debug log started");
 }
 
 void
 DebugLogger::log_line(debuglog_categories category, const string & msg)
+{
+    MutexLock lock(mutex);
+    write_line(category, msg);
+}
+
+void
+DebugLogger::write_line(debuglog_categories category, const string & msg)
 {
     if (fd < 0) return;
 
@@ -134,8 +146,9 @@ DebugLogger::log_line(debuglog_categories category, const string & msg)
 	    // logging.
 	    (void)close(fd);
 	    fd = 2;
-	    LOGLINE(ALWAYS, PACKAGE_STRING": Failed to write log output ("
-		    << strerror(errno) << ')');
+	    write_line(DEBUGLOG_CATEGORY_ALWAYS,
+		       PACKAGE_STRING": Failed to write log output (" +
+		       string(strerror(errno)) + ')');
 	    fd = -2;
 	    break;
 	}
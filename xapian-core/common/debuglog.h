@@ -23,6 +23,7 @@
 
 #ifdef XAPIAN_DEBUG_LOG
 
+#include "mutexlock.h"
 #include "output-internal.h"
 #include "pretty.h"
 
@@ -95,9 +96,19 @@ class DebugLogger {
     /// The current indent level.
     int indent_level;
 
+    /** Serialises logging from different threads.
+     *
+     *  Worker threads (e.g. those committing brass tables in parallel) may
+     *  log at the same time as the calling thread.
+     */
+    Mutex mutex;
+
     /// Initialise categories_mask.
     void initialise_categories_mask();
 
+    /// Write out message @a msg (the caller must hold mutex).
+    void write_line(debuglog_categories category, const std::string & msg);
+
   public:
     /// Constructor.
     DebugLogger()
@@ -121,9 +132,13 @@ class DebugLogger {
     /// Log message @a msg of category @a category.
     void log_line(debuglog_categories category, const std::string & msg);
 
-    void indent() { ++indent_level; }
+    void indent() {
+	MutexLock lock(mutex);
+	++indent_level;
+    }
 
     void outdent() {
+	MutexLock lock(mutex);
 	if (indent_level) --indent_level;
     }
 };
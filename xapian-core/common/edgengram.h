@@ -0,0 +1,72 @@
+/** @file edgengram.h
+ * @brief Helpers for the edge n-gram terms TermGenerator can generate.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_EDGENGRAM_H
+#define XAPIAN_INCLUDED_EDGENGRAM_H
+
+#include <string>
+
+/** The most characters an edge n-gram is generated for.
+ *
+ *  Partial terms longer than this are expanded from the terms in the
+ *  database, but such expansions should be small.
+ */
+const unsigned MAX_EDGE_NGRAM_LENGTH = 4;
+
+/** Make the edge n-gram term for @a root.
+ *
+ *  Edge n-gram terms are a zero byte and a byte with value 1, followed by the
+ *  term prefix and the start of the word.  Like biwords, they start with a
+ *  zero byte, which keeps them out of wildcard and partial expansion.
+ */
+inline std::string
+make_edge_ngram(const std::string & root)
+{
+    std::string ngram("\0\x01", 2);
+    ngram += root;
+    return ngram;
+}
+
+/** Is @a term an edge n-gram term?
+ *
+ *  Edge n-gram terms get the wdf of the words they come from, so a partial
+ *  word matched using one is weighted like the expansion it replaces, but
+ *  their wdf isn't counted in the document length.  Otherwise they would
+ *  change the weights given to every other query.
+ */
+inline bool
+is_edge_ngram(const std::string & term)
+{
+    return term.size() > 2 && term[0] == '\0' && term[1] == '\x01';
+}
+
+/** The term which marks a document as having edge n-grams for field
+ *  @a prefix.
+ */
+inline std::string
+edge_ngram_marker(const std::string & prefix)
+{
+    std::string marker("\0\x02", 2);
+    marker += prefix;
+    return marker;
+}
+
+#endif // XAPIAN_INCLUDED_EDGENGRAM_H
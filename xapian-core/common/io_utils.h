@@ -88,6 +88,24 @@ inline void io_write_block(int fd, const unsigned char * p, size_t n, off_t b) {
     io_write_block(fd, reinterpret_cast<const char *>(p), n, b);
 }
 
+/** Hint that count blocks of size n bytes starting at block b will soon be
+ *  read from file descriptor fd.
+ *
+ *  This is only advice to the OS, so any error is ignored.  On platforms
+ *  without posix_fadvise() this does nothing.
+ */
+inline void io_readahead_block(int fd, size_t n, off_t b, off_t count)
+{
+#ifdef HAVE_POSIX_FADVISE
+    (void)posix_fadvise(fd, b * n, count * n, POSIX_FADV_WILLNEED);
+#else
+    (void)fd;
+    (void)n;
+    (void)b;
+    (void)count;
+#endif
+}
+
 /** Delete a file.
  *
  *  @param	filename	The file to delete.
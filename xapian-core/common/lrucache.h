@@ -0,0 +1,144 @@
+/** @file lrucache.h
+ * @brief Map which keeps track of which entries were least recently used.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_LRUCACHE_H
+#define XAPIAN_INCLUDED_LRUCACHE_H
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <utility>
+
+/** Map which keeps track of which entries were least recently used.
+ *
+ *  This handles the bookkeeping for a cache - deciding what to evict and
+ *  when is left to the user, as the caches we have measure their size in
+ *  different ways, and some have entries which mustn't be evicted.  It does
+ *  no locking, so a cache shared between threads needs to protect it with a
+ *  mutex.
+ *
+ *  Entries are kept in a list, most recently used first, with a map from the
+ *  key to the entry in the list.  An entry is a std::pair of the key and the
+ *  value, like a std::map entry.
+ */
+template<typename K, typename V>
+class LRUCache {
+  public:
+    typedef std::pair<K, V> entry_type;
+
+    /// Iterator over the entries, most recently used first.
+    typedef typename std::list<entry_type>::iterator iterator;
+
+  private:
+    /// Entries, most recently used first.
+    std::list<entry_type> lru;
+
+    typedef std::map<K, iterator> index_type;
+
+    /// Map from key to entry in lru.
+    index_type index;
+
+  public:
+    /** Find the value for @a key, and mark it as the most recently used.
+     *
+     *  @return A pointer to the value, or NULL if there isn't an entry.
+     */
+    V * find(const K & key) {
+	typename index_type::const_iterator i = index.find(key);
+	if (i == index.end()) return NULL;
+	// Move to the most recently used end.
+	lru.splice(lru.begin(), lru, i->second);
+	return &i->second->second;
+    }
+
+    /** Find the value for @a key, without marking it as used.
+     *
+     *  @return A pointer to the value, or NULL if there isn't an entry.
+     */
+    V * peek(const K & key) {
+	typename index_type::const_iterator i = index.find(key);
+	if (i == index.end()) return NULL;
+	return &i->second->second;
+    }
+
+    /// Is there an entry for @a key?
+    bool contains(const K & key) const {
+	return index.find(key) != index.end();
+    }
+
+    /** Add an entry for @a key as the most recently used.
+     *
+     *  There mustn't already be an entry for @a key.
+     *
+     *  @return A reference to the new entry's value.
+     */
+    V & insert(const K & key, const V & value = V()) {
+	lru.push_front(entry_type(key, value));
+	index.insert(std::make_pair(key, lru.begin()));
+	return lru.front().second;
+    }
+
+    /// Remove the entry for @a key, if there is one.
+    void erase(const K & key) {
+	typename index_type::iterator i = index.find(key);
+	if (i == index.end()) return;
+	lru.erase(i->second);
+	index.erase(i);
+    }
+
+    /** Remove the entry @a it points to.
+     *
+     *  @return An iterator to the entry after it.
+     */
+    iterator erase(iterator it) {
+	index.erase(it->first);
+	return lru.erase(it);
+    }
+
+    /// Return the least recently used entry (there must be one).
+    entry_type & back() { return lru.back(); }
+
+    /// Remove the least recently used entry (there must be one).
+    void pop_back() {
+	index.erase(lru.back().first);
+	lru.pop_back();
+    }
+
+    /// Remove all the entries.
+    void clear() {
+	index.clear();
+	lru.clear();
+    }
+
+    /// Return the number of entries.
+    size_t size() const { return index.size(); }
+
+    /// Return true if there are no entries.
+    bool empty() const { return index.empty(); }
+
+    /// Return an iterator to the most recently used entry.
+    iterator begin() { return lru.begin(); }
+
+    /// Return an iterator to the end of the entries.
+    iterator end() { return lru.end(); }
+};
+
+#endif // XAPIAN_INCLUDED_LRUCACHE_H
@@ -0,0 +1,196 @@
+/** @file streamvbyte.cc
+ * @brief Encode and decode blocks of integers with Stream VByte.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "streamvbyte.h"
+
+// Use SSSE3 if the compiler has been told it can, or if we can select it at
+// runtime (which needs GCC 4.9 or later on x86).
+#if defined __SSSE3__
+# define STREAMVBYTE_SSSE3
+# define STREAMVBYTE_TARGET
+#elif (defined __x86_64__ || defined __i386__) && !defined __clang__ && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+# define STREAMVBYTE_SSSE3
+# define STREAMVBYTE_RUNTIME_CHECK
+# define STREAMVBYTE_TARGET __attribute__((target("ssse3")))
+#endif
+
+#ifdef STREAMVBYTE_SSSE3
+# include <tmmintrin.h>
+#endif
+
+using namespace std;
+
+/// Masks to keep the low 1, 2, 3 or 4 bytes of a value.
+static const unsigned value_mask[4] = {
+    0xff, 0xffff, 0xffffff, 0xffffffff
+};
+
+void
+encode_streamvbyte(string & s, const unsigned * values, size_t n)
+{
+    size_t control = s.size();
+    s.append((n + 3) / 4, '\0');
+    for (size_t i = 0; i != n; ++i) {
+	unsigned v = values[i];
+	int len;
+	if (v < 0x100) {
+	    len = 1;
+	} else if (v < 0x10000) {
+	    len = 2;
+	} else if (v < 0x1000000) {
+	    len = 3;
+	} else {
+	    len = 4;
+	}
+	s[control + i / 4] |= char((len - 1) << (2 * (i % 4)));
+	for (int j = 0; j != len; ++j) {
+	    s += char(v);
+	    v >>= 8;
+	}
+    }
+}
+
+#ifdef STREAMVBYTE_SSSE3
+/// The total length of the four values described by each control byte.
+static const unsigned char group_length[256] = {
+     4,  5,  6,  7,  5,  6,  7,  8,  6,  7,  8,  9,  7,  8,  9, 10,
+     5,  6,  7,  8,  6,  7,  8,  9,  7,  8,  9, 10,  8,  9, 10, 11,
+     6,  7,  8,  9,  7,  8,  9, 10,  8,  9, 10, 11,  9, 10, 11, 12,
+     7,  8,  9, 10,  8,  9, 10, 11,  9, 10, 11, 12, 10, 11, 12, 13,
+     5,  6,  7,  8,  6,  7,  8,  9,  7,  8,  9, 10,  8,  9, 10, 11,
+     6,  7,  8,  9,  7,  8,  9, 10,  8,  9, 10, 11,  9, 10, 11, 12,
+     7,  8,  9, 10,  8,  9, 10, 11,  9, 10, 11, 12, 10, 11, 12, 13,
+     8,  9, 10, 11,  9, 10, 11, 12, 10, 11, 12, 13, 11, 12, 13, 14,
+     6,  7,  8,  9,  7,  8,  9, 10,  8,  9, 10, 11,  9, 10, 11, 12,
+     7,  8,  9, 10,  8,  9, 10, 11,  9, 10, 11, 12, 10, 11, 12, 13,
+     8,  9, 10, 11,  9, 10, 11, 12, 10, 11, 12, 13, 11, 12, 13, 14,
+     9, 10, 11, 12, 10, 11, 12, 13, 11, 12, 13, 14, 12, 13, 14, 15,
+     7,  8,  9, 10,  8,  9, 10, 11,  9, 10, 11, 12, 10, 11, 12, 13,
+     8,  9, 10, 11,  9, 10, 11, 12, 10, 11, 12, 13, 11, 12, 13, 14,
+     9, 10, 11, 12, 10, 11, 12, 13, 11, 12, 13, 14, 12, 13, 14, 15,
+    10, 11, 12, 13, 11, 12, 13, 14, 12, 13, 14, 15, 13, 14, 15, 16,
+};
+
+/// Shuffle masks for _mm_shuffle_epi8(), indexed by control byte.
+static unsigned char shuffle_masks[256][16];
+
+# ifdef STREAMVBYTE_RUNTIME_CHECK
+/// Is SSSE3 available on this CPU?
+static bool use_ssse3;
+# else
+static const bool use_ssse3 = true;
+# endif
+
+/// Set up the shuffle masks (and check for SSSE3 if necessary).
+static struct ShuffleMaskInit {
+    ShuffleMaskInit() {
+# ifdef STREAMVBYTE_RUNTIME_CHECK
+	__builtin_cpu_init();
+	use_ssse3 = __builtin_cpu_supports("ssse3");
+# endif
+	for (int c = 0; c != 256; ++c) {
+	    unsigned char * mask = shuffle_masks[c];
+	    int in = 0;
+	    for (int i = 0; i != 4; ++i) {
+		int len = ((c >> (2 * i)) & 3) + 1;
+		for (int j = 0; j != 4; ++j) {
+		    // A mask byte with the top bit set gives a zero byte.
+		    mask[i * 4 + j] = (j < len) ? in++ : 0x80;
+		}
+	    }
+	}
+    }
+} shuffle_mask_init;
+
+/** Decode whole groups of four with SSSE3 while there are 16 bytes of input.
+ *
+ *  Returns the number of groups decoded.
+ */
+STREAMVBYTE_TARGET
+static size_t
+decode_groups_ssse3(const unsigned char * control, size_t groups,
+		    const char ** p, const char * end, unsigned * values)
+{
+    const char * q = *p;
+    size_t g;
+    for (g = 0; g != groups && end - q >= 16; ++g) {
+	unsigned c = control[g];
+	__m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(q));
+	__m128i mask =
+	    _mm_loadu_si128(reinterpret_cast<const __m128i *>(shuffle_masks[c]));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(values + g * 4),
+			 _mm_shuffle_epi8(data, mask));
+	q += group_length[c];
+    }
+    *p = q;
+    return g;
+}
+#endif
+
+/// Read a little-endian value of @a len bytes.
+static inline unsigned
+read_value(const char * p, int len)
+{
+    unsigned v = 0;
+    for (int j = len - 1; j >= 0; --j)
+	v = (v << 8) | static_cast<unsigned char>(p[j]);
+    return v;
+}
+
+const char *
+decode_streamvbyte(const char * p, const char * end,
+		   unsigned * values, size_t n)
+{
+    size_t groups = (n + 3) / 4;
+    if (size_t(end - p) < groups) return NULL;
+    const unsigned char * control = reinterpret_cast<const unsigned char *>(p);
+    p += groups;
+
+    // The final group may be partial, so always decode it the slow way.
+    size_t full_groups = n / 4;
+    size_t g = 0;
+#ifdef STREAMVBYTE_SSSE3
+    if (use_ssse3)
+	g = decode_groups_ssse3(control, full_groups, &p, end, values);
+#endif
+    // Without SSSE3, we can still decode four values without a branch per
+    // byte if there's enough input left to read four bytes for each.
+    for ( ; g < full_groups && end - p >= 16; ++g) {
+	unsigned c = control[g];
+	unsigned * out = values + g * 4;
+	for (int i = 0; i != 4; ++i) {
+	    int len = ((c >> (2 * i)) & 3) + 1;
+	    out[i] = read_value(p, 4) & value_mask[len - 1];
+	    p += len;
+	}
+    }
+
+    for (size_t i = g * 4; i != n; ++i) {
+	int len = ((control[i / 4] >> (2 * (i % 4))) & 3) + 1;
+	if (end - p < len) return NULL;
+	values[i] = read_value(p, len);
+	p += len;
+    }
+    return p;
+}
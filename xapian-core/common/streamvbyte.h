@@ -0,0 +1,55 @@
+/** @file streamvbyte.h
+ * @brief Encode and decode blocks of integers with Stream VByte.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_STREAMVBYTE_H
+#define XAPIAN_INCLUDED_STREAMVBYTE_H
+
+#include <cstddef>
+#include <string>
+
+/** Append @a n values encoded with Stream VByte to @a s.
+ *
+ *  The encoding starts with a control byte for each group of four values,
+ *  holding the number of bytes (minus one) used by each value in two bits,
+ *  lowest bits first.  This is followed by the values themselves,
+ *  little-endian, using the fewest bytes possible.  Keeping the lengths
+ *  separate from the data means that decoding doesn't need a branch per
+ *  byte, and four values can be decoded at once with a SIMD shuffle.
+ *
+ *  Values are at most 32 bits.
+ */
+void encode_streamvbyte(std::string & s, const unsigned * values, size_t n);
+
+/** Decode @a n values encoded by encode_streamvbyte().
+ *
+ *  @param p	  Start of the encoded data.
+ *  @param end	  End of the buffer containing the encoded data.
+ *  @param values Where to store the decoded values.  This must have room for
+ *		  @a n rounded up to a multiple of 4 values.
+ *  @param n	  The number of values to decode.
+ *
+ *  @return A pointer to the byte after the encoded data, or NULL if the data
+ *	    runs out.
+ */
+const char * decode_streamvbyte(const char * p, const char * end,
+				unsigned * values, size_t n);
+
+#endif // XAPIAN_INCLUDED_STREAMVBYTE_H
@@ -0,0 +1,181 @@
+/** @file workerthreads.cc
+ * @brief Run independent tasks concurrently.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "workerthreads.h"
+
+#include "xapian/error.h"
+
+#ifdef __WIN32__
+# include "safewindows.h"
+# include <process.h>
+#elif defined HAVE_PTHREADS
+# include <pthread.h>
+#endif
+
+#include <new>
+
+using namespace std;
+
+enum {
+    EXCEPTION_NONE,
+    EXCEPTION_XAPIAN,
+    EXCEPTION_BAD_ALLOC,
+    EXCEPTION_OTHER
+};
+
+WorkerTask::~WorkerTask() { }
+
+void
+WorkerTask::run_and_catch()
+{
+    exception_type = EXCEPTION_NONE;
+    try {
+	run();
+    } catch (const Xapian::Error & e) {
+	exception_type = EXCEPTION_XAPIAN;
+	// The byte before the type name is the type code.
+	err_code = e.get_type()[-1];
+	err_msg = e.get_msg();
+	err_context = e.get_context();
+	const char * err = e.get_error_string();
+	have_err_string = (err != NULL);
+	if (err) err_string = err;
+    } catch (const bad_alloc &) {
+	exception_type = EXCEPTION_BAD_ALLOC;
+    } catch (...) {
+	exception_type = EXCEPTION_OTHER;
+    }
+}
+
+void
+WorkerTask::rethrow() const
+{
+    switch (exception_type) {
+	case EXCEPTION_NONE:
+	    return;
+	case EXCEPTION_BAD_ALLOC:
+	    throw bad_alloc();
+	case EXCEPTION_XAPIAN: {
+	    // Names used by errordispatch.h.
+	    const string & msg = err_msg;
+	    const string & context = err_context;
+	    const char * error_string =
+		have_err_string ? err_string.c_str() : NULL;
+	    switch (err_code) {
+#include "xapian/errordispatch.h"
+	    }
+	    break;
+	}
+    }
+    throw Xapian::InternalError("Unknown exception thrown by worker thread");
+}
+
+namespace {
+
+/// The share of the tasks which one thread runs.
+struct TaskBatch {
+    vector<WorkerTask *> tasks;
+
+    void run() {
+	for (size_t i = 0; i < tasks.size(); ++i)
+	    tasks[i]->run_and_catch();
+    }
+};
+
+}
+
+#ifdef __WIN32__
+static unsigned __stdcall
+worker_thread(void * arg)
+{
+    static_cast<TaskBatch *>(arg)->run();
+    return 0;
+}
+#elif defined HAVE_PTHREADS
+extern "C" {
+static void *
+worker_thread(void * arg)
+{
+    static_cast<TaskBatch *>(arg)->run();
+    return NULL;
+}
+}
+#endif
+
+void
+WorkerThreads::run_and_wait(size_t max_threads)
+{
+    if (tasks.empty()) return;
+
+#if !defined __WIN32__ && !defined HAVE_PTHREADS
+    // We can't start any threads, so the calling thread runs every task.
+    max_threads = 1;
+#endif
+
+    size_t n_threads = tasks.size();
+    if (max_threads && max_threads < n_threads) n_threads = max_threads;
+    vector<TaskBatch> batches(n_threads);
+    for (size_t i = 0; i < tasks.size(); ++i)
+	batches[i % n_threads].tasks.push_back(tasks[i]);
+
+#ifdef __WIN32__
+    vector<HANDLE> threads(n_threads);
+#elif defined HAVE_PTHREADS
+    vector<pthread_t> threads(n_threads);
+#endif
+    vector<bool> started(n_threads);
+    for (size_t i = 1; i < n_threads; ++i) {
+#ifdef __WIN32__
+	uintptr_t h = _beginthreadex(NULL, 0, worker_thread, &batches[i], 0,
+				     NULL);
+	started[i] = (h != 0);
+	threads[i] = reinterpret_cast<HANDLE>(h);
+#elif defined HAVE_PTHREADS
+	started[i] = (pthread_create(&threads[i], NULL, worker_thread,
+				     &batches[i]) == 0);
+#endif
+    }
+
+    batches[0].run();
+    for (size_t i = 1; i < n_threads; ++i) {
+	if (!started[i]) {
+	    // Couldn't start a thread for these tasks, so just run them here.
+	    batches[i].run();
+	    continue;
+	}
+#ifdef __WIN32__
+	WaitForSingleObject(threads[i], INFINITE);
+	CloseHandle(threads[i]);
+#elif defined HAVE_PTHREADS
+	(void)pthread_join(threads[i], NULL);
+#endif
+    }
+}
+
+void
+WorkerThreads::run()
+{
+    run_and_wait(0);
+    for (size_t i = 0; i < tasks.size(); ++i)
+	tasks[i]->rethrow();
+}
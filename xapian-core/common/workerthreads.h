@@ -0,0 +1,99 @@
+/** @file workerthreads.h
+ * @brief Run independent tasks concurrently.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_WORKERTHREADS_H
+#define XAPIAN_INCLUDED_WORKERTHREADS_H
+
+#include <string>
+#include <vector>
+
+/// A piece of work which can be run on a worker thread.
+class WorkerTask {
+    friend class WorkerThreads;
+
+    /// What sort of exception run() threw (0 if none).
+    int exception_type;
+
+    /// Details of a Xapian::Error thrown by run().
+    char err_code;
+    std::string err_msg, err_context, err_string;
+    bool have_err_string;
+
+  public:
+    WorkerTask() : exception_type(0) { }
+
+    virtual ~WorkerTask();
+
+    /// Do the work.
+    virtual void run() = 0;
+
+    /// Call run(), catching any exception it throws.
+    void run_and_catch();
+
+    /// Rethrow any exception caught by run_and_catch().
+    void rethrow() const;
+};
+
+/** Run a set of tasks concurrently.
+ *
+ *  Xapian objects aren't shared between threads, so it's up to the caller
+ *  to ensure the tasks don't touch the same objects.
+ */
+class WorkerThreads {
+    /// The tasks to run.
+    std::vector<WorkerTask *> tasks;
+
+  public:
+    /// Add a task (ownership isn't transferred).
+    void add(WorkerTask * task) { tasks.push_back(task); }
+
+    /// The number of tasks added.
+    size_t size() const { return tasks.size(); }
+
+    /** Run all the tasks and wait for them to finish.
+     *
+     *  The first task is run by the calling thread, and the others each get
+     *  a thread of their own.  If a thread can't be started, its task is
+     *  run by the calling thread instead (as all the tasks are if Xapian was
+     *  built without thread support).
+     *
+     *  If any tasks throw an exception, it is rethrown in the calling thread
+     *  once all the tasks have finished (if several do, the exception from
+     *  the earliest task added wins).  Xapian::Error subclasses and
+     *  std::bad_alloc are rethrown as the same type; anything else is
+     *  reported as Xapian::InternalError.
+     */
+    void run();
+
+    /** Run all the tasks and wait for them to finish, using at most
+     *  @a max_threads threads.
+     *
+     *  If there are more tasks than threads, each thread runs a share of the
+     *  tasks in turn.  Exceptions aren't rethrown - call rethrow() on each
+     *  task to see if it failed.
+     *
+     *  @param max_threads  The maximum number of threads to use, including
+     *			    the calling thread (0 means one per task).
+     */
+    void run_and_wait(size_t max_threads);
+};
+
+#endif // XAPIAN_INCLUDED_WORKERTHREADS_H
@@ -26,6 +26,7 @@
 #include "xapian/enquire.h"
 #include "xapian/expanddecider.h"
 #include "backends/database.h"
+#include "biword.h"
 #include "debuglog.h"
 #include "api/omenquireinternal.h"
 #include "expandweight.h"
@@ -168,6 +169,9 @@ ESet::Internal::expand(Xapian::termcount max_esize,
 
 	string term = tree->get_termname();
 
+	// Skip terms the TermGenerator added for the matcher's own use.
+	if (is_internal_term(term)) continue;
+
 	// If there's an ExpandDecider, see if it accepts the term.
 	if (edecider && !(*edecider)(term)) continue;
 
@@ -11,6 +11,7 @@ inc_HEADERS =\
 
 xapianinclude_HEADERS =\
 	include/xapian/attributes.h\
+	include/xapian/cachestats.h\
 	include/xapian/compactor.h\
 	include/xapian/constants.h\
 	include/xapian/database.h\
@@ -97,6 +97,9 @@
 // Database compaction and merging
 #include <xapian/compactor.h>
 
+// Statistics for the process-wide caches
+#include <xapian/cachestats.h>
+
 // ELF visibility annotations for GCC.
 #include <xapian/visibility.h>
 
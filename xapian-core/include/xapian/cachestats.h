@@ -0,0 +1,95 @@
+/** @file cachestats.h
+ * @brief Statistics for the process-wide caches.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_CACHESTATS_H
+#define XAPIAN_INCLUDED_CACHESTATS_H
+
+#if !defined XAPIAN_INCLUDED_XAPIAN_H && !defined XAPIAN_LIB_BUILD
+# error "Never use <xapian/cachestats.h> directly; include <xapian.h> instead."
+#endif
+
+#include <xapian/visibility.h>
+#include <cstddef>
+#include <string>
+
+namespace Xapian {
+
+/** Statistics for one of the caches shared by the whole process.
+ *
+ *  These caches are enabled by setting environment variables (see
+ *  docs/admin_notes.rst), which makes it hard to tell how well they're
+ *  working without a way to ask them.  The statistics are read when this
+ *  object is constructed, so construct a new one to see how they've changed.
+ *
+ *  This is new in Xapian 1.3.2.
+ */
+class XAPIAN_VISIBILITY_DEFAULT CacheStats {
+    bool enabled;
+
+    unsigned long hits;
+
+    unsigned long misses;
+
+    size_t size;
+
+    size_t capacity;
+
+  public:
+    /// The caches which statistics can be read for.
+    typedef enum {
+	/// Brass B-tree blocks (XAPIAN_BLOCK_CACHE_SIZE).
+	BLOCK_CACHE,
+	/// Brass term frequencies (XAPIAN_TERMFREQ_CACHE_SIZE).
+	TERMFREQ_CACHE,
+	/// QueryParser wildcard expansions (XAPIAN_WILDCARD_CACHE_SIZE).
+	WILDCARD_CACHE
+    } cache_type;
+
+    /// Read the current statistics for cache @a which.
+    explicit CacheStats(cache_type which);
+
+    /// Is the cache enabled?  (If not, all the statistics are zero.)
+    bool is_enabled() const { return enabled; }
+
+    /// Return the number of lookups which found what they wanted.
+    unsigned long get_hits() const { return hits; }
+
+    /// Return the number of lookups which didn't find what they wanted.
+    unsigned long get_misses() const { return misses; }
+
+    /** Return the amount currently held.
+     *
+     *  This is in the same units as the size the cache was enabled with:
+     *  bytes for BLOCK_CACHE, and terms for TERMFREQ_CACHE and
+     *  WILDCARD_CACHE.
+     */
+    size_t get_size() const { return size; }
+
+    /// Return the most the cache will hold.
+    size_t get_capacity() const { return capacity; }
+
+    /// Return a string describing this object.
+    std::string get_description() const;
+};
+
+}
+
+#endif // XAPIAN_INCLUDED_CACHESTATS_H
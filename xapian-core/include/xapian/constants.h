@@ -116,6 +116,24 @@ const int DB_DANGEROUS		 = 0x08;
  */
 const int DB_NO_TERMLIST	 = 0x10;
 
+/** When opening a database read-only, memory map its tables.
+ *
+ *  For backends which support it (currently brass), B-tree blocks are then
+ *  copied from the OS page cache rather than being read with a system call
+ *  for each block.  If the tables can't be mapped (for example, because
+ *  there isn't enough address space), blocks are read in the usual way.
+ *  This flag is ignored when opening a WritableDatabase.
+ *
+ *  Reads aren't zero-copy - each block is still copied out of the mapping,
+ *  since a writer may overwrite a block in the mapping after its revision
+ *  has been checked.  The saving is the system call per block.
+ *
+ *  A database opened with this flag must not be overwritten in place (e.g.
+ *  using DB_CREATE_OR_OVERWRITE) while it is open - if the file shrinks, the
+ *  process will be killed by SIGBUS.
+ */
+const int DB_MMAP		 = 0x20;
+
 /** Use the brass backend.
  *
  *  When opening a WritableDatabase, this means create a brass database if a
@@ -81,6 +81,10 @@ class XAPIAN_VISIBILITY_DEFAULT Database {
 	 *  backend to use.
 	 *
 	 * @param path directory that the database is stored in.
+	 * @param flags  Bitwise-or of Xapian::DB_* constants: a backend code
+	 *		 such as Xapian::DB_BACKEND_BRASS to only open a
+	 *		 particular type of database, and Xapian::DB_MMAP to
+	 *		 memory map the database's tables.
 	 */
 	explicit Database(const std::string &path, int flags = 0);
 
@@ -469,6 +473,15 @@ class XAPIAN_VISIBILITY_DEFAULT Database {
 	 */
 	std::string get_uuid() const;
 
+	/** @private @internal Get a key identifying the current revision of
+	 *  this database.
+	 *
+	 *  This is used to tie cached results to the revision they came
+	 *  from.  The key is empty if any sub-database can't supply one (for
+	 *  example, because it's writable and may have uncommitted changes).
+	 */
+	std::string get_revision_key() const;
+
 	/** Check the integrity of a database or database table.
 	 *
 	 *  This method is currently experimental, and may change incompatibly
@@ -598,6 +611,13 @@ class XAPIAN_VISIBILITY_DEFAULT WritableDatabase : public Database {
 	 *  you can improve indexing throughput dramatically by setting
 	 *  XAPIAN_FLUSH_THRESHOLD in the environment to a larger value.
 	 *
+	 *  Alternatively, you can set XAPIAN_FLUSH_MEMORY_LIMIT in the
+	 *  environment to a number of bytes, and changes will be committed
+	 *  whenever the memory used to buffer them (as reported by
+	 *  get_memory_used()) reaches that size.  If this is set and
+	 *  XAPIAN_FLUSH_THRESHOLD isn't, the number of documents modified
+	 *  isn't limited.
+	 *
 	 *  This method was new in Xapian 1.1.0 - in earlier versions it was
 	 *  called flush().
 	 *
@@ -616,6 +636,17 @@ class XAPIAN_VISIBILITY_DEFAULT WritableDatabase : public Database {
 	 */
 	void flush() { commit(); }
 
+	/** Get an estimate of the memory used to buffer pending changes.
+	 *
+	 *  This is intended for monitoring an indexer's memory use.  The
+	 *  estimate is in bytes, and covers the data structures holding the
+	 *  changes which haven't yet been written to the database's tables.
+	 *
+	 *  Currently only the brass and chert backends track this - for other
+	 *  backends this always returns 0.
+	 */
+	size_t get_memory_used() const;
+
 	/** Begin a transaction.
 	 *
 	 *  In Xapian a transaction is a group of modifications to the database
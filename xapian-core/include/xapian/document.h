@@ -40,6 +40,23 @@
 
 namespace Xapian {
 
+/** Receives document data in pieces from Document::get_data(DataSink &).
+ *
+ *  This is new in Xapian 1.3.2.
+ */
+class XAPIAN_VISIBILITY_DEFAULT DataSink {
+  public:
+    /// Virtual destructor, because we have virtual methods.
+    virtual ~DataSink();
+
+    /** Append the next piece of the data.
+     *
+     *  @param p	The start of the piece.
+     *  @param len	The length of the piece in bytes.
+     */
+    virtual void append(const char * p, size_t len) = 0;
+};
+
 /** A handle representing a document in a Xapian database.
  *
  *  The Document class fetches information from the database lazily.  Usually
@@ -125,6 +142,19 @@ class XAPIAN_VISIBILITY_DEFAULT Document {
 	 */
 	std::string get_data() const;
 
+	/** Pass the data stored in the document to @a sink in pieces.
+	 *
+	 *  This allows large document data to be processed incrementally.
+	 *  With the brass backend, compressed data is decompressed a piece at
+	 *  a time, so the whole of it never needs to be held in memory at
+	 *  once.  Other backends may pass all the data in one piece.
+	 *
+	 *  This is new in Xapian 1.3.2.
+	 *
+	 *  @param sink	The object to pass the data to.
+	 */
+	void get_data(DataSink & sink) const;
+
 	/** Set data stored in the document.
 	 *
 	 *  Xapian treats the data as an opaque blob.  It may try to compress
@@ -659,6 +659,71 @@ class XAPIAN_VISIBILITY_DEFAULT MatchDecider {
 	virtual ~MatchDecider();
 };
 
+/** A cache of match results, which can be shared between Enquire objects.
+ *
+ *  Results are cached for a query together with the settings of the
+ *  Enquire object which affect them (the weighting scheme, sort order,
+ *  collapsing and cutoffs) and the revision of the database being searched,
+ *  so reopening a database at a newer revision means cached results for
+ *  the old revision won't be used (they'll be evicted once they're the
+ *  least recently used).
+ *
+ *  Results are only cached for searches over databases which can identify
+ *  their revision - currently brass and chert databases opened for reading.
+ *  Searches using a MatchDecider, KeyMaker, MatchSpy, RSet or time limit
+ *  also bypass the cache, as do queries using a PostingSource which
+ *  doesn't support serialisation, and user-defined weighting schemes which
+ *  don't support serialisation.
+ *
+ *  When a search isn't found in the cache, enough results are calculated
+ *  to serve later pages too, and the match statistics reflect that.
+ *
+ *  The same MSetCache can be used by Enquire objects in different threads
+ *  at the same time.
+ */
+class XAPIAN_VISIBILITY_DEFAULT MSetCache {
+    public:
+	class Internal;
+	/// @private @internal Reference counted internals.
+	Xapian::Internal::intrusive_ptr<Internal> internal;
+
+	/** Create an MSetCache.
+	 *
+	 *  @param max_entries	The maximum number of searches to cache the
+	 *			results of (default: 1000).
+	 *  @param min_depth	The minimum number of results to calculate
+	 *			and cache for each search (default: 100).
+	 */
+	explicit MSetCache(Xapian::doccount max_entries = 1000,
+			   Xapian::doccount min_depth = 100);
+
+	/// Copying is allowed (and is cheap).
+	MSetCache(const MSetCache & other);
+
+	/// Assignment is allowed (and is cheap).
+	void operator=(const MSetCache & other);
+
+	/// Destructor.
+	~MSetCache();
+
+	/// Remove all the entries from the cache.
+	void clear();
+
+	/// Return the number of searches currently cached.
+	Xapian::doccount size() const;
+
+	/// Return the number of searches which were found in the cache.
+	Xapian::doccount get_hits() const;
+
+	/** Return the number of searches which could have been cached but
+	 *  weren't found in the cache.
+	 */
+	Xapian::doccount get_misses() const;
+
+	/// Return a string describing this object.
+	std::string get_description() const;
+};
+
 /** This class provides an interface to the information retrieval
  *  system for the purpose of searching.
  *
@@ -990,6 +1055,88 @@ class XAPIAN_VISIBILITY_DEFAULT Enquire {
 	 */
 	void set_time_limit(double time_limit);
 
+	/** Set the number of threads to use for the match.
+	 *
+	 *  If the database is made up of several local sub-databases, setting
+	 *  this to more than 1 allows each sub-database to be matched on a
+	 *  thread of its own (using up to @a n threads), with the results
+	 *  then merged.  If @a n is larger than the number of local
+	 *  sub-databases, each sub-database is also split into ranges of
+	 *  document ids which are matched on threads of their own - this
+	 *  requires opening the sub-database again for each extra range, which
+	 *  is currently only supported for brass databases opened read-only
+	 *  (for other sub-databases, the whole sub-database is matched on one
+	 *  thread).  When sorting primarily by relevance, the threads
+	 *  share the minimum weight a document needs to make the MSet, so
+	 *  each thread benefits from good matches found by the others.
+	 *
+	 *  The results are the same as for a match on a single thread, except
+	 *  that the estimated number of matches may differ, and the bounds on
+	 *  the number of matches may be less tight when a sub-database is
+	 *  split into ranges (though never looser than the bounds given by the
+	 *  term frequencies).
+	 *
+	 *  @param n  The maximum number of threads to use (default: 1).
+	 *
+	 *  Limitations:
+	 *
+	 *  Any Xapian::MatchSpy objects in use must implement clone(),
+	 *  serialise_results() and merge_results() (as for the remote
+	 *  backend), and any Xapian::PostingSource objects in the query must
+	 *  implement clone() - otherwise the match is run on a single thread.
+	 *  Any Xapian::KeyMaker or Xapian::MatchDecider in use may be called
+	 *  from several threads at once, so must be safe to use in this way.
+	 *  Remote sub-databases are matched as usual.
+	 */
+	void set_parallelism(unsigned n);
+
+	/** Set whether to profile the match.
+	 *
+	 *  When profiling is enabled, each call to get_mset() records a
+	 *  profile of the tree of postlists built for the query, which can be
+	 *  retrieved using get_profile().  This has a modest overhead (mostly
+	 *  from timing each call), so is intended for tuning queries rather
+	 *  than for routine use.
+	 *
+	 *  Parallel matching (see set_parallelism()) isn't used while
+	 *  profiling, and remote sub-databases aren't profiled.
+	 *
+	 *  @param enabled  true to profile the match (default: false).
+	 */
+	void set_profiling(bool enabled);
+
+	/** Get the profile of the most recent match.
+	 *
+	 *  The profile has one line for each node of the postlist tree built
+	 *  for each local sub-database, with children indented below their
+	 *  parent.  Each line gives the number of calls to next(), skip_to()
+	 *  and check(), the number of documents scored, the number of
+	 *  postings decoded, chunks read and blocks loaded (for the nodes
+	 *  below it in the case of interior nodes) and the time spent in the
+	 *  node (including the nodes below it).  If a node was replaced as an
+	 *  optimisation during the match (e.g. an OR decaying to an
+	 *  AND_MAYBE), what it was replaced with is listed below it.
+	 *
+	 *  The counts of postings, chunks and blocks are currently only
+	 *  available for brass databases.
+	 *
+	 *  @return The profile, or an empty string if profiling wasn't
+	 *	    enabled for the most recent call to get_mset().
+	 */
+	std::string get_profile() const;
+
+	/** Set a cache to use for the results of get_mset().
+	 *
+	 *  See Xapian::MSetCache for details of which searches are cached.
+	 *
+	 *  @param cache  The cache to use, or NULL to stop using a cache
+	 *		  (the default).  The object pointed to must remain
+	 *		  valid while this Enquire uses it (this allows one
+	 *		  cache to be used by Enquire objects in several
+	 *		  threads).
+	 */
+	void set_mset_cache(Xapian::MSetCache * cache);
+
 	/** Get (a portion of) the match set for the current query.
 	 *
 	 *  @param first     the first item in the result set to return.
@@ -494,6 +494,16 @@ class XAPIAN_VISIBILITY_DEFAULT QueryParser {
     /// Stemming strategies, for use with set_stemming_strategy().
     typedef enum { STEM_NONE, STEM_SOME, STEM_ALL, STEM_ALL_Z } stem_strategy;
 
+    /** What to do when a wildcard expands to more terms than the limit set
+     *  by set_max_wildcard_expansion().
+     */
+    typedef enum {
+	/// Throw QueryParserError.
+	WILDCARD_LIMIT_ERROR,
+	/// Expand to just the terms which index the most documents.
+	WILDCARD_LIMIT_MOST_FREQUENT
+    } wildcard_limit_type;
+
     /// Copy constructor.
     QueryParser(const QueryParser & o);
 
@@ -582,8 +592,22 @@ class XAPIAN_VISIBILITY_DEFAULT QueryParser {
      *
      *  @param limit	The maximum number of terms each wildcard in the query
      *			can expand to, or 0 for no limit (which is the default).
+     *  @param limit_type	What to do if a wildcard expands to more than
+     *			@a limit terms: WILDCARD_LIMIT_ERROR (the default)
+     *			throws QueryParserError, while
+     *			WILDCARD_LIMIT_MOST_FREQUENT expands to the @a limit
+     *			terms with the highest term frequencies.
+     *
+     *  To find the most frequent terms, WILDCARD_LIMIT_MOST_FREQUENT has to
+     *  look at the term frequency of every term the wildcard matches, however
+     *  small @a limit is, so a wildcard which matches a lot of terms is slow
+     *  to expand.  The wildcard cache (see docs/admin_notes.rst) can avoid
+     *  this when the same wildcard is used again, but not for a wildcard
+     *  which matches more than half as many terms as the cache holds.
      */
-    void set_max_wildcard_expansion(Xapian::termcount limit);
+    void set_max_wildcard_expansion(Xapian::termcount limit,
+				    wildcard_limit_type limit_type =
+					WILDCARD_LIMIT_ERROR);
 
     /** Parse a query.
      *
@@ -92,7 +92,44 @@ class XAPIAN_VISIBILITY_DEFAULT TermGenerator {
     /// Flags to OR together and pass to TermGenerator::set_flags().
     enum {
 	/// Index data required for spelling correction.
-	FLAG_SPELLING = 128 // Value matches QueryParser flag.
+	FLAG_SPELLING = 128, // Value matches QueryParser flag.
+
+	/** Index pairs of adjacent words to speed up phrase searches.
+	 *
+	 *  For each pair of terms generated at adjacent positions in the
+	 *  same field, a term is added with wdf 0, which allows the matcher
+	 *  to check a two word phrase without reading any positional data.
+	 *  The matcher only does this for a field (i.e. a term prefix) in
+	 *  documents which have been indexed with this flag set for that
+	 *  field, so if you use it for a field in a document you should set
+	 *  it for all calls to index_text() for that field, and not add
+	 *  positional information for it in other ways.  Biwords are only
+	 *  generated for fields whose prefix consists of capital letters
+	 *  (which includes no prefix).
+	 *
+	 *  This is new in Xapian 1.3.2.
+	 */
+	FLAG_BIWORDS = 4096,
+
+	/** Index the start of each word to speed up partial matching.
+	 *
+	 *  For each unstemmed term, terms are added for its first one, two,
+	 *  three and four characters, which the QueryParser uses for
+	 *  FLAG_PARTIAL instead of expanding the partial word to every term
+	 *  in the database starting with it.  The QueryParser only does this
+	 *  for a field (i.e. a term prefix) where every document in the
+	 *  database has been indexed with this flag set for that field.
+	 *  This flag has no effect with STEM_ALL or STEM_ALL_Z, which don't
+	 *  generate unstemmed terms.
+	 *
+	 *  Each of these terms gets the wdf of the words it comes from, so a
+	 *  partial word is weighted as it would be when expanded.  The
+	 *  backends don't count their wdf in the document length, so the
+	 *  weights given to other queries aren't changed.
+	 *
+	 *  This is new in Xapian 1.3.2.
+	 */
+	FLAG_EDGE_NGRAMS = 8192
     };
 
     /// Stemming strategies, for use with set_stemming_strategy().
@@ -547,6 +547,13 @@ class XAPIAN_VISIBILITY_DEFAULT BM25Weight : public Weight {
 		       Xapian::termcount doclen) const;
     double get_maxpart() const;
 
+    /** @private @internal Upper bound on get_sumpart() for documents in
+     *  which the term's wdf is at most @a wdf_max and whose length is at
+     *  least @a doclen_min.
+     */
+    double get_maxpart_for_wdf(Xapian::termcount wdf_max,
+			       Xapian::termcount doclen_min) const;
+
     double get_sumextra(Xapian::termcount doclen) const;
     double get_maxextra() const;
 };
@@ -606,6 +613,13 @@ class XAPIAN_VISIBILITY_DEFAULT TradWeight : public Weight {
 		       Xapian::termcount doclen) const;
     double get_maxpart() const;
 
+    /** @private @internal Upper bound on get_sumpart() for documents in
+     *  which the term's wdf is at most @a wdf_max and whose length is at
+     *  least @a doclen_min.
+     */
+    double get_maxpart_for_wdf(Xapian::termcount wdf_max,
+			       Xapian::termcount doclen_min) const;
+
     double get_sumextra(Xapian::termcount doclen) const;
     double get_maxextra() const;
 };
@@ -4,19 +4,23 @@ noinst_HEADERS +=\
 	matcher/branchpostlist.h\
 	matcher/collapser.h\
 	matcher/const_database_wrapper.h\
+	matcher/docidrangepostlist.h\
 	matcher/exactphrasepostlist.h\
 	matcher/externalpostlist.h\
 	matcher/extraweightpostlist.h\
 	matcher/localsubmatch.h\
+	matcher/matchprofile.h\
 	matcher/maxpostlist.h\
 	matcher/mergepostlist.h\
 	matcher/msetcmp.h\
 	matcher/msetpostlist.h\
 	matcher/multiandpostlist.h\
 	matcher/multimatch.h\
+	matcher/multiorpostlist.h\
 	matcher/multixorpostlist.h\
 	matcher/orpostlist.h\
 	matcher/phrasepostlist.h\
+	matcher/profilepostlist.h\
 	matcher/queryoptimiser.h\
 	matcher/remotesubmatch.h\
 	matcher/selectpostlist.h\
@@ -43,18 +47,22 @@ lib_src +=\
 	matcher/branchpostlist.cc\
 	matcher/collapser.cc\
 	matcher/const_database_wrapper.cc\
+	matcher/docidrangepostlist.cc\
 	matcher/exactphrasepostlist.cc\
 	matcher/externalpostlist.cc\
 	matcher/localsubmatch.cc\
+	matcher/matchprofile.cc\
 	matcher/maxpostlist.cc\
 	matcher/mergepostlist.cc\
 	matcher/msetcmp.cc\
 	matcher/msetpostlist.cc\
 	matcher/multiandpostlist.cc\
 	matcher/multimatch.cc\
+	matcher/multiorpostlist.cc\
 	matcher/multixorpostlist.cc\
 	matcher/orpostlist.cc\
 	matcher/phrasepostlist.cc\
+	matcher/profilepostlist.cc\
 	matcher/selectpostlist.cc\
 	matcher/synonympostlist.cc\
 	matcher/valuegepostlist.cc\
@@ -69,25 +69,24 @@ CollapseData::add_item(const Xapian::Internal::MSetItem & item,
 collapse_result
 Collapser::process(Xapian::Internal::MSetItem & item,
 		   PostList * postlist,
-		   Xapian::Document::Internal & vsdoc,
+		   const ValueStreamDocument & vsdoc,
 		   const MSetCmp & mcmp)
 {
     ++docs_considered;
     // The postlist will supply the collapse key for a remote match.
     const string * key_ptr = postlist->get_collapse_key();
-    if (key_ptr) {
-	item.collapse_key = *key_ptr;
-    } else {
+    if (!key_ptr) {
 	// Otherwise use the Document object to get the value.
-	item.collapse_key = vsdoc.get_value(slot);
+	key_ptr = &vsdoc.get_value_ref(slot, key_buf);
     }
 
-    if (item.collapse_key.empty()) {
+    if (key_ptr->empty()) {
 	// We don't collapse items with an empty collapse key.
 	++no_collapse_key;
 	return EMPTY;
     }
 
+    item.collapse_key = *key_ptr;
     map<string, CollapseData>::iterator oldkey;
     oldkey = table.find(item.collapse_key);
     if (oldkey == table.end()) {
@@ -25,6 +25,7 @@
 #include "msetcmp.h"
 #include "api/omenquireinternal.h"
 #include "api/postlist.h"
+#include "valuestreamdocument.h"
 
 #include <map>
 
@@ -117,6 +118,9 @@ class Collapser {
     /** The maximum number of items to keep for each collapse key value. */
     Xapian::doccount collapse_max;
 
+    /// Buffer for collapse keys which the value stream can't reference.
+    std::string key_buf;
+
   public:
     /// Replaced item when REPLACED is returned by @a collapse().
     Xapian::Internal::MSetItem old_item;
@@ -134,14 +138,14 @@ class Collapser {
      *  @param item		The new item.
      *  @param postlist		PostList to try to get collapse key from
      *				(this happens for a remote match).
-     *  @param doc		Document for getting values.
+     *  @param vsdoc		Document for getting values.
      *  @param mcmp		MSetItem comparison functor.
      *
      *  @return How @a item was handled: EMPTY, ADDED, REJECTED or REPLACED.
      */
     collapse_result process(Xapian::Internal::MSetItem & item,
 			    PostList * postlist,
-			    Xapian::Document::Internal & vsdoc,
+			    const ValueStreamDocument & vsdoc,
 			    const MSetCmp & mcmp);
 
     Xapian::doccount get_collapse_count(const std::string & collapse_key,
@@ -0,0 +1,162 @@
+/** @file docidrangepostlist.cc
+ * @brief Restrict a postlist to a range of docids
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "docidrangepostlist.h"
+
+#include "debuglog.h"
+#include "multimatch.h"
+#include "str.h"
+
+#include <algorithm>
+
+using namespace std;
+
+DocidRangePostList::~DocidRangePostList()
+{
+    delete pl;
+}
+
+void
+DocidRangePostList::handle_prune(PostList * p)
+{
+    if (p) {
+	delete pl;
+	pl = p;
+	if (matcher) matcher->recalc_maxweight();
+    }
+}
+
+Xapian::doccount
+DocidRangePostList::get_termfreq_min() const
+{
+    // Every docid outside the range might match.
+    Xapian::doccount outside = db_last - (last - first + 1);
+    Xapian::doccount tf_min = pl->get_termfreq_min();
+    return tf_min > outside ? tf_min - outside : 0;
+}
+
+Xapian::doccount
+DocidRangePostList::get_termfreq_max() const
+{
+    Xapian::doccount tf_max = pl->get_termfreq_max();
+    return min(tf_max, Xapian::doccount(last - first + 1));
+}
+
+Xapian::doccount
+DocidRangePostList::get_termfreq_est() const
+{
+    // Assume the matches are spread evenly over the docid space.
+    double scale = double(last - first + 1) / db_last;
+    Xapian::doccount est =
+	static_cast<Xapian::doccount>(pl->get_termfreq_est() * scale + 0.5);
+    est = max(est, get_termfreq_min());
+    return min(est, get_termfreq_max());
+}
+
+double
+DocidRangePostList::get_maxweight() const
+{
+    return pl->get_maxweight();
+}
+
+Xapian::docid
+DocidRangePostList::get_docid() const
+{
+    return pl->get_docid();
+}
+
+Xapian::termcount
+DocidRangePostList::get_doclength() const
+{
+    return pl->get_doclength();
+}
+
+double
+DocidRangePostList::get_weight() const
+{
+    return pl->get_weight();
+}
+
+const string *
+DocidRangePostList::get_collapse_key() const
+{
+    return pl->get_collapse_key();
+}
+
+bool
+DocidRangePostList::at_end() const
+{
+    return pl->at_end() || pl->get_docid() > last;
+}
+
+double
+DocidRangePostList::recalc_maxweight()
+{
+    return pl->recalc_maxweight();
+}
+
+PostList *
+DocidRangePostList::next(double w_min)
+{
+    LOGCALL(MATCH, PostList *, "DocidRangePostList::next", w_min);
+    if (!started) {
+	started = true;
+	handle_prune(pl->skip_to(first, w_min));
+    } else {
+	handle_prune(pl->next(w_min));
+    }
+    RETURN(NULL);
+}
+
+PostList *
+DocidRangePostList::skip_to(Xapian::docid did, double w_min)
+{
+    LOGCALL(MATCH, PostList *, "DocidRangePostList::skip_to", did | w_min);
+    started = true;
+    handle_prune(pl->skip_to(max(did, first), w_min));
+    RETURN(NULL);
+}
+
+string
+DocidRangePostList::get_description() const
+{
+    string desc("(DocidRange ");
+    desc += str(first);
+    desc += "..";
+    desc += str(last);
+    desc += ' ';
+    desc += pl->get_description();
+    desc += ')';
+    return desc;
+}
+
+Xapian::termcount
+DocidRangePostList::get_wdf() const
+{
+    return pl->get_wdf();
+}
+
+Xapian::termcount
+DocidRangePostList::count_matching_subqs() const
+{
+    return pl->count_matching_subqs();
+}
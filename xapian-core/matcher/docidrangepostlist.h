@@ -0,0 +1,108 @@
+/** @file docidrangepostlist.h
+ * @brief Restrict a postlist to a range of docids
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_DOCIDRANGEPOSTLIST_H
+#define XAPIAN_INCLUDED_DOCIDRANGEPOSTLIST_H
+
+#include "api/postlist.h"
+
+class MultiMatch;
+
+/** PostList which only returns entries in a range of docids.
+ *
+ *  This is used to split a match of a single database between threads.
+ */
+class DocidRangePostList : public PostList {
+    /// Don't allow assignment.
+    void operator=(const DocidRangePostList &);
+
+    /// Don't allow copying.
+    DocidRangePostList(const DocidRangePostList &);
+
+    /// The postlist we're restricting.
+    PostList * pl;
+
+    /// The first docid in the range.
+    Xapian::docid first;
+
+    /// The last docid in the range.
+    Xapian::docid last;
+
+    /// The highest docid in the database.
+    Xapian::docid db_last;
+
+    /// Pointer to the matcher object, so we can report pruning.
+    MultiMatch * matcher;
+
+    /// Have we started iterating yet?
+    bool started;
+
+    /// Replace pl with @a p, if it isn't NULL.
+    void handle_prune(PostList * p);
+
+  public:
+    /** Construct a DocidRangePostList.
+     *
+     *  @param pl_	The postlist to restrict (ownership is taken).
+     *  @param first_	The first docid in the range.
+     *  @param last_	The last docid in the range.
+     *  @param db_last_	The highest docid in the database.
+     *  @param matcher_	The matcher, so we can report pruning.
+     */
+    DocidRangePostList(PostList * pl_,
+		       Xapian::docid first_, Xapian::docid last_,
+		       Xapian::docid db_last_, MultiMatch * matcher_)
+	: pl(pl_), first(first_), last(last_), db_last(db_last_),
+	  matcher(matcher_), started(false) { }
+
+    ~DocidRangePostList();
+
+    Xapian::doccount get_termfreq_min() const;
+
+    Xapian::doccount get_termfreq_max() const;
+
+    Xapian::doccount get_termfreq_est() const;
+
+    double get_maxweight() const;
+
+    Xapian::docid get_docid() const;
+
+    Xapian::termcount get_doclength() const;
+
+    double get_weight() const;
+
+    const std::string * get_collapse_key() const;
+
+    bool at_end() const;
+
+    double recalc_maxweight();
+
+    Internal * next(double w_min);
+
+    Internal * skip_to(Xapian::docid, double w_min);
+
+    std::string get_description() const;
+
+    Xapian::termcount get_wdf() const;
+
+    Xapian::termcount count_matching_subqs() const;
+};
+
+#endif // XAPIAN_INCLUDED_DOCIDRANGEPOSTLIST_H
@@ -71,6 +71,73 @@ class TermCompare {
     }
 };
 
+/** Find the first entry in v at or after index lo which is >= value.
+ *
+ *  We probe forwards in exponentially increasing steps and then binary chop
+ *  within the last step, so the cost is logarithmic in the distance moved
+ *  rather than in the length of v.
+ */
+static size_t
+gallop(const vector<Xapian::termpos> & v, size_t lo, Xapian::termpos value)
+{
+    size_t n = v.size();
+    size_t hi = lo;
+    size_t step = 1;
+    while (hi < n && v[hi] < value) {
+	lo = hi + 1;
+	hi += step;
+	step *= 2;
+    }
+    if (hi > n) hi = n;
+    return lower_bound(v.begin() + lo, v.begin() + hi, value) - v.begin();
+}
+
+/** If one list is this many times longer than the other, gallop through it
+ *  rather than merging.
+ */
+const size_t GALLOP_RATIO = 8;
+
+void
+ExactPhrasePostList::intersect_candidates(Xapian::termpos offset)
+{
+    size_t n_cand = candidates.size();
+    size_t n_pos = positions.size();
+    size_t j = 0;
+    if (n_cand * GALLOP_RATIO < n_pos) {
+	// Few candidates - look each one up in positions.
+	size_t p = 0;
+	for (size_t c = 0; c != n_cand; ++c) {
+	    Xapian::termpos required = candidates[c] + offset;
+	    p = gallop(positions, p, required);
+	    if (p == n_pos) break;
+	    if (positions[p] == required) candidates[j++] = candidates[c];
+	}
+    } else if (n_pos * GALLOP_RATIO < n_cand) {
+	// Few positions - look each one up in candidates.  Any match is at or
+	// after the entry we're writing to, so we can filter in place.
+	size_t c = 0;
+	for (size_t p = 0; p != n_pos; ++p) {
+	    if (positions[p] < offset) continue;
+	    Xapian::termpos base = positions[p] - offset;
+	    c = gallop(candidates, c, base);
+	    if (c == n_cand) break;
+	    if (candidates[c] == base) candidates[j++] = base;
+	}
+    } else {
+	size_t c = 0, p = 0;
+	while (c != n_cand && p != n_pos) {
+	    Xapian::termpos required = candidates[c] + offset;
+	    if (positions[p] < required) {
+		++p;
+	    } else {
+		if (positions[p] == required) candidates[j++] = candidates[c];
+		++c;
+	    }
+	}
+    }
+    candidates.resize(j);
+}
+
 bool
 ExactPhrasePostList::test_doc()
 {
@@ -84,46 +151,36 @@ ExactPhrasePostList::test_doc()
     // similar order.
     sort(order, order + terms.size(), TermCompare(terms));
 
-    // If the first term we check only occurs too close to the start of the
-    // document, we only need to read one term's positions.  E.g. search for
-    // "ripe mango" when the only occurrence of 'mango' in the current document
-    // is at position 0.
+    // Read the positions of the first term into candidates, converted to the
+    // position the phrase would start at.  If the first term only occurs too
+    // close to the start of the document, we only need to read one term's
+    // positions.  E.g. search for "ripe mango" when the only occurrence of
+    // 'mango' in the current document is at position 0.
     start_position_list(0);
-    poslists[0]->skip_to(poslists[0]->index);
-    if (poslists[0]->at_end()) RETURN(false);
-
-    // If we get here, we'll need to read the positionlists for at least two
-    // terms, so check the true positionlist length for the two terms with the
-    // lowest wdf and if necessary swap them so the true shorter one is first.
-    start_position_list(1);
-    if (poslists[0]->get_size() < poslists[1]->get_size()) {
-	poslists[1]->skip_to(poslists[1]->index);
-	if (poslists[1]->at_end()) RETURN(false);
-	swap(poslists[0], poslists[1]);
+    Xapian::termpos idx0 = poslists[0]->index;
+    candidates.clear();
+    poslists[0]->get_positions(candidates);
+    vector<Xapian::termpos>::iterator first_valid =
+	lower_bound(candidates.begin(), candidates.end(), idx0);
+    candidates.erase(candidates.begin(), first_valid);
+    if (candidates.empty()) RETURN(false);
+    if (idx0) {
+	vector<Xapian::termpos>::iterator c;
+	for (c = candidates.begin(); c != candidates.end(); ++c) *c -= idx0;
     }
 
-    unsigned read_hwm = 1;
-    Xapian::termpos idx0 = poslists[0]->index;
-    do {
-	Xapian::termpos base = poslists[0]->get_position() - idx0;
-	unsigned i = 1;
-	while (true) {
-	    if (i > read_hwm) {
-		read_hwm = i;
-		start_position_list(i);
-		// FIXME: consider comparing with poslist[0] and swapping
-		// if less common.  Should we allow for the number of positions
-		// we've read from poslist[0] already?
-	    }
-	    Xapian::termpos required = base + poslists[i]->index;
-	    poslists[i]->skip_to(required);
-	    if (poslists[i]->at_end()) RETURN(false);
-	    if (poslists[i]->get_position() != required) break;
-	    if (++i == terms.size()) RETURN(true);
-	}
-	poslists[0]->next();
-    } while (!poslists[0]->at_end());
-    RETURN(false);
+    // Then filter the candidates by each other term in turn, stopping as soon
+    // as none are left.  Each step costs roughly the length of the shorter
+    // list (times a log factor when the lengths are very different) rather
+    // than a skip_to() call per position.
+    for (unsigned i = 1; i != terms.size(); ++i) {
+	start_position_list(i);
+	positions.clear();
+	poslists[i]->get_positions(positions);
+	intersect_candidates(poslists[i]->index);
+	if (candidates.empty()) RETURN(false);
+    }
+    RETURN(true);
 }
 
 Xapian::termcount
@@ -44,9 +44,24 @@ class ExactPhrasePostList : public SelectPostList {
 
     unsigned * order;
 
+    /** Phrase start positions which are still possible matches.
+     *
+     *  These are kept between calls to avoid reallocating for each document.
+     */
+    std::vector<Xapian::termpos> candidates;
+
+    /// Buffer to read the positions for the term being checked into.
+    std::vector<Xapian::termpos> positions;
+
     /// Start reading from the i-th position list.
     void start_position_list(unsigned i);
 
+    /** Remove entries from candidates which aren't in positions.
+     *
+     *  A candidate c matches if positions contains c + offset.
+     */
+    void intersect_candidates(Xapian::termpos offset);
+
     /// Test if the current document contains the terms as an exact phrase.
     bool test_doc();
 
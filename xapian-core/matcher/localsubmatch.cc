@@ -28,6 +28,8 @@
 #include "api/emptypostlist.h"
 #include "extraweightpostlist.h"
 #include "api/leafpostlist.h"
+#include "matchprofile.h"
+#include "multimatch.h"
 #include "omassert.h"
 #include "queryoptimiser.h"
 #include "synonympostlist.h"
@@ -77,8 +79,9 @@ LocalSubMatch::get_postlist(MultiMatch * matcher,
     // Build the postlist tree for the query.  This calls
     // LocalSubMatch::open_post_list() for each term in the query.
     PostList * pl;
+    MatchProfile * profile = matcher ? matcher->get_profile() : NULL;
     {
-	QueryOptimiser opt(*db, *this, matcher);
+	QueryOptimiser opt(*db, *this, matcher, profile);
 	pl = query.internal->postlist(&opt, 1.0);
 	*total_subqs_ptr = opt.get_total_subqs();
     }
@@ -89,7 +92,10 @@ LocalSubMatch::get_postlist(MultiMatch * matcher,
 	// There's a term-independent weight contribution, so we combine the
 	// postlist tree with an ExtraWeightPostList which adds in this
 	// contribution.
+	PostList * child = pl;
 	pl = new ExtraWeightPostList(pl, extra_wt.release(), matcher);
+	if (profile)
+	    pl = profile->wrap(pl, "EXTRA_WEIGHT", matcher, &child, &child + 1);
     }
 
     RETURN(pl);
@@ -125,9 +131,10 @@ LeafPostList *
 LocalSubMatch::open_post_list(const string& term,
 			      Xapian::termcount wqf,
 			      double factor,
+			      bool need_positions,
 			      LeafPostList ** hint)
 {
-    LOGCALL(MATCH, LeafPostList *, "LocalSubMatch::open_post_list", term | wqf | factor | hint);
+    LOGCALL(MATCH, LeafPostList *, "LocalSubMatch::open_post_list", term | wqf | factor | need_positions | hint);
 
     bool weighted = (factor != 0.0 && !term.empty());
     AutoPtr<Xapian::Weight> wt(weighted ? wt_factory->clone() : NULL);
@@ -137,15 +144,15 @@ LocalSubMatch::open_post_list(const string& term,
     }
 
     LeafPostList * pl = NULL;
-    if (!term.empty()) {
+    if (!term.empty() && !need_positions) {
 	if (!weighted || !wt_factory->get_sumpart_needs_wdf_()) {
 	    Xapian::doccount sub_tf;
 	    db->get_freqs(term, &sub_tf, NULL);
 	    if (sub_tf == db->get_doccount()) {
-		// If we're not going to use the wdf and the term indexes all
-		// documents, we can replace it with the MatchAll postlist,
-		// which is especially efficient if there are no gaps in the
-		// docids.
+		// If we're not going to use the wdf or positions and the term
+		// indexes all documents, we can replace it with the MatchAll
+		// postlist, which is especially efficient if there are no gaps
+		// in the docids.
 		pl = db->open_post_list(string());
 	    }
 	}
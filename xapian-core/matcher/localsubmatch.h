@@ -90,9 +90,16 @@ class LocalSubMatch : public SubMatch {
     PostList * make_synonym_postlist(PostList * or_pl, MultiMatch * matcher,
 				     double factor);
 
+    /** Open a postlist for @a term.
+     *
+     *  @param need_positions	If false and the postlist isn't weighted,
+     *				a term which indexes every document may be
+     *				replaced by the MatchAll postlist.
+     */
     LeafPostList * open_post_list(const std::string& term,
 				  Xapian::termcount wqf,
 				  double factor,
+				  bool need_positions,
 				  LeafPostList ** hint);
 };
 
@@ -0,0 +1,124 @@
+/** @file matchprofile.cc
+ * @brief Profile of the postlist tree built for a match
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "matchprofile.h"
+
+#include "profilepostlist.h"
+#include "str.h"
+
+using namespace std;
+
+MatchProfile::~MatchProfile()
+{
+    for (size_t i = 0; i != nodes.size(); ++i) {
+	delete nodes[i];
+    }
+}
+
+PostList *
+MatchProfile::wrap(PostList * pl, const string & label, MultiMatch * matcher,
+		   PostList * const * children_begin,
+		   PostList * const * children_end)
+{
+    nodes.push_back(new ProfileNode(label));
+    ProfileNode * node = nodes.back();
+    for (PostList * const * i = children_begin; i != children_end; ++i) {
+	map<const PostList *, ProfileNode *>::iterator c = wrappers.find(*i);
+	if (c != wrappers.end()) {
+	    node->children.push_back(c->second);
+	    // A postlist only has one parent.
+	    wrappers.erase(c);
+	}
+    }
+    PostList * res = new ProfilePostList(pl, node, matcher);
+    wrappers[res] = node;
+    return res;
+}
+
+PostList *
+MatchProfile::wrap_root(PostList * pl, size_t shard, MultiMatch * matcher)
+{
+    PostList * res = wrap(pl, "Database " + str(shard), matcher, &pl, &pl + 1);
+    roots.push_back(nodes.back());
+    wrappers.erase(res);
+    return res;
+}
+
+/// Add up the read counts for @a node and the nodes below it.
+static void
+add_read_counts(const ProfileNode & node,
+		totlen_t & postings, totlen_t & chunks, totlen_t & blocks)
+{
+    postings += node.postings;
+    chunks += node.chunks;
+    blocks += node.blocks;
+    for (size_t i = 0; i != node.children.size(); ++i) {
+	add_read_counts(*node.children[i], postings, chunks, blocks);
+    }
+}
+
+void
+MatchProfile::describe(const ProfileNode & node, const string & indent,
+		       string & desc)
+{
+    desc += indent;
+    desc += node.label;
+    desc += ": next=";
+    desc += str(node.nexts);
+    desc += " skip_to=";
+    desc += str(node.skip_tos);
+    desc += " check=";
+    desc += str(node.checks);
+    desc += " scored=";
+    desc += str(node.weights);
+    // Interior nodes report the reads done by the leaves below them.
+    totlen_t postings = 0, chunks = 0, blocks = 0;
+    add_read_counts(node, postings, chunks, blocks);
+    desc += " postings=";
+    desc += str(postings);
+    desc += " chunks=";
+    desc += str(chunks);
+    desc += " blocks=";
+    desc += str(blocks);
+    desc += " time=";
+    desc += str(node.time * 1e3);
+    desc += "ms\n";
+    for (size_t i = 0; i != node.prunes.size(); ++i) {
+	desc += indent;
+	desc += "  pruned to: ";
+	desc += node.prunes[i];
+	desc += '\n';
+    }
+    for (size_t i = 0; i != node.children.size(); ++i) {
+	describe(*node.children[i], indent + "  ", desc);
+    }
+}
+
+string
+MatchProfile::get_description() const
+{
+    string desc;
+    for (size_t i = 0; i != roots.size(); ++i) {
+	describe(*roots[i], string(), desc);
+    }
+    return desc;
+}
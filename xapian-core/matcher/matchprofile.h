@@ -0,0 +1,128 @@
+/** @file matchprofile.h
+ * @brief Profile of the postlist tree built for a match
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_MATCHPROFILE_H
+#define XAPIAN_INCLUDED_MATCHPROFILE_H
+
+#include "api/postlist.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+class MultiMatch;
+
+/// The profile of one node of the postlist tree.
+struct ProfileNode {
+    /// What this node is (e.g. "OR", or the term for a leaf).
+    std::string label;
+
+    /// The number of calls to next().
+    totlen_t nexts;
+
+    /// The number of calls to skip_to().
+    totlen_t skip_tos;
+
+    /// The number of calls to check().
+    totlen_t checks;
+
+    /// The number of calls to get_weight() (i.e. documents scored).
+    totlen_t weights;
+
+    /// The number of postings decoded (only counted for leaf nodes).
+    totlen_t postings;
+
+    /// The number of chunks read (only counted for leaf nodes).
+    totlen_t chunks;
+
+    /// The number of blocks loaded (only counted for leaf nodes).
+    totlen_t blocks;
+
+    /// Time spent in calls to this node (including its children), in seconds.
+    double time;
+
+    /// Descriptions of what this node was replaced with by pruning.
+    std::vector<std::string> prunes;
+
+    /// The nodes this node was built from.
+    std::vector<ProfileNode *> children;
+
+    explicit ProfileNode(const std::string & label_)
+	: label(label_), nexts(0), skip_tos(0), checks(0), weights(0),
+	  postings(0), chunks(0), blocks(0), time(0.0) { }
+};
+
+/** Profile of the postlist trees built for a match.
+ *
+ *  Each postlist in the tree is wrapped in a ProfilePostList which counts
+ *  the calls made to it and the time they take.
+ */
+class MatchProfile {
+    /// Don't allow assignment.
+    void operator=(const MatchProfile &);
+
+    /// Don't allow copying.
+    MatchProfile(const MatchProfile &);
+
+    /// All the nodes, which we own.
+    std::vector<ProfileNode *> nodes;
+
+    /// The nodes for the root of each sub-database's tree.
+    std::vector<ProfileNode *> roots;
+
+    /// The node for each ProfilePostList we've created.
+    std::map<const PostList *, ProfileNode *> wrappers;
+
+    /// Append a description of @a node and its children to @a desc.
+    static void describe(const ProfileNode & node, const std::string & indent,
+			 std::string & desc);
+
+  public:
+    MatchProfile() { }
+
+    ~MatchProfile();
+
+    /** Wrap @a pl in a ProfilePostList.
+     *
+     *  @param pl		The postlist to profile (ownership is taken).
+     *  @param label		What @a pl is.
+     *  @param matcher		The matcher, so pruning can be reported.
+     *  @param children_begin	Start of the postlists @a pl was built from.
+     *				Any of these which were wrapped by this method
+     *				become children of the new node.
+     *  @param children_end	End of the postlists @a pl was built from.
+     */
+    PostList * wrap(PostList * pl, const std::string & label,
+		    MultiMatch * matcher,
+		    PostList * const * children_begin,
+		    PostList * const * children_end);
+
+    /** Wrap the postlist tree for sub-database @a shard.
+     *
+     *  This adds a node for the sub-database to the top level of the
+     *  profile.
+     */
+    PostList * wrap_root(PostList * pl, size_t shard, MultiMatch * matcher);
+
+    /// Return a description of the profile, one node per line.
+    std::string get_description() const;
+};
+
+#endif // XAPIAN_INCLUDED_MATCHPROFILE_H
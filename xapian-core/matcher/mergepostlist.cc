@@ -158,6 +158,14 @@ MergePostList::get_collapse_key() const
     return plists[current]->get_collapse_key();
 }
 
+const string *
+MergePostList::get_sort_key() const
+{
+    LOGCALL(MATCH, const string *, "MergePostList::get_sort_key", NO_ARGS);
+    Assert(current != -1);
+    return plists[current]->get_sort_key();
+}
+
 double
 MergePostList::get_maxweight() const
 {
@@ -69,6 +69,7 @@ class MergePostList : public PostList {
 	Xapian::docid  get_docid() const;
 	double get_weight() const;
 	const string * get_collapse_key() const;
+	const string * get_sort_key() const;
 
 	double get_maxweight() const;
 
@@ -32,13 +32,19 @@
 #include "debuglog.h"
 #include "submatch.h"
 #include "localsubmatch.h"
+#include "matchprofile.h"
 #include "omassert.h"
 #include "api/omenquireinternal.h"
+#include "api/queryinternal.h"
+#include "mutexlock.h"
 #include "realtime.h"
+#include "workerthreads.h"
 
 #include "api/emptypostlist.h"
 #include "branchpostlist.h"
+#include "docidrangepostlist.h"
 #include "mergepostlist.h"
+#include "msetpostlist.h"
 
 #include "backends/document.h"
 
@@ -49,6 +55,7 @@
 
 #include <xapian/errorhandler.h>
 #include <xapian/matchspy.h>
+#include <xapian/postingsource.h>
 #include <xapian/version.h> // For XAPIAN_HAS_REMOTE_BACKEND
 
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
@@ -184,6 +191,77 @@ split_rset_by_db(const Xapian::RSet * rset,
     Assert(subrsets.size() == number_of_subdbs);
 }
 
+/// Task which fetches the statistics for a local SubMatch.
+class PrepareTask : public WorkerTask {
+    /// The SubMatch.
+    SubMatch * submatch;
+
+  public:
+    /// The index of the SubMatch.
+    size_t leaf;
+
+    /// The statistics for just this SubMatch.
+    Xapian::Weight::Internal stats;
+
+    /** Constructor.
+     *
+     *  @param wanted  Statistics object listing the terms wanted.
+     */
+    PrepareTask(size_t leaf_, SubMatch * submatch_,
+		const Xapian::Weight::Internal & wanted)
+	: submatch(submatch_), leaf(leaf_)
+    {
+	map<string, TermFreqs>::const_iterator t;
+	for (t = wanted.termfreqs.begin(); t != wanted.termfreqs.end(); ++t) {
+	    stats.termfreqs.insert(make_pair(t->first, TermFreqs()));
+	}
+    }
+
+    void run() {
+	(void)submatch->prepare_match(false, stats);
+    }
+};
+
+/** Count the local sub-databases of @a db, if they can be used from
+ *  different threads at once.
+ *
+ *  Xapian objects aren't shared between threads, so none of the local
+ *  sub-databases can appear more than once - if one does, 0 is returned.
+ */
+static size_t
+count_threadable_subdbs(const Xapian::Database & db,
+			const vector<bool> & is_remote)
+{
+    set<const Xapian::Database::Internal *> seen;
+    for (size_t i = 0; i != db.internal.size(); ++i) {
+	if (is_remote[i]) continue;
+	if (!seen.insert(db.internal[i].get()).second) return 0;
+    }
+    return seen.size();
+}
+
+/** Check if any PostingSource objects in @a query can be cloned.
+ *
+ *  When matching on several threads, each needs its own clone.
+ */
+static bool
+posting_sources_clonable(const Xapian::Query & query)
+{
+    if (query.get_type() == Xapian::Query::LEAF_POSTING_SOURCE) {
+	using Xapian::Internal::QueryPostingSource;
+	const QueryPostingSource * q =
+	    static_cast<const QueryPostingSource *>(query.internal.get());
+	Xapian::PostingSource * clone = q->get_posting_source()->clone();
+	if (!clone) return false;
+	delete clone;
+	return true;
+    }
+    for (size_t i = 0; i != query.get_num_subqueries(); ++i) {
+	if (!posting_sources_clonable(query.get_subquery(i))) return false;
+    }
+    return true;
+}
+
 /** Prepare some SubMatches.
  *
  *  This calls the prepare_match() method on each SubMatch object, causing them
@@ -201,17 +279,51 @@ split_rset_by_db(const Xapian::RSet * rset,
  *  searches - the local searchers will all fetch their statistics from disk
  *  without waiting for the remote searchers, so as soon as the remote searcher
  *  statistics arrive, we can move on to the next step.
+ *
+ *  If max_threads is more than 1, the statistics for the local SubMatches are
+ *  fetched concurrently first.
  */
 static void
 prepare_sub_matches(vector<intrusive_ptr<SubMatch> > & leaves,
+		    const vector<bool> & is_remote,
+		    unsigned max_threads,
 		    Xapian::ErrorHandler * errorhandler,
 		    Xapian::Weight::Internal & stats)
 {
-    LOGCALL_STATIC_VOID(MATCH, "prepare_sub_matches", leaves | errorhandler | stats);
+    LOGCALL_STATIC_VOID(MATCH, "prepare_sub_matches", leaves | is_remote | max_threads | errorhandler | stats);
     // We use a vector<bool> to track which SubMatches we're already prepared.
     vector<bool> prepared;
     prepared.resize(leaves.size(), false);
     size_t unprepared = leaves.size();
+    if (max_threads > 1) {
+	vector<PrepareTask> tasks;
+	tasks.reserve(leaves.size());
+	for (size_t leaf = 0; leaf < leaves.size(); ++leaf) {
+	    if (is_remote[leaf] || !leaves[leaf].get()) continue;
+	    tasks.push_back(PrepareTask(leaf, leaves[leaf].get(), stats));
+	}
+	WorkerThreads workers;
+	for (size_t i = 0; i < tasks.size(); ++i) {
+	    workers.add(&tasks[i]);
+	}
+	workers.run_and_wait(max_threads);
+	for (size_t i = 0; i < tasks.size(); ++i) {
+	    size_t leaf = tasks[i].leaf;
+	    try {
+		tasks[i].rethrow();
+		stats += tasks[i].stats;
+	    } catch (Xapian::Error & e) {
+		if (!errorhandler) throw;
+
+		LOGLINE(EXCEPTION, "Calling error handler for prepare_match() on a SubMatch.");
+		(*errorhandler)(e);
+		// Continue match without this sub-match.
+		leaves[leaf] = NULL;
+	    }
+	    prepared[leaf] = true;
+	    --unprepared;
+	}
+    }
     bool nowait = true;
     while (unprepared) {
 	for (size_t leaf = 0; leaf < leaves.size(); ++leaf) {
@@ -265,12 +377,104 @@ MultipleMatchSpy::operator()(const Xapian::Document &doc, double wt) {
     }
 }
 
+/// The minimum weight, shared between matches running on different threads.
+class SharedMinWeight {
+    Mutex mutex;
+
+    double min_weight;
+
+  public:
+    SharedMinWeight() : min_weight(0.0) { }
+
+    double get() {
+	MutexLock lock(mutex);
+	return min_weight;
+    }
+
+    void raise(double w) {
+	MutexLock lock(mutex);
+	if (w > min_weight) min_weight = w;
+    }
+};
+
+/** How many candidates to consider between checks of the shared minimum
+ *  weight.
+ *
+ *  Checking involves locking a mutex, so we don't want to do it for every
+ *  candidate.
+ */
+const unsigned SHARED_MIN_WEIGHT_INTERVAL = 64;
+
+/// Task which matches one local sub-database of a parallel match.
+class ShardMatch : public WorkerTask {
+    /// Don't allow assignment.
+    void operator=(const ShardMatch &);
+
+    /// Don't allow copying.
+    ShardMatch(const ShardMatch &);
+
+  public:
+    /// The index of the sub-database.
+    size_t shard;
+
+    /// Clones of the matchspies in use, for this match to feed.
+    vector<Xapian::MatchSpy *> spies;
+
+    /// The statistics (a copy, as building the postlists updates them).
+    Xapian::Weight::Internal stats;
+
+    /// The matcher for this sub-database.
+    AutoPtr<MultiMatch> match;
+
+    Xapian::doccount maxitems, check_at_least;
+
+    const Xapian::MatchDecider * mdecider;
+
+    const Xapian::KeyMaker * sorter;
+
+    /// The result of the match.
+    Xapian::MSet mset;
+
+    ShardMatch(size_t shard_,
+	       const Xapian::Weight::Internal & stats_,
+	       Xapian::doccount maxitems_,
+	       Xapian::doccount check_at_least_,
+	       const Xapian::MatchDecider * mdecider_,
+	       const Xapian::KeyMaker * sorter_)
+	: shard(shard_), stats(stats_),
+	  maxitems(maxitems_), check_at_least(check_at_least_),
+	  mdecider(mdecider_), sorter(sorter_) { }
+
+    ~ShardMatch() {
+	// The matcher refers to the spies, so must go first.
+	match.reset(NULL);
+	for (size_t i = 0; i != spies.size(); ++i) {
+	    delete spies[i];
+	}
+    }
+
+    void run() {
+	match->get_mset(0, maxitems, check_at_least, mset, stats,
+			mdecider, sorter);
+    }
+};
+
+/// The ShardMatch objects for a parallel match.
+class ShardMatches : public vector<ShardMatch *> {
+  public:
+    ~ShardMatches() {
+	for (size_t i = 0; i != size(); ++i) {
+	    delete (*this)[i];
+	}
+    }
+};
+
 ////////////////////////////////////
 // Initialisation and cleaning up //
 ////////////////////////////////////
 MultiMatch::MultiMatch(const Xapian::Database &db_,
 		       const Xapian::Query & query_,
-		       Xapian::termcount qlen,
+		       Xapian::termcount qlen_,
 		       const Xapian::RSet * omrset,
 		       Xapian::doccount collapse_max_,
 		       Xapian::valueno collapse_key_,
@@ -284,8 +488,9 @@ MultiMatch::MultiMatch(const Xapian::Database &db_,
 		       Xapian::Weight::Internal & stats,
 		       const Xapian::Weight * weight_,
 		       const vector<Xapian::MatchSpy *> & matchspies_,
-		       bool have_sorter, bool have_mdecider)
-	: db(db_), query(query_),
+		       bool have_sorter, bool have_mdecider,
+		       unsigned parallelism_, MatchProfile * profile_)
+	: db(db_), query(query_), qlen(qlen_),
 	  collapse_max(collapse_max_), collapse_key(collapse_key_),
 	  percent_cutoff(percent_cutoff_), weight_cutoff(weight_cutoff_),
 	  order(order_),
@@ -294,9 +499,12 @@ MultiMatch::MultiMatch(const Xapian::Database &db_,
 	  time_limit(time_limit_),
 	  errorhandler(errorhandler_), weight(weight_),
 	  is_remote(db.internal.size()),
+	  parallelism(parallelism_), shared_min_weight(NULL),
+	  range_first(0), range_last(0),
+	  full_termfreq_min(0), full_termfreq_max(0), profile(profile_),
 	  matchspies(matchspies_)
 {
-    LOGCALL_CTOR(MATCH, "MultiMatch", db_ | query_ | qlen | omrset | collapse_max_ | collapse_key_ | percent_cutoff_ | weight_cutoff_ | int(order_) | sort_key_ | int(sort_by_) | sort_value_forward_ | time_limit_| errorhandler_ | stats | weight_ | matchspies_ | have_sorter | have_mdecider);
+    LOGCALL_CTOR(MATCH, "MultiMatch", db_ | query_ | qlen_ | omrset | collapse_max_ | collapse_key_ | percent_cutoff_ | weight_cutoff_ | int(order_) | sort_key_ | int(sort_by_) | sort_value_forward_ | time_limit_| errorhandler_ | stats | weight_ | matchspies_ | have_sorter | have_mdecider | parallelism_ | profile_);
 
     if (query.empty()) return;
 
@@ -349,11 +557,241 @@ MultiMatch::MultiMatch(const Xapian::Database &db_,
 	leaves.push_back(smatch);
     }
 
+    unsigned prepare_threads = parallelism;
+    if (count_threadable_subdbs(db, is_remote) < 2) prepare_threads = 1;
+
     stats.mark_wanted_terms(query);
-    prepare_sub_matches(leaves, errorhandler, stats);
+    prepare_sub_matches(leaves, is_remote, prepare_threads, errorhandler,
+			stats);
     stats.set_bounds_from_db(db);
 }
 
+MultiMatch::MultiMatch(const MultiMatch & parent,
+		       const Xapian::Database & db_,
+		       const intrusive_ptr<SubMatch> & leaf,
+		       const vector<Xapian::MatchSpy *> & matchspies_)
+	: db(db_), query(parent.query), qlen(parent.qlen),
+	  collapse_max(parent.collapse_max), collapse_key(parent.collapse_key),
+	  percent_cutoff(parent.percent_cutoff),
+	  weight_cutoff(parent.weight_cutoff),
+	  order(parent.order),
+	  sort_key(parent.sort_key), sort_by(parent.sort_by),
+	  sort_value_forward(parent.sort_value_forward),
+	  time_limit(parent.time_limit),
+	  errorhandler(NULL), weight(parent.weight),
+	  is_remote(1),
+	  parallelism(1), shared_min_weight(NULL),
+	  range_first(0), range_last(0),
+	  full_termfreq_min(0), full_termfreq_max(0), profile(NULL),
+	  matchspies(matchspies_)
+{
+    LOGCALL_CTOR(MATCH, "MultiMatch", Literal("parent") | db_ | Literal("leaf") | matchspies_);
+    leaves.push_back(leaf);
+}
+
+/** Combine the MSets from matching docid ranges of one sub-database.
+ *
+ *  The ranges don't overlap, so this just needs to put all the items in
+ *  order and add up the counts.  A range which didn't see all its matches
+ *  only has loose bounds on them, so the totals are clamped to the bounds
+ *  for the whole sub-database (@a tf_min is 0 if a match decider or
+ *  percentage cutoff means those don't give a lower bound).
+ */
+static Xapian::MSet
+merge_range_msets(const vector<Xapian::MSet> & msets, const MSetCmp & mcmp,
+		  Xapian::doccount tf_min, Xapian::doccount tf_max,
+		  bool collapsing)
+{
+    vector<Xapian::Internal::MSetItem> items;
+    Xapian::doccount lower = 0, est = 0, upper = 0;
+    Xapian::doccount uncollapsed_lower = 0, uncollapsed_est = 0;
+    Xapian::doccount uncollapsed_upper = 0;
+    double max_possible = 0, max_attained = 0, percent_factor = 0;
+    for (size_t i = 0; i != msets.size(); ++i) {
+	const Xapian::MSet::Internal & r = *msets[i].internal;
+	items.insert(items.end(), r.items.begin(), r.items.end());
+	lower += r.matches_lower_bound;
+	est += r.matches_estimated;
+	upper += r.matches_upper_bound;
+	uncollapsed_lower += r.uncollapsed_lower_bound;
+	uncollapsed_est += r.uncollapsed_estimated;
+	uncollapsed_upper += r.uncollapsed_upper_bound;
+	max_possible = max(max_possible, r.max_possible);
+	if (i == 0 || r.max_attained > max_attained) {
+	    max_attained = r.max_attained;
+	    percent_factor = r.percent_factor;
+	}
+    }
+
+    upper = min(upper, tf_max);
+    uncollapsed_upper = min(uncollapsed_upper, tf_max);
+    uncollapsed_lower = max(uncollapsed_lower, tf_min);
+    // Collapsing can reduce the number of matches below tf_min.
+    if (!collapsing) lower = max(lower, tf_min);
+    est = max(min(est, upper), lower);
+    uncollapsed_est = max(min(uncollapsed_est, uncollapsed_upper),
+			  uncollapsed_lower);
+
+    sort(items.begin(), items.end(), mcmp);
+    return Xapian::MSet(new Xapian::MSet::Internal(0,
+						   upper, lower, est,
+						   uncollapsed_upper,
+						   uncollapsed_lower,
+						   uncollapsed_est,
+						   max_possible, max_attained,
+						   items, percent_factor));
+}
+
+void
+MultiMatch::match_in_parallel(Xapian::doccount maxitems,
+			      Xapian::doccount check_at_least,
+			      Xapian::Weight::Internal & stats,
+			      const Xapian::MatchDecider * mdecider,
+			      const Xapian::KeyMaker * sorter)
+{
+    LOGCALL_VOID(MATCH, "MultiMatch::match_in_parallel", maxitems | check_at_least | stats | Literal("mdecider") | Literal("sorter"));
+    if (!posting_sources_clonable(query)) {
+	LOGLINE(MATCH, "PostingSource can't be cloned - not matching in parallel");
+	return;
+    }
+
+    size_t n_local = count_threadable_subdbs(db, is_remote);
+    if (n_local == 0) {
+	LOGLINE(MATCH, "Sub-database used more than once - not matching in parallel");
+	return;
+    }
+
+    // If there are more threads than local sub-databases, split each into
+    // docid ranges which are matched separately.
+    Xapian::doccount ranges_per_shard = max(size_t(1), parallelism / n_local);
+    if (n_local == 1 && ranges_per_shard == 1) return;
+
+    // The bounds are looked up from the combined database, which the
+    // threads can't share.
+    stats.cache_bounds();
+
+    ShardMatches shards;
+    for (size_t i = 0; i != leaves.size(); ++i) {
+	if (is_remote[i] || !leaves[i].get()) continue;
+	Xapian::Database::Internal * subdb = db.internal[i].get();
+
+	// Each docid range after the first needs its own instance of the
+	// database, since the same one can't be used from several threads.
+	vector<intrusive_ptr<Xapian::Database::Internal> > instances;
+	instances.push_back(subdb);
+	Xapian::docid db_last = subdb->get_lastdocid();
+	while (instances.size() < min(ranges_per_shard, db_last)) {
+	    Xapian::Database::Internal * another =
+		subdb->get_another_instance(instances.size() - 1);
+	    if (!another) break;
+	    instances.push_back(another);
+	}
+
+	Xapian::doccount n_ranges = instances.size();
+	Xapian::docid range_size = db_last / n_ranges;
+	for (Xapian::doccount r = 0; r != n_ranges; ++r) {
+	    shards.push_back(new ShardMatch(i, stats, maxitems, check_at_least,
+					   mdecider, sorter));
+	    ShardMatch & shard = *shards.back();
+	    vector<Xapian::MatchSpy *>::const_iterator j;
+	    for (j = matchspies.begin(); j != matchspies.end(); ++j) {
+		try {
+		    shard.spies.push_back((*j)->clone());
+		} catch (const Xapian::UnimplementedError &) {
+		    LOGLINE(MATCH, "MatchSpy can't be cloned - not matching in parallel");
+		    return;
+		}
+	    }
+	    if (n_ranges == 1) {
+		shard.match.reset(new MultiMatch(*this, Xapian::Database(subdb),
+						 leaves[i], shard.spies));
+		continue;
+	    }
+	    intrusive_ptr<SubMatch> leaf = leaves[i];
+	    if (r != 0) {
+		leaf = new LocalSubMatch(instances[r].get(), query, qlen,
+					 Xapian::RSet(), weight);
+	    }
+	    shard.match.reset(new MultiMatch(*this,
+					     Xapian::Database(instances[r].get()),
+					     leaf, shard.spies));
+	    shard.match->range_first = r * range_size + 1;
+	    shard.match->range_last =
+		(r + 1 == n_ranges) ? db_last : (r + 1) * range_size;
+	}
+    }
+
+    // The minimum weight found by one match is valid for the others if we're
+    // sorting primarily by relevance, but not if collapsing or using a
+    // percentage cutoff, since those make which documents are wanted depend
+    // on other documents.
+    SharedMinWeight shared;
+    if ((sort_by == REL || sort_by == REL_VAL) &&
+	collapse_max == 0 && percent_cutoff == 0) {
+	for (size_t i = 0; i != shards.size(); ++i) {
+	    shards[i]->match->shared_min_weight = &shared;
+	}
+    }
+
+    WorkerThreads workers;
+    for (size_t i = 0; i != shards.size(); ++i) {
+	workers.add(shards[i]);
+    }
+    workers.run_and_wait(parallelism);
+
+    bool sort_forward = (order != Xapian::Enquire::DESCENDING);
+    MSetCmp mcmp(get_msetcmp_function(sort_by, sort_forward,
+				      sort_value_forward));
+    shard_msets.resize(leaves.size());
+    size_t i = 0;
+    while (i != shards.size()) {
+	// The ShardMatch objects for the docid ranges of a sub-database are
+	// adjacent.
+	size_t shard_no = shards[i]->shard;
+	size_t end = i + 1;
+	while (end != shards.size() && shards[end]->shard == shard_no) ++end;
+	matched_separately[shard_no] = true;
+	try {
+	    for (size_t k = i; k != end; ++k) {
+		shards[k]->rethrow();
+	    }
+	} catch (Xapian::Error & e) {
+	    i = end;
+	    if (!errorhandler) throw;
+	    LOGLINE(EXCEPTION, "Calling error handler for a parallel match "
+			       "of a SubMatch.");
+	    (*errorhandler)(e);
+	    // Continue match without this sub-match.
+	    leaves[shard_no] = NULL;
+	    continue;
+	}
+	if (end - i == 1) {
+	    shard_msets[shard_no] = shards[i]->mset;
+	} else {
+	    vector<Xapian::MSet> range_msets;
+	    for (size_t k = i; k != end; ++k) {
+		range_msets.push_back(shards[k]->mset);
+	    }
+	    const MultiMatch & range_match = *shards[i]->match;
+	    Xapian::doccount tf_min = range_match.full_termfreq_min;
+	    if (mdecider || percent_cutoff) tf_min = 0;
+	    shard_msets[shard_no] =
+		merge_range_msets(range_msets, mcmp, tf_min,
+				  range_match.full_termfreq_max,
+				  collapse_max != 0);
+	}
+	// Every docid range of a sub-database has the same maximum weight
+	// parts, so only add them once.
+	stats.add_max_parts(shards[i]->stats);
+	for (; i != end; ++i) {
+	    for (size_t j = 0; j != matchspies.size(); ++j) {
+		const Xapian::MatchSpy * spy = shards[i]->spies[j];
+		matchspies[j]->merge_results(spy->serialise_results());
+	    }
+	}
+    }
+}
+
 double
 MultiMatch::getorrecalc_maxweight(PostList *pl)
 {
@@ -424,6 +862,14 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 	}
     }
 
+    matched_separately = is_remote;
+    // The profile isn't shared between threads, so don't match in parallel
+    // when profiling.
+    if (parallelism > 1 && check_at_least != 0 && !profile) {
+	match_in_parallel(first + maxitems, first + check_at_least, stats,
+			  mdecider, sorter);
+    }
+
     // Get postlists and term info
     vector<PostList *> postlists;
     Xapian::termcount total_subqs = 0;
@@ -435,15 +881,29 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
     for (size_t i = 0; i != leaves.size(); ++i) {
 	PostList *pl;
 	try {
-	    pl = leaves[i]->get_postlist(this, &total_subqs);
-	    if (is_remote[i]) {
-		if (pl->get_termfreq_min() > first + maxitems) {
+	    if (matched_separately[i] && !is_remote[i]) {
+		bool decreasing_relevance =
+		    (sort_by == REL || sort_by == REL_VAL);
+		pl = new MSetPostList(shard_msets[i], decreasing_relevance,
+				      true);
+	    } else {
+		pl = leaves[i]->get_postlist(this, &total_subqs);
+		if (profile && !is_remote[i])
+		    pl = profile->wrap_root(pl, i, this);
+	    }
+	    if (matched_separately[i]) {
+		// The separate match passes on at most first + maxitems
+		// matches, except that combining the matches from docid
+		// ranges of a local sub-database may give more.
+		Xapian::doccount passed = first + maxitems;
+		if (!is_remote[i]) passed = shard_msets[i].size();
+		if (pl->get_termfreq_min() > passed) {
 		    LOGLINE(MATCH, "Found " <<
-				   pl->get_termfreq_min() - (first + maxitems)
-				   << " definite matches in remote submatch "
+				   pl->get_termfreq_min() - passed
+				   << " definite matches in separate submatch "
 				   "which aren't passed to local match");
 		    definite_matches_not_seen += pl->get_termfreq_min();
-		    definite_matches_not_seen -= first + maxitems;
+		    definite_matches_not_seen -= passed;
 		}
 	    }
 	} catch (Xapian::Error & e) {
@@ -460,6 +920,16 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
     }
     Assert(!postlists.empty());
 
+    if (range_last) {
+	// We're matching one docid range of a sub-database.
+	AssertEq(postlists.size(), 1);
+	full_termfreq_min = postlists[0]->get_termfreq_min();
+	full_termfreq_max = postlists[0]->get_termfreq_max();
+	postlists[0] = new DocidRangePostList(postlists[0],
+					      range_first, range_last,
+					      db.get_lastdocid(), this);
+    }
+
     ValueStreamDocument vsdoc(db);
     ++vsdoc._refs;
     Xapian::Document doc(&vsdoc);
@@ -478,9 +948,7 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
     Xapian::doccount docs_matched = 0;
     double greatest_wt = 0;
     Xapian::termcount greatest_wt_subqs_matched = 0;
-#ifdef XAPIAN_HAS_REMOTE_BACKEND
     unsigned greatest_wt_subqs_db_num = UINT_MAX;
-#endif
     vector<Xapian::Internal::MSetItem> items;
 
     // maximum weight a document could possibly have
@@ -563,6 +1031,9 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
     // Object to handle collapsing.
     Collapser collapser(collapse_key, collapse_max);
 
+    // Buffer for sort keys which the value stream can't reference.
+    string sort_key_buf;
+
     /// Comparison functor for sorting MSet
     bool sort_forward = (order != Xapian::Enquire::DESCENDING);
     MSetCmp mcmp(get_msetcmp_function(sort_by, sort_forward, sort_value_forward));
@@ -582,6 +1053,12 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
     // Is the mset a valid heap?
     bool is_heap = false;
 
+    // Has min_weight been raised using the minimum weight shared with matches
+    // on other threads?  If so, we may not see all the matches, even if we
+    // don't fill the proto-mset.
+    bool used_shared_min_weight = false;
+    unsigned until_shared_check = SHARED_MIN_WEIGHT_INTERVAL;
+
     while (true) {
 	bool pushback;
 
@@ -594,6 +1071,24 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 	    }
 	}
 
+	// Only use the shared minimum weight once we've seen check_at_least
+	// matches, like we do when raising min_weight ourselves.
+	if (shared_min_weight && docs_matched >= check_at_least &&
+	    --until_shared_check == 0) {
+	    until_shared_check = SHARED_MIN_WEIGHT_INTERVAL;
+	    double shared_wt = shared_min_weight->get();
+	    if (shared_wt > min_weight) {
+		LOGLINE(MATCH, "Setting min_weight to " << shared_wt <<
+			" from " << min_weight << " (shared)");
+		min_weight = shared_wt;
+		used_shared_min_weight = true;
+		if (rare(getorrecalc_maxweight(pl.get()) < min_weight)) {
+		    LOGLINE(MATCH, "*** TERMINATING EARLY (4)");
+		    break;
+		}
+	    }
+	}
+
 	PostList * pl_copy = pl.get();
 	if (rare(next_handling_prune(pl_copy, min_weight, this))) {
 	    (void)pl.release();
@@ -639,10 +1134,16 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 	}
 
 	if (sort_by != REL) {
-	    if (sorter) {
+	    // If the key is known (e.g. from a separately matched MSet), use
+	    // it - the documents aren't in docid order then, so we can't read
+	    // values from vsdoc.
+	    const string * key = pl->get_sort_key();
+	    if (key) {
+		new_item.sort_key = *key;
+	    } else if (sorter) {
 		new_item.sort_key = (*sorter)(doc);
 	    } else {
-		new_item.sort_key = vsdoc.get_value(sort_key);
+		new_item.sort_key = vsdoc.get_value_ref(sort_key, sort_key_buf);
 	    }
 
 	    // We're sorting by value (in part at least), so compare the item
@@ -657,7 +1158,13 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 		    ++docs_matched;
 		    if (!calculated_weight) wt = pl->get_weight();
 		    if (matchspy) {
-			matchspy->operator()(doc, wt);
+			const unsigned int multiplier = db.internal.size();
+			Xapian::doccount n = (did - 1) % multiplier;
+			// The spy has already seen documents from a remote
+			// database or a separate match.
+			if (!matched_separately[n]) {
+			    matchspy->operator()(doc, wt);
+			}
 		    }
 		    if (wt > greatest_wt) goto new_greatest_weight;
 		    continue;
@@ -682,9 +1189,10 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 	    const unsigned int multiplier = db.internal.size();
 	    Assert(multiplier != 0);
 	    Xapian::doccount n = (did - 1) % multiplier; // which actual database
-	    // If the results are from a remote database, then the functor will
-	    // already have been applied there so we can skip this step.
-	    if (!is_remote[n]) {
+	    // If the results are from a remote database or a separate match,
+	    // then the functor will already have been applied there so we can
+	    // skip this step.
+	    if (!matched_separately[n]) {
 		++decider_considered;
 		if (mdecider && !mdecider->operator()(doc)) {
 		    ++decider_denied;
@@ -796,6 +1304,8 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 			    LOGLINE(MATCH, "Setting min_weight to " <<
 				    min_item.wt << " from " << min_weight);
 			    min_weight = min_item.wt;
+			    if (shared_min_weight)
+				shared_min_weight->raise(min_weight);
 			}
 		    }
 		}
@@ -828,20 +1338,15 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 	if (wt > greatest_wt) {
 new_greatest_weight:
 	    greatest_wt = wt;
-#ifdef XAPIAN_HAS_REMOTE_BACKEND
 	    const unsigned int multiplier = db.internal.size();
 	    unsigned int db_num = (did - 1) % multiplier;
-	    if (is_remote[db_num]) {
+	    if (matched_separately[db_num]) {
 		// Note that the greatest weighted document came from a remote
-		// database, and which one.
+		// database or a separate match, and which one.
 		greatest_wt_subqs_db_num = db_num;
-	    } else
-#endif
-	    {
+	    } else {
 		greatest_wt_subqs_matched = pl->count_matching_subqs();
-#ifdef XAPIAN_HAS_REMOTE_BACKEND
 		greatest_wt_subqs_db_num = UINT_MAX;
-#endif
 	    }
 	    if (percent_cutoff) {
 		double w = wt * percent_cutoff_factor;
@@ -874,15 +1379,19 @@ new_greatest_weight:
 
     double percent_scale = 0;
     if (!items.empty() && greatest_wt > 0) {
-#ifdef XAPIAN_HAS_REMOTE_BACKEND
 	if (greatest_wt_subqs_db_num != UINT_MAX) {
 	    const unsigned int n = greatest_wt_subqs_db_num;
-	    RemoteSubMatch * rem_match;
-	    rem_match = static_cast<RemoteSubMatch*>(leaves[n].get());
-	    percent_scale = rem_match->get_percent_factor() / 100.0;
-	} else
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
+	    if (is_remote[n]) {
+		RemoteSubMatch * rem_match;
+		rem_match = static_cast<RemoteSubMatch*>(leaves[n].get());
+		percent_scale = rem_match->get_percent_factor() / 100.0;
+	    } else
 #endif
-	{
+	    {
+		percent_scale = shard_msets[n].internal->percent_factor / 100.0;
+	    }
+	} else {
 	    percent_scale = greatest_wt_subqs_matched / double(total_subqs);
 	    percent_scale /= greatest_wt;
 	}
@@ -927,7 +1436,7 @@ new_greatest_weight:
     Xapian::doccount uncollapsed_lower_bound = matches_lower_bound;
     Xapian::doccount uncollapsed_upper_bound = matches_upper_bound;
     Xapian::doccount uncollapsed_estimated = matches_estimated;
-    if (items.size() < max_msize) {
+    if (items.size() < max_msize && !used_shared_min_weight) {
 	// We have fewer items in the mset than we tried to get for it, so we
 	// must have all the matches in it.
 	LOGLINE(MATCH, "items.size() = " << items.size() <<
@@ -938,7 +1447,8 @@ new_greatest_weight:
 	    = items.size();
 	if (collapser && matches_lower_bound > uncollapsed_lower_bound)
 	    uncollapsed_lower_bound = matches_lower_bound;
-    } else if (!collapser && docs_matched < check_at_least) {
+    } else if (!collapser && docs_matched < check_at_least &&
+	       !used_shared_min_weight) {
 	// We have seen fewer matches than we checked for, so we must have seen
 	// all the matches.
 	LOGLINE(MATCH, "Setting bounds equal");
@@ -31,6 +31,9 @@
 #include "xapian/query.h"
 #include "xapian/weight.h"
 
+class MatchProfile;
+class SharedMinWeight;
+
 class MultiMatch
 {
     private:
@@ -41,6 +44,8 @@ class MultiMatch
 
 	Xapian::Query query;
 
+	Xapian::termcount qlen;
+
 	Xapian::doccount collapse_max;
 
 	Xapian::valueno collapse_key;
@@ -73,6 +78,42 @@ class MultiMatch
 	/** Is each sub-database remote? */
 	vector<bool> is_remote;
 
+	/** Is each sub-database matched separately?
+	 *
+	 *  This is true for remote sub-databases, and for local sub-databases
+	 *  which we've matched on a thread of their own.  The results of these
+	 *  are merged in from an MSet, and the matchspies and match decider
+	 *  have already been applied to them.
+	 */
+	vector<bool> matched_separately;
+
+	/// The MSets from local sub-databases matched on threads of their own.
+	vector<Xapian::MSet> shard_msets;
+
+	/// The maximum number of threads to use.
+	unsigned parallelism;
+
+	/** The minimum weight shared with matches on other threads.
+	 *
+	 *  NULL unless this is matching one sub-database of a parallel match.
+	 */
+	SharedMinWeight * shared_min_weight;
+
+	/** The range of docids to match, if this is matching part of a
+	 *  database for a parallel match (range_last is 0 otherwise).
+	 */
+	Xapian::docid range_first, range_last;
+
+	/** Bounds on the number of matches in the whole sub-database.
+	 *
+	 *  Set by get_mset() when matching a docid range, so the counts
+	 *  from the ranges can be clamped when they're combined.
+	 */
+	Xapian::doccount full_termfreq_min, full_termfreq_max;
+
+	/// The profile to record, or NULL if we're not profiling.
+	MatchProfile * profile;
+
 	/// The matchspies to use.
 	const vector<Xapian::MatchSpy *> & matchspies;
 
@@ -82,6 +123,33 @@ class MultiMatch
 	 */
 	double getorrecalc_maxweight(PostList *pl);
 
+	/** Match the local sub-databases on threads of their own.
+	 *
+	 *  If there are more threads available than local sub-databases, the
+	 *  sub-databases are also split into docid ranges, each matched on a
+	 *  thread of its own.
+	 *
+	 *  Sets matched_separately and shard_msets for the sub-databases
+	 *  matched.  If the match can't be done in parallel, nothing is done.
+	 */
+	void match_in_parallel(Xapian::doccount maxitems,
+			       Xapian::doccount check_at_least,
+			       Xapian::Weight::Internal & stats,
+			       const Xapian::MatchDecider * mdecider,
+			       const Xapian::KeyMaker * sorter);
+
+	/** Construct a MultiMatch for part of a parallel match by @a parent.
+	 *
+	 *  The statistics must already have been gathered.
+	 *
+	 *  @param db_	The sub-database to match.
+	 *  @param leaf	The SubMatch for @a db_.
+	 *  @param matchspies_ The matchspies for this match to use.
+	 */
+	MultiMatch(const MultiMatch & parent, const Xapian::Database & db_,
+		   const Xapian::Internal::intrusive_ptr<SubMatch> & leaf,
+		   const vector<Xapian::MatchSpy *> & matchspies_);
+
 	/// Copying is not permitted.
 	MultiMatch(const MultiMatch &);
 
@@ -103,6 +171,8 @@ class MultiMatch
 	 *  @param matchspies_ Any the MatchSpy objects in use.
 	 *  @param have_sorter Is there a sorter in use?
 	 *  @param have_mdecider Is there a Xapian::MatchDecider in use?
+	 *  @param parallelism_ The maximum number of threads to use.
+	 *  @param profile_ The profile to record (or NULL to not profile).
 	 */
 	MultiMatch(const Xapian::Database &db_,
 		   const Xapian::Query & query,
@@ -121,7 +191,8 @@ class MultiMatch
 		   Xapian::Weight::Internal & stats,
 		   const Xapian::Weight *wtscheme,
 		   const vector<Xapian::MatchSpy *> & matchspies_,
-		   bool have_sorter, bool have_mdecider);
+		   bool have_sorter, bool have_mdecider,
+		   unsigned parallelism_, MatchProfile * profile_);
 
 	/** Run the match and generate an MSet object.
 	 *
@@ -141,6 +212,9 @@ class MultiMatch
 	void recalc_maxweight() {
 	    recalculate_w_max = true;
 	}
+
+	/// The profile to record, or NULL if we're not profiling.
+	MatchProfile * get_profile() const { return profile; }
 };
 
 #endif /* OM_HGUARD_MULTIMATCH_H */
@@ -0,0 +1,392 @@
+/** @file multiorpostlist.cc
+ * @brief N-way OR postlist with MaxScore pruning
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "multiorpostlist.h"
+
+#include "debuglog.h"
+#include "multimatch.h"
+#include "omassert.h"
+
+#include <algorithm>
+
+using namespace std;
+
+MultiOrPostList::~MultiOrPostList()
+{
+    if (kids) {
+	for (size_t i = 0; i < n_kids; ++i) {
+	    delete kids[i].pl;
+	}
+	delete [] kids;
+    }
+}
+
+size_t
+MultiOrPostList::count_non_essential(double w_min, double & non_ess_max) const
+{
+    non_ess_max = 0;
+    size_t n = 0;
+    // Always leave at least one essential sub-postlist - if the maximum
+    // weights of all of them sum to less than w_min then nothing can match,
+    // so it doesn't matter which we step through.
+    while (n + 1 < n_kids && non_ess_max + kids[n].max_wt < w_min) {
+	non_ess_max += kids[n].max_wt;
+	++n;
+    }
+    return n;
+}
+
+void
+MultiOrPostList::erase_sublist(size_t n)
+{
+    delete kids[n].pl;
+    --n_kids;
+    for (size_t i = n; i < n_kids; ++i) {
+	kids[i] = kids[i + 1];
+    }
+    // Recalculate the total rather than subtracting, so rounding errors
+    // can't leave it smaller than the sum of the remaining max_wt values.
+    max_total = 0;
+    for (size_t i = 0; i < n_kids; ++i) {
+	max_total += kids[i].max_wt;
+    }
+    if (matcher) matcher->recalc_maxweight();
+}
+
+bool
+MultiOrPostList::advance_sublist(size_t n, Xapian::docid did_min,
+				 double w_min)
+{
+    AssertRel(kids[n].head,<,did_min);
+    PostList * res;
+    if (kids[n].head == did && did_min == did + 1) {
+	res = kids[n].pl->next(new_min(w_min, n));
+    } else {
+	res = kids[n].pl->skip_to(did_min, new_min(w_min, n));
+    }
+    if (res) {
+	delete kids[n].pl;
+	kids[n].pl = res;
+	if (matcher) matcher->recalc_maxweight();
+    }
+
+    if (kids[n].pl->at_end()) {
+	erase_sublist(n);
+	return true;
+    }
+
+    kids[n].head = kids[n].pl->get_docid();
+    return false;
+}
+
+bool
+MultiOrPostList::block_bound_reaches(Xapian::docid candidate,
+				     size_t n_non_ess, double w_min) const
+{
+    double bound = 0;
+    for (size_t i = 0; i < n_kids; ++i) {
+	Xapian::docid head = kids[i].head;
+	if (head == candidate) {
+	    Xapian::docid last;
+	    bound += kids[i].pl->get_block_maxweight(last);
+	} else if (head < candidate && i < n_non_ess) {
+	    // A non-essential sub-postlist which hasn't been advanced to the
+	    // candidate yet - if its current block extends that far, we can
+	    // use the block's bound.
+	    double max_wt = kids[i].max_wt;
+	    if (head) {
+		Xapian::docid last;
+		double block_max = kids[i].pl->get_block_maxweight(last);
+		if (last >= candidate) max_wt = min(max_wt, block_max);
+	    }
+	    bound += max_wt;
+	}
+	// Otherwise the sub-postlist is past the candidate so doesn't match it.
+    }
+    return bound >= w_min;
+}
+
+PostList *
+MultiOrPostList::find_next_match(Xapian::docid did_min, double w_min)
+{
+    while (true) {
+	double non_ess_max;
+	size_t n_non_ess = count_non_essential(w_min, non_ess_max);
+
+	// Advance the essential sub-postlists.  If one runs out, the split
+	// between essential and non-essential may change, so start again.
+	bool erased = false;
+	for (size_t i = n_non_ess; i < n_kids; ++i) {
+	    if (kids[i].head < did_min && advance_sublist(i, did_min, w_min)) {
+		erased = true;
+		break;
+	    }
+	}
+
+	if (n_kids <= 1) {
+	    if (n_kids == 0) {
+		did = 0;
+		return NULL;
+	    }
+	    // Only one sub-postlist left, so replace ourselves with it.
+	    if (kids[0].head < did_min && advance_sublist(0, did_min, w_min)) {
+		did = 0;
+		return NULL;
+	    }
+	    n_kids = 0;
+	    return kids[0].pl;
+	}
+
+	if (erased) continue;
+
+	// The candidate is the lowest docid any essential sub-postlist is at.
+	Xapian::docid candidate = kids[n_non_ess].head;
+	for (size_t i = n_non_ess + 1; i < n_kids; ++i) {
+	    candidate = min(candidate, kids[i].head);
+	}
+
+	if (w_min > 0 && !block_bound_reaches(candidate, n_non_ess, w_min)) {
+	    LOGLINE(MATCH, "MultiOrPostList: skipping " << candidate <<
+			   " (block bound < " << w_min << ")");
+	    did = candidate;
+	    did_min = candidate + 1;
+	    continue;
+	}
+
+	if (n_non_ess) {
+	    // Check if the candidate can achieve w_min before advancing the
+	    // non-essential sub-postlists, and then advance them in descending
+	    // order of maximum weight, stopping once it's clear it can't.
+	    double bound = non_ess_max;
+	    for (size_t i = n_non_ess; i < n_kids; ++i) {
+		if (kids[i].head == candidate)
+		    bound += kids[i].pl->get_weight();
+	    }
+	    size_t j = n_non_ess;
+	    while (bound >= w_min && j-- > 0) {
+		bound -= kids[j].max_wt;
+		if (kids[j].head < candidate &&
+		    advance_sublist(j, candidate, w_min)) {
+		    continue;
+		}
+		if (kids[j].head == candidate)
+		    bound += kids[j].pl->get_weight();
+	    }
+	    if (bound < w_min) {
+		LOGLINE(MATCH, "MultiOrPostList: skipping " << candidate <<
+			       " (bound " << bound << " < " << w_min << ")");
+		did = candidate;
+		did_min = candidate + 1;
+		continue;
+	    }
+	}
+
+	did = candidate;
+	return NULL;
+    }
+}
+
+Xapian::doccount
+MultiOrPostList::get_termfreq_min() const
+{
+    Xapian::doccount res = kids[0].pl->get_termfreq_min();
+    for (size_t i = 1; i < n_kids; ++i) {
+	res = max(res, kids[i].pl->get_termfreq_min());
+    }
+    return res;
+}
+
+Xapian::doccount
+MultiOrPostList::get_termfreq_max() const
+{
+    Xapian::doccount res = kids[0].pl->get_termfreq_max();
+    for (size_t i = 1; i < n_kids; ++i) {
+	Xapian::doccount c = kids[i].pl->get_termfreq_max();
+	if (db_size - res <= c)
+	    return db_size;
+	res += c;
+    }
+    return res;
+}
+
+Xapian::doccount
+MultiOrPostList::get_termfreq_est() const
+{
+    if (rare(db_size == 0))
+	return 0;
+
+    // We calculate the estimate assuming independence.  The simplest
+    // way to calculate this seems to be a series of (n_kids - 1) pairwise
+    // calculations, which gives the same answer regardless of the order.
+    double scale = 1.0 / db_size;
+    double P_est = kids[0].pl->get_termfreq_est() * scale;
+    for (size_t i = 1; i < n_kids; ++i) {
+	double P_i = kids[i].pl->get_termfreq_est() * scale;
+	P_est += P_i - P_est * P_i;
+    }
+    return static_cast<Xapian::doccount>(P_est * db_size + 0.5);
+}
+
+TermFreqs
+MultiOrPostList::get_termfreq_est_using_stats(
+	const Xapian::Weight::Internal & stats) const
+{
+    // We calculate the estimate assuming independence.  The simplest
+    // way to calculate this seems to be a series of (n_kids - 1) pairwise
+    // calculations, which gives the same answer regardless of the order.
+    TermFreqs freqs(kids[0].pl->get_termfreq_est_using_stats(stats));
+
+    // Our caller should have ensured this.
+    Assert(stats.collection_size);
+    double scale = 1.0 / stats.collection_size;
+    double P_est = freqs.termfreq * scale;
+    double Pr_est = 0;
+    if (stats.rset_size != 0)
+	Pr_est = freqs.reltermfreq / double(stats.rset_size);
+    double Pc_scale = 1.0 / stats.total_term_count;
+    double Pc_est = freqs.collfreq * Pc_scale;
+
+    for (size_t i = 1; i < n_kids; ++i) {
+	freqs = kids[i].pl->get_termfreq_est_using_stats(stats);
+	double P_i = freqs.termfreq * scale;
+	P_est += P_i - P_est * P_i;
+	double Pc_i = freqs.collfreq * Pc_scale;
+	Pc_est += Pc_i - Pc_est * Pc_i;
+	// If the rset is empty, Pr_est should be 0 already, so leave
+	// it alone.
+	if (stats.rset_size != 0) {
+	    double Pr_i = freqs.reltermfreq / double(stats.rset_size);
+	    Pr_est += Pr_i - Pr_est * Pr_i;
+	}
+    }
+    return TermFreqs(Xapian::doccount(P_est * stats.collection_size + 0.5),
+		     Xapian::doccount(Pr_est * stats.rset_size + 0.5),
+		     Xapian::termcount(Pc_est * stats.total_term_count + 0.5));
+}
+
+double
+MultiOrPostList::get_maxweight() const
+{
+    return max_total;
+}
+
+Xapian::docid
+MultiOrPostList::get_docid() const
+{
+    return did;
+}
+
+Xapian::termcount
+MultiOrPostList::get_doclength() const
+{
+    Assert(did);
+    for (size_t i = 0; i < n_kids; ++i) {
+	if (kids[i].head == did)
+	    return kids[i].pl->get_doclength();
+    }
+    Assert(false);
+    return 0;
+}
+
+double
+MultiOrPostList::get_weight() const
+{
+    Assert(did);
+    double res = 0.0;
+    for (size_t i = 0; i < n_kids; ++i) {
+	if (kids[i].head == did)
+	    res += kids[i].pl->get_weight();
+    }
+    return res;
+}
+
+bool
+MultiOrPostList::at_end() const
+{
+    return (did == 0);
+}
+
+double
+MultiOrPostList::recalc_maxweight()
+{
+    LOGCALL(MATCH, double, "MultiOrPostList::recalc_maxweight", NO_ARGS);
+    for (size_t i = 0; i < n_kids; ++i) {
+	kids[i].max_wt = kids[i].pl->recalc_maxweight();
+    }
+    sort(kids, kids + n_kids);
+    max_total = 0;
+    for (size_t i = 0; i < n_kids; ++i) {
+	max_total += kids[i].max_wt;
+    }
+    RETURN(max_total);
+}
+
+PostList *
+MultiOrPostList::next(double w_min)
+{
+    LOGCALL(MATCH, PostList *, "MultiOrPostList::next", w_min);
+    RETURN(find_next_match(did + 1, w_min));
+}
+
+PostList *
+MultiOrPostList::skip_to(Xapian::docid did_min, double w_min)
+{
+    LOGCALL(MATCH, PostList *, "MultiOrPostList::skip_to", did_min | w_min);
+    if (rare(did_min == 0)) did_min = 1;
+    if (did_min <= did) RETURN(NULL);
+    RETURN(find_next_match(did_min, w_min));
+}
+
+string
+MultiOrPostList::get_description() const
+{
+    string desc("(");
+    desc += kids[0].pl->get_description();
+    for (size_t i = 1; i < n_kids; ++i) {
+	desc += " OR ";
+	desc += kids[i].pl->get_description();
+    }
+    desc += ')';
+    return desc;
+}
+
+Xapian::termcount
+MultiOrPostList::get_wdf() const
+{
+    Xapian::termcount totwdf = 0;
+    for (size_t i = 0; i < n_kids; ++i) {
+	if (kids[i].head == did)
+	    totwdf += kids[i].pl->get_wdf();
+    }
+    return totwdf;
+}
+
+Xapian::termcount
+MultiOrPostList::count_matching_subqs() const
+{
+    Xapian::termcount total = 0;
+    for (size_t i = 0; i < n_kids; ++i) {
+	if (kids[i].head == did)
+	    total += kids[i].pl->count_matching_subqs();
+    }
+    return total;
+}
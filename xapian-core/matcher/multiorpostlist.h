@@ -0,0 +1,179 @@
+/** @file multiorpostlist.h
+ * @brief N-way OR postlist with MaxScore pruning
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_MULTIORPOSTLIST_H
+#define XAPIAN_INCLUDED_MULTIORPOSTLIST_H
+
+#include "api/postlist.h"
+
+class MultiMatch;
+
+/** N-way OR postlist with wt=sum(wt_i).
+ *
+ *  The sub-postlists are kept in ascending order of maximum weight.  Given
+ *  the minimum weight w_min which a document needs to achieve, the longest
+ *  prefix of sub-postlists whose maximum weights sum to less than w_min is
+ *  "non-essential" - a document which only matches those can't achieve w_min,
+ *  so we only need to look for candidate documents in the other "essential"
+ *  sub-postlists, and just skip the non-essential ones to each candidate
+ *  (this is the MaxScore algorithm).
+ *
+ *  Before calculating a candidate's weight, we also check it against the sum
+ *  of the sub-postlists' block weight bounds (as in Block-Max WAND).
+ */
+class MultiOrPostList : public PostList {
+    /// Don't allow assignment.
+    void operator=(const MultiOrPostList &);
+
+    /// Don't allow copying.
+    MultiOrPostList(const MultiOrPostList &);
+
+    /// Information about a sub-postlist.
+    struct SubPostList {
+	/// The sub-postlist.
+	PostList * pl;
+
+	/// The maximum weight pl can return.
+	double max_wt;
+
+	/** The docid pl is positioned at, or 0 if pl hasn't been started.
+	 *
+	 *  Non-essential sub-postlists may lag behind the current docid.
+	 */
+	Xapian::docid head;
+
+	/// Order by ascending maximum weight.
+	bool operator<(const SubPostList & o) const {
+	    return max_wt < o.max_wt;
+	}
+    };
+
+    /// The current docid, or zero if we haven't started.
+    Xapian::docid did;
+
+    /// The number of sub-postlists.
+    size_t n_kids;
+
+    /// Array of sub-postlists, in ascending order of max_wt.
+    SubPostList * kids;
+
+    /// Total maximum weight (== sum of max_wt values).
+    double max_total;
+
+    /// The number of documents in the database.
+    Xapian::doccount db_size;
+
+    /// Pointer to the matcher object, so we can report pruning.
+    MultiMatch *matcher;
+
+    /// Calculate the minimum weight sub-postlist n needs to contribute.
+    double new_min(double w_min, size_t n) const {
+	return w_min - (max_total - kids[n].max_wt);
+    }
+
+    /** Return the number of non-essential sub-postlists for @a w_min.
+     *
+     *  @param[out] non_ess_max	The sum of their maximum weights.
+     */
+    size_t count_non_essential(double w_min, double & non_ess_max) const;
+
+    /** Advance sub-postlist @a n to docid @a did_min or later.
+     *
+     *  @return true if the sub-postlist has run out, in which case it has been
+     *  removed.
+     */
+    bool advance_sublist(size_t n, Xapian::docid did_min, double w_min);
+
+    /// Remove sub-postlist @a n.
+    void erase_sublist(size_t n);
+
+    /** Check if @a candidate could achieve @a w_min using the sub-postlists'
+     *  block weight bounds.
+     *
+     *  This is a cheaper (but looser) test than calculating the weights.
+     */
+    bool block_bound_reaches(Xapian::docid candidate, size_t n_non_ess,
+			     double w_min) const;
+
+    /** Move to the first document >= @a did_min which could achieve weight
+     *  @a w_min.
+     */
+    PostList * find_next_match(Xapian::docid did_min, double w_min);
+
+  public:
+    /** Construct from 2 random-access iterators to a container of PostList*,
+     *  a pointer to the matcher, and the document collection size.
+     */
+    template <class RandomItor>
+    MultiOrPostList(RandomItor pl_begin, RandomItor pl_end,
+		    MultiMatch * matcher_, Xapian::doccount db_size_)
+	: did(0), n_kids(pl_end - pl_begin), kids(NULL),
+	  max_total(0), db_size(db_size_), matcher(matcher_)
+    {
+	kids = new SubPostList[n_kids];
+	for (size_t i = 0; i < n_kids; ++i) {
+	    kids[i].pl = pl_begin[i];
+	    kids[i].max_wt = 0;
+	    kids[i].head = 0;
+	}
+    }
+
+    ~MultiOrPostList();
+
+    Xapian::doccount get_termfreq_min() const;
+
+    Xapian::doccount get_termfreq_max() const;
+
+    Xapian::doccount get_termfreq_est() const;
+
+    TermFreqs get_termfreq_est_using_stats(
+	const Xapian::Weight::Internal & stats) const;
+
+    double get_maxweight() const;
+
+    Xapian::docid get_docid() const;
+
+    Xapian::termcount get_doclength() const;
+
+    double get_weight() const;
+
+    bool at_end() const;
+
+    double recalc_maxweight();
+
+    Internal *next(double w_min);
+
+    Internal *skip_to(Xapian::docid, double w_min);
+
+    std::string get_description() const;
+
+    /** get_wdf() for MultiOrPostlist returns the sum of the wdfs of the
+     *  sub postlists which match the current docid.
+     *
+     *  The wdf isn't really meaningful in many situations, but if the lists
+     *  are being combined as a synonym we want the sum of the wdfs, so we do
+     *  that in general.
+     */
+    Xapian::termcount get_wdf() const;
+
+    Xapian::termcount count_matching_subqs() const;
+};
+
+#endif // XAPIAN_INCLUDED_MULTIORPOSTLIST_H
@@ -0,0 +1,240 @@
+/** @file profilepostlist.cc
+ * @brief PostList which profiles the calls made to another
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "profilepostlist.h"
+
+#include "debuglog.h"
+#include "matchprofile.h"
+#include "multimatch.h"
+#include "realtime.h"
+
+using namespace std;
+
+ProfilePostList::ProfilePostList(PostList * pl_, ProfileNode * node_,
+				 MultiMatch * matcher_)
+    : pl(pl_), node(node_), matcher(matcher_),
+      is_leaf(node_->children.empty())
+{
+    if (is_leaf) {
+	// Count the reads done when the postlist was opened.  The blocks
+	// count is for the whole table, so only a difference is meaningful.
+	totlen_t postings, chunks, blocks;
+	pl->get_read_counts(postings, chunks, blocks);
+	node->postings += postings;
+	node->chunks += chunks;
+    }
+}
+
+ProfilePostList::~ProfilePostList()
+{
+    delete pl;
+}
+
+void
+ProfilePostList::start_call(Snapshot & start) const
+{
+    if (is_leaf)
+	pl->get_read_counts(start.postings, start.chunks, start.blocks);
+    start.time = RealTime::now();
+}
+
+void
+ProfilePostList::end_call(const Snapshot & start) const
+{
+    node->time += RealTime::now() - start.time;
+    if (is_leaf) {
+	totlen_t postings, chunks, blocks;
+	pl->get_read_counts(postings, chunks, blocks);
+	node->postings += postings - start.postings;
+	node->chunks += chunks - start.chunks;
+	node->blocks += blocks - start.blocks;
+    }
+}
+
+void
+ProfilePostList::handle_prune(PostList * p)
+{
+    if (p) {
+	LOGLINE(MATCH, "ProfilePostList: " << node->label << " pruned");
+	node->prunes.push_back(p->get_description());
+	delete pl;
+	pl = p;
+	if (matcher) matcher->recalc_maxweight();
+    }
+}
+
+Xapian::doccount
+ProfilePostList::get_termfreq_min() const
+{
+    return pl->get_termfreq_min();
+}
+
+Xapian::doccount
+ProfilePostList::get_termfreq_max() const
+{
+    return pl->get_termfreq_max();
+}
+
+Xapian::doccount
+ProfilePostList::get_termfreq_est() const
+{
+    return pl->get_termfreq_est();
+}
+
+TermFreqs
+ProfilePostList::get_termfreq_est_using_stats(
+	const Xapian::Weight::Internal & stats) const
+{
+    return pl->get_termfreq_est_using_stats(stats);
+}
+
+double
+ProfilePostList::get_maxweight() const
+{
+    return pl->get_maxweight();
+}
+
+double
+ProfilePostList::get_block_maxweight(Xapian::docid & last) const
+{
+    return pl->get_block_maxweight(last);
+}
+
+Xapian::docid
+ProfilePostList::get_docid() const
+{
+    return pl->get_docid();
+}
+
+Xapian::termcount
+ProfilePostList::get_doclength() const
+{
+    return pl->get_doclength();
+}
+
+Xapian::termcount
+ProfilePostList::get_wdf() const
+{
+    return pl->get_wdf();
+}
+
+double
+ProfilePostList::get_weight() const
+{
+    ++node->weights;
+    Snapshot start;
+    start_call(start);
+    double wt = pl->get_weight();
+    end_call(start);
+    return wt;
+}
+
+const string *
+ProfilePostList::get_collapse_key() const
+{
+    return pl->get_collapse_key();
+}
+
+const string *
+ProfilePostList::get_sort_key() const
+{
+    return pl->get_sort_key();
+}
+
+bool
+ProfilePostList::at_end() const
+{
+    return pl->at_end();
+}
+
+double
+ProfilePostList::recalc_maxweight()
+{
+    return pl->recalc_maxweight();
+}
+
+PositionList *
+ProfilePostList::read_position_list()
+{
+    return pl->read_position_list();
+}
+
+PositionList *
+ProfilePostList::open_position_list() const
+{
+    return pl->open_position_list();
+}
+
+PostList *
+ProfilePostList::next(double w_min)
+{
+    ++node->nexts;
+    Snapshot start;
+    start_call(start);
+    PostList * p = pl->next(w_min);
+    end_call(start);
+    handle_prune(p);
+    return NULL;
+}
+
+PostList *
+ProfilePostList::skip_to(Xapian::docid did, double w_min)
+{
+    ++node->skip_tos;
+    Snapshot start;
+    start_call(start);
+    PostList * p = pl->skip_to(did, w_min);
+    end_call(start);
+    handle_prune(p);
+    return NULL;
+}
+
+PostList *
+ProfilePostList::check(Xapian::docid did, double w_min, bool & valid)
+{
+    ++node->checks;
+    Snapshot start;
+    start_call(start);
+    PostList * p = pl->check(did, w_min, valid);
+    end_call(start);
+    handle_prune(p);
+    return NULL;
+}
+
+Xapian::termcount
+ProfilePostList::count_matching_subqs() const
+{
+    return pl->count_matching_subqs();
+}
+
+void
+ProfilePostList::get_read_counts(totlen_t & postings, totlen_t & chunks,
+				 totlen_t & blocks) const
+{
+    pl->get_read_counts(postings, chunks, blocks);
+}
+
+string
+ProfilePostList::get_description() const
+{
+    return pl->get_description();
+}
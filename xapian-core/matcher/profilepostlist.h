@@ -0,0 +1,128 @@
+/** @file profilepostlist.h
+ * @brief PostList which profiles the calls made to another
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_PROFILEPOSTLIST_H
+#define XAPIAN_INCLUDED_PROFILEPOSTLIST_H
+
+#include "api/postlist.h"
+
+class MultiMatch;
+struct ProfileNode;
+
+/** PostList which profiles the calls made to another.
+ *
+ *  The calls to next(), skip_to(), check() and get_weight() are counted and
+ *  timed, and for a leaf node the work done reading postings is counted too.
+ *  Everything else is simply passed through.
+ */
+class ProfilePostList : public PostList {
+    /// Don't allow assignment.
+    void operator=(const ProfilePostList &);
+
+    /// Don't allow copying.
+    ProfilePostList(const ProfilePostList &);
+
+    /// The postlist we're profiling.
+    PostList * pl;
+
+    /// Where we record the profile.
+    ProfileNode * node;
+
+    /// Pointer to the matcher object, so we can report pruning.
+    MultiMatch * matcher;
+
+    /// Is this a leaf node (so we count the reads it does)?
+    bool is_leaf;
+
+    /// The state at the start of a call.
+    struct Snapshot {
+	double time;
+	totlen_t postings, chunks, blocks;
+    };
+
+    /// Record the state at the start of a call.
+    void start_call(Snapshot & start) const;
+
+    /// Add what happened since @a start to node.
+    void end_call(const Snapshot & start) const;
+
+    /// Replace pl with @a p, if it isn't NULL.
+    void handle_prune(PostList * p);
+
+  public:
+    /** Construct a ProfilePostList.
+     *
+     *  @param pl_	The postlist to profile (ownership is taken).
+     *  @param node_	Where to record the profile.
+     *  @param matcher_	The matcher, so we can report pruning.
+     */
+    ProfilePostList(PostList * pl_, ProfileNode * node_,
+		    MultiMatch * matcher_);
+
+    ~ProfilePostList();
+
+    Xapian::doccount get_termfreq_min() const;
+
+    Xapian::doccount get_termfreq_max() const;
+
+    Xapian::doccount get_termfreq_est() const;
+
+    TermFreqs get_termfreq_est_using_stats(
+	const Xapian::Weight::Internal & stats) const;
+
+    double get_maxweight() const;
+
+    double get_block_maxweight(Xapian::docid & last) const;
+
+    Xapian::docid get_docid() const;
+
+    Xapian::termcount get_doclength() const;
+
+    Xapian::termcount get_wdf() const;
+
+    double get_weight() const;
+
+    const std::string * get_collapse_key() const;
+
+    const std::string * get_sort_key() const;
+
+    bool at_end() const;
+
+    double recalc_maxweight();
+
+    PositionList * read_position_list();
+
+    PositionList * open_position_list() const;
+
+    Internal * next(double w_min);
+
+    Internal * skip_to(Xapian::docid, double w_min);
+
+    Internal * check(Xapian::docid did, double w_min, bool & valid);
+
+    Xapian::termcount count_matching_subqs() const;
+
+    void get_read_counts(totlen_t & postings, totlen_t & chunks,
+			 totlen_t & blocks) const;
+
+    std::string get_description() const;
+};
+
+#endif // XAPIAN_INCLUDED_PROFILEPOSTLIST_H
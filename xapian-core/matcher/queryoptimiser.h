@@ -23,9 +23,15 @@
 #define XAPIAN_INCLUDED_QUERYOPTIMISER_H
 
 #include "backends/database.h"
+#include "biword.h"
 #include "localsubmatch.h"
+#include "matchprofile.h"
 #include "api/postlist.h"
 
+#include <map>
+#include <string>
+#include <vector>
+
 class LeafPostList;
 class MultiMatch;
 namespace Xapian {
@@ -50,6 +56,11 @@ class QueryOptimiser {
 
     LeafPostList * hint;
 
+    /** Field prefixes we've checked for biwords, and how many documents in
+     *  db have them.
+     */
+    std::map<std::string, Xapian::doccount> biword_prefixes;
+
   public:
     const Xapian::Database::Internal & db;
 
@@ -57,11 +68,19 @@ class QueryOptimiser {
 
     MultiMatch * matcher;
 
+    /// The profile to record, or NULL if we're not profiling.
+    MatchProfile * profile;
+
+    /// Will positional information be read from postlists we open?
+    bool need_positions;
+
     QueryOptimiser(const Xapian::Database::Internal & db_,
 		   LocalSubMatch & localsubmatch_,
-		   MultiMatch * matcher_)
+		   MultiMatch * matcher_,
+		   MatchProfile * profile_)
 	: localsubmatch(localsubmatch_), total_subqs(0), hint(0),
-	  db(db_), db_size(db.get_doccount()), matcher(matcher_) { }
+	  db(db_), db_size(db.get_doccount()), matcher(matcher_),
+	  profile(profile_), need_positions(false) { }
 
     void inc_total_subqs() { ++total_subqs; }
 
@@ -72,12 +91,60 @@ class QueryOptimiser {
     LeafPostList * open_post_list(const std::string& term,
 				  Xapian::termcount wqf,
 				  double factor) {
-	return localsubmatch.open_post_list(term, wqf, factor, &hint);
+	return localsubmatch.open_post_list(term, wqf, factor,
+					    need_positions, &hint);
+    }
+
+    /** How many documents in db were indexed with biwords for field
+     *  @a prefix?
+     *
+     *  In those documents, an exact phrase in that field can be checked
+     *  using the biwords for each adjacent pair of terms.
+     */
+    Xapian::doccount get_biword_freq(const std::string & prefix) {
+	std::map<std::string, Xapian::doccount>::const_iterator i;
+	i = biword_prefixes.find(prefix);
+	if (i != biword_prefixes.end()) return i->second;
+	Xapian::doccount marker_tf;
+	db.get_freqs(biword_marker(prefix), &marker_tf, NULL);
+	biword_prefixes.insert(std::make_pair(prefix, marker_tf));
+	return marker_tf;
     }
 
     PostList * make_synonym_postlist(PostList * pl, double factor) {
 	return localsubmatch.make_synonym_postlist(pl, matcher, factor);
     }
+
+    /// Are we profiling the match?
+    bool profiling() const { return profile != NULL; }
+
+    /** Wrap leaf postlist @a pl so calls to it are profiled.
+     *
+     *  Only call this if profiling() is true.
+     */
+    PostList * profile_postlist(PostList * pl, const std::string & label) {
+	return profile->wrap(pl, label, matcher, NULL, NULL);
+    }
+
+    /** Wrap postlist @a pl built from @a child so calls to it are profiled.
+     *
+     *  Only call this if profiling() is true.
+     */
+    PostList * profile_postlist(PostList * pl, const std::string & label,
+				PostList * child) {
+	return profile->wrap(pl, label, matcher, &child, &child + 1);
+    }
+
+    /** Wrap postlist @a pl built from @a children so calls to it are
+     *  profiled.
+     *
+     *  Only call this if profiling() is true.
+     */
+    PostList * profile_postlist(PostList * pl, const std::string & label,
+				const std::vector<PostList *> & children) {
+	return profile->wrap(pl, label, matcher,
+			     &children[0], &children[0] + children.size());
+    }
 };
 
 #endif // XAPIAN_INCLUDED_QUERYOPTIMISER_H
@@ -71,5 +71,5 @@ RemoteSubMatch::get_postlist(MultiMatch * matcher,
     // For remote databases we report percent_factor rather than counting the
     // number of subqueries.
     (void)total_subqs_ptr;
-    return new MSetPostList(mset, decreasing_relevance);
+    return new MSetPostList(mset, decreasing_relevance, false);
 }
@@ -51,8 +51,8 @@ ValueStreamDocument::new_subdb(int n)
     clear_valuelists(valuelists);
 }
 
-string
-ValueStreamDocument::do_get_value(Xapian::valueno slot) const
+ValueList *
+ValueStreamDocument::find_value(Xapian::valueno slot) const
 {
 #ifdef XAPIAN_ASSERTIONS_PARANOID
     if (!doc) {
@@ -69,10 +69,7 @@ ValueStreamDocument::do_get_value(Xapian::valueno slot) const
 	ret.first->second = vl;
     } else {
 	vl = ret.first->second;
-	if (!vl) {
-	    AssertEqParanoid(string(), doc->get_value(slot));
-	    return string();
-	}
+	if (!vl) return NULL;
     }
 
     if (vl->check(did)) {
@@ -80,16 +77,43 @@ ValueStreamDocument::do_get_value(Xapian::valueno slot) const
 	    delete vl;
 	    ret.first->second = NULL;
 	} else if (vl->get_docid() == did) {
-	    Assert(vl);
-	    string v = vl->get_value();
-	    AssertEq(v, doc->get_value(slot));
-	    return v;
+	    return vl;
 	}
     }
+    return NULL;
+}
+
+string
+ValueStreamDocument::do_get_value(Xapian::valueno slot) const
+{
+    ValueList * vl = find_value(slot);
+    if (vl) {
+	string v = vl->get_value();
+	AssertEqParanoid(v, doc->get_value(slot));
+	return v;
+    }
     AssertEqParanoid(string(), doc->get_value(slot));
     return string();
 }
 
+const string &
+ValueStreamDocument::get_value_ref(Xapian::valueno slot, string & buf) const
+{
+    ValueList * vl = find_value(slot);
+    if (vl) {
+	const string * p = vl->get_value_ptr();
+	if (p) {
+	    AssertEqParanoid(*p, doc->get_value(slot));
+	    return *p;
+	}
+	buf = vl->get_value();
+    } else {
+	buf.resize(0);
+    }
+    AssertEqParanoid(buf, doc->get_value(slot));
+    return buf;
+}
+
 void
 ValueStreamDocument::do_get_all_values(map<Xapian::valueno, string> & v) const
 {
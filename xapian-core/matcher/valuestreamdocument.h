@@ -66,7 +66,26 @@ class ValueStreamDocument : public Xapian::Document::Internal {
 	return ValueStreamDocument::do_get_value(slot);
     }
 
+    /** Get the value in @a slot, avoiding copying it where we can.
+     *
+     *  @param slot	The value slot.
+     *  @param buf	Used to hold the value if the value stream can't give
+     *			us a reference to it.
+     *
+     *  @return The value (empty if it isn't set), which remains valid until
+     *	    the next call to a method of this object or until @a buf is
+     *	    modified.
+     */
+    const string & get_value_ref(Xapian::valueno slot, string & buf) const;
+
   private:
+    /** Find the value stream for @a slot, positioned on the current document.
+     *
+     *  @return The value stream, or NULL if the current document has no
+     *	    value in @a slot.
+     */
+    ValueList * find_value(Xapian::valueno slot) const;
+
     /** Implementation of virtual methods @{ */
     string do_get_value(Xapian::valueno slot) const;
     void do_get_all_values(map<Xapian::valueno, string> & values_) const;
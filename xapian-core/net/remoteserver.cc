@@ -479,7 +479,8 @@ RemoteServer::msg_query(const string &message_in)
     MultiMatch match(*db, query, qlen, &rset, collapse_max, collapse_key,
 		     percent_cutoff, weight_cutoff, order,
 		     sort_key, sort_by, sort_value_forward, time_limit, NULL,
-		     local_stats, wt.get(), matchspies.spies, false, false);
+		     local_stats, wt.get(), matchspies.spies, false, false, 1,
+		     NULL);
 
     send_message(REPLY_STATS, serialise_stats(local_stats));
 
@@ -136,9 +136,11 @@ QueryParser::set_database(const Database &db) {
 }
 
 void
-QueryParser::set_max_wildcard_expansion(Xapian::termcount max)
+QueryParser::set_max_wildcard_expansion(Xapian::termcount max,
+					 wildcard_limit_type limit_type)
 {
     internal->max_wildcard_expansion = max;
+    internal->wildcard_limit = limit_type;
 }
 
 Query
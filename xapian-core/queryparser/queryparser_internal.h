@@ -88,6 +88,8 @@ class QueryParser::Internal : public Xapian::Internal::intrusive_base {
 
     Xapian::termcount max_wildcard_expansion;
 
+    wildcard_limit_type wildcard_limit;
+
     void add_prefix(const string &field, const string &prefix,
 		    filter_type type);
 
@@ -100,7 +102,8 @@ class QueryParser::Internal : public Xapian::Internal::intrusive_base {
 
   public:
     Internal() : stem_action(STEM_SOME), stopper(NULL),
-	default_op(Query::OP_OR), errmsg(NULL), max_wildcard_expansion(0) { }
+	default_op(Query::OP_OR), errmsg(NULL), max_wildcard_expansion(0),
+	wildcard_limit(WILDCARD_LIMIT_ERROR) { }
 
     Query parse_query(const string & query_string, unsigned int flags, const string & default_prefix);
 };
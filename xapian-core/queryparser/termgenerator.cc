@@ -60,6 +60,8 @@ TermGenerator::set_document(const Xapian::Document & doc)
 {
     internal->doc = doc;
     internal->termpos = 0;
+    internal->last_term.resize(0);
+    internal->last_termpos = 0;
 }
 
 const Xapian::Document &
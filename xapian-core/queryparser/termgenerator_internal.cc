@@ -26,6 +26,8 @@
 #include <xapian/queryparser.h>
 #include <xapian/unicode.h>
 
+#include "biword.h"
+#include "edgengram.h"
 #include "stringutils.h"
 
 #include <limits>
@@ -117,12 +119,70 @@ inline unsigned check_suffix(unsigned ch) {
 #define STOPWORDS_IGNORE 1
 #define STOPWORDS_INDEX_UNSTEMMED_ONLY 2
 
+void
+TermGenerator::Internal::add_posting(const string & term, termcount wdf_inc)
+{
+    doc.add_posting(term, ++termpos, wdf_inc);
+    if (!biwords_active) return;
+    if (last_termpos == termpos - 1 && !last_term.empty()) {
+	// Only pair up terms from the same field.
+	string::size_type n = biword_prefix_length(term);
+	if (n == biword_prefix_length(last_term) &&
+	    last_term.compare(0, n, term, 0, n) == 0) {
+	    const string & biword = make_biword(last_term, term);
+	    if (!biword.empty()) doc.add_term(biword, 0);
+	}
+    }
+    last_term = term;
+    last_termpos = termpos;
+}
+
+void
+TermGenerator::Internal::add_edge_ngrams(const string & prefix,
+					 const string & term,
+					 termcount wdf_inc)
+{
+    string ngram = make_edge_ngram(prefix);
+    Utf8Iterator i(term);
+    for (unsigned n = 0; n != MAX_EDGE_NGRAM_LENGTH; ++n) {
+	if (i == Utf8Iterator()) break;
+	Unicode::append_utf8(ngram, *i);
+	++i;
+	// The backend doesn't count this wdf in the document length.
+	doc.add_term(ngram, wdf_inc);
+    }
+}
+
 void
 TermGenerator::Internal::index_text(Utf8Iterator itor, termcount wdf_inc,
 				    const string & prefix, bool with_positions)
 {
     bool cjk_ngram = CJK::is_cjk_enabled();
 
+    biwords_active = false;
+    if (with_positions && (flags & FLAG_BIWORDS)) {
+	// The field prefix of the terms we'll add positions for.
+	string field = prefix;
+	if (strategy == TermGenerator::STEM_ALL_Z) field.insert(0, 1, 'Z');
+	// The matcher can only tell which field a term is in if the prefix
+	// follows the usual convention of capital letters.
+	if (biword_prefix_length(field) == field.size()) {
+	    // Record that phrases in this field of this document can be
+	    // checked using biwords.
+	    doc.add_term(biword_marker(field), 0);
+	    biwords_active = true;
+	}
+    }
+
+    if ((flags & FLAG_EDGE_NGRAMS) &&
+	(strategy == TermGenerator::STEM_SOME ||
+	 strategy == TermGenerator::STEM_NONE)) {
+	// Record that partial terms in this field can be matched using edge
+	// n-grams.  Only unstemmed terms get edge n-grams, so with the other
+	// strategies the QueryParser has to expand partial terms.
+	doc.add_term(edge_ngram_marker(prefix), 0);
+    }
+
     int stop_mode = STOPWORDS_INDEX_UNSTEMMED_ONLY;
 
     if (!stopper) stop_mode = STOPWORDS_NONE;
@@ -174,10 +234,12 @@ TermGenerator::Internal::index_text(Utf8Iterator itor, termcount wdf_inc,
 		    if (strategy == TermGenerator::STEM_SOME ||
 			strategy == TermGenerator::STEM_NONE) {
 			if (with_positions && tk.get_length() == 1) {
-			    doc.add_posting(prefix + cjk_token, ++termpos, wdf_inc);
+			    add_posting(prefix + cjk_token, wdf_inc);
 			} else {
 			    doc.add_term(prefix + cjk_token, wdf_inc);
 			}
+			if (flags & FLAG_EDGE_NGRAMS)
+			    add_edge_ngrams(prefix, cjk_token, wdf_inc);
 		    }
 
 		    if ((flags & FLAG_SPELLING) && prefix.empty())
@@ -206,7 +268,7 @@ TermGenerator::Internal::index_text(Utf8Iterator itor, termcount wdf_inc,
 		    stem += stemmer(cjk_token);
 		    if (strategy != TermGenerator::STEM_SOME &&
 			with_positions) {
-			doc.add_posting(stem, ++termpos, wdf_inc);
+			add_posting(stem, wdf_inc);
 		    } else {
 			doc.add_term(stem, wdf_inc);
 		    }
@@ -272,10 +334,12 @@ endofterm:
 	if (strategy == TermGenerator::STEM_SOME ||
 	    strategy == TermGenerator::STEM_NONE) {
 	    if (with_positions) {
-		doc.add_posting(prefix + term, ++termpos, wdf_inc);
+		add_posting(prefix + term, wdf_inc);
 	    } else {
 		doc.add_term(prefix + term, wdf_inc);
 	    }
+	    if (flags & FLAG_EDGE_NGRAMS)
+		add_edge_ngrams(prefix, term, wdf_inc);
 	}
 	if ((flags & FLAG_SPELLING) && prefix.empty()) db.add_spelling(term);
 
@@ -300,7 +364,7 @@ endofterm:
 	stem += stemmer(term);
 	if (strategy != TermGenerator::STEM_SOME &&
 	    with_positions) {
-	    doc.add_posting(stem, ++termpos, wdf_inc);
+	    add_posting(stem, wdf_inc);
 	} else {
 	    doc.add_term(stem, wdf_inc);
 	}
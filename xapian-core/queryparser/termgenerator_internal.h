@@ -27,6 +27,8 @@
 #include <xapian/termgenerator.h>
 #include <xapian/stem.h>
 
+#include <string>
+
 namespace Xapian {
 
 class Stopper;
@@ -42,9 +44,26 @@ class TermGenerator::Internal : public Xapian::Internal::intrusive_base {
     unsigned max_word_length;
     WritableDatabase db;
 
+    /// The last term added with a position, for FLAG_BIWORDS.
+    std::string last_term;
+
+    /// The position of last_term.
+    termcount last_termpos;
+
+    /// Are we generating biwords for the current index_text() call?
+    bool biwords_active;
+
+    /// Add @a term at the next position.
+    void add_posting(const std::string & term, termcount wdf_inc);
+
+    /// Add the edge n-grams of @a term, for FLAG_EDGE_NGRAMS.
+    void add_edge_ngrams(const std::string & prefix, const std::string & term,
+			 termcount wdf_inc);
+
   public:
     Internal() : strategy(STEM_SOME), stopper(NULL), termpos(0),
-	flags(TermGenerator::flags(0)), max_word_length(64) { }
+	flags(TermGenerator::flags(0)), max_word_length(64),
+	last_termpos(0), biwords_active(false) { }
     void index_text(Utf8Iterator itor,
 		    termcount weight,
 		    const std::string & prefix,
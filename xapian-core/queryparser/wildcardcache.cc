@@ -0,0 +1,190 @@
+/** @file wildcardcache.cc
+ * @brief Process-wide cache of wildcard expansions.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "wildcardcache.h"
+
+#include "debuglog.h"
+#include "pack.h"
+#include "stringutils.h"
+
+#include <cstdlib>
+
+using namespace std;
+
+void
+PrefixDictionary::add(const string & term, Xapian::doccount termfreq)
+{
+    if (termfreqs.size() % BLOCK_SIZE == 0) {
+	block_starts.push_back(data.size());
+	pack_string(data, term);
+    } else {
+	string::size_type shared = 0;
+	string::size_type len = min(term.size(), last_term.size());
+	while (shared < len && term[shared] == last_term[shared]) ++shared;
+	pack_uint(data, shared);
+	pack_string(data, term.substr(shared));
+    }
+    last_term = term;
+    termfreqs.push_back(termfreq);
+}
+
+void
+PrefixDictionary::get_terms(const string & prefix,
+			    vector<TermAndFreq> & out) const
+{
+    const char * start = data.data();
+    const char * end = start + data.size();
+
+    // Find the last block starting with a term before prefix.
+    size_t lo = 0, hi = block_starts.size();
+    while (hi - lo > 1) {
+	size_t mid = lo + (hi - lo) / 2;
+	const char * p = start + block_starts[mid];
+	string head;
+	if (!unpack_string(&p, end, head)) return;
+	if (head < prefix) {
+	    lo = mid;
+	} else {
+	    hi = mid;
+	}
+    }
+    if (block_starts.empty()) return;
+
+    const char * p = start + block_starts[lo];
+    string term;
+    for (size_t n = lo * BLOCK_SIZE; n != termfreqs.size(); ++n) {
+	if (n % BLOCK_SIZE == 0) {
+	    if (!unpack_string(&p, end, term)) return;
+	} else {
+	    string::size_type shared;
+	    string suffix;
+	    if (!unpack_uint(&p, end, &shared) ||
+		!unpack_string(&p, end, suffix)) return;
+	    term.resize(shared);
+	    term += suffix;
+	}
+	if (term < prefix) continue;
+	if (!startswith(term, prefix)) break;
+	out.push_back(make_pair(term, termfreqs[n]));
+    }
+}
+
+void
+PrefixDictionary::swap(PrefixDictionary & o)
+{
+    data.swap(o.data);
+    block_starts.swap(o.block_starts);
+    termfreqs.swap(o.termfreqs);
+    last_term.swap(o.last_term);
+}
+
+WildcardCache *
+WildcardCache::get_instance()
+{
+    // The instance is deliberately never deleted, as QueryParser objects may
+    // still be using it while static destructors run.
+    static WildcardCache * instance = NULL;
+    static bool initialised = false;
+    static Mutex init_mutex;
+    MutexLock lock(init_mutex);
+    if (!initialised) {
+	initialised = true;
+	const char *p = getenv("XAPIAN_WILDCARD_CACHE_SIZE");
+	if (p) {
+	    size_t capacity = strtoul(p, NULL, 10);
+	    if (capacity) instance = new WildcardCache(capacity);
+	}
+    }
+    return instance;
+}
+
+bool
+WildcardCache::read(const string & db_key, const string & root,
+		    vector<TermAndFreq> & out)
+{
+    MutexLock lock(mutex);
+    // Look for an entry for root, and failing that for the longest prefix of
+    // root which we have an entry for.
+    string::size_type len = root.size();
+    while (true) {
+	const PrefixDictionary * terms =
+	    entries.find(Key(db_key, root.substr(0, len)));
+	if (terms) {
+	    ++hits;
+	    terms->get_terms(root, out);
+	    return true;
+	}
+	if (len == 0) break;
+	--len;
+    }
+    ++misses;
+    return false;
+}
+
+void
+WildcardCache::add(const string & db_key, const string & root,
+		   const vector<TermAndFreq> & terms)
+{
+    // Don't let one huge expansion flush everything else out.
+    if (terms.size() > capacity / 2) return;
+
+    PrefixDictionary dict;
+    vector<TermAndFreq>::const_iterator t;
+    for (t = terms.begin(); t != terms.end(); ++t) {
+	dict.add(t->first, t->second);
+    }
+
+    MutexLock lock(mutex);
+    Key key(db_key, root);
+    // Another QueryParser may have added this while we were expanding it.
+    if (entries.contains(key)) return;
+    while (size + dict.size() > capacity) {
+	LOGLINE(QUERYPARSER, "Evicting expansion of " <<
+		entries.back().first.root << " from the wildcard cache");
+	size -= entries.back().second.size();
+	entries.pop_back();
+    }
+    entries.insert(key).swap(dict);
+    size += entries.peek(key)->size();
+}
+
+unsigned long
+WildcardCache::get_hits() const
+{
+    MutexLock lock(mutex);
+    return hits;
+}
+
+unsigned long
+WildcardCache::get_misses() const
+{
+    MutexLock lock(mutex);
+    return misses;
+}
+
+size_t
+WildcardCache::get_size() const
+{
+    MutexLock lock(mutex);
+    return size;
+}
@@ -0,0 +1,174 @@
+/** @file wildcardcache.h
+ * @brief Process-wide cache of wildcard expansions.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_WILDCARDCACHE_H
+#define XAPIAN_INCLUDED_WILDCARDCACHE_H
+
+#include "lrucache.h"
+#include "mutexlock.h"
+#include "xapian/types.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/// A term and its term frequency.
+typedef std::pair<std::string, Xapian::doccount> TermAndFreq;
+
+/** A sorted list of terms and their frequencies, stored front-coded.
+ *
+ *  Adjacent terms in sorted order usually share a long prefix, so each term
+ *  is stored as the length of the prefix it shares with the previous term
+ *  followed by the rest of the term.  Every BLOCK_SIZE-th term is stored in
+ *  full so we can binary chop to the start of a range of terms.
+ */
+class PrefixDictionary {
+    /// How often to store a term in full.
+    static const unsigned BLOCK_SIZE = 16;
+
+    /// The front-coded terms.
+    std::string data;
+
+    /// Offset in data of each term stored in full.
+    std::vector<std::string::size_type> block_starts;
+
+    /// The term frequency of each term.
+    std::vector<Xapian::doccount> termfreqs;
+
+    /// The last term added.
+    std::string last_term;
+
+  public:
+    /** Add a term.
+     *
+     *  Terms must be added in ascending byte order.
+     */
+    void add(const std::string & term, Xapian::doccount termfreq);
+
+    /// Append all the terms starting with @a prefix to @a out.
+    void get_terms(const std::string & prefix,
+		   std::vector<TermAndFreq> & out) const;
+
+    /// Return the number of terms.
+    size_t size() const { return termfreqs.size(); }
+
+    /// Swap the contents with another PrefixDictionary.
+    void swap(PrefixDictionary & o);
+};
+
+/** A size-bounded cache of wildcard expansions, shared by all QueryParser
+ *  objects in the process.
+ *
+ *  An entry holds all the terms in a database starting with a particular
+ *  string, so a wildcard (or a longer wildcard starting with the same
+ *  string) can be expanded without iterating the database's terms.  The
+ *  database is identified by its revision key, so entries for a database
+ *  which has since been updated stop being used and get evicted as they
+ *  fall out of use.
+ *
+ *  The cache is enabled by setting XAPIAN_WILDCARD_CACHE_SIZE in the
+ *  environment to the maximum total number of terms to hold.
+ */
+class WildcardCache {
+    /// Don't allow copying.
+    WildcardCache(const WildcardCache &);
+
+    /// Don't allow assignment.
+    void operator=(const WildcardCache &);
+
+    struct Key {
+	std::string db_key;
+
+	std::string root;
+
+	Key(const std::string & db_key_, const std::string & root_)
+	    : db_key(db_key_), root(root_) { }
+
+	bool operator<(const Key & o) const {
+	    if (db_key != o.db_key) return db_key < o.db_key;
+	    return root < o.root;
+	}
+    };
+
+    /// Map from the database and root to the expansion.
+    LRUCache<Key, PrefixDictionary> entries;
+
+    /// The total number of terms in all the entries.
+    size_t size;
+
+    /// The maximum total number of terms.
+    size_t capacity;
+
+    /// Number of successful lookups.
+    unsigned long hits;
+
+    /// Number of unsuccessful lookups.
+    unsigned long misses;
+
+    /// Protects all the above.
+    mutable Mutex mutex;
+
+  public:
+    /// Create a cache holding up to @a capacity_ terms.
+    explicit WildcardCache(size_t capacity_)
+	: size(0), capacity(capacity_), hits(0), misses(0) { }
+
+    /** Return the process-wide cache.
+     *
+     *  @return NULL if the cache isn't enabled.
+     */
+    static WildcardCache * get_instance();
+
+    /** Look up the terms starting with @a root.
+     *
+     *  An entry for @a root or for any prefix of it can be used.
+     *
+     *  @param db_key	Key identifying the database and its revision.
+     *  @param root	The string the terms must start with.
+     *  @param[out] out	The terms and their frequencies, if found.
+     *
+     *  @return true if an entry was found.
+     */
+    bool read(const std::string & db_key, const std::string & root,
+	      std::vector<TermAndFreq> & out);
+
+    /** Add the terms starting with @a root to the cache.
+     *
+     *  @param terms	All the terms starting with @a root, in ascending
+     *			order.
+     */
+    void add(const std::string & db_key, const std::string & root,
+	     const std::vector<TermAndFreq> & terms);
+
+    /// Return the number of lookups which found an entry.
+    unsigned long get_hits() const;
+
+    /// Return the number of lookups which didn't find an entry.
+    unsigned long get_misses() const;
+
+    /// Return the total number of terms currently held.
+    size_t get_size() const;
+
+    /// Return the maximum total number of terms to hold.
+    size_t get_capacity() const { return capacity; }
+};
+
+#endif // XAPIAN_INCLUDED_WILDCARDCACHE_H
@@ -2450,3 +2450,244 @@ DEFINE_TESTCASE(uuid1, backend && !multi) {
 
     return true;
 }
+
+/// Check pruning in an OR of many terms doesn't change the top results.
+DEFINE_TESTCASE(multior1, backend) {
+    Xapian::Database db(get_database("etext"));
+    Xapian::Enquire enquire(db);
+    static const char * const terms[] = {
+	"the", "and", "king", "prussian", "friedrich", "army", "battle", "war"
+    };
+    const size_t n_terms = sizeof(terms) / sizeof(terms[0]);
+    Xapian::Query query(Xapian::Query::OP_OR, terms, terms + n_terms);
+
+    for (int i = 0; i < 3; ++i) {
+	Xapian::Query q = query;
+	if (i == 1) {
+	    // Check an n-way OR under AND_MAYBE, so it is passed a reduced
+	    // minimum weight.
+	    q = Xapian::Query(q.OP_AND_MAYBE, Xapian::Query("prussian"), q);
+	} else if (i == 2) {
+	    q = Xapian::Query(q.OP_ELITE_SET, terms, terms + n_terms, 5);
+	}
+	enquire.set_query(q);
+	// Asking for all the matches means there's no minimum weight to prune
+	// with.
+	Xapian::MSet full = enquire.get_mset(0, db.get_doccount());
+	for (Xapian::doccount k = 1; k <= 20; k += 3) {
+	    tout << "Query " << q.get_description() << " top " << k << endl;
+	    Xapian::MSet top = enquire.get_mset(0, k);
+	    TEST_EQUAL(top.size(), min(k, full.size()));
+	    TEST(mset_range_is_same(top, 0, full, 0, top.size()));
+	}
+    }
+
+    return true;
+}
+
+/// Check matching sub-databases on several threads gives the same results.
+DEFINE_TESTCASE(parallelmatch1, backend && !remote) {
+    Xapian::Database db(get_database("etext"));
+    db.add_database(get_database("apitest_simpledata"));
+    db.add_database(get_database("apitest_phrase"));
+    db.add_database(get_database("apitest_simpledata2"));
+    static const char * const terms[] = {
+	"the", "and", "of", "this", "is", "word", "paragraph", "prussian"
+    };
+    const size_t n_terms = sizeof(terms) / sizeof(terms[0]);
+    Xapian::Query query(Xapian::Query::OP_OR, terms, terms + n_terms);
+
+    for (int i = 0; i < 4; ++i) {
+	Xapian::MSet msets[2];
+	Xapian::ValueCountMatchSpy spy0(13), spy1(13);
+	Xapian::ValueCountMatchSpy * spies[2] = { &spy0, &spy1 };
+	for (int j = 0; j < 2; ++j) {
+	    Xapian::Enquire enquire(db);
+	    enquire.set_query(query);
+	    enquire.set_parallelism(j ? 3 : 1);
+	    Xapian::doccount check_at_least = 0;
+	    switch (i) {
+		case 1:
+		    enquire.set_sort_by_value_then_relevance(11, true);
+		    break;
+		case 2:
+		    enquire.set_collapse_key(13);
+		    break;
+		case 3:
+		    enquire.add_matchspy(spies[j]);
+		    // Make sure the matchspies see all the matches.
+		    check_at_least = db.get_doccount();
+		    break;
+	    }
+	    msets[j] = enquire.get_mset(2, 10, check_at_least);
+	}
+	tout << "Case " << i << endl;
+	TEST_EQUAL(msets[0].size(), msets[1].size());
+	TEST(mset_range_is_same(msets[0], 0, msets[1], 0, msets[0].size()));
+	if (i == 3) {
+	    TEST_EQUAL(spy0.get_total(), spy1.get_total());
+	    TEST_EQUAL(spy0.get_description(), spy1.get_description());
+	    Xapian::TermIterator t0 = spy0.values_begin();
+	    Xapian::TermIterator t1 = spy1.values_begin();
+	    while (t0 != spy0.values_end()) {
+		TEST(t1 != spy1.values_end());
+		TEST_EQUAL(*t0, *t1);
+		TEST_EQUAL(t0.get_termfreq(), t1.get_termfreq());
+		++t0;
+		++t1;
+	    }
+	    TEST(t1 == spy1.values_end());
+	}
+    }
+
+    return true;
+}
+
+/// Test splitting a single database into docid ranges to match in parallel.
+DEFINE_TESTCASE(parallelmatch2, backend && !remote) {
+    Xapian::Database db(get_database("etext"));
+    static const char * const terms[] = {
+	"the", "and", "of", "this", "word", "paragraph", "prussian"
+    };
+    const size_t n_terms = sizeof(terms) / sizeof(terms[0]);
+    Xapian::Query query(Xapian::Query::OP_OR, terms, terms + n_terms);
+
+    for (int i = 0; i < 4; ++i) {
+	Xapian::MSet msets[2];
+	Xapian::ValueCountMatchSpy spy0(13), spy1(13);
+	Xapian::ValueCountMatchSpy * spies[2] = { &spy0, &spy1 };
+	for (int j = 0; j < 2; ++j) {
+	    Xapian::Enquire enquire(db);
+	    enquire.set_query(query);
+	    enquire.set_parallelism(j ? 4 : 1);
+	    Xapian::doccount check_at_least = 0;
+	    switch (i) {
+		case 1:
+		    enquire.set_sort_by_value_then_relevance(11, true);
+		    break;
+		case 2:
+		    enquire.set_collapse_key(13);
+		    break;
+		case 3:
+		    enquire.add_matchspy(spies[j]);
+		    // Make sure the matchspies see all the matches.
+		    check_at_least = db.get_doccount();
+		    break;
+	    }
+	    msets[j] = enquire.get_mset(5, 20, check_at_least);
+	}
+	tout << "Case " << i << endl;
+	TEST_EQUAL(msets[0].size(), msets[1].size());
+	TEST(mset_range_is_same(msets[0], 0, msets[1], 0, msets[0].size()));
+	TEST_REL(msets[1].get_matches_lower_bound(),<=,
+		 msets[1].get_matches_estimated());
+	TEST_REL(msets[1].get_matches_estimated(),<=,
+		 msets[1].get_matches_upper_bound());
+	if (i == 3) {
+	    TEST_EQUAL(msets[0].get_matches_estimated(),
+		       msets[1].get_matches_estimated());
+	    TEST_EQUAL(spy0.get_total(), spy1.get_total());
+	    TEST_EQUAL(spy0.get_description(), spy1.get_description());
+	}
+    }
+
+    return true;
+}
+
+/// Check splitting a database into ranges doesn't loosen exact bounds.
+DEFINE_TESTCASE(parallelmatch5, backend && !remote) {
+    Xapian::Database db(get_database("etext"));
+    static const char * const terms[] = { "the", "prussian", "mention" };
+    for (size_t i = 0; i != sizeof(terms) / sizeof(terms[0]); ++i) {
+	Xapian::Query query(terms[i]);
+	Xapian::doccount tf = db.get_termfreq(terms[i]);
+	for (unsigned parallelism = 1; parallelism <= 4; parallelism *= 2) {
+	    Xapian::Enquire enquire(db);
+	    enquire.set_query(query);
+	    enquire.set_parallelism(parallelism);
+	    Xapian::MSet mset = enquire.get_mset(0, 10);
+	    tout << query.get_description() << " parallelism " << parallelism
+		 << endl;
+	    TEST_EQUAL(mset.get_matches_lower_bound(), tf);
+	    TEST_EQUAL(mset.get_matches_estimated(), tf);
+	    TEST_EQUAL(mset.get_matches_upper_bound(), tf);
+	}
+    }
+
+    return true;
+}
+
+/// Check a match spy sees each match once when sorting by value in parallel.
+DEFINE_TESTCASE(parallelmatch4, backend && !remote) {
+    Xapian::Database db(get_database("etext"));
+    db.add_database(get_database("apitest_simpledata"));
+    static const char * const terms[] = { "the", "and", "of", "this" };
+    Xapian::Query query(Xapian::Query::OP_OR, terms, terms + 4);
+
+    Xapian::doccount expected_total = 0;
+    string expected_description;
+    for (unsigned parallelism = 1; parallelism <= 4; parallelism *= 2) {
+	Xapian::ValueCountMatchSpy spy(13);
+	Xapian::Enquire enquire(db);
+	enquire.set_query(query);
+	enquire.set_parallelism(parallelism);
+	enquire.set_sort_by_value(11, false);
+	enquire.add_matchspy(&spy);
+	// Ask for only a few items so that most candidates sort lower than
+	// the lowest item in the proto-MSet.
+	Xapian::MSet mset = enquire.get_mset(0, 5, db.get_doccount());
+	tout << "parallelism " << parallelism << endl;
+	TEST_EQUAL(mset.size(), 5);
+	TEST_EQUAL(spy.get_total(), mset.get_matches_estimated());
+	if (parallelism == 1) {
+	    expected_total = spy.get_total();
+	    expected_description = spy.get_description();
+	} else {
+	    TEST_EQUAL(spy.get_total(), expected_total);
+	    TEST_EQUAL(spy.get_description(), expected_description);
+	}
+    }
+
+    return true;
+}
+
+/// Test profiling the match.
+DEFINE_TESTCASE(profile1, backend && !remote) {
+    Xapian::Database db(get_database("etext"));
+    static const char * const terms[] = { "the", "paragraph", "prussian" };
+    Xapian::Query query(Xapian::Query::OP_OR, terms, terms + 3);
+    query = Xapian::Query(Xapian::Query::OP_AND_NOT, query,
+			  Xapian::Query("word"));
+
+    Xapian::Enquire enquire(db);
+    enquire.set_query(query);
+    TEST(enquire.get_profile().empty());
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST(enquire.get_profile().empty());
+
+    enquire.set_profiling(true);
+    Xapian::MSet mset_profiled = enquire.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), mset_profiled.size());
+    TEST(mset_range_is_same(mset, 0, mset_profiled, 0, mset.size()));
+
+    string profile = enquire.get_profile();
+    tout << profile;
+    TEST(startswith(profile, "Database 0: next="));
+    TEST_STRINGS_EQUAL(profile.substr(profile.size() - 3), "ms\n");
+    TEST(profile.find("\n  AND_NOT: next=") != string::npos);
+    TEST(profile.find("\n    OR: next=") != string::npos);
+    TEST(profile.find("\n      prussian: next=") != string::npos);
+    TEST(profile.find("\n    word: ") != string::npos);
+    if (get_dbtype() == "brass") {
+	// The root node reports the reads done by all the leaves.
+	string root(profile, 0, profile.find('\n'));
+	TEST(root.find(" postings=0 ") == string::npos);
+	TEST(root.find(" chunks=0 ") == string::npos);
+    }
+
+    enquire.set_profiling(false);
+    (void)enquire.get_mset(0, 10);
+    TEST(enquire.get_profile().empty());
+
+    return true;
+}
@@ -958,3 +958,311 @@ DEFINE_TESTCASE(newfreelistblock1, writable) {
 
     return true;
 }
+
+/// Regression test for brass freelists which span several blocks.
+DEFINE_TESTCASE(newfreelistblock2, brass) {
+    string path = get_named_writable_database_path("newfreelistblock2");
+    // Use the smallest block size so the freelist needs lots of blocks.
+    Xapian::WritableDatabase wdb(path,
+				 Xapian::DB_CREATE_OR_OVERWRITE|
+				 Xapian::DB_BACKEND_BRASS,
+				 2048);
+    for (int round = 0; round < 6; ++round) {
+	for (Xapian::docid did = 1; did <= 2000; ++did) {
+	    Xapian::Document doc;
+	    for (Xapian::docid i = 0; i < 20; ++i) {
+		doc.add_term("T" + str((did * 7 + i * 13 + round) % 500));
+	    }
+	    doc.set_data(str(did) + "/" + str(round));
+	    wdb.replace_document(did, doc);
+	}
+	wdb.commit();
+    }
+    wdb.close();
+
+    TEST_EQUAL(Xapian::Database::check(path), 0);
+    return true;
+}
+
+/// Feature test for Xapian::DB_MMAP.
+DEFINE_TESTCASE(mmap1, brass) {
+    Xapian::WritableDatabase wdb = get_named_writable_database("mmap1");
+    string path = get_named_writable_database_path("mmap1");
+    Xapian::Document doc;
+    for (int i = 0; i < 100; ++i) {
+	doc.add_term("T" + str(i));
+    }
+    for (Xapian::docid did = 1; did <= 200; ++did) {
+	doc.set_data(str(did));
+	wdb.add_document(doc);
+    }
+    wdb.commit();
+
+    Xapian::Database db(path, Xapian::DB_MMAP);
+    TEST_EQUAL(db.get_doccount(), 200);
+    TEST_EQUAL(db.get_termfreq("T42"), 200);
+    TEST_EQUAL(db.get_document(123).get_data(), "123");
+    Xapian::PostingIterator p = db.postlist_begin("T99");
+    for (Xapian::docid did = 1; did <= 200; ++did) {
+	TEST(p != db.postlist_end("T99"));
+	TEST_EQUAL(*p, did);
+	++p;
+    }
+    TEST(p == db.postlist_end("T99"));
+
+    // Extend the DB files so that some blocks are beyond the mapping, and
+    // check that reopen() picks up the changes.
+    for (Xapian::docid did = 201; did <= 2000; ++did) {
+	doc.set_data(str(did));
+	wdb.add_document(doc);
+    }
+    wdb.commit();
+    TEST(db.reopen());
+    TEST_EQUAL(db.get_doccount(), 2000);
+    TEST_EQUAL(db.get_termfreq("T42"), 2000);
+    TEST_EQUAL(db.get_document(1999).get_data(), "1999");
+    Xapian::doccount count = 0;
+    for (p = db.postlist_begin("T7"); p != db.postlist_end("T7"); ++p) {
+	TEST_EQUAL(*p, ++count);
+    }
+    TEST_EQUAL(count, 2000);
+
+    // Check the flag is accepted, and ignored, by WritableDatabase.
+    wdb.close();
+    Xapian::WritableDatabase wdb2(path, Xapian::DB_OPEN|Xapian::DB_MMAP);
+    TEST_EQUAL(wdb2.get_doccount(), 2000);
+    return true;
+}
+
+/// Check compressed tags survive writing, reading and compaction.
+DEFINE_TESTCASE(compressedtags1, brass) {
+    Xapian::WritableDatabase wdb =
+	get_named_writable_database("compressedtags1");
+    string path = get_named_writable_database_path("compressedtags1");
+    for (int i = 1; i <= 20; ++i) {
+	Xapian::Document doc;
+	string data;
+	for (int j = 0; j < 500; ++j) {
+	    data += "some very compressible data ";
+	    data += str(i);
+	}
+	doc.set_data(data);
+	for (int j = 0; j < 200; ++j) {
+	    doc.add_term("term" + str(j * i));
+	}
+	wdb.add_document(doc);
+    }
+    wdb.commit();
+
+    string out = get_named_writable_database_path("compressedtags1out");
+    rm_rf(out);
+    {
+	Xapian::Compactor compact;
+	compact.set_destdir(out);
+	compact.add_source(path);
+	compact.compact();
+    }
+
+    Xapian::Database db(path);
+    Xapian::Database cdb(out);
+    for (Xapian::docid did = 1; did <= 20; ++did) {
+	Xapian::Document doc = db.get_document(did);
+	TEST_EQUAL(doc.get_data().size(),
+		   500 * (28 + str(did).size()));
+	TEST_EQUAL(doc.get_data(), cdb.get_document(did).get_data());
+	TEST_EQUAL(doc.termlist_count(), 200);
+	Xapian::TermIterator t = cdb.termlist_begin(did);
+	for (Xapian::TermIterator i = doc.termlist_begin();
+	     i != doc.termlist_end(); ++i) {
+	    TEST(t != cdb.termlist_end(did));
+	    TEST_EQUAL(*i, *t);
+	    ++t;
+	}
+	TEST(t == cdb.termlist_end(did));
+    }
+    return true;
+}
+
+/// Test caching match results with MSetCache.
+DEFINE_TESTCASE(msetcache1, brass || chert) {
+    Xapian::Database db(get_database("etext"));
+    static const char * const terms[] = { "the", "word", "prussian" };
+    Xapian::Query query(Xapian::Query::OP_OR, terms, terms + 3);
+
+    Xapian::Enquire enquire(db);
+    enquire.set_query(query);
+    Xapian::MSet page1 = enquire.get_mset(0, 10);
+    Xapian::MSet page2 = enquire.get_mset(10, 10);
+    Xapian::MSet page3 = enquire.get_mset(15, 10);
+
+    Xapian::MSetCache cache(10, 20);
+    enquire.set_mset_cache(&cache);
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST_EQUAL(cache.size(), 1);
+    TEST_EQUAL(cache.get_hits(), 0);
+    TEST_EQUAL(cache.get_misses(), 1);
+    TEST_EQUAL(mset.size(), page1.size());
+    TEST(mset_range_is_same(mset, 0, page1, 0, page1.size()));
+    TEST_EQUAL(mset.get_termfreq("word"), page1.get_termfreq("word"));
+    TEST_EQUAL_DOUBLE(mset.get_termweight("word"),
+		      page1.get_termweight("word"));
+
+    // The second page should be served from the cache, by another Enquire.
+    Xapian::Enquire enquire2(db);
+    enquire2.set_query(query);
+    enquire2.set_mset_cache(&cache);
+    mset = enquire2.get_mset(10, 10);
+    TEST_EQUAL(cache.get_hits(), 1);
+    TEST_EQUAL(mset.get_firstitem(), 10);
+    TEST_EQUAL(mset.size(), page2.size());
+    TEST(mset_range_is_same(mset, 0, page2, 0, page2.size()));
+    TEST_EQUAL(mset[0].get_document().get_data(),
+	       page2[0].get_document().get_data());
+    TEST_EQUAL(mset.convert_to_percent(mset[0]),
+	       page2.convert_to_percent(page2[0]));
+
+    // This needs more results than are cached, so the entry is replaced.
+    mset = enquire2.get_mset(15, 10);
+    TEST_EQUAL(cache.get_hits(), 1);
+    TEST_EQUAL(cache.get_misses(), 2);
+    TEST_EQUAL(cache.size(), 1);
+    TEST(mset_range_is_same(mset, 0, page3, 0, page3.size()));
+
+    // Changing a setting which affects the results should miss.
+    enquire2.set_weighting_scheme(Xapian::BM25Weight(2, 0, 1, 0.5, 0.5));
+    mset = enquire2.get_mset(0, 10);
+    TEST_EQUAL(cache.get_misses(), 3);
+    TEST_EQUAL(cache.size(), 2);
+
+    // Searches with a MatchDecider aren't cached.
+    Xapian::ValueSetMatchDecider decider(1, true);
+    decider.add_value("hello");
+    mset = enquire.get_mset(0, 10, 0, NULL, &decider);
+    TEST_EQUAL(cache.get_hits(), 1);
+    TEST_EQUAL(cache.get_misses(), 3);
+
+    enquire.set_mset_cache(NULL);
+    mset = enquire.get_mset(0, 10);
+    TEST_EQUAL(cache.get_hits(), 1);
+    TEST_EQUAL(cache.get_misses(), 3);
+
+    cache.clear();
+    TEST_EQUAL(cache.size(), 0);
+
+    return true;
+}
+
+/// Test MSetCache doesn't return results from an older revision.
+DEFINE_TESTCASE(msetcache2, brass || chert) {
+    Xapian::WritableDatabase wdb = get_named_writable_database("msetcache2");
+    Xapian::Document doc;
+    doc.add_term("foo");
+    wdb.add_document(doc);
+    wdb.commit();
+
+    Xapian::MSetCache cache;
+    Xapian::Database db(get_named_writable_database_path("msetcache2"));
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("foo"));
+    enquire.set_mset_cache(&cache);
+    TEST_EQUAL(enquire.get_mset(0, 10).size(), 1);
+    TEST_EQUAL(enquire.get_mset(0, 10).size(), 1);
+    TEST_EQUAL(cache.get_misses(), 1);
+    TEST_EQUAL(cache.get_hits(), 1);
+
+    wdb.add_document(doc);
+    // The writable database may have uncommitted changes, so isn't cached.
+    Xapian::Enquire wenquire(wdb);
+    wenquire.set_query(Xapian::Query("foo"));
+    wenquire.set_mset_cache(&cache);
+    TEST_EQUAL(wenquire.get_mset(0, 10).size(), 2);
+    TEST_EQUAL(cache.get_misses(), 1);
+    wdb.commit();
+
+    // Until reopened, the reader still sees the old revision.
+    TEST_EQUAL(enquire.get_mset(0, 10).size(), 1);
+    TEST_EQUAL(cache.get_hits(), 2);
+    db.reopen();
+    TEST_EQUAL(enquire.get_mset(0, 10).size(), 2);
+    TEST_EQUAL(cache.get_misses(), 2);
+    TEST_EQUAL(cache.get_hits(), 2);
+
+    return true;
+}
+
+/// Test matching docid ranges in parallel still works after reopening.
+DEFINE_TESTCASE(parallelmatch3, brass) {
+    Xapian::WritableDatabase wdb = get_named_writable_database("parallelmatch3");
+    Xapian::Document doc;
+    doc.add_term("foo");
+    for (int i = 0; i != 100; ++i) wdb.add_document(doc);
+    wdb.commit();
+
+    Xapian::Database db(get_named_writable_database_path("parallelmatch3"));
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("foo"));
+    enquire.set_parallelism(4);
+    TEST_EQUAL(enquire.get_mset(0, 200).size(), 100);
+    // The other instances of the database are reused for a second match.
+    TEST_EQUAL(enquire.get_mset(0, 200).size(), 100);
+
+    for (int i = 0; i != 50; ++i) wdb.add_document(doc);
+    wdb.commit();
+    // Until reopened, the reader still sees the old revision.
+    TEST_EQUAL(enquire.get_mset(0, 200).size(), 100);
+    db.reopen();
+    TEST_EQUAL(enquire.get_mset(0, 200).size(), 150);
+
+    return true;
+}
+
+/// Test reading the statistics for the process-wide caches.
+DEFINE_TESTCASE(cachestats1, brass) {
+    Xapian::Database db = get_database("apitest_simpledata");
+    Xapian::CacheStats before(Xapian::CacheStats::TERMFREQ_CACHE);
+    tout << before.get_description() << endl;
+    if (!before.is_enabled()) {
+	TEST_EQUAL(before.get_hits(), 0);
+	TEST_EQUAL(before.get_misses(), 0);
+	TEST_EQUAL(before.get_size(), 0);
+	TEST_EQUAL(before.get_capacity(), 0);
+	TEST_STRINGS_EQUAL(before.get_description(), "CacheStats(disabled)");
+	SKIP_TEST("XAPIAN_TERMFREQ_CACHE_SIZE isn't set");
+    }
+
+    // Look up a term which this process is unlikely to have looked up before
+    // twice - the first should miss and the second hit.
+    db.get_termfreq("cachestats1");
+    db.get_termfreq("cachestats1");
+    Xapian::CacheStats after(Xapian::CacheStats::TERMFREQ_CACHE);
+    tout << after.get_description() << endl;
+    TEST_REL(after.get_misses(),>,before.get_misses());
+    TEST_REL(after.get_hits(),>,before.get_hits());
+    TEST_REL(after.get_size(),<=,after.get_capacity());
+
+    return true;
+}
+
+/// Check CacheStats reports on the wildcard cache.
+DEFINE_TESTCASE(cachestats2, brass) {
+    Xapian::Database db = get_database("apitest_simpledata");
+    Xapian::CacheStats before(Xapian::CacheStats::WILDCARD_CACHE);
+    tout << before.get_description() << endl;
+    if (!before.is_enabled()) {
+	TEST_EQUAL(before.get_size(), 0);
+	TEST_STRINGS_EQUAL(before.get_description(), "CacheStats(disabled)");
+	SKIP_TEST("XAPIAN_WILDCARD_CACHE_SIZE isn't set");
+    }
+
+    Xapian::QueryParser qp;
+    qp.set_database(db);
+    Xapian::Query q1 = qp.parse_query("wor*", qp.FLAG_WILDCARD);
+    // A longer wildcard can be answered from the entry for a shorter one.
+    Xapian::Query q2 = qp.parse_query("word*", qp.FLAG_WILDCARD);
+    Xapian::CacheStats after(Xapian::CacheStats::WILDCARD_CACHE);
+    tout << after.get_description() << endl;
+    TEST_REL(after.get_hits(),>,before.get_hits());
+    TEST_REL(after.get_size(),<=,after.get_capacity());
+
+    return true;
+}
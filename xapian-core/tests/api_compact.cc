@@ -584,3 +584,61 @@ DEFINE_TESTCASE(compactmultipass1, brass || chert) {
 
     return true;
 }
+
+// Test building a database in shards and compacting them, as described in
+// admin_notes.rst.
+DEFINE_TESTCASE(compactshards1, brass) {
+    Xapian::Database indb(get_database("apitest_simpledata"));
+    string outdbpath = get_named_writable_database_path("compactshards1");
+    rm_rf(outdbpath);
+
+    Xapian::Compactor compact;
+    compact.set_destdir(outdbpath);
+    // Use small shards so there are enough to need a multipass merge.
+    Xapian::docid did = 1;
+    for (int shard = 0; did <= indb.get_lastdocid(); ++shard) {
+	string shardpath = outdbpath + "_shard" + str(shard);
+	rm_rf(shardpath);
+	Xapian::WritableDatabase db(shardpath,
+				    Xapian::DB_CREATE|Xapian::DB_BACKEND_BRASS|
+				    Xapian::DB_NO_SYNC|Xapian::DB_DANGEROUS);
+	for (int i = 0; i != 2 && did <= indb.get_lastdocid(); ++i, ++did) {
+	    db.add_document(indb.get_document(did));
+	}
+	if (shard == 0) db.set_metadata("foo", "bar");
+	db.commit();
+	compact.add_source(shardpath);
+    }
+    compact.set_multipass(true);
+    compact.compact();
+
+    Xapian::Database outdb(outdbpath);
+    TEST_EQUAL(indb.get_doccount(), outdb.get_doccount());
+    TEST_EQUAL(indb.get_lastdocid(), outdb.get_lastdocid());
+    TEST_EQUAL(indb.get_avlength(), outdb.get_avlength());
+    TEST_EQUAL(outdb.get_metadata("foo"), "bar");
+    dbcheck(outdb, outdb.get_doccount(), outdb.get_lastdocid());
+
+    for (did = 1; did <= indb.get_lastdocid(); ++did) {
+	Xapian::Document in_doc = indb.get_document(did);
+	Xapian::Document out_doc = outdb.get_document(did);
+	TEST_EQUAL(in_doc.get_data(), out_doc.get_data());
+	TEST_EQUAL(in_doc.termlist_count(), out_doc.termlist_count());
+	Xapian::TermIterator t = in_doc.termlist_begin();
+	Xapian::TermIterator u = out_doc.termlist_begin();
+	while (t != in_doc.termlist_end()) {
+	    TEST_EQUAL(*t, *u);
+	    TEST_EQUAL(t.get_wdf(), u.get_wdf());
+	    ++t;
+	    ++u;
+	}
+    }
+
+    for (Xapian::TermIterator t = indb.allterms_begin();
+	 t != indb.allterms_end(); ++t) {
+	TEST_EQUAL(t.get_termfreq(), outdb.get_termfreq(*t));
+	TEST_EQUAL(indb.get_collection_freq(*t), outdb.get_collection_freq(*t));
+    }
+
+    return true;
+}
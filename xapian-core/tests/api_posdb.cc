@@ -24,12 +24,14 @@
 
 #include "api_posdb.h"
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
 using namespace std;
 
 #include <xapian.h>
+#include "str.h"
 #include "testsuite.h"
 #include "testutils.h"
 
@@ -469,6 +471,89 @@ DEFINE_TESTCASE(phrase2, positional) {
     return true;
 }
 
+static Xapian::Query
+make_phrase(const char * a, const char * b)
+{
+    const char * terms[] = { a, b };
+    return Xapian::Query(Xapian::Query::OP_PHRASE, terms, terms + 2);
+}
+
+/// Test exact phrases where the position lists differ greatly in length.
+DEFINE_TESTCASE(exactphrase1, positional && writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    Xapian::termpos p;
+    Xapian::Document doc;
+    for (p = 1; p <= 1000; ++p) doc.add_posting("x", p);
+    doc.add_posting("y", 500);
+    doc.add_posting("y", 777);
+    db.add_document(doc);
+
+    doc.clear_terms();
+    for (p = 2; p <= 2000; p += 2) doc.add_posting("x", p);
+    doc.add_posting("y", 1001);
+    db.add_document(doc);
+
+    doc.clear_terms();
+    for (p = 2; p <= 2000; p += 2) doc.add_posting("x", p);
+    doc.add_posting("y", 1000);
+    doc.add_posting("y", 1500);
+    db.add_document(doc);
+
+    doc.clear_terms();
+    doc.add_posting("z", 1);
+    for (p = 2; p <= 200; ++p) doc.add_posting("x", p);
+    db.add_document(doc);
+
+    doc.clear_terms();
+    for (p = 1; p <= 100; p += 2) {
+	doc.add_posting("x", p);
+	doc.add_posting("w", p + 1);
+    }
+    db.add_document(doc);
+
+    // Give 'y' a misleadingly high wdf so it is checked after 'x'.
+    doc.clear_terms();
+    for (p = 1; p < 1000; ++p) doc.add_posting("x", p);
+    doc.add_posting("y", 1000, 2000);
+    db.add_document(doc);
+
+    // Make sure 'x' doesn't index every document, otherwise with BoolWeight
+    // it gets replaced by the all documents postlist.
+    doc.clear_terms();
+    doc.add_posting("w", 1);
+    db.add_document(doc);
+
+    db.commit();
+
+    Xapian::Enquire enquire(db);
+    enquire.set_weighting_scheme(Xapian::BoolWeight());
+
+    enquire.set_query(make_phrase("x", "y"));
+    mset_expect_order(enquire.get_mset(0, 10), 1, 2, 6);
+
+    enquire.set_query(make_phrase("y", "x"));
+    mset_expect_order(enquire.get_mset(0, 10), 1, 2);
+
+    enquire.set_query(make_phrase("y", "y"));
+    mset_expect_order(enquire.get_mset(0, 10));
+
+    enquire.set_query(make_phrase("x", "z"));
+    mset_expect_order(enquire.get_mset(0, 10));
+
+    enquire.set_query(make_phrase("z", "x"));
+    mset_expect_order(enquire.get_mset(0, 10), 4);
+
+    static const char * const xxy[] = { "x", "x", "y" };
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_PHRASE, xxy, xxy + 3));
+    mset_expect_order(enquire.get_mset(0, 10), 1, 6);
+
+    static const char * const xwxw[] = { "x", "w", "x", "w" };
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_PHRASE, xwxw, xwxw + 4));
+    mset_expect_order(enquire.get_mset(0, 10), 5);
+
+    return true;
+}
+
 /// Test getting position lists from databases
 DEFINE_TESTCASE(poslist1, positional) {
     Xapian::Database mydb(get_database("apitest_poslist"));
@@ -611,6 +696,74 @@ DEFINE_TESTCASE(poslist3, positional && writable) {
     return true;
 }
 
+static void
+check_poslist4(const Xapian::Database & db)
+{
+    Xapian::PositionIterator pl = db.positionlist_begin(1, "foo");
+    Xapian::PositionIterator pl_end = db.positionlist_end(1, "foo");
+    for (Xapian::termpos p = 3; p < 300; p += 3) {
+	TEST(pl != pl_end);
+	TEST_EQUAL(*pl, p);
+	++pl;
+    }
+    TEST(pl != pl_end);
+    TEST_EQUAL(*pl, 100000);
+    ++pl;
+    TEST(pl == pl_end);
+
+    pl = db.positionlist_begin(1, "foo");
+    pl.skip_to(3);
+    TEST_EQUAL(*pl, 3);
+    pl.skip_to(100);
+    TEST_EQUAL(*pl, 102);
+    pl.skip_to(101);
+    TEST_EQUAL(*pl, 102);
+    ++pl;
+    TEST_EQUAL(*pl, 105);
+    pl.skip_to(298);
+    TEST_EQUAL(*pl, 100000);
+    pl.skip_to(100000);
+    TEST_EQUAL(*pl, 100000);
+    pl.skip_to(100001);
+    TEST(pl == pl_end);
+
+    Xapian::TermIterator t = db.termlist_begin(1);
+    t.skip_to("foo");
+    try {
+	TEST_EQUAL(t.positionlist_count(), 100);
+    } catch (const Xapian::UnimplementedError &) {
+	// Not implemented for remote databases.
+    }
+
+    pl = db.positionlist_begin(1, "bar");
+    TEST_EQUAL(*pl, 0);
+    ++pl;
+    TEST_EQUAL(*pl, 7);
+    ++pl;
+    TEST(pl == db.positionlist_end(1, "bar"));
+}
+
+/// Check long position lists, which brass stores differently.
+DEFINE_TESTCASE(poslist4, positional && writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+
+    Xapian::Document document;
+    // Include a large gap to check values needing several bytes work.
+    for (Xapian::termpos p = 3; p < 300; p += 3)
+	document.add_posting("foo", p);
+    document.add_posting("foo", 100000);
+    document.add_posting("bar", 0);
+    document.add_posting("bar", 7);
+    db.add_document(document);
+
+    // Check both the buffered and committed versions.
+    check_poslist4(db);
+    db.commit();
+    check_poslist4(db);
+
+    return true;
+}
+
 // Regression test - in 0.9.4 (and many previous versions) you couldn't get a
 // PositionIterator from a TermIterator from Database::termlist_begin().
 //
@@ -634,3 +787,208 @@ DEFINE_TESTCASE(positfromtermit1, positional) {
 
     return true;
 }
+
+/// Check phrase searches give the same results when biwords are indexed.
+DEFINE_TESTCASE(biwords1, positional && writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    static const char * const texts[] = {
+	"the cat sat on the mat",
+	"the mat sat on the cat",
+	"a cat on a mat",
+	"the the the cat"
+    };
+    Xapian::TermGenerator termgen;
+    termgen.set_flags(Xapian::TermGenerator::FLAG_BIWORDS);
+    for (size_t i = 0; i != sizeof(texts) / sizeof(texts[0]); ++i) {
+	Xapian::Document doc;
+	termgen.set_document(doc);
+	termgen.index_text(texts[i]);
+	db.add_document(doc);
+    }
+    db.commit();
+
+    static const struct { const char * phrase; const char * docids; } tests[] = {
+	{ "the cat", "1 2 4" },
+	{ "cat sat", "1" },
+	{ "the the", "4" },
+	{ "mat cat", "" },
+	{ "on the mat", "1" },
+	{ "sat on the", "1 2" },
+	{ NULL, NULL }
+    };
+
+    Xapian::Enquire enquire(db);
+    for (size_t i = 0; tests[i].phrase; ++i) {
+	vector<string> terms;
+	string phrase = tests[i].phrase;
+	string::size_type b = 0;
+	while (true) {
+	    string::size_type e = phrase.find(' ', b);
+	    terms.push_back(phrase.substr(b, e - b));
+	    if (e == string::npos) break;
+	    b = e + 1;
+	}
+	Xapian::Query query(Xapian::Query::OP_PHRASE,
+			    terms.begin(), terms.end());
+	enquire.set_query(query);
+	tout << query.get_description() << '\n';
+	Xapian::MSet mset = enquire.get_mset(0, 10);
+	// Sort so we don't depend on the weights.
+	vector<Xapian::docid> sorted;
+	for (Xapian::MSetIterator m = mset.begin(); m != mset.end(); ++m)
+	    sorted.push_back(*m);
+	sort(sorted.begin(), sorted.end());
+	string docids;
+	for (size_t j = 0; j != sorted.size(); ++j) {
+	    if (j) docids += ' ';
+	    docids += str(sorted[j]);
+	}
+	TEST_STRINGS_EQUAL(docids, tests[i].docids);
+    }
+
+    // A two term phrase shouldn't need its positions checked.
+    if (get_dbtype().find("remote") == string::npos) {
+	static const char * const two[] = { "the", "cat" };
+	enquire.set_query(Xapian::Query(Xapian::Query::OP_PHRASE, two, two + 2));
+	enquire.set_profiling(true);
+	TEST_EQUAL(enquire.get_mset(0, 10).size(), 3);
+	string profile = enquire.get_profile();
+	tout << profile;
+	TEST(profile.find("PHRASE") == string::npos);
+	enquire.set_profiling(false);
+    }
+
+    // Check a document indexed without biwords is still found, and that
+    // the biwords are still used for the other documents.
+    Xapian::Document doc;
+    doc.add_posting("the", 1);
+    doc.add_posting("cat", 2);
+    db.add_document(doc);
+    doc.clear_terms();
+    doc.add_posting("cat", 1);
+    doc.add_posting("the", 2);
+    doc.add_posting("mat", 3);
+    db.add_document(doc);
+    db.commit();
+    static const char * const two[] = { "the", "cat" };
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_PHRASE, two, two + 2));
+    bool profile = (get_dbtype().find("remote") == string::npos);
+    enquire.set_profiling(profile);
+    TEST_EQUAL(enquire.get_mset(0, 10).size(), 4);
+    if (profile) {
+	string p = enquire.get_profile();
+	tout << p;
+	TEST(p.find("AND_NOT") != string::npos);
+    }
+    static const char * const three[] = { "cat", "the", "mat" };
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_PHRASE, three, three + 3));
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 1);
+    TEST_EQUAL(*mset.begin(), 6);
+    static const char * const on_the_mat[] = { "on", "the", "mat" };
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_PHRASE,
+				    on_the_mat, on_the_mat + 3));
+    mset = enquire.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 1);
+    TEST_EQUAL(*mset.begin(), 1);
+
+    return true;
+}
+
+/// Check biwords for one field don't stop phrases in other fields matching.
+DEFINE_TESTCASE(biwords2, positional && writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    Xapian::TermGenerator title_termgen;
+    title_termgen.set_flags(Xapian::TermGenerator::FLAG_BIWORDS);
+    Xapian::TermGenerator body_termgen;
+    for (int i = 0; i != 2; ++i) {
+	Xapian::Document doc;
+	title_termgen.set_document(doc);
+	title_termgen.index_text("The Prussian Army", 1, "S");
+	body_termgen.set_document(doc);
+	body_termgen.increase_termpos(100);
+	body_termgen.index_text("the prussian cavalry");
+	db.add_document(doc);
+    }
+    Xapian::Document doc;
+    title_termgen.set_document(doc);
+    title_termgen.index_text("Horses", 1, "S");
+    body_termgen.set_document(doc);
+    body_termgen.increase_termpos(100);
+    body_termgen.index_text("grass");
+    db.add_document(doc);
+    db.commit();
+
+    Xapian::Enquire enquire(db);
+    static const char * const body[] = { "prussian", "cavalry" };
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_PHRASE, body, body + 2));
+    TEST_EQUAL(enquire.get_mset(0, 10).size(), 2);
+
+    static const char * const title[] = { "Sprussian", "Sarmy" };
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_PHRASE, title, title + 2));
+    if (get_dbtype().find("remote") == string::npos)
+	enquire.set_profiling(true);
+    TEST_EQUAL(enquire.get_mset(0, 10).size(), 2);
+    if (get_dbtype().find("remote") == string::npos) {
+	// The title phrase should be checked using the biword.
+	string profile = enquire.get_profile();
+	tout << profile;
+	TEST(profile.find("PHRASE") == string::npos);
+	enquire.set_profiling(false);
+    }
+
+    // A document without the title field shouldn't stop the title biwords
+    // being used.
+    doc.clear_terms();
+    body_termgen.set_document(doc);
+    body_termgen.index_text("prussian army");
+    db.add_document(doc);
+    db.commit();
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_PHRASE, title, title + 2));
+    if (get_dbtype().find("remote") == string::npos)
+	enquire.set_profiling(true);
+    TEST_EQUAL(enquire.get_mset(0, 10).size(), 2);
+    if (get_dbtype().find("remote") == string::npos) {
+	string profile = enquire.get_profile();
+	tout << profile;
+	TEST(profile.find("AND_NOT") != string::npos);
+	enquire.set_profiling(false);
+    }
+
+    // Biwords shouldn't be reachable when expanding a term prefix, or be
+    // suggested by query expansion.
+    Xapian::TermIterator t = db.allterms_begin("Sprussia");
+    TEST(t != db.allterms_end("Sprussia"));
+    TEST_EQUAL(*t, "Sprussian");
+    TEST(++t == db.allterms_end("Sprussia"));
+    Xapian::RSet rset;
+    rset.add_document(1);
+    Xapian::ESet eset = enquire.get_eset(100, rset);
+    for (Xapian::ESetIterator e = eset.begin(); e != eset.end(); ++e) {
+	TEST((*e).find('\0') == string::npos);
+    }
+
+    return true;
+}
+
+/// Check a phrase with a term in every document works with BoolWeight.
+DEFINE_TESTCASE(phraseboolweight1, positional && writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    for (Xapian::termpos i = 0; i != 3; ++i) {
+	Xapian::Document doc;
+	doc.add_posting("cat", 1);
+	doc.add_posting("sat", 2 + i);
+	db.add_document(doc);
+    }
+    db.commit();
+
+    Xapian::Enquire enquire(db);
+    static const char * const terms[] = { "cat", "sat" };
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_PHRASE, terms, terms + 2));
+    enquire.set_weighting_scheme(Xapian::BoolWeight());
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 1);
+    TEST_EQUAL(*mset.begin(), 1);
+
+    return true;
+}
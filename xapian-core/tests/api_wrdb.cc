@@ -2014,3 +2014,664 @@ DEFINE_TESTCASE(modifyvalues1, writable) {
 
     return true;
 }
+
+/// Test buffered posting changes which replace earlier buffered changes.
+DEFINE_TESTCASE(bufferedpostings1, writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    // Enough terms to need the buffered changes to be resized several times.
+    const Xapian::doccount N = 5000;
+    for (Xapian::docid did = 1; did <= 3; ++did) {
+	Xapian::Document doc;
+	for (Xapian::doccount i = 0; i != N; ++i)
+	    doc.add_term("T" + str(i), did);
+	doc.add_term("common");
+	db.add_document(doc);
+    }
+    // Replace documents out of order, including one more than once, and
+    // delete one, all without committing.
+    Xapian::Document doc;
+    doc.add_term("T7", 5);
+    doc.add_term("replaced");
+    db.replace_document(2, doc);
+    db.replace_document(1, doc);
+    doc.add_term("T8");
+    db.replace_document(2, doc);
+    db.delete_document(3);
+
+    // Looking at a postlist flushes just that term's changes.
+    TEST_EQUAL(db.get_termfreq("T7"), 2);
+    Xapian::PostingIterator p = db.postlist_begin("T7");
+    TEST(p != db.postlist_end("T7"));
+    TEST_EQUAL(*p, 1);
+    TEST_EQUAL(p.get_wdf(), 5);
+    ++p;
+    TEST(p != db.postlist_end("T7"));
+    TEST_EQUAL(*p, 2);
+    TEST_EQUAL(p.get_wdf(), 5);
+    ++p;
+    TEST(p == db.postlist_end("T7"));
+
+    // Looking at terms with a prefix flushes all the changes for them.
+    Xapian::doccount count = 0;
+    for (Xapian::TermIterator t = db.allterms_begin("T1");
+	 t != db.allterms_end("T1"); ++t) {
+	++count;
+    }
+    TEST_EQUAL(count, 0);
+
+    db.commit();
+    TEST_EQUAL(db.get_doccount(), 2);
+    TEST_EQUAL(db.get_termfreq("T8"), 1);
+    TEST_EQUAL(db.get_termfreq("T9"), 0);
+    TEST_EQUAL(db.get_termfreq("replaced"), 2);
+    TEST_EQUAL(db.get_termfreq("common"), 0);
+    TEST_EQUAL(db.get_collection_freq("T7"), 10);
+    Xapian::doccount terms = 0;
+    for (Xapian::TermIterator t = db.allterms_begin();
+	 t != db.allterms_end(); ++t) {
+	++terms;
+    }
+    TEST_EQUAL(terms, 3);
+
+    return true;
+}
+
+/// Check WritableDatabase::get_memory_used() tracks pending changes.
+DEFINE_TESTCASE(memoryused1, brass || chert) {
+    Xapian::WritableDatabase db = get_writable_database();
+    TEST_EQUAL(db.get_memory_used(), 0);
+
+    Xapian::Document doc;
+    doc.add_term("foo");
+    doc.add_term("bar", 2);
+    doc.add_value(1, "value");
+    db.add_document(doc);
+    size_t used = db.get_memory_used();
+    TEST_REL(used,>,0);
+
+    for (int i = 0; i < 100; ++i) {
+	doc.add_term("T" + str(i));
+	db.add_document(doc);
+    }
+    TEST_REL(db.get_memory_used(),>,used);
+
+    db.commit();
+    TEST_EQUAL(db.get_memory_used(), 0);
+
+    db.begin_transaction(false);
+    db.delete_document(1);
+    TEST_REL(db.get_memory_used(),>,0);
+    db.cancel_transaction();
+    TEST_EQUAL(db.get_memory_used(), 0);
+
+    return true;
+}
+
+/// Check skipping within brass postlist chunks using the skip table.
+DEFINE_TESTCASE(postlistskip1, brass) {
+    Xapian::WritableDatabase db;
+    db = get_named_writable_database("postlistskip1", string());
+
+    // Add in two batches, so the second commit appends to existing chunks.
+    for (Xapian::docid did = 1; did <= 3000; ++did) {
+	Xapian::Document doc;
+	doc.add_term("all", did % 7 + 1);
+	if (did % 3 == 0) doc.add_term("third");
+	db.add_document(doc);
+	if (did == 1000) db.commit();
+    }
+    db.commit();
+
+    // Delete some documents from the middle of chunks.
+    for (Xapian::docid did = 500; did <= 2500; did += 250)
+	db.delete_document(did);
+    db.commit();
+
+    static const Xapian::docid targets[] = {
+	2, 3, 33, 34, 64, 65, 100, 499, 500, 501, 900, 1000, 1001, 1500,
+	1750, 2000, 2999, 3000
+    };
+    Xapian::PostingIterator p = db.postlist_begin("third");
+    for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); ++i) {
+	Xapian::docid target = targets[i];
+	p.skip_to(target);
+	TEST(p != db.postlist_end("third"));
+	Xapian::docid expect = (target + 2) / 3 * 3;
+	while (expect >= 500 && expect <= 2500 && expect % 250 == 0)
+	    expect += 3;
+	TEST_EQUAL(*p, expect);
+	TEST_EQUAL(p.get_wdf(), 1);
+    }
+    p.skip_to(3001);
+    TEST(p == db.postlist_end("third"));
+
+    p = db.postlist_begin("all");
+    for (Xapian::docid did = 1; did <= 3000; did += 37) {
+	p.skip_to(did);
+	TEST(p != db.postlist_end("all"));
+	Xapian::docid expect = did;
+	if (did >= 500 && did <= 2500 && did % 250 == 0) ++expect;
+	TEST_EQUAL(*p, expect);
+	TEST_EQUAL(p.get_wdf(), expect % 7 + 1);
+	// Document lengths are looked up by skipping in the doclen list.
+	TEST_EQUAL(db.get_doclength(expect),
+		   expect % 7 + 1 + (expect % 3 == 0 ? 1 : 0));
+    }
+
+    const string & db_path = get_named_writable_database_path("postlistskip1");
+    return Xapian::Database::check(db_path) == 0;
+}
+
+/// Check a commit which changes every table is seen by a new reader.
+DEFINE_TESTCASE(commitalltables1, brass) {
+    // Brass commits its tables concurrently, so check none gets missed.
+    Xapian::WritableDatabase db = get_writable_database();
+    for (int round = 1; round <= 2; ++round) {
+	Xapian::Document doc;
+	doc.add_posting("foo" + str(round), 1);
+	doc.add_value(0, str(round));
+	doc.set_data("data" + str(round));
+	db.add_document(doc);
+	db.add_synonym("foo" + str(round), "bar");
+	db.add_spelling("foo" + str(round));
+	db.set_metadata("key", str(round));
+	db.commit();
+
+	Xapian::Database rdb = get_writable_database_as_database();
+	TEST_EQUAL(rdb.get_doccount(), Xapian::doccount(round));
+	TEST_EQUAL(rdb.get_termfreq("foo" + str(round)), 1);
+	TEST_EQUAL(*rdb.positionlist_begin(round, "foo" + str(round)), 1);
+	TEST_EQUAL(rdb.get_document(round).termlist_count(), 1);
+	TEST_STRINGS_EQUAL(rdb.get_document(round).get_data(), "data" + str(round));
+	TEST_STRINGS_EQUAL(rdb.get_document(round).get_value(0), str(round));
+	TEST_STRINGS_EQUAL(*rdb.synonyms_begin("foo" + str(round)), "bar");
+	Xapian::termcount spellings = 0;
+	Xapian::TermIterator sp;
+	for (sp = rdb.spellings_begin(); sp != rdb.spellings_end(); ++sp)
+	    ++spellings;
+	TEST_EQUAL(spellings, Xapian::termcount(round));
+	TEST_STRINGS_EQUAL(rdb.get_metadata("key"), str(round));
+    }
+    return true;
+}
+
+#ifdef HAVE__PUTENV_S
+# define set_env_var(V, N) _putenv_s(V, #N)
+#elif defined HAVE_SETENV
+# define set_env_var(V, N) setenv(V, #N, 1)
+#else
+# define set_env_var(V, N) putenv(const_cast<char*>(V "=" #N))
+#endif
+
+/// Check document lengths are correct when read from the dense cache.
+DEFINE_TESTCASE(doclencache1, brass) {
+    // Once enabled, the cache stays enabled for the rest of the process.
+    set_env_var("XAPIAN_DOCLEN_CACHE_SIZE", 1000000);
+    Xapian::WritableDatabase wdb;
+    wdb = get_named_writable_database("doclencache1", string());
+    for (Xapian::docid did = 1; did <= 300; ++did) {
+	Xapian::Document doc;
+	// Leave some documents with no terms, so a length of 0.
+	if (did % 5) doc.add_term("t", did % 11);
+	wdb.add_document(doc);
+    }
+    for (Xapian::docid did = 50; did <= 300; did += 50)
+	wdb.delete_document(did);
+    wdb.commit();
+
+    // The cache is only used for a read-only database.
+    const string & db_path = get_named_writable_database_path("doclencache1");
+    Xapian::Database db(db_path);
+    // The cache is filled a page at a time, so start at the end to check
+    // a page doesn't have to be filled from its first doclen chunk.
+    TEST_EQUAL(db.get_doclength(299), 299 % 11);
+    TEST_EXCEPTION(Xapian::DocNotFoundError, db.get_doclength(300));
+    for (Xapian::docid did = 1; did <= 300; ++did) {
+	if (did % 50 == 0) {
+	    TEST_EXCEPTION(Xapian::DocNotFoundError, db.get_doclength(did));
+	    TEST_EXCEPTION(Xapian::DocNotFoundError, db.get_document(did));
+	    continue;
+	}
+	TEST_EQUAL(db.get_doclength(did), did % 5 ? did % 11 : 0);
+    }
+    TEST_EXCEPTION(Xapian::DocNotFoundError, db.get_doclength(301));
+
+    Xapian::PostingIterator p = db.postlist_begin("t");
+    for (Xapian::docid did = 1; did <= 300; did += 7) {
+	p.skip_to(did);
+	TEST(p != db.postlist_end("t"));
+	TEST_EQUAL(p.get_doclength(), p.get_wdf());
+    }
+
+    // A second handle on the same revision shares the cache.
+    Xapian::Database db3(db_path);
+    TEST_EQUAL(db3.get_doclength(299), 299 % 11);
+    TEST_EQUAL(db3.get_doclength(2), 2);
+    TEST_EXCEPTION(Xapian::DocNotFoundError, db3.get_doclength(250));
+
+    // Check the cache is rebuilt when the database is reopened.
+    Xapian::Document doc;
+    doc.add_term("t", 42);
+    wdb.replace_document(1, doc);
+    wdb.replace_document(50, doc);
+    wdb.add_document(doc);
+    wdb.commit();
+    TEST_EQUAL(db.get_doclength(1), 1);
+    TEST(db.reopen());
+    TEST_EQUAL(db.get_doclength(1), 42);
+    TEST_EQUAL(db.get_doclength(50), 42);
+    TEST_EQUAL(db.get_doclength(301), 42);
+    TEST_EQUAL(db.get_doclength(2), 2);
+
+    // Check a database where most docids aren't in use still works.
+    wdb.replace_document(1000, doc);
+    wdb.commit();
+    Xapian::Database db2(db_path);
+    TEST_EQUAL(db2.get_doclength(1000), 42);
+    TEST_EQUAL(db2.get_doclength(301), 42);
+    TEST_EXCEPTION(Xapian::DocNotFoundError, db2.get_doclength(100));
+    TEST_EXCEPTION(Xapian::DocNotFoundError, db2.get_doclength(999));
+
+    return true;
+}
+
+#define set_value_columns(N) set_env_var("XAPIAN_VALUE_COLUMNS", N)
+
+struct unset_value_columns_helper_ {
+    ~unset_value_columns_helper_() { set_value_columns(0); }
+};
+
+/// Check values are correct when read from a dense column.
+DEFINE_TESTCASE(valuecolumn1, brass) {
+    // Ensure that we don't leave columns enabled for the next testcase,
+    // even if this one exits with an exception.
+    unset_value_columns_helper_ ezlxq;
+    set_value_columns(1000);
+
+    Xapian::WritableDatabase wdb;
+    wdb = get_named_writable_database("valuecolumn1", string());
+    for (Xapian::docid did = 1; did <= 300; ++did) {
+	Xapian::Document doc;
+	doc.add_term("t");
+	// Leave some documents without a value in slot 1.
+	if (did % 3) doc.add_value(1, str(did % 17));
+	doc.add_value(2, Xapian::sortable_serialise(did));
+	wdb.add_document(doc);
+    }
+    for (Xapian::docid did = 50; did <= 300; did += 50)
+	wdb.delete_document(did);
+    wdb.commit();
+
+    // Columns are only used for a read-only database.
+    const string & db_path = get_named_writable_database_path("valuecolumn1");
+    Xapian::Database db(db_path);
+
+    Xapian::ValueIterator v = db.valuestream_begin(1);
+    TEST_STRINGS_EQUAL(v.get_description(), "ValueIterator(BrassValueColumnList(slot=1))");
+    for (Xapian::docid did = 1; did <= 300; ++did) {
+	if (did % 3 == 0 || did % 50 == 0) continue;
+	TEST(v != db.valuestream_end(1));
+	TEST_EQUAL(v.get_docid(), did);
+	TEST_STRINGS_EQUAL(*v, str(did % 17));
+	++v;
+    }
+    TEST(v == db.valuestream_end(1));
+
+    v = db.valuestream_begin(1);
+    v.skip_to(3);
+    TEST_EQUAL(v.get_docid(), 4);
+    TEST(v.check(5));
+    TEST_EQUAL(v.get_docid(), 5);
+    TEST(!v.check(6));
+    ++v;
+    TEST_EQUAL(v.get_docid(), 7);
+    v.skip_to(300);
+    TEST(v == db.valuestream_end(1));
+
+    // Values read from documents should come from the column too.
+    TEST_STRINGS_EQUAL(db.get_document(16).get_value(1), str(16 % 17));
+    TEST_STRINGS_EQUAL(db.get_document(18).get_value(1), string());
+
+    // Check sorting and counting values work.
+    Xapian::Enquire enq(db);
+    enq.set_query(Xapian::Query("t"));
+    enq.set_sort_by_value(2, true);
+    Xapian::ValueCountMatchSpy spy(1);
+    enq.add_matchspy(&spy);
+    Xapian::MSet mset = enq.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 10);
+    TEST_EQUAL(*mset[0], 299);
+    TEST_EQUAL(*mset[1], 298);
+    TEST_EQUAL(*mset[2], 297);
+    TEST_EQUAL(*mset[3], 296);
+    TEST_EQUAL(spy.get_total(), 294);
+    map<string, Xapian::doccount> counts;
+    for (Xapian::docid did = 1; did <= 300; ++did) {
+	if (did % 3 == 0 || did % 50 == 0) continue;
+	++counts[str(did % 17)];
+    }
+    Xapian::TermIterator t = spy.values_begin();
+    map<string, Xapian::doccount>::const_iterator i;
+    for (i = counts.begin(); i != counts.end(); ++i) {
+	TEST(t != spy.values_end());
+	TEST_STRINGS_EQUAL(*t, i->first);
+	TEST_EQUAL(t.get_termfreq(), i->second);
+	++t;
+    }
+    TEST(t == spy.values_end());
+
+    // Slot 2 has a different value for every document, so its column
+    // stores the values by docid rather than using a dictionary.
+    v = db.valuestream_begin(2);
+    TEST_STRINGS_EQUAL(v.get_description(), "ValueIterator(BrassValueColumnList(slot=2))");
+    for (Xapian::docid did = 1; did <= 300; ++did) {
+	if (did % 50 == 0) continue;
+	TEST(v != db.valuestream_end(2));
+	TEST_EQUAL(v.get_docid(), did);
+	TEST_STRINGS_EQUAL(*v, Xapian::sortable_serialise(did));
+	++v;
+    }
+    TEST(v == db.valuestream_end(2));
+    v = db.valuestream_begin(2);
+    v.skip_to(50);
+    TEST_EQUAL(v.get_docid(), 51);
+    TEST(!v.check(100));
+    TEST(v.check(101));
+    TEST_STRINGS_EQUAL(*v, Xapian::sortable_serialise(101));
+    TEST_STRINGS_EQUAL(db.get_document(299).get_value(2),
+		       Xapian::sortable_serialise(299));
+
+    // Check sorting in both directions on the high-cardinality column.
+    enq.set_sort_by_value(2, false);
+    mset = enq.get_mset(0, 3);
+    TEST_EQUAL(mset.size(), 3);
+    TEST_EQUAL(*mset[0], 1);
+    TEST_EQUAL(*mset[1], 2);
+    TEST_EQUAL(*mset[2], 3);
+    enq.set_query(Xapian::Query(Xapian::Query::OP_VALUE_RANGE, 2,
+				Xapian::sortable_serialise(98),
+				Xapian::sortable_serialise(102)));
+    mset = enq.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 4);
+    enq.set_query(Xapian::Query("t"));
+
+    enq.set_sort_by_value(1, false);
+    mset = enq.get_mset(0, 3);
+    // Documents without a value sort first.
+    TEST_EQUAL(*mset[0], 3);
+
+    // Check collapsing on a slot with a column.
+    enq.set_sort_by_relevance();
+    enq.set_collapse_key(1);
+    mset = enq.get_mset(0, 300);
+    Xapian::doccount no_key = 0;
+    for (Xapian::doccount j = 0; j != mset.size(); ++j) {
+	Xapian::docid did = *mset[j];
+	if (did % 3 == 0) {
+	    TEST_STRINGS_EQUAL(mset[j].get_collapse_key(), string());
+	    ++no_key;
+	} else {
+	    TEST_STRINGS_EQUAL(mset[j].get_collapse_key(), str(did % 17));
+	    TEST_EQUAL(mset[j].get_collapse_count() + 1, counts[str(did % 17)]);
+	}
+    }
+    TEST_EQUAL(mset.size(), counts.size() + no_key);
+    enq.set_collapse_key(Xapian::BAD_VALUENO);
+    enq.set_query(Xapian::Query(Xapian::Query::OP_VALUE_RANGE, 1, "16", "16"));
+    mset = enq.get_mset(0, 20);
+    TEST_EQUAL(mset.size(), counts["16"]);
+
+    // Check the columns are rebuilt when the database is reopened.
+    Xapian::Document doc;
+    doc.add_value(1, "new");
+    wdb.replace_document(1, doc);
+    wdb.add_document(doc);
+    wdb.commit();
+    TEST_STRINGS_EQUAL(*db.valuestream_begin(1), "1");
+    TEST(db.reopen());
+    v = db.valuestream_begin(1);
+    TEST_STRINGS_EQUAL(*v, "new");
+    v.skip_to(300);
+    TEST_EQUAL(v.get_docid(), 301);
+    TEST_STRINGS_EQUAL(*v, "new");
+
+    // Check a database with more documents than the limit still works.
+    set_value_columns(100);
+    Xapian::Database db2(db_path);
+    v = db2.valuestream_begin(1);
+    TEST_STRINGS_EQUAL(v.get_description(), "ValueIterator(BrassValueList(slot=1))");
+    TEST_STRINGS_EQUAL(*v, "new");
+
+    return true;
+}
+
+/// Check skipping blocks of postings by their maximum wdf.
+DEFINE_TESTCASE(blockmaxweight1, brass) {
+    Xapian::WritableDatabase db;
+    db = get_named_writable_database("blockmaxweight1", string());
+
+    // "rare" has a high wdf in a few documents, and each of "a", "b" and "c"
+    // occurs once in most documents, so most blocks of postings for the
+    // latter can't reach the weight of the top documents.
+    for (Xapian::docid did = 1; did <= 5000; ++did) {
+	Xapian::Document doc;
+	if (did % 500 == 0) doc.add_term("rare", 20);
+	if (did % 7) doc.add_term("a");
+	if (did % 5) doc.add_term("b");
+	if (did % 3) doc.add_term("c");
+	if (did % 1000 == 0) {
+	    doc.add_term("a", 30);
+	    doc.add_term("b", 30);
+	}
+	doc.add_term("pad", 10);
+	db.add_document(doc);
+    }
+    db.commit();
+
+    Xapian::Enquire enquire(db);
+    static const char * const terms[] = { "rare", "a", "b", "c" };
+    for (int i = 0; i < 3; ++i) {
+	Xapian::Query q;
+	if (i == 0) {
+	    q = Xapian::Query(Xapian::Query::OP_OR, terms, terms + 4);
+	} else if (i == 1) {
+	    q = Xapian::Query(Xapian::Query::OP_OR, terms + 1, terms + 3);
+	} else {
+	    q = Xapian::Query(Xapian::Query::OP_AND_MAYBE,
+			      Xapian::Query("c"),
+			      Xapian::Query(Xapian::Query::OP_OR,
+					    terms, terms + 3));
+	}
+	enquire.set_query(q);
+	for (int w = 0; w < 2; ++w) {
+	    if (w == 0) {
+		enquire.set_weighting_scheme(Xapian::BM25Weight());
+	    } else {
+		enquire.set_weighting_scheme(Xapian::TradWeight());
+	    }
+	    Xapian::MSet full = enquire.get_mset(0, db.get_doccount());
+	    for (Xapian::doccount k = 1; k <= 25; k += 4) {
+		tout << q.get_description() << " top " << k << endl;
+		Xapian::MSet top = enquire.get_mset(0, k);
+		TEST_EQUAL(top.size(), k);
+		TEST(mset_range_is_same(top, 0, full, 0, k));
+	    }
+	}
+    }
+
+    return true;
+}
+
+/// Check blocks are bounded using the lengths of their documents.
+DEFINE_TESTCASE(blockmaxweight2, brass) {
+    Xapian::WritableDatabase db;
+    db = get_named_writable_database("blockmaxweight2", string());
+
+    // Every document has "t" once, but only the first 500 are short, so with
+    // BM25 the blocks of later documents can't reach the top weight.
+    for (Xapian::docid did = 1; did <= 3000; ++did) {
+	Xapian::Document doc;
+	doc.add_term("t");
+	doc.add_term("pad", did <= 500 ? 2 : 50);
+	db.add_document(doc);
+    }
+    db.commit();
+
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("t"));
+    // Don't clamp the normalised document length, so the shortest document
+    // gets the highest weight.
+    enquire.set_weighting_scheme(Xapian::BM25Weight(1, 0, 1, 0.5, 0));
+    enquire.set_profiling(true);
+    Xapian::MSet full = enquire.get_mset(0, db.get_doccount());
+    Xapian::MSet top = enquire.get_mset(0, 10);
+    TEST(mset_range_is_same(top, 0, full, 0, 10));
+    string profile = enquire.get_profile();
+    tout << profile;
+    string::size_type i = profile.find(" postings=");
+    TEST(i != string::npos);
+    // The first block of each chunk is decoded when the chunk is read.
+    TEST_REL(atoi(profile.c_str() + i + 10),<,1500);
+
+    // Shortening a document without changing its wdf for "t" must still
+    // lower the bound for its block.
+    Xapian::Document doc;
+    doc.add_term("t");
+    db.replace_document(2000, doc);
+    db.commit();
+
+    full = enquire.get_mset(0, db.get_doccount());
+    top = enquire.get_mset(0, 10);
+    TEST_EQUAL(*top.begin(), 2000);
+    TEST(mset_range_is_same(top, 0, full, 0, 10));
+
+    TEST_EQUAL(Xapian::Database::check(get_named_writable_database_path("blockmaxweight2")), 0);
+
+    return true;
+}
+
+/// A DataSink which records the pieces of data it's passed.
+class PieceCollector : public Xapian::DataSink {
+  public:
+    string data;
+
+    unsigned pieces;
+
+    PieceCollector() : pieces(0) { }
+
+    void append(const char * p, size_t len) {
+	data.append(p, len);
+	++pieces;
+    }
+};
+
+/// Check Document::get_data(DataSink &).
+DEFINE_TESTCASE(getdatasink1, writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+
+    // Big enough that even compressed it will be stored in many items.
+    string big;
+    for (int i = 0; i < 100000; ++i) {
+	big += str(i);
+	big += ' ';
+    }
+    Xapian::Document doc;
+    doc.set_data(big);
+    db.add_document(doc);
+    doc.set_data("small");
+    db.add_document(doc);
+    doc.set_data(string());
+    db.add_document(doc);
+    db.commit();
+
+    Xapian::Database rdb = db;
+    for (Xapian::docid did = 1; did <= 3; ++did) {
+	Xapian::Document d = rdb.get_document(did);
+	PieceCollector sink;
+	d.get_data(sink);
+	TEST_STRINGS_EQUAL(sink.data, d.get_data());
+	if (did == 1) {
+	    // Brass decompresses the data a piece at a time.
+	    if (get_dbtype() == "brass")
+		TEST_REL(sink.pieces,>,1);
+	} else if (did == 3) {
+	    TEST_EQUAL(sink.pieces, 0);
+	}
+    }
+
+    // Data which has been set is passed in one piece.
+    Xapian::Document d = rdb.get_document(2);
+    d.set_data(big);
+    PieceCollector sink;
+    d.get_data(sink);
+    TEST_EQUAL(sink.pieces, 1);
+    TEST_STRINGS_EQUAL(sink.data, big);
+
+    return true;
+}
+
+/// Check a termlist which is compressed in several blocks.
+DEFINE_TESTCASE(bigtermlist1, writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+
+    Xapian::Document doc;
+    for (int i = 0; i < 20000; ++i) {
+	doc.add_term("term" + str(i));
+    }
+    db.add_document(doc);
+    db.commit();
+
+    Xapian::Database rdb = db;
+    TEST_EQUAL(rdb.get_doclength(1), 20000);
+    Xapian::Document d = rdb.get_document(1);
+    TEST_EQUAL(d.termlist_count(), 20000);
+    Xapian::TermIterator t = rdb.termlist_begin(1);
+    for (int i = 0; i < 20000; ++i) {
+	TEST(t != rdb.termlist_end(1));
+	++t;
+    }
+    TEST(t == rdb.termlist_end(1));
+    TEST_EQUAL(rdb.get_termfreq("term19999"), 1);
+
+    return true;
+}
+
+/// Check edge n-gram terms don't add to the document length.
+DEFINE_TESTCASE(edgengramdoclen1, writable) {
+    Xapian::WritableDatabase db =
+	get_named_writable_database("edgengramdoclen1", string());
+    const string ngram("\0\x01" "ca", 4);
+
+    Xapian::Document doc;
+    doc.add_term("cat", 3);
+    doc.add_term("car", 2);
+    doc.add_term(ngram, 5);
+    Xapian::docid did = db.add_document(doc);
+    db.commit();
+    TEST_EQUAL(db.get_doclength(did), 5);
+    TEST_EQUAL(db.get_avlength(), 5);
+    Xapian::PostingIterator p = db.postlist_begin(ngram);
+    TEST(p != db.postlist_end(ngram));
+    TEST_EQUAL(p.get_wdf(), 5);
+
+    // Replacing the document changes the length by the changes to the other
+    // terms only.
+    doc.remove_term("car");
+    doc.add_term(ngram, 4);
+    doc.add_term("cow", 1);
+    db.replace_document(did, doc);
+    db.commit();
+    TEST_EQUAL(db.get_doclength(did), 4);
+    doc.remove_term(ngram);
+    db.replace_document(did, doc);
+    db.commit();
+    TEST_EQUAL(db.get_doclength(did), 4);
+
+    if (get_dbtype() == "brass" || get_dbtype() == "chert") {
+	const string & path =
+	    get_named_writable_database_path("edgengramdoclen1");
+	TEST_EQUAL(Xapian::Database::check(path), 0);
+    }
+
+    return true;
+}
@@ -0,0 +1,145 @@
+/** @file perftest_buildshards.cc
+ * @brief Performance test for building a database in shards.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "perftest/perftest_buildshards.h"
+
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+#include <xapian.h>
+
+#include "backendmanager.h"
+#include "perftest.h"
+#include "str.h"
+#include "testrunner.h"
+#include "testsuite.h"
+#include "testutils.h"
+#include "unixcmds.h"
+
+using namespace std;
+
+/// Generate a random integer from 0 to @a range - 1.
+static unsigned int
+rand_int(unsigned int range)
+{
+    return (unsigned int)(range * (rand() / (RAND_MAX + 1.0)));
+}
+
+/** Generate a random document.
+ *
+ *  Terms are picked from a vocabulary of @a vocab_size words, with small
+ *  numbers being much more likely, so a few terms index most documents and
+ *  most terms index very few, as with real text.
+ */
+static Xapian::Document
+gen_doc(unsigned int num, unsigned int terms, unsigned int vocab_size)
+{
+    Xapian::Document doc;
+    doc.set_data("random document " + str(num));
+    for (unsigned int j = 0; j != terms; ++j) {
+	unsigned int n = rand_int(vocab_size);
+	n = rand_int(n + 1);
+	doc.add_term("t" + str(n));
+    }
+    doc.add_value(0, str(num));
+    return doc;
+}
+
+// Compare adding documents to a single database with building shards and
+// merging them, as described in admin_notes.rst.
+DEFINE_TESTCASE(buildshards1, brass) {
+    logger.testcase_begin("buildshards1");
+
+    unsigned int runsize = 200000;
+    unsigned int shardsize = 20000;
+    unsigned int terms = 100;
+    unsigned int vocab_size = 1000000;
+    unsigned int seed = 42;
+
+    std::map<std::string, std::string> params;
+    params["runsize"] = str(runsize);
+    params["seed"] = str(seed);
+    params["terms"] = str(terms);
+    params["vocab_size"] = str(vocab_size);
+
+    // Add all the documents to one database.
+    string dbname("buildshards1_single");
+    params["method"] = "single";
+    logger.indexing_begin(dbname, params);
+    {
+	Xapian::WritableDatabase db =
+	    backendmanager->get_writable_database(dbname, "");
+	srand(seed);
+	for (unsigned int i = 0; i != runsize; ++i) {
+	    db.add_document(gen_doc(i, terms, vocab_size));
+	    logger.indexing_add();
+	}
+	db.commit();
+    }
+    logger.indexing_end();
+
+    // Add the same documents to shards, then merge them.
+    dbname = "buildshards1_shards";
+    params["method"] = "shards";
+    params["shardsize"] = str(shardsize);
+    logger.indexing_begin(dbname, params);
+    string path = backendmanager->get_writable_database_path(dbname);
+    rm_rf(path);
+    vector<string> shards;
+    {
+	Xapian::Compactor compact;
+	compact.set_destdir(path);
+	srand(seed);
+	for (unsigned int i = 0; i != runsize; i += shardsize) {
+	    string shard = path + "_shard" + str(shards.size());
+	    shards.push_back(shard);
+	    Xapian::WritableDatabase db(shard,
+					Xapian::DB_CREATE_OR_OVERWRITE|
+					Xapian::DB_BACKEND_BRASS|
+					Xapian::DB_NO_SYNC|
+					Xapian::DB_DANGEROUS);
+	    for (unsigned int j = i; j != runsize && j != i + shardsize; ++j) {
+		db.add_document(gen_doc(j, terms, vocab_size));
+		logger.indexing_add();
+	    }
+	    db.commit();
+	    compact.add_source(shard);
+	}
+	compact.set_multipass(shards.size() > 3);
+	compact.compact();
+    }
+    logger.indexing_end();
+    for (size_t i = 0; i != shards.size(); ++i) {
+	rm_rf(shards[i]);
+    }
+
+    Xapian::Database single(
+	backendmanager->get_writable_database_path("buildshards1_single"));
+    Xapian::Database merged(path);
+    TEST_EQUAL(single.get_doccount(), merged.get_doccount());
+    TEST_EQUAL(single.get_avlength(), merged.get_avlength());
+
+    logger.testcase_end();
+    return true;
+}
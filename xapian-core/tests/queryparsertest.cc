@@ -1074,6 +1074,46 @@ static bool test_qp_flag_wildcard3()
 #endif
 }
 
+// Test expanding a wildcard to the most frequent terms past the limit.
+static bool test_qp_flag_wildcard4()
+{
+#ifndef XAPIAN_HAS_INMEMORY_BACKEND
+    SKIP_TEST("Testcase requires the InMemory backend which is disabled");
+#else
+    Xapian::WritableDatabase db(Xapian::InMemory::open());
+    static const char * const terms[] = {
+	"muscat", "muscle", "muscle", "musclebound", "muscular", "muscular",
+	"muscular", "mutton", "mutton"
+    };
+    for (size_t i = 0; i != sizeof(terms) / sizeof(terms[0]); ++i) {
+	Xapian::Document doc;
+	doc.add_term(terms[i]);
+	db.add_document(doc);
+    }
+
+    Xapian::QueryParser qp;
+    qp.set_database(db);
+    qp.set_max_wildcard_expansion(3,
+	    Xapian::QueryParser::WILDCARD_LIMIT_MOST_FREQUENT);
+    Xapian::Query qobj;
+    qobj = qp.parse_query("mu*", Xapian::QueryParser::FLAG_WILDCARD);
+    TEST_STRINGS_EQUAL(qobj.get_description(),
+		       "Query((muscle@1 SYNONYM muscular@1 SYNONYM mutton@1))");
+    // Ties are broken by term.
+    qobj = qp.parse_query("musc*", Xapian::QueryParser::FLAG_WILDCARD);
+    TEST_STRINGS_EQUAL(qobj.get_description(),
+		       "Query((muscat@1 SYNONYM muscle@1 SYNONYM muscular@1))");
+    // Expansions within the limit are unchanged.
+    qobj = qp.parse_query("mut*", Xapian::QueryParser::FLAG_WILDCARD);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(mutton@1)");
+
+    qp.set_max_wildcard_expansion(3);
+    TEST_EXCEPTION(Xapian::QueryParserError,
+	qp.parse_query("mu*", Xapian::QueryParser::FLAG_WILDCARD));
+    return true;
+#endif
+}
+
 // Test partial queries.
 static bool test_qp_flag_partial1()
 {
@@ -1209,6 +1249,156 @@ static bool test_qp_flag_partial1()
 #endif
 }
 
+// Test partial queries using edge n-grams.
+static bool test_qp_flag_partial2()
+{
+#ifndef XAPIAN_HAS_INMEMORY_BACKEND
+    SKIP_TEST("Testcase requires the InMemory backend which is disabled");
+#else
+    Xapian::WritableDatabase db(Xapian::InMemory::open());
+    Xapian::TermGenerator termgen;
+    termgen.set_flags(Xapian::TermGenerator::FLAG_EDGE_NGRAMS);
+    static const char * const texts[] = { "muscle man", "mutton", "abc" };
+    for (size_t i = 0; i != sizeof(texts) / sizeof(texts[0]); ++i) {
+	Xapian::Document doc;
+	termgen.set_document(doc);
+	termgen.index_text(texts[i]);
+	db.add_document(doc);
+    }
+
+    Xapian::QueryParser qp;
+    qp.set_database(db);
+    qp.set_stemmer(Xapian::Stem("english"));
+    qp.set_stemming_strategy(Xapian::QueryParser::STEM_SOME);
+    Xapian::Query qobj = qp.parse_query("mu", Xapian::QueryParser::FLAG_PARTIAL);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((\\x00\\x01mu@1 OR Zmu@1))");
+    Xapian::Enquire enquire(db);
+    enquire.set_query(qobj);
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 2);
+    // The edge n-grams shouldn't add to the document length.
+    TEST_EQUAL(db.get_doclength(1), 2);
+    TEST_EQUAL(db.get_doclength(2), 1);
+
+    qobj = qp.parse_query("musc", Xapian::QueryParser::FLAG_PARTIAL);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((\\x00\\x01musc@1 OR Zmusc@1))");
+    enquire.set_query(qobj);
+    TEST_EQUAL(enquire.get_mset(0, 10).size(), 1);
+
+    // Longer partial terms are expanded.
+    qobj = qp.parse_query("muscl", Xapian::QueryParser::FLAG_PARTIAL);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((muscle@1 OR Zmuscl@1))");
+
+    // If any document lacks edge n-grams, partial terms are expanded.
+    Xapian::Document doc;
+    doc.add_term("mud");
+    db.add_document(doc);
+    qobj = qp.parse_query("mu", Xapian::QueryParser::FLAG_PARTIAL);
+    TEST_STRINGS_EQUAL(qobj.get_description(),
+		       "Query(((mud@1 SYNONYM muscle@1 SYNONYM mutton@1) OR Zmu@1))");
+    return true;
+#endif
+}
+
+// Test edge n-grams are only used for fields indexed with them.
+static bool test_qp_flag_partial3()
+{
+#ifndef XAPIAN_HAS_INMEMORY_BACKEND
+    SKIP_TEST("Testcase requires the InMemory backend which is disabled");
+#else
+    Xapian::WritableDatabase db(Xapian::InMemory::open());
+    Xapian::TermGenerator title_termgen;
+    title_termgen.set_flags(Xapian::TermGenerator::FLAG_EDGE_NGRAMS);
+    Xapian::TermGenerator body_termgen;
+    Xapian::Document doc;
+    title_termgen.set_document(doc);
+    title_termgen.index_text("The Prussian Army", 1, "S");
+    body_termgen.set_document(doc);
+    body_termgen.index_text("the prussian cavalry");
+    db.add_document(doc);
+
+    Xapian::QueryParser qp;
+    qp.set_database(db);
+    qp.add_prefix("", "");
+    qp.add_prefix("", "S");
+    Xapian::Query qobj = qp.parse_query("prus", Xapian::QueryParser::FLAG_PARTIAL);
+    TEST_STRINGS_EQUAL(qobj.get_description(),
+		       "Query(((prussian@1 SYNONYM \\x00\\x01Sprus@1) OR (prus@1 SYNONYM Sprus@1)))");
+    Xapian::Enquire enquire(db);
+    enquire.set_query(qobj);
+    TEST_EQUAL(enquire.get_mset(0, 10).size(), 1);
+
+    // No edge n-grams are generated for stemmed terms, so they get expanded.
+    Xapian::Document doc2;
+    title_termgen.set_stemmer(Xapian::Stem("english"));
+    title_termgen.set_stemming_strategy(title_termgen.STEM_ALL);
+    title_termgen.set_document(doc2);
+    title_termgen.index_text("Prussian", 1, "T");
+    db.add_document(doc2);
+    qp.add_prefix("title", "T");
+    qobj = qp.parse_query("title:prus", Xapian::QueryParser::FLAG_PARTIAL);
+    TEST_STRINGS_EQUAL(qobj.get_description(),
+		       "Query((Tprussian@1 OR Tprus@1))");
+    return true;
+#endif
+}
+
+// Test partial words matched using edge n-grams are ranked as when expanded.
+static bool test_qp_flag_partial4()
+{
+#ifndef XAPIAN_HAS_INMEMORY_BACKEND
+    SKIP_TEST("Testcase requires the InMemory backend which is disabled");
+#else
+    Xapian::WritableDatabase db(Xapian::InMemory::open());
+    Xapian::WritableDatabase expand_db(Xapian::InMemory::open());
+    Xapian::TermGenerator termgen;
+    static const char * const texts[] = {
+	"mutton pie", "the muscle of a man", "mud mud mud", "muscle mud",
+	"abc", "music for a mummy", "a mule"
+    };
+    for (size_t i = 0; i != sizeof(texts) / sizeof(texts[0]); ++i) {
+	Xapian::Document doc;
+	termgen.set_document(doc);
+	termgen.set_flags(Xapian::TermGenerator::FLAG_EDGE_NGRAMS);
+	termgen.index_text(texts[i]);
+	db.add_document(doc);
+	Xapian::Document expand_doc;
+	termgen.set_document(expand_doc);
+	termgen.set_flags(Xapian::TermGenerator::flags(0));
+	termgen.index_text(texts[i]);
+	expand_db.add_document(expand_doc);
+    }
+
+    Xapian::QueryParser qp;
+    qp.set_database(db);
+    Xapian::Enquire enquire(db);
+    Xapian::Query qobj = qp.parse_query("mu", Xapian::QueryParser::FLAG_PARTIAL);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((\\x00\\x01mu@1 OR mu@1))");
+    enquire.set_query(qobj);
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+
+    qp.set_database(expand_db);
+    Xapian::Enquire expand_enquire(expand_db);
+    qobj = qp.parse_query("mu", Xapian::QueryParser::FLAG_PARTIAL);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(((mud@1 SYNONYM mule@1 SYNONYM mummy@1 SYNONYM muscle@1 SYNONYM music@1 SYNONYM mutton@1) OR mu@1))");
+    expand_enquire.set_query(qobj);
+    Xapian::MSet expand_mset = expand_enquire.get_mset(0, 10);
+
+    // The documents with more words starting "mu" for their length should
+    // rank higher, in the same order as for the expanded query.
+    TEST_EQUAL(mset.size(), 6);
+    TEST_EQUAL(expand_mset.size(), 6);
+    TEST_EQUAL(*mset.begin(), 3);
+    Xapian::MSetIterator i = mset.begin(), j = expand_mset.begin();
+    for ( ; i != mset.end(); ++i, ++j) {
+	TEST_EQUAL(*i, *j);
+	TEST_REL(i.get_weight(),>,0);
+    }
+    TEST_REL(mset.begin().get_weight(),>,mset.back().get_weight());
+    return true;
+#endif
+}
+
 static bool test_qp_flag_bool_any_case1()
 {
     using Xapian::QueryParser;
@@ -2767,7 +2957,11 @@ static const test_desc tests[] = {
     TESTCASE(qp_flag_wildcard1),
     TESTCASE(qp_flag_wildcard2),
     TESTCASE(qp_flag_wildcard3),
+    TESTCASE(qp_flag_wildcard4),
     TESTCASE(qp_flag_partial1),
+    TESTCASE(qp_flag_partial2),
+    TESTCASE(qp_flag_partial3),
+    TESTCASE(qp_flag_partial4),
     TESTCASE(qp_flag_bool_any_case1),
     TESTCASE(qp_stopper1),
     TESTCASE(qp_flag_pure_not1),
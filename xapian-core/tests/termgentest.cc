@@ -23,6 +23,7 @@
 
 #include <xapian.h>
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 
@@ -832,12 +833,91 @@ static bool test_tg_max_word_length1()
     return true;
 }
 
+/// Test biword generation.
+static bool test_tg_biwords1()
+{
+    Xapian::TermGenerator termgen;
+    termgen.set_flags(Xapian::TermGenerator::FLAG_BIWORDS);
+
+    Xapian::Document doc;
+    termgen.set_document(doc);
+
+    termgen.index_text("The cat sat");
+    // Biwords are generated across calls, and for prefixed terms.
+    termgen.index_text("dog", 1, "S");
+    // But not across a gap in positions.
+    termgen.increase_termpos();
+    termgen.index_text("mat");
+    termgen.index_text_without_positions("on rug");
+
+    string output = format_doc_termlist(doc);
+    replace(output.begin(), output.end(), '\0', '|');
+    TEST_STRINGS_EQUAL(output,
+		       "|| ||S |cat|sat |the|cat Sdog[4] cat[2] mat[105] on:1 "
+		       "rug:1 sat[3] the[1]");
+
+    // No biword between the last term of the previous document and the first
+    // of the next.
+    Xapian::Document doc2;
+    termgen.set_document(doc2);
+    termgen.index_text("rug");
+    // No biwords for a prefix which isn't all capital letters, as the matcher
+    // can't tell where it ends.
+    termgen.index_text("big rug", 1, "x:");
+    // The marker for STEM_ALL_Z is for the "Z" prefixed terms.
+    termgen.set_stemmer(Xapian::Stem("en"));
+    termgen.set_stemming_strategy(termgen.STEM_ALL_Z);
+    termgen.index_text("red cats");
+    output = format_doc_termlist(doc2);
+    replace(output.begin(), output.end(), '\0', '|');
+    TEST_STRINGS_EQUAL(output,
+		       "|| ||Z |Zred|Zcat Zcat[5] Zred[4] rug[1] x:big[2] "
+		       "x:rug[3]");
+
+    return true;
+}
+
+static bool test_tg_edgengrams1()
+{
+    Xapian::TermGenerator termgen;
+    termgen.set_flags(Xapian::TermGenerator::FLAG_EDGE_NGRAMS);
+
+    Xapian::Document doc;
+    termgen.set_document(doc);
+
+    // The n-grams get the wdf of all the words they come from.
+    termgen.index_text("The cat cattle");
+    // Prefixed terms get edge n-grams too.
+    termgen.index_text("muscle", 1, "S");
+    // N-grams are of characters, not bytes.
+    termgen.index_text("\xc3\xbc" "ber");
+    // Stemmed terms don't get edge n-grams, and nor does the field.
+    termgen.set_stemmer(Xapian::Stem("en"));
+    termgen.set_stemming_strategy(termgen.STEM_ALL);
+    termgen.index_text("dogs", 1, "T");
+
+    string output = format_doc_termlist(doc);
+    replace(output.begin(), output.end(), '\0', '|');
+    replace(output.begin(), output.end(), '\x01', '+');
+    replace(output.begin(), output.end(), '\x02', '*');
+    TEST_STRINGS_EQUAL(output,
+		       "|+Sm:1 |+Smu:1 |+Smus:1 |+Smusc:1 |+c:2 |+ca:2 "
+		       "|+cat:2 |+catt:1 |+t:1 |+th:1 |+the:1 |+\xc3\xbc:1 "
+		       "|+\xc3\xbc" "b:1 |+\xc3\xbc" "be:1 |+\xc3\xbc" "ber:1 "
+		       "|* |*S Smuscle[4] Tdog[6] cat[2] cattle[3] the[1] "
+		       "\xc3\xbc" "ber[5]");
+
+    return true;
+}
+
 /// Test cases for the TermGenerator.
 static const test_desc tests[] = {
     TESTCASE(termgen1),
     TESTCASE(tg_spell1),
     TESTCASE(tg_spell2),
     TESTCASE(tg_max_word_length1),
+    TESTCASE(tg_biwords1),
+    TESTCASE(tg_edgengrams1),
     END_OF_TESTCASES
 };
 
@@ -21,6 +21,7 @@
 
 #include <config.h>
 
+#include <algorithm>
 #include <cfloat>
 #include <iostream>
 
@@ -34,6 +35,10 @@ using namespace std;
 #include "../common/str.cc"
 #include "../common/stringutils.cc"
 #include "../common/log2.h"
+// For Xapian::Error, which WorkerThreads passes between threads.
+#include "../api/error.cc"
+#include "../unicode/description_append.cc"
+#include "../unicode/utf8itor.cc"
 
 // Simpler version of TEST_EXCEPTION macro.
 #define TEST_EXCEPTION(TYPE, CODE) \
@@ -47,8 +52,19 @@ using namespace std;
 
 // Code we're unit testing:
 #include "../common/fileutils.cc"
+#include "../common/lrucache.h"
 #include "../common/serialise-double.cc"
+#include "../common/streamvbyte.cc"
+#include "../common/workerthreads.cc"
 #include "../net/length.cc"
+#include "../queryparser/wildcardcache.cc"
+#ifdef XAPIAN_HAS_BRASS_BACKEND
+# include "../backends/brass/brass_blockcache.cc"
+# include "../backends/brass/brass_codec.cc"
+# include "../common/compression_stream.cc"
+# include "../backends/brass/brass_cursor.h"
+# include "../backends/brass/brass_termfreqcache.cc"
+#endif
 
 DEFINE_TESTCASE_(simple_exceptions_work1) {
     try {
@@ -300,6 +316,440 @@ static bool test_serialiselength2()
 }
 #endif
 
+#ifdef XAPIAN_HAS_BRASS_BACKEND
+// Test the brass block cache's LRU eviction and pinning.
+static bool test_blockcache1()
+{
+    const size_t BLOCKSIZE = 2048;
+    byte block[BLOCKSIZE];
+    byte buf[BLOCKSIZE];
+    // Room for three blocks.
+    BrassBlockCache cache(3 * BLOCKSIZE);
+    uint4 id = cache.get_file_id("foo");
+    TEST_NOT_EQUAL(id, 0);
+    TEST_EQUAL(cache.get_file_id("foo"), id);
+    uint4 id2 = cache.get_file_id("bar");
+    TEST_NOT_EQUAL(id2, id);
+
+    for (uint4 n = 1; n <= 3; ++n) {
+	memset(block, n, BLOCKSIZE);
+	cache.add(id, 1, n, block, BLOCKSIZE);
+    }
+    TEST_EQUAL(cache.get_used(), 3 * BLOCKSIZE);
+
+    // Different revision or file shouldn't match.
+    TEST(!cache.read(id, 2, 1, buf, BLOCKSIZE));
+    TEST(!cache.read(id2, 1, 1, buf, BLOCKSIZE));
+    TEST_EQUAL(cache.get_misses(), 2);
+
+    TEST(cache.read(id, 1, 1, buf, BLOCKSIZE));
+    TEST_EQUAL(buf[0], 1);
+    TEST_EQUAL(buf[BLOCKSIZE - 1], 1);
+    TEST_EQUAL(cache.get_hits(), 1);
+
+    // Block 2 is now least recently used, so adding block 4 should evict it.
+    memset(block, 4, BLOCKSIZE);
+    cache.add(id, 1, 4, block, BLOCKSIZE);
+    TEST_EQUAL(cache.get_used(), 3 * BLOCKSIZE);
+    TEST(!cache.read(id, 1, 2, buf, BLOCKSIZE));
+    TEST(cache.read(id, 1, 3, buf, BLOCKSIZE));
+    TEST_EQUAL(buf[0], 3);
+
+    // Pinned blocks shouldn't be evicted.
+    TEST(cache.pin(id, 1, 1));
+    TEST(!cache.pin(id, 1, 2));
+    memset(block, 5, BLOCKSIZE);
+    cache.add(id, 1, 5, block, BLOCKSIZE);
+    memset(block, 6, BLOCKSIZE);
+    cache.add(id, 1, 6, block, BLOCKSIZE);
+    TEST(cache.read(id, 1, 1, buf, BLOCKSIZE));
+    TEST_EQUAL(buf[0], 1);
+    TEST(!cache.read(id, 1, 3, buf, BLOCKSIZE));
+    TEST(!cache.read(id, 1, 4, buf, BLOCKSIZE));
+
+    // Once unpinned, it can be evicted again.
+    cache.unpin(id, 1, 1);
+    TEST(cache.read(id, 1, 5, buf, BLOCKSIZE));
+    TEST(cache.read(id, 1, 6, buf, BLOCKSIZE));
+    memset(block, 7, BLOCKSIZE);
+    cache.add(id, 1, 7, block, BLOCKSIZE);
+    TEST(!cache.read(id, 1, 1, buf, BLOCKSIZE));
+    TEST(cache.read(id, 1, 7, buf, BLOCKSIZE));
+    TEST_EQUAL(buf[0], 7);
+
+    return true;
+}
+
+// Test the brass termfreq cache's lookups and LRU eviction.
+static bool test_termfreqcache1()
+{
+    BrassTermFreqCache cache(2);
+    uint4 id = cache.get_file_id("foo");
+    TEST_NOT_EQUAL(id, 0);
+    TEST_EQUAL(cache.get_file_id("foo"), id);
+    uint4 id2 = cache.get_file_id("bar");
+    TEST_NOT_EQUAL(id2, id);
+
+    Xapian::doccount tf;
+    Xapian::termcount cf;
+    TEST(!cache.read(id, 1, "a", tf, cf));
+    cache.add(id, 1, "a", 3, 7);
+    cache.add(id, 1, "b", 0, 0);
+    TEST_EQUAL(cache.get_size(), 2);
+
+    // Different revision or file shouldn't match.
+    TEST(!cache.read(id, 2, "a", tf, cf));
+    TEST(!cache.read(id2, 1, "a", tf, cf));
+    TEST_EQUAL(cache.get_misses(), 3);
+
+    TEST(cache.read(id, 1, "a", tf, cf));
+    TEST_EQUAL(tf, 3);
+    TEST_EQUAL(cf, 7);
+    // Terms which don't exist are cached too.
+    TEST(cache.read(id, 1, "b", tf, cf));
+    TEST_EQUAL(tf, 0);
+    TEST_EQUAL(cf, 0);
+    TEST_EQUAL(cache.get_hits(), 2);
+
+    // "a" is now least recently used, so adding "c" should evict it.
+    cache.add(id, 2, "c", 1, 1);
+    TEST_EQUAL(cache.get_size(), 2);
+    TEST(!cache.read(id, 1, "a", tf, cf));
+    TEST(cache.read(id, 1, "b", tf, cf));
+    TEST(cache.read(id, 2, "c", tf, cf));
+    TEST_EQUAL(tf, 1);
+
+    // Only ids for recently opened files are remembered, and a forgotten
+    // file gets a new id.
+    for (int i = 0; i != 1024; ++i) cache.get_file_id(str(i));
+    uint4 new_id = cache.get_file_id("foo");
+    TEST_NOT_EQUAL(new_id, 0);
+    TEST_NOT_EQUAL(new_id, id);
+    TEST_NOT_EQUAL(new_id, id2);
+    TEST_EQUAL(cache.get_file_id("foo"), new_id);
+
+    return true;
+}
+#endif
+
+// Test LRUCache's ordering of entries.
+DEFINE_TESTCASE_(lrucache1) {
+    LRUCache<string, int> cache;
+    TEST(cache.empty());
+    cache.insert("a", 1);
+    cache.insert("b", 2);
+    cache.insert("c");
+    TEST_EQUAL(cache.size(), 3);
+    TEST(cache.contains("c"));
+    TEST_EQUAL(*cache.peek("c"), 0);
+    TEST(cache.find("d") == NULL);
+
+    // "a" is the least recently used, until we find it.
+    TEST_STRINGS_EQUAL(cache.back().first, "a");
+    TEST_EQUAL(*cache.find("a"), 1);
+    TEST_STRINGS_EQUAL(cache.back().first, "b");
+    // Peeking doesn't count as a use.
+    *cache.peek("b") = 4;
+    TEST_STRINGS_EQUAL(cache.back().first, "b");
+    TEST_EQUAL(cache.back().second, 4);
+    cache.pop_back();
+    TEST(!cache.contains("b"));
+
+    // Most recently used first.
+    LRUCache<string, int>::iterator i = cache.begin();
+    TEST_STRINGS_EQUAL(i->first, "a");
+    i = cache.erase(i);
+    TEST_STRINGS_EQUAL(i->first, "c");
+    TEST(++i == cache.end());
+    TEST_EQUAL(cache.size(), 1);
+    cache.erase("c");
+    cache.erase("c");
+    TEST(cache.empty());
+
+    cache.insert("x", 1);
+    cache.clear();
+    TEST(cache.empty());
+    TEST(cache.find("x") == NULL);
+
+    return true;
+}
+
+// Test PrefixDictionary enumerating terms by prefix.
+DEFINE_TESTCASE_(prefixdictionary1) {
+    PrefixDictionary dict;
+    vector<TermAndFreq> out;
+    dict.get_terms("", out);
+    TEST(out.empty());
+
+    // Enough terms for several blocks.
+    vector<string> terms;
+    for (unsigned i = 0; i < 100; ++i) {
+	terms.push_back("a" + str(i));
+	terms.push_back("ab" + str(i));
+    }
+    terms.push_back("b");
+    terms.push_back("");
+    sort(terms.begin(), terms.end());
+    for (size_t i = 0; i != terms.size(); ++i) {
+	dict.add(terms[i], Xapian::doccount(i));
+    }
+    TEST_EQUAL(dict.size(), terms.size());
+
+    static const char * const prefixes[] = {
+	"", "a", "a1", "a99", "ab", "ab5", "ab50", "b", "ba", "c", NULL
+    };
+    for (size_t p = 0; prefixes[p]; ++p) {
+	string prefix = prefixes[p];
+	out.clear();
+	dict.get_terms(prefix, out);
+	size_t j = 0;
+	for (size_t i = 0; i != terms.size(); ++i) {
+	    if (!startswith(terms[i], prefix)) continue;
+	    TEST(j < out.size());
+	    TEST_EQUAL(out[j].first, terms[i]);
+	    TEST_EQUAL(out[j].second, i);
+	    ++j;
+	}
+	TEST_EQUAL(j, out.size());
+    }
+    return true;
+}
+
+// Test the wildcard cache's lookups and eviction.
+DEFINE_TESTCASE_(wildcardcache1) {
+    WildcardCache cache(10);
+    vector<TermAndFreq> terms, out;
+    terms.push_back(make_pair(string("abc"), 2));
+    terms.push_back(make_pair(string("abd"), 1));
+    terms.push_back(make_pair(string("acd"), 3));
+
+    TEST(!cache.read("db1", "a", out));
+    cache.add("db1", "a", terms);
+    TEST_EQUAL(cache.get_size(), 3);
+
+    // A different database shouldn't match.
+    TEST(!cache.read("db2", "a", out));
+    TEST_EQUAL(cache.get_misses(), 2);
+
+    TEST(cache.read("db1", "a", out));
+    TEST_EQUAL(out.size(), 3);
+    TEST_EQUAL(out[2].first, "acd");
+    TEST_EQUAL(out[2].second, 3);
+
+    // A longer root can be answered from the entry for "a".
+    out.clear();
+    TEST(cache.read("db1", "ab", out));
+    TEST_EQUAL(out.size(), 2);
+    TEST_EQUAL(out[1].first, "abd");
+    out.clear();
+    TEST(cache.read("db1", "ax", out));
+    TEST(out.empty());
+    TEST_EQUAL(cache.get_hits(), 3);
+    // But a shorter one can't.
+    TEST(!cache.read("db1", "", out));
+
+    // Too large an expansion isn't cached at all.
+    vector<TermAndFreq> big(6, make_pair(string("b"), 1));
+    cache.add("db1", "b", big);
+    TEST(!cache.read("db1", "b", out));
+
+    // Then adding 5 more terms should evict the least recently used entry.
+    cache.add("db2", "a", terms);
+    TEST_EQUAL(cache.get_size(), 6);
+    TEST(cache.read("db2", "a", out));
+    terms.push_back(make_pair(string("ace"), 1));
+    terms.push_back(make_pair(string("acf"), 1));
+    cache.add("db3", "a", terms);
+    TEST_EQUAL(cache.get_size(), 8);
+    TEST(!cache.read("db1", "a", out));
+    TEST(cache.read("db2", "a", out));
+    TEST(cache.read("db3", "a", out));
+
+    return true;
+}
+
+// Check Stream VByte encoding and decoding round trip.
+DEFINE_TESTCASE_(streamvbyte1) {
+    unsigned values[130];
+    for (unsigned i = 0; i < 130; ++i) {
+	// Mix up values needing 1, 2, 3 and 4 bytes.
+	unsigned shift = (i * 7) % 32;
+	values[i] = (i * 2654435761u) >> shift;
+    }
+    values[0] = 0;
+    values[1] = 0xffffffff;
+
+    for (size_t n = 0; n <= 130; ++n) {
+	string s = "x";
+	encode_streamvbyte(s, values, n);
+	// Check decoding from a buffer which ends right after the encoded
+	// data, and from one with more data after it.
+	for (int extra = 0; extra < 2; ++extra) {
+	    string buf = s;
+	    if (extra) buf.append(20, '\xff');
+	    unsigned out[132];
+	    const char * p = buf.data() + 1;
+	    const char * end = buf.data() + buf.size();
+	    const char * r = decode_streamvbyte(p, end, out, n);
+	    TEST(r != NULL);
+	    TEST_EQUAL(size_t(r - buf.data()), s.size());
+	    for (size_t i = 0; i < n; ++i)
+		TEST_EQUAL(out[i], values[i]);
+	}
+	if (n) {
+	    // Truncated data should be detected.
+	    const char * p = s.data() + 1;
+	    unsigned out[132];
+	    TEST(decode_streamvbyte(p, s.data() + s.size() - 1, out, n) == NULL);
+	}
+    }
+    return true;
+}
+
+/// Task for testing WorkerThreads.
+class TestTask : public WorkerTask {
+  public:
+    /// 0 to succeed, 1 to throw a Xapian::Error, 2 to throw something else.
+    int action;
+
+    /// The number of times run() has been called.
+    int runs;
+
+    explicit TestTask(int action_ = 0) : action(action_), runs(0) { }
+
+    void run() {
+	++runs;
+	if (action == 1)
+	    throw Xapian::DatabaseCorruptError("bad", "ctx");
+	if (action == 2)
+	    throw 42;
+    }
+};
+
+// Check WorkerThreads runs every task and passes exceptions back.
+DEFINE_TESTCASE_(workerthreads1) {
+    TestTask tasks[5];
+    WorkerThreads workers;
+    for (size_t i = 0; i != 5; ++i) workers.add(&tasks[i]);
+    TEST_EQUAL(workers.size(), 5);
+    workers.run();
+    for (size_t i = 0; i != 5; ++i) TEST_EQUAL(tasks[i].runs, 1);
+
+    // With fewer threads than tasks, each thread runs several tasks.
+    tasks[3].action = 1;
+    workers.run_and_wait(2);
+    for (size_t i = 0; i != 5; ++i) TEST_EQUAL(tasks[i].runs, 2);
+    tasks[2].rethrow();
+    try {
+	tasks[3].rethrow();
+	FAIL_TEST("Expected DatabaseCorruptError");
+    } catch (const Xapian::DatabaseCorruptError & e) {
+	TEST_STRINGS_EQUAL(e.get_msg(), "bad");
+	TEST_STRINGS_EQUAL(e.get_context(), "ctx");
+    }
+
+    // The exception from the earliest task added wins, and an exception
+    // which isn't a Xapian::Error is reported as an InternalError.
+    tasks[1].action = 2;
+    TEST_EXCEPTION(Xapian::InternalError, workers.run());
+    tasks[1].action = 0;
+    TEST_EXCEPTION(Xapian::DatabaseCorruptError, workers.run());
+    for (size_t i = 0; i != 5; ++i) TEST_EQUAL(tasks[i].runs, 4);
+    return true;
+}
+
+#ifdef XAPIAN_HAS_BRASS_BACKEND
+// Check how a brass cursor decides which blocks to prefetch.
+DEFINE_TESTCASE_(readahead1) {
+    Brass::Cursor cur;
+    uint4 first = 0, count = 0;
+    // The first block read starts a batch of the minimum size.
+    TEST(cur.next_readahead(10, 10000, first, count));
+    TEST_EQUAL(first, 11);
+    TEST_EQUAL(count, READAHEAD_MIN_BLOCKS);
+    // Nothing more is prefetched until half the batch has been read...
+    for (uint4 n = 11; n < 11 + READAHEAD_MIN_BLOCKS / 2; ++n)
+	TEST(!cur.next_readahead(n, 10000, first, count));
+    // ...and then the next batch is twice the size.
+    TEST(cur.next_readahead(11 + READAHEAD_MIN_BLOCKS / 2, 10000,
+			    first, count));
+    TEST_EQUAL(first, 11 + READAHEAD_MIN_BLOCKS);
+    TEST_EQUAL(count, 2 * READAHEAD_MIN_BLOCKS);
+
+    // A long scan stops growing the batch at the maximum size.
+    uint4 n = first;
+    uint4 max_count = 0;
+    while (n < 5000) {
+	if (cur.next_readahead(n, 10000, first, count)) {
+	    TEST_REL(first,>,n);
+	    max_count = std::max(max_count, count);
+	}
+	++n;
+    }
+    TEST_EQUAL(max_count, READAHEAD_MAX_BLOCKS);
+
+    // Jumping back leaves prefetched blocks unused, so the batch shrinks.
+    TEST(cur.next_readahead(100, 10000, first, count));
+    TEST_EQUAL(first, 101);
+    TEST_EQUAL(count, READAHEAD_MAX_BLOCKS / 2);
+
+    // Jumping forward past what's been prefetched doesn't waste anything.
+    TEST(cur.next_readahead(6000, 10000, first, count));
+    TEST_EQUAL(first, 6001);
+    TEST_EQUAL(count, READAHEAD_MAX_BLOCKS / 2);
+
+    // We don't prefetch past the end of the table.
+    Brass::Cursor cur2;
+    TEST(cur2.next_readahead(95, 100, first, count));
+    TEST_EQUAL(first, 96);
+    TEST_EQUAL(count, 4);
+    TEST(!cur2.next_readahead(99, 100, first, count));
+    return true;
+}
+
+// Check compressed tags can be decompressed when split up at any point.
+DEFINE_TESTCASE_(brasscodec1) {
+    string tag;
+    for (unsigned i = 0; i < 50000; ++i) {
+	tag += str((i * 2654435761u) >> 20);
+	tag += ' ';
+    }
+    // This is big enough to need several blocks for LZ4.
+    TEST_REL(tag.size(),>,200000);
+
+    BrassCodec codec(Z_DEFAULT_STRATEGY);
+    for (int c = BRASS_CODEC_ZLIB; c <= BRASS_CODEC_ZSTD; ++c) {
+	if (!BrassCodec::available(c)) continue;
+	tout << BrassCodec::name(c) << endl;
+	string compressed;
+	TEST(codec.compress(c, tag, compressed));
+	TEST_REL(compressed.size(),<,tag.size());
+
+	for (size_t step = 1; step < 20000; step = step * 3 + 7) {
+	    tout << "step " << step << endl;
+	    string result;
+	    BrassStringTagSink sink(result);
+	    codec.decompress_start();
+	    for (size_t i = 0; i < compressed.size(); i += step) {
+		size_t len = std::min(step, compressed.size() - i);
+		codec.decompress_chunk(compressed.data() + i, len, sink);
+	    }
+	    codec.decompress_end(sink);
+	    TEST(result == tag);
+	}
+
+	// A truncated tag should be detected.
+	string result;
+	BrassStringTagSink sink(result);
+	codec.decompress_start();
+	codec.decompress_chunk(compressed.data(), compressed.size() - 3, sink);
+	TEST_EXCEPTION(Xapian::DatabaseCorruptError,
+		       codec.decompress_end(sink));
+    }
+    return true;
+}
+#endif
+
 // Test log2() (which might be our replacement version).
 static bool test_log2()
 {
@@ -315,9 +765,20 @@ static const test_desc tests[] = {
     TESTCASE(class_exceptions_work1),
     TESTCASE(resolverelativepath1),
     TESTCASE(serialisedouble1),
+    TESTCASE(lrucache1),
+    TESTCASE(prefixdictionary1),
+    TESTCASE(wildcardcache1),
+    TESTCASE(streamvbyte1),
+    TESTCASE(workerthreads1),
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
     TESTCASE(serialiselength1),
     TESTCASE(serialiselength2),
+#endif
+#ifdef XAPIAN_HAS_BRASS_BACKEND
+    TESTCASE(blockcache1),
+    TESTCASE(termfreqcache1),
+    TESTCASE(readahead1),
+    TESTCASE(brasscodec1),
 #endif
     TESTCASE(log2),
     END_OF_TESTCASES
@@ -176,6 +176,17 @@ double
 BM25Weight::get_maxpart() const
 {
     LOGCALL(WTCALC, double, "BM25Weight::get_maxpart", NO_ARGS);
+    RETURN(BM25Weight::get_maxpart_for_wdf(get_wdf_upper_bound(), 0));
+}
+
+double
+BM25Weight::get_maxpart_for_wdf(Xapian::termcount wdf_max,
+				Xapian::termcount doclen_min) const
+{
+    LOGCALL(WTCALC, double, "BM25Weight::get_maxpart_for_wdf", wdf_max | doclen_min);
+    wdf_max = min(wdf_max, get_wdf_upper_bound());
+    // If param_k1 is 0, denom would be 0 too.
+    if (wdf_max == 0) RETURN(0.0);
     double denom = param_k1;
     if (param_k1 != 0.0) {
 	if (param_b != 0.0) {
@@ -187,12 +198,16 @@ BM25Weight::get_maxpart() const
 	    // However, we can do better if doclen_min > wdf_max since then a
 	    // better bound can be found by simply evaluating at
 	    // doclen=doclen_min and wdf=wdf_max.
+	    //
+	    // This is also a valid bound for documents with any wdf up to
+	    // wdf_max, since the weight at doclen=max(wdf, doclen_min)
+	    // increases with wdf.
+	    doclen_min = max(doclen_min, get_doclength_lower_bound());
 	    Xapian::doclength normlen_lb =
-		 max(max(get_wdf_upper_bound(), get_doclength_lower_bound()) * len_factor, param_min_normlen);
+		 max(max(wdf_max, doclen_min) * len_factor, param_min_normlen);
 	    denom *= (normlen_lb * param_b + (1 - param_b));
 	}
     }
-    double wdf_max(get_wdf_upper_bound());
     denom += wdf_max;
     AssertRel(denom,>,0);
     RETURN(termweight * (wdf_max / denom));
@@ -150,10 +150,18 @@ TradWeight::get_sumpart(Xapian::termcount wdf, Xapian::termcount len) const
 double
 TradWeight::get_maxpart() const
 {
+    return TradWeight::get_maxpart_for_wdf(get_wdf_upper_bound(), 0);
+}
+
+double
+TradWeight::get_maxpart_for_wdf(Xapian::termcount wdf_max,
+				Xapian::termcount doclen_min) const
+{
+    wdf_max = min(wdf_max, get_wdf_upper_bound());
     // FIXME: need to force non-zero wdf_max to stop percentages breaking...
-    double wdf_max(max(get_wdf_upper_bound(), Xapian::termcount(1)));
-    Xapian::termcount doclen_lb = get_doclength_lower_bound();
-    return termweight * (wdf_max / (doclen_lb * len_factor + wdf_max));
+    double wdf_bound(max(wdf_max, Xapian::termcount(1)));
+    Xapian::termcount doclen_lb = max(doclen_min, get_doclength_lower_bound());
+    return termweight * (wdf_bound / (doclen_lb * len_factor + wdf_bound));
 }
 
 double
@@ -32,6 +32,7 @@
 
 #include "autoptr.h"
 #include <set>
+#include <typeinfo>
 
 using namespace std;
 
@@ -67,6 +68,61 @@ Weight::Internal::operator +=(const Weight::Internal & inc)
     return *this;
 }
 
+void
+Weight::Internal::add_max_parts(const Weight::Internal & inc)
+{
+    if (!inc.have_max_part) return;
+    have_max_part = true;
+    map<string, TermFreqs>::const_iterator i;
+    for (i = inc.termfreqs.begin(); i != inc.termfreqs.end(); ++i) {
+	termfreqs[i->first].max_part += i->second.max_part;
+    }
+}
+
+void
+Weight::Internal::cache_bounds()
+{
+    doclength_lower_bound = db.get_doclength_lower_bound();
+    doclength_upper_bound = db.get_doclength_upper_bound();
+    map<string, TermFreqs>::const_iterator i;
+    for (i = termfreqs.begin(); i != termfreqs.end(); ++i) {
+	wdf_upper_bounds[i->first] = db.get_wdf_upper_bound(i->first);
+    }
+    bounds_cached = true;
+}
+
+Xapian::termcount
+Weight::Internal::get_wdf_upper_bound(const string & term) const
+{
+    if (!bounds_cached) return db.get_wdf_upper_bound(term);
+    map<string, Xapian::termcount>::const_iterator i;
+    i = wdf_upper_bounds.find(term);
+    // The wdf can't exceed the document length, so that's a valid bound for
+    // a term we don't have a cached bound for.
+    if (i == wdf_upper_bounds.end()) return doclength_upper_bound;
+    return i->second;
+}
+
+double
+Weight::Internal::get_maxpart_for_wdf(const Xapian::Weight & wt,
+				      Xapian::termcount wdf_max,
+				      Xapian::termcount doclen_min)
+{
+    // Check the exact type, since a subclass may override get_sumpart().
+    const type_info & type = typeid(wt);
+    if (type == typeid(Xapian::BM25Weight)) {
+	const Xapian::BM25Weight & bm25 =
+	    static_cast<const Xapian::BM25Weight &>(wt);
+	return bm25.get_maxpart_for_wdf(wdf_max, doclen_min);
+    }
+    if (type == typeid(Xapian::TradWeight)) {
+	const Xapian::TradWeight & trad =
+	    static_cast<const Xapian::TradWeight &>(wt);
+	return trad.get_maxpart_for_wdf(wdf_max, doclen_min);
+    }
+    return wt.get_maxpart();
+}
+
 void
 Weight::Internal::accumulate_stats(const Xapian::Database::Internal &subdb,
 				   const Xapian::RSet &rset)
@@ -94,9 +94,22 @@ class Weight::Internal {
      *  collection. */
     std::map<std::string, TermFreqs> termfreqs;
 
+    /** Have the bounds been looked up from db by cache_bounds()?
+     *
+     *  If so, the bounds below are used instead of db.
+     */
+    bool bounds_cached;
+
+    /// Cached bounds on the document length.
+    Xapian::termcount doclength_lower_bound, doclength_upper_bound;
+
+    /// Cached bounds on the wdf of the terms in termfreqs.
+    std::map<std::string, Xapian::termcount> wdf_upper_bounds;
+
     Internal()
 	: total_length(0), collection_size(0), rset_size(0),
-	  total_term_count(0), have_max_part(false) { }
+	  total_term_count(0), have_max_part(false), bounds_cached(false),
+	  doclength_lower_bound(0), doclength_upper_bound(0) { }
 
     /** Add in the supplied statistics from a sub-database.
      *
@@ -105,6 +118,20 @@ class Weight::Internal {
      */
     Internal & operator +=(const Internal & inc);
 
+    /** Return an upper bound on what @a wt's get_sumpart() can return
+     *  for any document in which the term's wdf is at most @a wdf_max and
+     *  whose length is at least @a doclen_min.
+     *
+     *  The matcher uses this to bound the weight of runs of postings where
+     *  the backend knows the largest wdf and a lower bound on the document
+     *  lengths.  BM25Weight and TradWeight give a
+     *  tighter bound than get_maxpart(); for other weighting schemes
+     *  (including subclasses of those two) get_maxpart() is returned.
+     */
+    static double get_maxpart_for_wdf(const Xapian::Weight & wt,
+				      Xapian::termcount wdf_max,
+				      Xapian::termcount doclen_min);
+
     /// Mark the terms we need to collate stats for.
     void mark_wanted_terms(const Xapian::Query &query) {
 	Xapian::TermIterator t;
@@ -186,6 +213,9 @@ class Weight::Internal {
 	i->second.max_part += max_part;
     }
 
+    /// Add in the max_part values from @a inc.
+    void add_max_parts(const Internal & inc);
+
     Xapian::doclength get_average_length() const {
 	if (rare(collection_size == 0)) return 0;
 	return Xapian::doclength(total_length) / collection_size;
@@ -194,6 +224,26 @@ class Weight::Internal {
     /** Set the "bounds" stats from Database @a db. */
     void set_bounds_from_db(const Xapian::Database &db_) { db = db_; }
 
+    /** Look up the bounds from db now, so they can be used without
+     *  accessing db.
+     *
+     *  This is needed before matching sub-databases on several threads,
+     *  since db can't be used from more than one thread at once.
+     */
+    void cache_bounds();
+
+    Xapian::termcount get_doclength_lower_bound() const {
+	if (bounds_cached) return doclength_lower_bound;
+	return db.get_doclength_lower_bound();
+    }
+
+    Xapian::termcount get_doclength_upper_bound() const {
+	if (bounds_cached) return doclength_upper_bound;
+	return db.get_doclength_upper_bound();
+    }
+
+    Xapian::termcount get_wdf_upper_bound(const std::string & term) const;
+
     /// Return a std::string describing this object.
     std::string get_description() const;
 };